@@ -0,0 +1,427 @@
+// Micro benchmarks of the operations the debugger performs at every stop:
+// breakpoint round trips, register and memory access and DWARF lookups.
+//
+//   debugger_bench [--iterations N] [--output file.json]
+//
+// The results are written as JSON, to stdout unless --output is given. All
+// times are in nanoseconds.
+
+#include "nkgt/debug_info.hpp"
+#include "nkgt/debugger.hpp"
+#include "nkgt/maps.hpp"
+#include "nkgt/registers.hpp"
+#include "nkgt/symbols.hpp"
+#include "nkgt/target.hpp"
+#include "nkgt/util.hpp"
+
+#include <fmt/core.h>
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <chrono>
+#include <csignal>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <iterator>
+#include <numeric>
+#include <optional>
+#include <random>
+#include <string>
+#include <string_view>
+#include <sys/ptrace.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+using clock_type = std::chrono::steady_clock;
+
+struct benchmark {
+    std::string name;
+    // Bytes moved by each iteration, 0 when throughput does not apply.
+    std::size_t bytes = 0;
+    std::vector<double> samples;
+};
+
+auto elapsed(clock_type::time_point start, clock_type::time_point end) -> double {
+    return std::chrono::duration<double, std::nano>(end - start).count();
+}
+
+// Runs f iterations times and records how long each run took.
+template<typename F>
+auto measure(std::string name, std::size_t iterations, F&& f, std::size_t bytes = 0) -> benchmark {
+    benchmark b{std::move(name), bytes, {}};
+    b.samples.reserve(iterations);
+
+    for(std::size_t i = 0; i < iterations; ++i) {
+        const auto start = clock_type::now();
+        f();
+        b.samples.push_back(elapsed(start, clock_type::now()));
+    }
+
+    return b;
+}
+
+auto percentile(const std::vector<double>& sorted, double p) -> double {
+    const auto index = static_cast<std::size_t>(p * static_cast<double>(sorted.size() - 1));
+    return sorted[index];
+}
+
+auto write_json(std::FILE* out, std::vector<benchmark>& benchmarks) -> void {
+    fmt::memory_buffer buffer;
+    fmt::format_to(std::back_inserter(buffer), "{{\n  \"benchmarks\": [");
+
+    bool first = true;
+    for(auto& b : benchmarks) {
+        if(b.samples.empty()) {
+            continue;
+        }
+
+        std::sort(b.samples.begin(), b.samples.end());
+        const double sum = std::accumulate(b.samples.begin(), b.samples.end(), 0.0);
+        const double mean = sum / static_cast<double>(b.samples.size());
+        const double median = percentile(b.samples, 0.5);
+
+        fmt::format_to(
+            std::back_inserter(buffer),
+            "{}\n    {{\"name\": \"{}\", \"unit\": \"ns\", \"iterations\": {}, "
+            "\"min\": {:.1f}, \"median\": {:.1f}, \"p99\": {:.1f}, \"max\": {:.1f}, \"mean\": {:.1f}",
+            first ? "" : ",",
+            b.name,
+            b.samples.size(),
+            b.samples.front(),
+            median,
+            percentile(b.samples, 0.99),
+            b.samples.back(),
+            mean
+        );
+
+        if(b.bytes != 0) {
+            // MiB/s at the median.
+            const double throughput = static_cast<double>(b.bytes) / (median / 1e9) / (1 << 20);
+            fmt::format_to(
+                std::back_inserter(buffer),
+                ", \"bytes\": {}, \"throughput_mib_s\": {:.1f}",
+                b.bytes,
+                throughput
+            );
+        }
+
+        fmt::format_to(std::back_inserter(buffer), "}}");
+        first = false;
+    }
+
+    fmt::format_to(std::back_inserter(buffer), "\n  ]\n}}\n");
+    std::fwrite(buffer.data(), 1, buffer.size(), out);
+}
+
+// Starts program traced by this process and waits until it is stopped at its
+// first instruction. Returns -1 on failure.
+auto launch(const char* program, const std::string& argument) -> pid_t {
+    const pid_t pid = fork();
+
+    if(pid == -1) {
+        nkgt::util::print_error_message("fork", errno);
+        return -1;
+    }
+
+    if(pid == 0) {
+        if(ptrace(PTRACE_TRACEME, 0, nullptr, nullptr) == -1) {
+            std::_Exit(EXIT_FAILURE);
+        }
+
+        execl(program, program, argument.c_str(), nullptr);
+        std::_Exit(EXIT_FAILURE);
+    }
+
+    int status = 0;
+    waitpid(pid, &status, 0);
+    if(!WIFSTOPPED(status)) {
+        fmt::print(stderr, "Failed to launch {}.\n", program);
+        return -1;
+    }
+
+    if(ptrace(PTRACE_SETOPTIONS, pid, nullptr, PTRACE_O_EXITKILL) == -1) {
+        nkgt::util::print_error_message("ptrace", errno);
+        return -1;
+    }
+
+    return pid;
+}
+
+// Resumes pid and waits for it to stop. Returns false once it has exited.
+auto resume(pid_t pid) -> bool {
+    if(ptrace(PTRACE_CONT, pid, nullptr, nullptr) == -1) {
+        return false;
+    }
+
+    int status = 0;
+    waitpid(pid, &status, 0);
+    return WIFSTOPPED(status);
+}
+
+auto terminate(pid_t pid) -> void {
+    kill(pid, SIGKILL);
+    waitpid(pid, nullptr, 0);
+}
+
+// Runtime address of the function name of program, which pid is running.
+auto function_address(
+    pid_t pid,
+    const char* program,
+    std::string_view name
+) -> std::optional<std::uintptr_t> {
+    const auto table = nkgt::symbols::load_symbols(program);
+    if(!table) {
+        return std::nullopt;
+    }
+
+    const auto* function = table->find(name);
+    if(function == nullptr) {
+        return std::nullopt;
+    }
+
+    nkgt::maps::address_space address_space(pid);
+    const auto bias = address_space.load_bias(
+        std::filesystem::canonical(program).string(),
+        table->load_base()
+    );
+
+    if(!bias) {
+        return std::nullopt;
+    }
+
+    return function->address + *bias;
+}
+
+// Breakpoint, register and memory benchmarks, on an inferior that calls
+// bench_hit() in a loop with a pointer to a 64 MiB buffer.
+auto bench_live(std::size_t iterations, std::vector<benchmark>& results) -> bool {
+    // One more hit than the measured ones: the first is used for the register
+    // and memory benchmarks.
+    const pid_t pid = launch(LOOP_INFERIOR, std::to_string(iterations + 1));
+    if(pid == -1) {
+        return false;
+    }
+
+    const auto address = function_address(pid, LOOP_INFERIOR, "bench_hit");
+    if(!address) {
+        fmt::print(stderr, "Failed to find bench_hit in {}.\n", LOOP_INFERIOR);
+        terminate(pid);
+        return false;
+    }
+
+    nkgt::target::ptrace_target debugee(pid);
+    std::unordered_map<std::intptr_t, nkgt::debugger::breakpoint> breakpoints;
+    auto& bp = breakpoints[static_cast<std::intptr_t>(*address)];
+    bp.pid = pid;
+    bp.address = static_cast<std::intptr_t>(*address);
+
+    if(!nkgt::debugger::enable_breakpoint(bp) || !resume(pid)) {
+        fmt::print(stderr, "Failed to reach bench_hit.\n");
+        terminate(pid);
+        return false;
+    }
+
+    using nkgt::registers::reg;
+
+    const auto regs = debugee.read_registers();
+    if(!regs) {
+        terminate(pid);
+        return false;
+    }
+
+    const std::uintptr_t buffer_address = regs->rdi;
+    const std::size_t buffer_size = regs->rsi;
+
+    results.push_back(measure("registers/read_all", iterations, [&] {
+        (void)debugee.read_registers();
+    }));
+
+    results.push_back(measure("registers/write_all", iterations, [&] {
+        (void)debugee.write_registers(*regs);
+    }));
+
+    results.push_back(measure("registers/get_rip", iterations, [&] {
+        (void)nkgt::registers::get_register_value(debugee, reg::rip);
+    }));
+
+    results.push_back(measure("registers/set_rax", iterations, [&] {
+        (void)nkgt::registers::set_register_value(debugee, reg::rax, regs->rax);
+    }));
+
+    const reg batch[] = {reg::rip, reg::rsp, reg::rbp, reg::rdi, reg::rsi, reg::rax};
+    uint64_t values[std::size(batch)];
+    results.push_back(measure("registers/read_batch_6", iterations, [&] {
+        (void)nkgt::registers::read_registers(debugee, batch, values, std::size(batch));
+    }));
+
+    results.push_back(measure("registers/read_extended_state", iterations, [&] {
+        debugee.invalidate_caches();
+        (void)debugee.read_extended_state();
+    }));
+
+    std::vector<uint8_t> buffer(16 << 20);
+    for(const std::size_t size : {8ul, 64ul, 4ul << 10, 64ul << 10, 1ul << 20, 16ul << 20}) {
+        // Fewer iterations for the large reads, at least 10.
+        const std::size_t n = std::max<std::size_t>(10, iterations * 4096 / std::max<std::size_t>(size, 4096));
+
+        results.push_back(measure(fmt::format("memory/read_{}", size), n, [&] {
+            (void)debugee.read_memory(buffer_address, buffer.data(), size);
+        }, size));
+    }
+
+    // 256 pages 64 KiB apart, as the pretty printer would fetch the elements
+    // of a linked structure.
+    std::vector<nkgt::target::memory_request> requests;
+    for(std::size_t i = 0; i < 256 && (i + 1) * (64 << 10) <= buffer_size; ++i) {
+        requests.push_back({buffer_address + i * (64 << 10), buffer.data() + i * 4096, 4096});
+    }
+
+    results.push_back(measure("memory/read_scatter_256x4096", iterations, [&] {
+        (void)debugee.read_memory_scatter(requests.data(), requests.size());
+    }, requests.size() * 4096));
+
+    // Each hit is split in stepping over the breakpoint and running to the
+    // next one, to tell the cost of the single step from the one of the
+    // context switches.
+    benchmark round_trip{"breakpoint/round_trip", 0, {}};
+    benchmark step_over{"breakpoint/step_over", 0, {}};
+    benchmark resume_to_hit{"breakpoint/continue", 0, {}};
+
+    for(std::size_t i = 0; i < iterations; ++i) {
+        const auto start = clock_type::now();
+        if(!nkgt::debugger::step_over_breakpoint(debugee, breakpoints)) {
+            break;
+        }
+
+        const auto stepped = clock_type::now();
+        if(!resume(pid)) {
+            break;
+        }
+
+        debugee.invalidate_caches();
+        const auto end = clock_type::now();
+
+        round_trip.samples.push_back(elapsed(start, end));
+        step_over.samples.push_back(elapsed(start, stepped));
+        resume_to_hit.samples.push_back(elapsed(stepped, end));
+    }
+
+    results.push_back(std::move(round_trip));
+    results.push_back(std::move(step_over));
+    results.push_back(std::move(resume_to_hit));
+
+    terminate(pid);
+    return true;
+}
+
+// PC to function and PC to line lookups on a program with thousands of
+// functions.
+auto bench_dwarf(std::size_t iterations, std::vector<benchmark>& results) -> bool {
+    const auto table = nkgt::symbols::load_symbols(MANY_FUNCTIONS_INFERIOR);
+    if(!table || table->functions().empty()) {
+        fmt::print(stderr, "Failed to read the symbols of {}.\n", MANY_FUNCTIONS_INFERIOR);
+        return false;
+    }
+
+    auto info = nkgt::debug_info::load_debug_info(MANY_FUNCTIONS_INFERIOR);
+    if(!info) {
+        fmt::print(stderr, "Failed to read the debug info of {}.\n", MANY_FUNCTIONS_INFERIOR);
+        return false;
+    }
+
+    const auto& functions = table->functions();
+    std::mt19937_64 generator(42);
+    std::uniform_int_distribution<std::size_t> pick(0, functions.size() - 1);
+
+    std::vector<uint64_t> pcs(iterations);
+    for(auto& pc : pcs) {
+        const auto& f = functions[pick(generator)];
+        pc = f.address + (f.size > 1 ? f.size / 2 : 0);
+    }
+
+    // The first lookups build the indices.
+    results.push_back(measure("dwarf/function_index_build", 1, [&] {
+        (void)(*info)->function_at(pcs.front());
+    }));
+
+    results.push_back(measure("dwarf/line_table_build", 1, [&] {
+        (void)(*info)->line_at(pcs.front());
+    }));
+
+    std::size_t i = 0;
+    results.push_back(measure("dwarf/function_at", iterations, [&] {
+        (void)(*info)->function_at(pcs[i++ % pcs.size()]);
+    }));
+
+    i = 0;
+    results.push_back(measure("dwarf/line_at", iterations, [&] {
+        (void)(*info)->line_at(pcs[i++ % pcs.size()]);
+    }));
+
+    i = 0;
+    results.push_back(measure("symbols/lookup", iterations, [&] {
+        (void)table->lookup(pcs[i++ % pcs.size()]);
+    }));
+
+    return true;
+}
+
+auto print_usage() -> void {
+    fmt::print(stderr, "Usage: debugger_bench [--iterations N] [--output file.json]\n");
+}
+
+}
+
+int main(int argc, const char** argv) {
+    std::size_t iterations = 10000;
+    const char* output_path = nullptr;
+
+    for(int i = 1; i < argc; ++i) {
+        const std::string_view argument = argv[i];
+
+        if(argument == "--iterations" && i + 1 < argc) {
+            const std::string_view value = argv[++i];
+            const auto [end, ec] = std::from_chars(value.data(), value.data() + value.size(), iterations);
+            if(ec != std::errc{} || end != value.data() + value.size() || iterations == 0) {
+                print_usage();
+                return EXIT_FAILURE;
+            }
+        } else if(argument == "--output" && i + 1 < argc) {
+            output_path = argv[++i];
+        } else {
+            print_usage();
+            return EXIT_FAILURE;
+        }
+    }
+
+    std::FILE* out = stdout;
+    if(output_path != nullptr) {
+        out = std::fopen(output_path, "w");
+        if(out == nullptr) {
+            nkgt::util::print_error_message("fopen", errno);
+            return EXIT_FAILURE;
+        }
+    } else {
+        // The library reports progress on stdout: move it to stderr so that
+        // stdout only has the JSON.
+        out = fdopen(dup(STDOUT_FILENO), "w");
+        dup2(STDERR_FILENO, STDOUT_FILENO);
+    }
+
+    std::vector<benchmark> results;
+    const bool live = bench_live(iterations, results);
+    const bool dwarf = bench_dwarf(iterations, results);
+
+    write_json(out, results);
+    std::fclose(out);
+
+    return live && dwarf ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,39 @@
+# Writes to OUTPUT a program with FUNCTION_COUNT functions, all of them called
+# from main through a table so that none of them is discarded.
+#
+#   cmake -DOUTPUT=file.cpp -DFUNCTION_COUNT=10000 -P generate_functions.cmake
+
+if(NOT DEFINED OUTPUT OR NOT DEFINED FUNCTION_COUNT)
+    message(FATAL_ERROR "OUTPUT and FUNCTION_COUNT must be defined")
+endif()
+
+math(EXPR LAST "${FUNCTION_COUNT} - 1")
+
+set(functions "")
+set(table "")
+foreach(i RANGE ${LAST})
+    string(APPEND functions
+        "__attribute__((noinline)) int function_${i}(int x) {\n"
+        "    int y = x * ${i};\n"
+        "    return y + ${i};\n"
+        "}\n\n"
+    )
+    string(APPEND table "    function_${i},\n")
+endforeach()
+
+file(WRITE ${OUTPUT}.tmp
+    "// Generated by generate_functions.cmake, do not edit.\n\n"
+    "${functions}"
+    "using function_type = int (*)(int);\n\n"
+    "static const function_type functions[] = {\n"
+    "${table}"
+    "};\n\n"
+    "int main(int argc, char**) {\n"
+    "    int result = 0;\n"
+    "    for(const auto f : functions) {\n"
+    "        result += f(argc);\n"
+    "    }\n"
+    "    return result == 0 ? 1 : 0;\n"
+    "}\n"
+)
+file(RENAME ${OUTPUT}.tmp ${OUTPUT})
@@ -0,0 +1,27 @@
+#include <cstdlib>
+#include <cstring>
+
+// The debugger places its breakpoint here. The buffer is passed in so that the
+// debugger can find it in rdi and rsi at the first hit.
+extern "C" __attribute__((noinline)) void bench_hit(const unsigned char* buffer, unsigned long size) {
+    asm volatile("" : : "r"(buffer), "r"(size) : "memory");
+}
+
+int main(int argc, char** argv) {
+    const unsigned long iterations = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000;
+    const unsigned long size = 64ul << 20;
+
+    auto* buffer = static_cast<unsigned char*>(std::malloc(size));
+    if(buffer == nullptr) {
+        return 1;
+    }
+
+    std::memset(buffer, 0x5a, size);
+
+    for(unsigned long i = 0; i < iterations; ++i) {
+        bench_hit(buffer, size);
+    }
+
+    std::free(buffer);
+    return 0;
+}
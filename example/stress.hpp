@@ -0,0 +1,54 @@
+#pragma once
+// Protocol between the stress test inferiors and tests/stress_tests.cpp.
+//
+// The test places a breakpoint on stress_hit(). At every hit it writes
+// stress_slot_value(i) to *slot and sets the third argument to
+// stress_reply(i), which stress_hit() returns. stress_round() checks both, so
+// the inferior fails as soon as a memory or register write of the debugger
+// is lost or lands in the wrong place.
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+
+inline uint64_t stress_slot_value(uint64_t i) {
+    return i * 0x9e3779b97f4a7c15u;
+}
+
+inline uint64_t stress_reply(uint64_t i) {
+    return ~i;
+}
+
+extern "C" __attribute__((noinline)) uint64_t stress_hit(uint64_t* slot, uint64_t i, uint64_t reply) {
+    asm volatile("" : "+r"(reply) : "r"(slot), "r"(i) : "memory");
+    return reply;
+}
+
+// Returns false when the debugger did not answer as expected.
+inline bool stress_round(uint64_t i) {
+    volatile uint64_t slot = 0;
+    const uint64_t reply = stress_hit(const_cast<uint64_t*>(&slot), i, 0);
+    return slot == stress_slot_value(i) && reply == stress_reply(i);
+}
+
+// Work that does not involve the debugger, whose result is known: the sum of
+// the lengths of the Collatz sequences starting below limit.
+__attribute__((noinline)) inline uint64_t stress_work(uint64_t limit) {
+    uint64_t total = 0;
+    for(uint64_t n = 1; n < limit; ++n) {
+        for(uint64_t x = n; x != 1; x = x % 2 == 0 ? x / 2 : 3 * x + 1) {
+            ++total;
+        }
+    }
+
+    return total;
+}
+
+inline uint64_t stress_iterations(int argc, char** argv) {
+    return argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1000;
+}
+
+inline int stress_fail(const char* what, uint64_t i) {
+    std::fprintf(stderr, "%s at iteration %llu\n", what, static_cast<unsigned long long>(i));
+    return EXIT_FAILURE;
+}
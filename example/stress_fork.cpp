@@ -0,0 +1,40 @@
+// Stress test inferior: forks a child every few calls to stress_hit(). The
+// children are not traced and inherit the breakpoint, so they must not reach
+// it: they only check that the rest of the code is intact.
+
+#include "stress.hpp"
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+int main(int argc, char** argv) {
+    const uint64_t iterations = stress_iterations(argc, argv);
+    constexpr uint64_t limit = 100;
+    const uint64_t expected = stress_work(limit);
+
+    for(uint64_t i = 0; i < iterations; ++i) {
+        if(!stress_round(i)) {
+            return stress_fail("Wrong answer of the debugger", i);
+        }
+
+        if(i % 16 != 0) {
+            continue;
+        }
+
+        const pid_t child = fork();
+        if(child == -1) {
+            return stress_fail("fork failed", i);
+        }
+
+        if(child == 0) {
+            _exit(stress_work(limit) == expected ? 42 : 1);
+        }
+
+        int status = 0;
+        if(waitpid(child, &status, 0) != child || !WIFEXITED(status) || WEXITSTATUS(status) != 42) {
+            return stress_fail("Wrong result of a child", i);
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
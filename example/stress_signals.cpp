@@ -0,0 +1,80 @@
+// Stress test inferior: raises signals between calls to stress_hit(), which
+// is called from the SIGUSR1 handler too, on an alternate stack. The debugger
+// has to deliver SIGUSR1 and SIGUSR2 for the counts to match.
+
+#include "stress.hpp"
+
+#include <csignal>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+volatile sig_atomic_t usr1_count = 0;
+volatile sig_atomic_t usr2_count = 0;
+volatile sig_atomic_t handler_failures = 0;
+
+void on_usr1(int) {
+    // Iterations of the handler are told apart by their top bit.
+    if(!stress_round((uint64_t{1} << 63) | static_cast<uint64_t>(usr1_count))) {
+        handler_failures = handler_failures + 1;
+    }
+
+    usr1_count = usr1_count + 1;
+}
+
+void on_usr2(int) {
+    usr2_count = usr2_count + 1;
+}
+
+}
+
+int main(int argc, char** argv) {
+    const uint64_t iterations = stress_iterations(argc, argv);
+
+    std::vector<char> stack(1 << 16);
+    stack_t alternate = {};
+    alternate.ss_sp = stack.data();
+    alternate.ss_size = stack.size();
+    if(sigaltstack(&alternate, nullptr) == -1) {
+        return stress_fail("sigaltstack failed", 0);
+    }
+
+    struct sigaction action = {};
+    action.sa_handler = on_usr1;
+    action.sa_flags = SA_ONSTACK;
+    sigaction(SIGUSR1, &action, nullptr);
+    action.sa_handler = on_usr2;
+    action.sa_flags = 0;
+    sigaction(SIGUSR2, &action, nullptr);
+
+    uint64_t usr1_expected = 0;
+    uint64_t usr2_expected = 0;
+
+    for(uint64_t i = 0; i < iterations; ++i) {
+        if(!stress_round(i)) {
+            return stress_fail("Wrong answer of the debugger", i);
+        }
+
+        // SIGUSR1 every 3 iterations, SIGUSR2 every 2.
+        if(i % 3 == 0) {
+            raise(SIGUSR1);
+            ++usr1_expected;
+        }
+
+        if(i % 2 == 0) {
+            raise(SIGUSR2);
+            ++usr2_expected;
+        }
+    }
+
+    if(handler_failures != 0) {
+        return stress_fail("Wrong answer of the debugger in the signal handler", iterations);
+    }
+
+    if(static_cast<uint64_t>(usr1_count) != usr1_expected || static_cast<uint64_t>(usr2_count) != usr2_expected) {
+        return stress_fail("Lost signals", iterations);
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,46 @@
+// Stress test inferior: the main thread calls stress_hit() while worker
+// threads, which the debugger does not trace, run code next to it.
+
+#include "stress.hpp"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+int main(int argc, char** argv) {
+    const uint64_t iterations = stress_iterations(argc, argv);
+    constexpr uint64_t limit = 2000;
+    const uint64_t expected = stress_work(limit);
+
+    std::atomic<bool> done = false;
+    std::atomic<uint64_t> mismatches = 0;
+    std::vector<std::thread> workers;
+
+    for(int t = 0; t < 4; ++t) {
+        workers.emplace_back([&] {
+            while(!done.load(std::memory_order_relaxed)) {
+                if(stress_work(limit) != expected) {
+                    mismatches.fetch_add(1);
+                }
+            }
+        });
+    }
+
+    for(uint64_t i = 0; i < iterations; ++i) {
+        if(!stress_round(i)) {
+            done = true;
+            for(auto& w : workers) {
+                w.join();
+            }
+
+            return stress_fail("Wrong answer of the debugger", i);
+        }
+    }
+
+    done = true;
+    for(auto& w : workers) {
+        w.join();
+    }
+
+    return mismatches == 0 ? EXIT_SUCCESS : stress_fail("Wrong result of a worker", iterations);
+}
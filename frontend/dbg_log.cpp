@@ -0,0 +1,234 @@
+#include <algorithm>
+#include <charconv>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+#include <fmt/core.h>
+
+#include "nkgt/event_log.hpp"
+#include "nkgt/registers.hpp"
+#include "nkgt/stats.hpp"
+
+namespace el = nkgt::event_log;
+
+namespace {
+
+struct options {
+    std::string_view path;
+    // Empty to keep every type.
+    std::vector<el::event> types;
+    std::optional<uint64_t> address;
+    std::optional<uint32_t> thread;
+    bool registers = false;
+    bool summary = false;
+};
+
+[[nodiscard]]
+auto parse_number(std::string_view text) -> std::optional<uint64_t> {
+    const bool hex = text.substr(0, 2) == "0x";
+    text.remove_prefix(hex ? 2 : 0);
+
+    uint64_t value = 0;
+    const auto [end, ec] = std::from_chars(text.data(), text.data() + text.size(), value, hex ? 16 : 10);
+    if(ec != std::errc() || end != text.data() + text.size()) {
+        return std::nullopt;
+    }
+
+    return value;
+}
+
+[[nodiscard]]
+auto parse_options(int argc, const char** argv) -> std::optional<options> {
+    options o;
+
+    for(int i = 1; i < argc; ++i) {
+        const std::string_view arg(argv[i]);
+        const bool has_value = i + 1 < argc;
+
+        if(arg == "--type" && has_value) {
+            const auto type = el::from_string(argv[++i]);
+            if(!type) {
+                fmt::print("Unknown event type {}.\n", argv[i]);
+                return std::nullopt;
+            }
+
+            o.types.push_back(*type);
+        } else if(arg == "--address" && has_value) {
+            o.address = parse_number(argv[++i]);
+            if(!o.address) {
+                return std::nullopt;
+            }
+        } else if(arg == "--thread" && has_value) {
+            const auto thread = parse_number(argv[++i]);
+            if(!thread) {
+                return std::nullopt;
+            }
+
+            o.thread = static_cast<uint32_t>(*thread);
+        } else if(arg == "--registers") {
+            o.registers = true;
+        } else if(arg == "--summary") {
+            o.summary = true;
+        } else if(o.path.empty() && arg.substr(0, 2) != "--") {
+            o.path = arg;
+        } else {
+            return std::nullopt;
+        }
+    }
+
+    if(o.path.empty()) {
+        return std::nullopt;
+    }
+
+    return o;
+}
+
+[[nodiscard]]
+auto matches(const options& o, const el::record& r) -> bool {
+    return (o.types.empty() || std::find(o.types.cbegin(), o.types.cend(), r.type) != o.types.cend()) &&
+           (!o.address || *o.address == r.address) &&
+           (!o.thread || *o.thread == r.thread);
+}
+
+auto print_event(const el::record& r, uint64_t origin_ns) -> void {
+    fmt::print(
+        "{:>14.6f}  {:>7}  {:<10}  {:#018x}",
+        static_cast<double>(r.time_ns - origin_ns) / 1e9,
+        r.thread,
+        el::to_string(r.type),
+        r.address
+    );
+
+    switch(r.type) {
+    case el::event::breakpoint:
+    case el::event::timer:
+        fmt::print("  ran {}", nkgt::stats::format_duration(r.values[0]));
+        break;
+    case el::event::skipped:
+        fmt::print(
+            "  ran {}, condition {}",
+            nkgt::stats::format_duration(r.values[0]),
+            nkgt::stats::format_duration(r.values[1])
+        );
+        break;
+    case el::event::signal:
+        fmt::print("  {} ({})", strsignal(static_cast<int>(r.values[0])), r.values[0]);
+        break;
+    case el::event::exit:
+        if(r.values[1] != 0) {
+            fmt::print("  killed by {} ({})", strsignal(static_cast<int>(r.values[0])), r.values[0]);
+        } else {
+            fmt::print("  status {}", r.values[0]);
+        }
+        break;
+    case el::event::library:
+    case el::event::registers:
+        break;
+    }
+
+    fmt::print("\n");
+}
+
+auto print_registers(const user_regs_struct& regs) -> void {
+    for(std::size_t i = 0; i < nkgt::registers::register_count; ++i) {
+        const auto r = static_cast<nkgt::registers::reg>(i);
+        fmt::print(
+            "{}{:>8} {:#018x}",
+            i % 4 == 0 ? "    " : "  ",
+            nkgt::registers::descriptor(r).name,
+            nkgt::registers::get_register_value(regs, r)
+        );
+
+        if(i % 4 == 3 || i + 1 == nkgt::registers::register_count) {
+            fmt::print("\n");
+        }
+    }
+}
+
+// Prints the matching events in order, each one followed by its register
+// snapshot if requested.
+auto render(const options& o, const std::vector<el::record>& records) -> void {
+    if(records.empty()) {
+        return;
+    }
+
+    const uint64_t origin_ns = records.front().time_ns;
+    bool shown = false;
+
+    for(std::size_t i = 0; i < records.size(); ++i) {
+        const auto& r = records[i];
+
+        if(r.type != el::event::registers) {
+            shown = matches(o, r);
+            if(shown) {
+                print_event(r, origin_ns);
+            }
+        } else if(shown && o.registers && r.part == 0) {
+            const auto regs = el::snapshot_registers(&r, records.size() - i);
+            if(regs) {
+                print_registers(*regs);
+            }
+        }
+    }
+}
+
+auto print_summary(const options& o, const std::vector<el::record>& records) -> void {
+    std::vector<el::record> selected;
+    std::copy_if(records.cbegin(), records.cend(), std::back_inserter(selected), [&](const auto& r) {
+        return matches(o, r);
+    });
+
+    fmt::print(
+        "{:<10}  {:<18}  {:>10}  {:>10}  {:>10}  {:>12}\n",
+        "event", "address", "count", "mean run", "condition", "span"
+    );
+
+    for(const auto& s : el::summarize(selected)) {
+        fmt::print(
+            "{:<10}  {:#018x}  {:>10}  {:>10}  {:>10}  {:>12}\n",
+            el::to_string(s.type),
+            s.address,
+            s.count,
+            s.total_run_ns == 0 ? "-" : nkgt::stats::format_duration(s.total_run_ns / s.count),
+            s.total_condition_ns == 0 ? "-" : nkgt::stats::format_duration(s.total_condition_ns / s.count),
+            nkgt::stats::format_duration(s.last_ns - s.first_ns)
+        );
+    }
+}
+
+}
+
+// Decoder of the event logs written by the log command of dbg.
+int main(int argc, const char** argv) {
+    const auto o = parse_options(argc, argv);
+    if(!o) {
+        fmt::print(
+            "Usage: {} [--type event]... [--address address] [--thread tid] [--registers] [--summary] log_file\n"
+            "Events: breakpoint, skipped, timer, library, signal, exit.\n",
+            argv[0]
+        );
+        return EXIT_FAILURE;
+    }
+
+    const auto contents = el::read(std::string(o->path));
+    if(!contents) {
+        fmt::print("Failed to read the event log {}.\n", o->path);
+        return EXIT_FAILURE;
+    }
+
+    if(contents->written > contents->capacity) {
+        fmt::print("{} records overwritten, the log starts later.\n", contents->written - contents->capacity);
+    }
+
+    if(o->summary) {
+        print_summary(*o, contents->records);
+    } else {
+        render(*o, contents->records);
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -1,34 +1,18 @@
+#include <cstdio>
 #include <filesystem>
 namespace fs = std::filesystem;
 #include <fstream>
-#include <sys/personality.h>
-#include <sys/ptrace.h>
-#include <sys/types.h>
-#include <unistd.h>
+#include <string>
+#include <string_view>
+#include <vector>
 
 #include <fmt/core.h>
 #include <fmt/std.h>
 
 #include "nkgt/debugger.hpp"
+#include "nkgt/process.hpp"
 #include "nkgt/util.hpp"
 
-static void execute_debugee(const char* program_name) {
-    if(personality(ADDR_NO_RANDOMIZE) == -1) {
-        nkgt::util::print_error_message("personality", errno);
-        std::exit(EXIT_FAILURE);
-    }
-
-    if(ptrace(PTRACE_TRACEME, 0, nullptr, nullptr) == -1) {
-        nkgt::util::print_error_message("ptrace", errno);
-        std::exit(EXIT_FAILURE);
-    }
-
-    if(execl(program_name, program_name, nullptr) == -1) {
-        nkgt::util::print_error_message("execl", errno);
-        std::exit(EXIT_FAILURE);
-    }
-}
-
 // Basic check for the input file validity.
 // Just for safety, we accept only ELF executable as debugee. As per elf(3), a
 // ELF executable will start with a magic number formed by the bytes 0x7f, 'E',
@@ -66,22 +50,81 @@ int main(int argc, const char** argv) {
         return -1;
     }
 
-    const fs::path program_path(argv[1]);
-    if(!is_file_valid(program_path)) {
-        fmt::print("The file {} does not exists or is not a regular file.\n", program_path);
+    // dbg --core core_file program
+    if(std::string_view(argv[1]) == "--core") {
+        if(argc < 4) {
+            fmt::print("Usage: {} --core core_file program\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+
+        const fs::path core_path(argv[2]);
+        const fs::path program_path(argv[3]);
+        if(!is_file_valid(core_path) || !is_file_valid(program_path)) {
+            fmt::print("The files {} and {} must be existing ELF files.\n", core_path, program_path);
+            return EXIT_FAILURE;
+        }
+
+        nkgt::debugger::run_core(core_path, program_path);
+        return EXIT_SUCCESS;
+    }
+
+    // dbg [--server address | -x script | --batch] program [arguments...]
+    // --batch reads the commands from the standard input.
+    const std::string_view mode(argv[1]);
+    const bool server = mode == "--server";
+    const bool script = mode == "-x";
+    const bool batch = mode == "--batch";
+    const int program_index = server || script ? 3 : batch ? 2 : 1;
+
+    if(argc <= program_index) {
+        fmt::print(
+            "Usage: {} [--server socket_path|[host]:port | -x script | --batch] program [arguments...]\n",
+            argv[0]
+        );
         return EXIT_FAILURE;
     }
 
-    pid_t pid = fork();
+    const nkgt::process::launch_options options = {
+        argv[program_index],
+        std::vector<std::string>(argv + program_index + 1, argv + argc),
+        nkgt::process::current_environment()
+    };
 
-    if(pid == 0) {
-        execute_debugee(program_path.c_str());
-    } else if(pid >= 1) {
-        nkgt::debugger::run(pid, program_path);
+    if(!is_file_valid(options.program)) {
+        fmt::print("The file {} does not exists or is not a regular file.\n", options.program);
+        return EXIT_FAILURE;
+    }
+
+    std::FILE* commands = batch ? stdin : nullptr;
+    if(script) {
+        commands = std::fopen(argv[2], "r");
+        if(commands == nullptr) {
+            nkgt::util::print_error_message("fopen", errno);
+            return EXIT_FAILURE;
+        }
+    }
+
+    // Nobody is reading the output as it is produced, so it is written in
+    // large blocks instead of line by line.
+    if(commands != nullptr) {
+        std::setvbuf(stdout, nullptr, _IOFBF, 1 << 16);
+    }
+
+    const auto pid = nkgt::process::launch(options);
+
+    if(!pid) {
+        fmt::print("Failed to start {}.\n", options.program);
+    } else if(server) {
+        nkgt::debugger::run_server(*pid, argv[2]);
+    } else if(commands != nullptr) {
+        nkgt::debugger::run_batch(*pid, options, commands);
     } else {
-        nkgt::util::print_error_message("fork", errno);
-        return -1;
+        nkgt::debugger::run(*pid, options);
+    }
+
+    if(script) {
+        std::fclose(commands);
     }
 
-    return EXIT_SUCCESS;
+    return pid ? EXIT_SUCCESS : EXIT_FAILURE;
 }
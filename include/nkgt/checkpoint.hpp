@@ -0,0 +1,25 @@
+#pragma once
+#include "nkgt/error_codes.hpp"
+#include "nkgt/target.hpp"
+
+#include <tl/expected.hpp>
+
+#include <sys/types.h>
+
+namespace nkgt::checkpoint {
+
+// Makes the stopped debugee call fork(2) by temporarily replacing the
+// instruction at the program counter with a syscall. The child is a copy on
+// write clone of the debugee, so its cost is only the pages that are written
+// afterwards by either of the two processes.
+//
+// On success the registers and the code of both processes are exactly the ones
+// the debugee had before the call and the child is returned stopped and traced
+// by the calling thread. Breakpoints are inherited by the child since its
+// memory is a copy of the one of the debugee.
+[[nodiscard]]
+auto fork_debugee(
+    target::target& debugee
+) -> tl::expected<pid_t, error::checkpoint>;
+
+}
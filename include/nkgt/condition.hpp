@@ -0,0 +1,88 @@
+#pragma once
+#include "nkgt/error_codes.hpp"
+#include "nkgt/target.hpp"
+
+#include <tl/expected.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <sys/user.h>
+#include <vector>
+
+namespace nkgt::condition {
+
+// Most registers and memory operands a condition can use. Evaluation works on
+// fixed arrays of this size, so it never allocates.
+constexpr std::size_t max_registers = 16;
+constexpr std::size_t max_loads = 8;
+
+enum class opcode : uint8_t {
+    constant,     // r[dst] = constants[operand]
+    reg,          // r[dst] = register at offset operand in user_regs_struct
+    load,         // r[dst] = 8 bytes read at addresses[operand]
+    address,      // addresses[operand] = r[a]
+    add, sub, mul, div, mod,
+    bit_and, bit_or, bit_xor, shl, shr,
+    eq, ne, lt, le, gt, ge,
+    logical_and, logical_or,
+    neg, bit_not, logical_not,
+    skip_if_false,  // if r[a] == 0, r[dst] = 0 and skip operand instructions
+    skip_if_true,   // if r[a] != 0, r[dst] = 1 and skip operand instructions
+};
+
+struct instruction {
+    opcode op;
+    uint8_t dst;
+    uint8_t a;
+    uint8_t b;
+    uint32_t operand;
+};
+
+// Breakpoint condition compiled to code for a small register machine. The
+// code runs in two phases: the first one computes the address of every memory
+// operand, which are then read with a single scatter read, and the second one
+// computes the value of the condition in r[0].
+//
+// As in C, && and || skip their right operand when the left one decides the
+// result. A memory operand that cannot be read, or whose address divides by
+// zero, is only an error if the second phase uses its value, so that guards
+// like rdi != 0 && *rdi == 5 work.
+class program {
+public:
+    // Evaluates the condition with the registers of the stopped debugee. Only
+    // reads memory if the condition has memory operands.
+    [[nodiscard]]
+    auto evaluate(
+        const user_regs_struct& regs,
+        target::target& debugee
+    ) const -> tl::expected<bool, error::condition>;
+
+    [[nodiscard]]
+    auto source() const -> const std::string& { return source_; }
+
+    // Number of instructions of both phases.
+    [[nodiscard]]
+    auto size() const -> std::size_t { return addresses_.size() + code_.size(); }
+
+private:
+    friend class compiler;
+
+    std::string source_;
+    std::vector<instruction> addresses_;
+    std::vector<instruction> code_;
+    std::vector<uint64_t> constants_;
+    std::size_t loads_ = 0;
+};
+
+// Compiles a C-like expression over unsigned 64-bit integers. The operands are
+// numbers (decimal or 0x hexadecimal), register names (optionally prefixed by
+// $) and *expression, the 8 bytes at an address. The address of a memory
+// operand cannot itself read memory.
+//
+// Example: compile("rdi == 0x42 && *(rsp + 8) != 0")
+[[nodiscard]]
+auto compile(std::string_view expression) -> tl::expected<program, error::condition>;
+
+}
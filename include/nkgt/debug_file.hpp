@@ -0,0 +1,127 @@
+#pragma once
+#include "nkgt/error_codes.hpp"
+
+#include <tl/expected.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <elf.h>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace nkgt::debug_file {
+
+// Contents of the .gnu_debuglink section: the name of the file holding the
+// debug information and the CRC-32 of its whole content.
+struct debuglink {
+    std::string name;
+    uint32_t crc;
+};
+
+// Read only view of a whole 64-bit ELF file, backed by a private mapping of
+// the file. Section contents are pointers into the mapping, so they are only
+// paged in when they are read, and stay valid as long as the elf_file lives.
+class elf_file {
+public:
+    elf_file(const elf_file&) = delete;
+    elf_file& operator=(const elf_file&) = delete;
+    ~elf_file();
+
+    // All the section headers, the null section at index 0 included.
+    [[nodiscard]]
+    auto sections() const -> const std::vector<Elf64_Shdr>& { return sections_; }
+
+    // Name of the section, empty when it is not in the string table.
+    [[nodiscard]]
+    auto section_name(const Elf64_Shdr& section) const -> std::string_view;
+
+    // Returns the first section called name, or nullptr.
+    [[nodiscard]]
+    auto find_section(std::string_view name) const -> const Elf64_Shdr*;
+
+    // Returns the content of section, or nullptr for SHT_NOBITS sections and
+    // sections that do not fit in the file.
+    [[nodiscard]]
+    auto contents(const Elf64_Shdr& section) const -> const std::byte*;
+
+    // Returns the GNU build-id of the file, empty if it has none.
+    [[nodiscard]]
+    auto build_id() const -> std::vector<uint8_t>;
+
+    // Returns the content of .gnu_debuglink, if the file has one.
+    [[nodiscard]]
+    auto link() const -> std::optional<debuglink>;
+
+    // True when the DWARF information is in this file, false if the file has
+    // been stripped or its .debug_info has been split off to a separate file.
+    [[nodiscard]]
+    auto has_debug_info() const -> bool;
+
+    [[nodiscard]]
+    auto data() const -> const std::byte* { return data_; }
+
+    [[nodiscard]]
+    auto size() const -> std::size_t { return size_; }
+
+    [[nodiscard]]
+    auto path() const -> const std::filesystem::path& { return path_; }
+
+private:
+    friend auto open_elf(
+        const std::filesystem::path& path
+    ) -> tl::expected<std::unique_ptr<elf_file>, error::debug_file>;
+
+    elf_file(std::filesystem::path path, const std::byte* data, std::size_t size)
+        : path_(std::move(path)), data_(data), size_(size) {}
+
+    std::filesystem::path path_;
+    const std::byte* data_;
+    std::size_t size_;
+    std::vector<Elf64_Shdr> sections_;
+    const Elf64_Shdr* names_ = nullptr;
+};
+
+// Maps the ELF file at path. Only 64-bit little endian files are accepted.
+[[nodiscard]]
+auto open_elf(
+    const std::filesystem::path& path
+) -> tl::expected<std::unique_ptr<elf_file>, error::debug_file>;
+
+// CRC-32 used by .gnu_debuglink (the one of zlib). crc is the value returned
+// for the previous part of the data, so that a file can be checksummed in
+// chunks.
+[[nodiscard]]
+auto crc32(const std::byte* data, std::size_t size, uint32_t crc = 0) -> uint32_t;
+
+// Where the debug file of the given build-id is installed under root, e.g.
+// root/.build-id/ab/cdef0123.debug.
+[[nodiscard]]
+auto build_id_path(const std::filesystem::path& root, const std::vector<uint8_t>& build_id) -> std::filesystem::path;
+
+// Default directory separate debug files are installed in.
+inline const std::filesystem::path default_debug_root = "/usr/lib/debug";
+
+// Looks for the debug file named by link for the program at program_path,
+// next to the program, in its .debug subdirectory and in the same directory
+// under each root. Candidates whose CRC-32 does not match are skipped.
+[[nodiscard]]
+auto find_debuglink_file(
+    const std::filesystem::path& program_path,
+    const debuglink& link,
+    const std::vector<std::filesystem::path>& roots
+) -> std::optional<std::filesystem::path>;
+
+// Returns the separate file with the DWARF information of program, looked up
+// first by build-id and then by .gnu_debuglink, or nothing if there is none.
+[[nodiscard]]
+auto find_separate_debug_file(
+    const elf_file& program,
+    const std::vector<std::filesystem::path>& roots = {default_debug_root}
+) -> std::optional<std::filesystem::path>;
+
+}
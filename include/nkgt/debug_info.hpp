@@ -0,0 +1,175 @@
+#pragma once
+#include "nkgt/dwarf_expr.hpp"
+#include "nkgt/error_codes.hpp"
+#include "nkgt/types.hpp"
+
+#include <tl/expected.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Opaque libdwarf handle, so that users of this header do not need libdwarf.
+struct Dwarf_Debug_s;
+
+namespace nkgt::debug_info {
+
+// A DWARF file opened through libdwarf, defined in debug_info.cpp.
+struct dwarf_file;
+
+// A function with code, from a DW_TAG_subprogram DIE. Addresses are the link
+// time ones. Like all the DIE offsets handed out by debug_info, die_offset
+// has the index of the file holding the DIE in its upper 16 bits: 0 for the
+// program (or its separate debug file), then the split DWARF files in the
+// order they were opened.
+struct function {
+    std::string name;
+    uint64_t low_pc;
+    uint64_t high_pc;
+    uint64_t die_offset;
+};
+
+// Row of the line table.
+struct source_line {
+    std::string_view file;
+    uint64_t line;
+};
+
+// A parameter or a variable. Its location is decoded once, the first time the
+// variable is looked up.
+struct variable {
+    std::string name;
+    dwarf_expr::location location;
+    // Offset of the DIE of the type, 0 when the variable has none.
+    uint64_t type_offset;
+};
+
+class debug_info {
+public:
+    debug_info(const debug_info&) = delete;
+    debug_info& operator=(const debug_info&) = delete;
+    ~debug_info();
+
+    // Returns the function whose code contains pc, or nullptr. The first call
+    // indexes all the functions of the program, except the ones of split
+    // compilation units: their .dwo file (or the .dwp package) is only opened
+    // the first time one of their addresses is looked up. The functions stay
+    // at the same address for the lifetime of the debug_info.
+    [[nodiscard]]
+    auto function_at(uint64_t pc) -> const function*;
+
+    // Returns the source line the code at pc comes from. The first call reads
+    // the line tables of all the compilation units.
+    [[nodiscard]]
+    auto line_at(uint64_t pc) -> std::optional<source_line>;
+
+    // Returns the frame base of f (its DW_AT_frame_base).
+    [[nodiscard]]
+    auto frame_base(const function& f) -> const dwarf_expr::location&;
+
+    // Looks name up between the parameters and the local variables of scope,
+    // nested blocks included, and then between the global variables. scope can
+    // be nullptr to only look at globals. A global that is not found loads all
+    // the split compilation units that have not been opened yet.
+    [[nodiscard]]
+    auto find_variable(const function* scope, std::string_view name) -> const variable*;
+
+    // Returns the type of v, or types::no_type when it has none. Types are
+    // added to the graph the first time they are needed.
+    [[nodiscard]]
+    auto type_of(const variable& v) -> types::type_id;
+
+    [[nodiscard]]
+    auto graph() const -> const types::type_graph& { return types_; }
+
+private:
+    friend auto load_debug_info(
+        const std::filesystem::path& path
+    ) -> tl::expected<std::unique_ptr<debug_info>, error::debug_symbols>;
+
+    // Compilation unit whose DIEs are in a .dwo file, or in the .dwp package
+    // next to the program. Only its skeleton is in the program.
+    struct split_unit {
+        std::string dwo_name;
+        std::string comp_dir;
+        uint64_t dwo_id;
+        // Both 0 when the unit is not contiguous.
+        uint64_t low_pc;
+        uint64_t high_pc;
+        bool loaded;
+    };
+
+    explicit debug_info(std::filesystem::path program_path);
+
+    [[nodiscard]]
+    auto dbg_of(uint64_t die_offset) const -> Dwarf_Debug_s*;
+
+    auto build_index() -> void;
+    auto build_line_table() -> void;
+    auto build_type(uint64_t offset) -> types::type_id;
+
+    [[nodiscard]]
+    auto lookup_function(uint64_t pc) const -> const function*;
+
+    // Indexes the split units for which pred is true and that have not been
+    // loaded yet. Returns true if any was.
+    template<typename Predicate>
+    auto load_split_units(Predicate pred) -> bool;
+    auto load_split_unit(split_unit& unit) -> void;
+
+    std::filesystem::path program_path_;
+    // The program (or its separate debug file) first. The files are kept
+    // mapped for as long as libdwarf uses them.
+    std::vector<std::unique_ptr<dwarf_file>> dwarf_files_;
+    std::vector<split_unit> split_units_;
+    std::size_t pending_split_units_ = 0;
+    // Index in dwarf_files_ of the .dwp package, once it has been looked for.
+    std::optional<std::size_t> package_;
+    bool package_searched_ = false;
+
+    bool indexed_ = false;
+    // Never moved once added, see function_at().
+    std::deque<function> functions_;
+    // Sorted by low_pc.
+    std::vector<const function*> functions_by_address_;
+    // Global name to DIE offset.
+    std::unordered_map<std::string, uint64_t> globals_;
+
+    struct line_row {
+        uint64_t address;
+        uint64_t line;
+        uint32_t file;
+        // Marks the first address after a sequence of rows.
+        bool end_sequence;
+    };
+
+    bool lines_read_ = false;
+    // Sorted by address.
+    std::vector<line_row> lines_;
+    std::vector<std::string> files_;
+
+    // Caches, keyed by DIE offset. Lookups that failed are cached as well.
+    std::unordered_map<uint64_t, dwarf_expr::location> frame_bases_;
+    std::map<std::pair<uint64_t, std::string>, std::optional<variable>> variables_;
+    std::unordered_map<uint64_t, types::type_id> type_ids_;
+    types::type_graph types_;
+};
+
+// Opens the DWARF information of the program at path or, when it has been
+// stripped, of its separate debug file (see debug_file.hpp). The sections
+// are read from a mapping of the file.
+[[nodiscard]]
+auto load_debug_info(
+    const std::filesystem::path& path
+) -> tl::expected<std::unique_ptr<debug_info>, error::debug_symbols>;
+
+}
@@ -1,11 +1,17 @@
 #pragma once
 #include "nkgt/error_codes.hpp"
+#include "nkgt/process.hpp"
+#include "nkgt/target.hpp"
 
 #include <tl/expected.hpp>
 
 #include <cstdint>
+#include <cstdio>
 #include <filesystem>
+#include <optional>
+#include <string_view>
 #include <sys/types.h>
+#include <unordered_map>
 
 namespace nkgt::debugger {
 
@@ -19,6 +25,56 @@ struct breakpoint {
 tl::expected<void, error::breakpoint> enable_breakpoint(breakpoint& bp);
 tl::expected<void, error::breakpoint> disable_breakpoint(breakpoint& bp);
 
-void run(pid_t pid, const std::filesystem::path& program_path);
+// Enables every disabled breakpoint of breakpoint_list in the debugee with one
+// read and one write per page, instead of a PEEKDATA and a POKEDATA for each
+// of them. Breakpoints on a page that cannot be modified stay disabled and the
+// error of the first such page is returned.
+auto enable_breakpoints(
+    target::target& debugee,
+    std::unordered_map<std::intptr_t, breakpoint>& breakpoint_list
+) -> tl::expected<void, error::breakpoint>;
+
+// When the debugee is stopped right after one of the enabled breakpoints of
+// breakpoint_list, rewinds the pc, executes the original instruction and
+// re-enables the breakpoint. Returns the signal that arrived during the step
+// and is still to be delivered, 0 if there is none, or nothing on failure.
+auto step_over_breakpoint(
+    target::target& debugee,
+    std::unordered_map<std::intptr_t, breakpoint>& breakpoint_list
+) -> std::optional<int>;
+
+// Resumes the debugee, stepping over the breakpoint it is stopped at if any,
+// and waits for it to stop again. A signal that arrived during the step is
+// delivered, the one the debugee was stopped by is not. Returns the status
+// reported by waitpid(), or nothing if the debugee could not be resumed.
+auto continue_execution(
+    target::target& debugee,
+    std::unordered_map<std::intptr_t, breakpoint>& breakpoint_list
+) -> std::optional<int>;
+
+// REPL on the debugee started by process::launch() with options, which are
+// kept for the run command.
+void run(pid_t pid, const process::launch_options& options);
+
+// Same as run(), but the commands are read from script (a file or a pipe, one
+// per line) until quit or the end of the input. For automation: the standard
+// output should be block buffered by the caller.
+void run_batch(
+    pid_t pid,
+    const process::launch_options& options,
+    std::FILE* script
+);
+
+// Serves the debugee to a GDB client over the remote serial protocol instead
+// of running the REPL. address is a Unix socket path or [host]:port, see
+// gdb_server::serve().
+void run_server(pid_t pid, std::string_view address);
+
+// Post-mortem session on a core file. Only the commands that inspect the
+// debugee (registers, memory, backtrace) are available.
+void run_core(
+    const std::filesystem::path& core_path,
+    const std::filesystem::path& program_path
+);
 
 }
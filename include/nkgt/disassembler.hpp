@@ -0,0 +1,75 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace nkgt::disassembler {
+
+constexpr std::size_t max_instruction_size = 15;
+
+struct instruction {
+    std::uintptr_t address;
+    uint8_t size;
+    std::array<uint8_t, max_instruction_size> bytes;
+    // Intel syntax, e.g. "mov rax, qword ptr [rbp - 0x8]". Valid instructions
+    // the decoder has no name for are shown as "(unknown)", invalid ones as
+    // "(bad)" with a size of 1.
+    std::string text;
+    // Destination of relative jumps and calls, or address of the rip relative
+    // memory operand.
+    std::optional<std::uintptr_t> target;
+    // Jumps (conditional or not), returns and instructions that never fall
+    // through, which end a basic block.
+    bool ends_block;
+};
+
+// Decodes the 64-bit instruction at the start of code, whose size bytes are
+// located at address. Returns nothing if code ends before the instruction.
+[[nodiscard]]
+auto decode(const uint8_t* code, std::size_t size, std::uintptr_t address) -> std::optional<instruction>;
+
+// Straight line code starting at an address, up to the first instruction
+// ending a basic block or max_block_instructions instructions. Blocks may
+// overlap when code is decoded from the middle of another block.
+struct block {
+    std::vector<instruction> instructions;
+
+    [[nodiscard]]
+    auto end() const -> std::uintptr_t {
+        return instructions.back().address + instructions.back().size;
+    }
+};
+
+// Decoded blocks by address. The content of the cache is only trusted as long
+// as the code does not change: writes to the memory of the debugee have to be
+// reported with invalidate(). Code modified by the debugee itself is not
+// noticed.
+class block_cache {
+public:
+    static constexpr std::size_t max_block_instructions = 32;
+
+    // Returns the block starting at address, or nullptr if it is not cached.
+    [[nodiscard]]
+    auto find(std::uintptr_t address) const -> const block*;
+
+    // Decodes and caches the block starting at address from the size bytes of
+    // code. Returns nullptr if not even one instruction fits in code.
+    auto insert(const uint8_t* code, std::size_t size, std::uintptr_t address) -> const block*;
+
+    // Drops the blocks with code on the pages of [address, address + size).
+    auto invalidate(std::uintptr_t address, std::size_t size) -> void;
+
+    auto clear() -> void { blocks_.clear(); }
+
+    [[nodiscard]]
+    auto size() const -> std::size_t { return blocks_.size(); }
+
+private:
+    std::map<std::uintptr_t, block> blocks_;
+};
+
+}
@@ -0,0 +1,146 @@
+#pragma once
+#include "nkgt/error_codes.hpp"
+#include "nkgt/target.hpp"
+
+#include <tl/expected.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <sys/user.h>
+#include <vector>
+
+namespace nkgt::dwarf_expr {
+
+// Operations of the decoded bytecode. Every DWARF operation maps to exactly
+// one of them: the 32 variants of DW_OP_lit, DW_OP_reg and DW_OP_breg and the
+// various DW_OP_const are folded in push_constant, location_register and
+// push_register, with the register number and the constant stored as
+// operands.
+enum class opcode : uint8_t {
+    push_address,         // DW_OP_addr, relocated by the load bias
+    push_constant,        // DW_OP_lit*, DW_OP_const*
+    push_register,        // DW_OP_breg*, DW_OP_bregx: register + operand
+    push_frame_base,      // DW_OP_fbreg: frame base + operand
+    push_cfa,             // DW_OP_call_frame_cfa
+    location_register,    // DW_OP_reg*, DW_OP_regx
+    dereference,          // DW_OP_deref, DW_OP_deref_size
+    duplicate,
+    drop,
+    over,
+    pick,
+    swap,
+    rotate,
+    absolute,
+    bit_and,
+    divide,
+    minus,
+    modulo,
+    multiply,
+    negate,
+    bit_not,
+    bit_or,
+    plus,
+    plus_constant,
+    shift_left,
+    shift_right,
+    shift_right_arithmetic,
+    bit_xor,
+    stack_value,
+    piece,
+    nop,
+    // Emitted for operations that cannot be evaluated from a single stop
+    // (e.g. DW_OP_entry_value): the value is reported as optimized out.
+    unavailable,
+};
+
+// 16 bytes per operation, laid out contiguously in a program.
+struct instruction {
+    opcode op;
+    uint8_t size;        // dereference: number of bytes to read
+    uint16_t reg;        // DWARF register number
+    uint32_t padding;
+    uint64_t operand;
+};
+
+using program = std::vector<instruction>;
+
+// Translates one DWARF operation, as returned by libdwarf, to its bytecode.
+// operand1 and operand2 follow the libdwarf conventions, signed operands
+// being stored as two's complement.
+[[nodiscard]]
+auto decode(
+    uint8_t atom,
+    uint64_t operand1,
+    uint64_t operand2
+) -> tl::expected<instruction, error::dwarf_expr>;
+
+// A location list. A plain location expression is a list with a single entry
+// covering all the address space.
+struct location_entry {
+    uint64_t low_pc;
+    uint64_t high_pc;
+    program code;
+};
+
+struct location {
+    std::vector<location_entry> entries;
+
+    // The program valid at pc (a link time address), if any.
+    [[nodiscard]]
+    auto at(uint64_t pc) const -> const program*;
+};
+
+// Where (a part of) an object lives.
+struct piece {
+    enum class kind : uint8_t {
+        memory,
+        reg,
+        value,
+        optimized_out,
+    };
+
+    kind k;
+    // The address for memory, the DWARF register number for reg and the value
+    // itself for value.
+    uint64_t value;
+    // 0 when the piece covers the whole object.
+    std::size_t size;
+};
+
+// State of the stop the expressions are evaluated against. Registers are
+// read once by the caller and shared by every evaluation at the same stop,
+// memory is only accessed for dereferences.
+struct context {
+    target::target& debugee;
+    const user_regs_struct& registers;
+    uint64_t load_bias;
+    uint64_t frame_base;
+    uint64_t cfa;
+};
+
+// Runs code and returns the pieces of the object it describes, in order.
+[[nodiscard]]
+auto evaluate(
+    const program& code,
+    const context& ctx
+) -> tl::expected<std::vector<piece>, error::dwarf_expr>;
+
+// Evaluates code and returns the single value it computes: this is how frame
+// bases are obtained.
+[[nodiscard]]
+auto evaluate_value(
+    const program& code,
+    const context& ctx
+) -> tl::expected<uint64_t, error::dwarf_expr>;
+
+// Reads the bytes of pieces into buffer, which must be large enough for all of
+// them. All the memory pieces are fetched with a single scatter read.
+[[nodiscard]]
+auto read_pieces(
+    const std::vector<piece>& pieces,
+    const context& ctx,
+    std::byte* buffer,
+    std::size_t size
+) -> tl::expected<void, error::dwarf_expr>;
+
+}
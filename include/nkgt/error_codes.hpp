@@ -10,8 +10,11 @@ enum class breakpoint {
 enum class registers {
     getregs_fail,
     setregs_fail,
+    getfpregs_fail,
     unknown_dwarf_number,
     unknown_reg_name,
+    unavailable_register,
+    unknown_view,
 };
 
 enum class address {
@@ -22,4 +25,96 @@ enum class debug_symbols {
     load_fail,
 };
 
+enum class debug_file {
+    open_fail,
+    map_fail,
+    invalid_format,
+};
+
+enum class memory {
+    read_fail,
+    write_fail,
+    unmapped_address,
+};
+
+enum class core_file {
+    open_fail,
+    map_fail,
+    invalid_format,
+    missing_registers,
+};
+
+enum class checkpoint {
+    inject_fail,
+    fork_fail,
+};
+
+enum class maps {
+    open_fail,
+    parse_fail,
+};
+
+enum class snapshot {
+    fork_fail,
+    clear_refs_fail,
+    pagemap_fail,
+    read_fail,
+};
+
+enum class search {
+    malformed_pattern,
+    empty_pattern,
+};
+
+enum class dwarf_expr {
+    unsupported_operation,
+    stack_underflow,
+    stack_overflow,
+    division_by_zero,
+    unknown_register,
+    memory_read_fail,
+    optimized_out,
+};
+
+enum class stats {
+    open_fail,
+    write_fail,
+};
+
+enum class gdb_server {
+    invalid_address,
+    socket_fail,
+    bind_fail,
+    listen_fail,
+    accept_fail,
+};
+
+enum class condition {
+    syntax_error,
+    unknown_register,
+    nested_load,
+    too_complex,
+    division_by_zero,
+    read_fail,
+};
+
+enum class launch {
+    fork_fail,
+    exec_fail,
+    setoptions_fail,
+};
+
+enum class shared_libraries {
+    auxv_fail,
+    static_program,
+    loader_not_found,
+    read_fail,
+};
+
+enum class event_log {
+    open_fail,
+    map_fail,
+    invalid_format,
+};
+
 }
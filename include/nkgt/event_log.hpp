@@ -0,0 +1,172 @@
+#pragma once
+#include "nkgt/error_codes.hpp"
+
+#include <tl/expected.hpp>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <string_view>
+#include <sys/types.h>
+#include <sys/user.h>
+#include <vector>
+
+namespace nkgt::event_log {
+
+enum class event : uint16_t {
+    // Stop at a breakpoint, reported to the user. values[0] is the time the
+    // debugee ran since it was resumed, in ns.
+    breakpoint,
+    // Hit of a breakpoint skipped by its condition or ignore count. values[0]
+    // as for breakpoint, values[1] is the time spent evaluating the condition.
+    skipped,
+    // Hit of a breakpoint of the timefunc command. values[0] as for
+    // breakpoint.
+    timer,
+    // Stop at the breakpoint of the dynamic loader, reporting a change to the
+    // shared libraries.
+    library,
+    // Stop for a signal other than the trap of a breakpoint. values[0] is the
+    // signal number.
+    signal,
+    // The debugee is gone. values[0] is its exit status, or the number of the
+    // signal that killed it if values[1] is 1.
+    exit,
+    // Part of a snapshot of the general purpose registers, see
+    // register_records.
+    registers,
+};
+
+inline constexpr std::size_t event_count = 7;
+inline constexpr std::size_t record_values = 5;
+
+// Every event fits in one record, except register snapshots, so that the log
+// is an array written without any encoding. address is the program counter of
+// the stop (the address of the breakpoint for breakpoint hits) and time_ns is
+// read from the steady clock.
+struct record {
+    uint64_t time_ns;
+    event type;
+    // Index of the record among those of the same event.
+    uint16_t part;
+    uint32_t thread;
+    uint64_t address;
+    std::array<uint64_t, record_values> values;
+};
+
+static_assert(sizeof(record) == 64);
+
+// A register snapshot is user_regs_struct split in this many consecutive
+// records, part 0 to register_records - 1. The stop it belongs to comes right
+// before it.
+inline constexpr std::size_t register_records =
+    (sizeof(user_regs_struct) / sizeof(uint64_t) + record_values - 1) / record_values;
+
+// First bytes of a log file, followed by capacity records.
+struct file_header {
+    std::array<char, 8> magic;
+    uint32_t version;
+    uint32_t record_size;
+    uint64_t capacity;
+    // Records appended since the creation of the log. Record i is stored at
+    // index i % capacity, so only the last capacity of them are in the file.
+    uint64_t written;
+    std::array<uint64_t, 4> reserved;
+};
+
+static_assert(sizeof(file_header) == 64);
+
+// Ring of records in a file mapped in memory, so that appending an event is a
+// copy of 64 bytes with no system call and no formatting. The records reach
+// the file even if the debugger crashes. Not thread safe.
+class writer {
+public:
+    writer(const writer&) = delete;
+    writer& operator=(const writer&) = delete;
+    ~writer();
+
+    auto append(const record& r) -> void {
+        records_[header_->written & (header_->capacity - 1)] = r;
+        header_->written += 1;
+    }
+
+    // Appends the register_records records of a snapshot of regs.
+    auto append_registers(uint64_t time_ns, pid_t thread, const user_regs_struct& regs) -> void;
+
+    [[nodiscard]]
+    auto written() const -> uint64_t { return header_->written; }
+
+    [[nodiscard]]
+    auto capacity() const -> uint64_t { return header_->capacity; }
+
+    [[nodiscard]]
+    auto path() const -> const std::filesystem::path& { return path_; }
+
+private:
+    friend auto create(
+        const std::filesystem::path& path,
+        uint64_t capacity
+    ) -> tl::expected<std::unique_ptr<writer>, error::event_log>;
+
+    writer() = default;
+
+    std::filesystem::path path_;
+    void* mapping_ = nullptr;
+    std::size_t size_ = 0;
+    file_header* header_ = nullptr;
+    record* records_ = nullptr;
+};
+
+// Creates (or truncates) the log file at path, with room for capacity records
+// rounded up to a power of two.
+[[nodiscard]]
+auto create(
+    const std::filesystem::path& path,
+    uint64_t capacity
+) -> tl::expected<std::unique_ptr<writer>, error::event_log>;
+
+struct contents {
+    uint64_t capacity;
+    uint64_t written;
+    // The records still in the file, oldest first.
+    std::vector<record> records;
+};
+
+// Reads a log file written by a writer, which should not be appending to it
+// anymore.
+[[nodiscard]]
+auto read(const std::filesystem::path& path) -> tl::expected<contents, error::event_log>;
+
+// Rebuilds the snapshot starting at first, out of count records. Returns
+// nothing if they do not hold a whole snapshot, e.g. because its first part
+// has been overwritten.
+[[nodiscard]]
+auto snapshot_registers(const record* first, std::size_t count) -> std::optional<user_regs_struct>;
+
+[[nodiscard]]
+auto to_string(event e) -> std::string_view;
+
+[[nodiscard]]
+auto from_string(std::string_view name) -> std::optional<event>;
+
+// Events of one type at one address.
+struct summary {
+    event type;
+    uint64_t address;
+    uint64_t count;
+    uint64_t first_ns;
+    uint64_t last_ns;
+    // Sums of values[0] and values[1], see event.
+    uint64_t total_run_ns;
+    uint64_t total_condition_ns;
+};
+
+// Aggregates records by type and address, most frequent first. Register
+// snapshots are left out.
+[[nodiscard]]
+auto summarize(const std::vector<record>& records) -> std::vector<summary>;
+
+}
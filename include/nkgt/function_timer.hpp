@@ -0,0 +1,117 @@
+#pragma once
+#include "nkgt/stats.hpp"
+
+#include <cstdint>
+#include <string>
+#include <sys/types.h>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace nkgt::function_timer {
+
+// Time as seen by the debugee: the clock, the number of times the debugee
+// stopped so far and the total time it spent stopped, i.e. not running its
+// own code.
+struct timestamp {
+    uint64_t now_ns;
+    uint64_t stops;
+    uint64_t stopped_ns;
+};
+
+// A call that has not returned yet.
+struct frame {
+    std::uintptr_t return_address;
+    // rsp at the entry, where the call stored return_address. The matching
+    // return leaves rsp 8 bytes above it.
+    std::uintptr_t stack_pointer;
+    timestamp start;
+};
+
+// Latency of the calls of one function, measured with a breakpoint at its
+// entry and one at the return address of every call in progress. Each thread
+// has its own stack of calls, so that recursion and concurrent calls are
+// paired correctly. This class only does the bookkeeping, the breakpoints are
+// set by the caller.
+class timer {
+public:
+    timer(std::string name, std::uintptr_t entry) : name_(std::move(name)), entry_(entry) {}
+
+    timer(const timer&) = delete;
+    timer& operator=(const timer&) = delete;
+
+    [[nodiscard]]
+    auto name() const -> const std::string& { return name_; }
+
+    [[nodiscard]]
+    auto entry() const -> std::uintptr_t { return entry_; }
+
+    // For a debugee restarted with its code at another address.
+    auto move_entry(std::uintptr_t entry) -> void { entry_ = entry; }
+
+    // Called when thread stops at the entry. Returns true if no call in
+    // progress returns to return_address yet, that is if a breakpoint must be
+    // set there.
+    [[nodiscard]]
+    auto enter(
+        pid_t thread,
+        std::uintptr_t return_address,
+        std::uintptr_t stack_pointer,
+        const timestamp& now
+    ) -> bool;
+
+    // Called when thread stops at address, one of the return addresses. If it
+    // is the return of the innermost call of the thread, records its duration
+    // without the time the debugee spent stopped and trap_cost_ns for every
+    // stop, the time to resume the debugee and see it stop again. Calls that
+    // will never return (their frame is below the stack pointer, e.g. after a
+    // longjmp) are dropped. Returns the return addresses that no call in
+    // progress uses anymore, whose breakpoints can be removed.
+    [[nodiscard]]
+    auto leave(
+        pid_t thread,
+        std::uintptr_t address,
+        std::uintptr_t stack_pointer,
+        const timestamp& now,
+        uint64_t trap_cost_ns
+    ) -> std::vector<std::uintptr_t>;
+
+    // True if a call in progress returns to address.
+    [[nodiscard]]
+    auto is_return_address(std::uintptr_t address) const -> bool {
+        return return_addresses_.find(address) != return_addresses_.cend();
+    }
+
+    // Forgets the calls in progress, e.g. when the debugee is restarted, and
+    // returns their return addresses.
+    [[nodiscard]]
+    auto clear_calls() -> std::vector<std::uintptr_t>;
+
+    // Durations of the completed calls, in nanoseconds.
+    [[nodiscard]]
+    auto latency() const -> const stats::histogram& { return latency_; }
+
+    // Calls whose return was never seen.
+    [[nodiscard]]
+    auto dropped() const -> uint64_t { return dropped_; }
+
+    auto reset() -> void {
+        latency_.reset();
+        dropped_ = 0;
+    }
+
+private:
+    // Removes a reference to the return address of f, adding it to released
+    // when it was the last one.
+    auto release(const frame& f, std::vector<std::uintptr_t>& released) -> void;
+
+    std::string name_;
+    std::uintptr_t entry_;
+    std::unordered_map<pid_t, std::vector<frame>> calls_;
+    // Number of calls in progress returning to each address.
+    std::unordered_map<std::uintptr_t, std::size_t> return_addresses_;
+    stats::histogram latency_;
+    uint64_t dropped_ = 0;
+};
+
+}
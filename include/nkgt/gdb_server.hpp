@@ -0,0 +1,71 @@
+#pragma once
+#include "nkgt/error_codes.hpp"
+
+#include <tl/expected.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <sys/types.h>
+
+namespace nkgt::gdb_server {
+
+// Something received from the client, see packet_reader.
+struct event {
+    enum class kind {
+        packet,
+        ack,
+        nack,
+        // A packet whose checksum does not match, to be answered with a nack.
+        corrupted,
+        // The ^C byte the client sends to stop a running debugee.
+        interrupt,
+    };
+
+    kind k;
+    // Unescaped payload of the packet, only for kind::packet.
+    std::string payload;
+};
+
+// Splits the byte stream coming from the client into packets. Any number of
+// packets can be fed at once, so that a client pipelining its requests is
+// answered without waiting for more data between them.
+class packet_reader {
+public:
+    auto feed(const char* data, std::size_t size) -> void { buffer_.append(data, size); }
+
+    // Returns the next complete event, or nothing when more data is needed.
+    [[nodiscard]]
+    auto next() -> std::optional<event>;
+
+private:
+    std::string buffer_;
+    std::size_t position_ = 0;
+};
+
+// Appends $payload#checksum to out, escaping the bytes that cannot appear in
+// a packet. Payloads can contain binary data.
+auto append_packet(std::string_view payload, std::string& out) -> void;
+
+// Appends data to out escaped as for a binary packet ('}' followed by the
+// byte xor 0x20 for '#', '$', '}' and '*').
+auto append_escaped(std::string_view data, std::string& out) -> void;
+
+// Target description (qXfer:features:read:target.xml) of the registers the
+// server exposes, in the order of the g packet.
+[[nodiscard]]
+auto target_description() -> const std::string&;
+
+// Serves the GDB remote serial protocol for pid, which must be stopped and
+// traced by the calling thread, to a single client.
+//
+// address is either a path, to listen on a Unix socket, or [host]:port to
+// listen on TCP. TCP connections are only accepted on the loopback interface.
+// Returns once the client detaches or kills the debugee, or the debugee
+// exits.
+[[nodiscard]]
+auto serve(pid_t pid, std::string_view address) -> tl::expected<void, error::gdb_server>;
+
+}
@@ -0,0 +1,101 @@
+#pragma once
+#include "nkgt/error_codes.hpp"
+
+#include <tl/expected.hpp>
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <sys/types.h>
+#include <vector>
+
+namespace nkgt::maps {
+
+// One line of /proc/pid/maps, see proc(5). The range is [start, end).
+struct region {
+    std::uintptr_t start;
+    std::uintptr_t end;
+    bool readable;
+    bool writable;
+    bool executable;
+    bool shared;
+    std::uint64_t offset;
+    // Empty for anonymous mappings, [heap], [stack] etc. for the special ones.
+    std::string path;
+};
+
+// Parses the content of a /proc/pid/maps file. The regions are returned in
+// the same order as the file, that is sorted by address.
+[[nodiscard]]
+auto parse_maps(
+    std::string_view content
+) -> tl::expected<std::vector<region>, error::maps>;
+
+[[nodiscard]]
+auto read_maps(pid_t pid) -> tl::expected<std::vector<region>, error::maps>;
+
+// Address of module relative to the address of a location in it.
+struct module_offset {
+    const region* module;
+    std::uintptr_t offset;
+};
+
+// Cached view of the memory map of the debugee. /proc/pid/maps is read again
+// only after invalidate() has been called, which the debugger does whenever
+// the debugee may have changed its mappings (it ran or a library was loaded),
+// so any number of queries at the same stop cost a single parse.
+//
+// The load bias of a module is the difference between the addresses in the
+// running process and the ones in the file, it is 0 for executables that are
+// not position independent. Symbol lookups go through it so that ASLR does not
+// need to be disabled.
+class address_space {
+public:
+    // Mappings of a live process, read from /proc/pid/maps.
+    explicit address_space(pid_t pid) : pid_(pid) {}
+
+    // Fixed set of mappings, e.g. the ones recorded in a core file.
+    explicit address_space(std::vector<region> regions)
+        : pid_(0), stale_(false), regions_(std::move(regions)) {}
+
+    auto invalidate() -> void { stale_ = pid_ != 0; }
+
+    // Keeps the regions of the last read of /proc/pid/maps, for a process that
+    // has exited and whose mappings cannot be read anymore.
+    auto freeze() -> void { stale_ = false; }
+
+    [[nodiscard]]
+    auto regions() -> const std::vector<region>&;
+
+    // Returns the region containing address, or nullptr.
+    [[nodiscard]]
+    auto find(std::uintptr_t address) -> const region*;
+
+    // Returns the first mapping of path (the one with file offset 0) and the
+    // offset of address from its start.
+    [[nodiscard]]
+    auto to_module_offset(std::uintptr_t address) -> std::optional<module_offset>;
+
+    // Returns the start of the first mapping of path, the one with file
+    // offset 0, that is the address module_offset::offset is relative to.
+    [[nodiscard]]
+    auto module_start(std::string_view path) -> std::optional<std::uintptr_t>;
+
+    // Returns the load bias of the module mapped from path, given the address
+    // its first byte has in the file (see symbols::symbol_table::load_base()).
+    [[nodiscard]]
+    auto load_bias(
+        std::string_view path,
+        std::uintptr_t load_base
+    ) -> std::optional<std::uintptr_t>;
+
+private:
+    auto refresh() -> void;
+
+    pid_t pid_;
+    bool stale_ = true;
+    std::vector<region> regions_;
+};
+
+}
@@ -0,0 +1,65 @@
+#pragma once
+#include "nkgt/target.hpp"
+#include "nkgt/types.hpp"
+
+#include <cstddef>
+#include <cstdio>
+#include <string>
+
+namespace nkgt::pretty_printer {
+
+struct limits {
+    // Elements printed for each array and container.
+    std::size_t max_elements = 200;
+    // Nesting of structs, arrays and containers printed before eliding them
+    // as {...}.
+    std::size_t max_depth = 8;
+    // Characters printed for each string.
+    std::size_t max_string = 200;
+};
+
+struct print_stats {
+    // Scatter reads issued to fetch the memory the value points to.
+    std::size_t reads;
+    std::size_t bytes;
+};
+
+// Bytes of a value of type t that are needed to print it: the size of the
+// type, except for arrays longer than the element limit.
+[[nodiscard]]
+auto footprint(
+    const types::type_graph& graph,
+    types::type_id t,
+    const limits& l
+) -> std::size_t;
+
+// Prints the value of type t whose first footprint() bytes are in data.
+//
+// Memory the value points to (the elements of a std::vector, the characters of
+// a std::string, ...) is not read while printing: the value is first walked
+// to find all the memory it needs, which is then fetched with one scatter
+// read, and so on for every level of indirection. The output is then
+// formatted in a buffer that is flushed to out as it fills up.
+//
+// The libstdc++ std::vector, std::basic_string, std::unordered_map and
+// std::shared_ptr are printed by their content rather than by their members.
+auto print(
+    target::target& debugee,
+    const types::type_graph& graph,
+    types::type_id t,
+    const std::byte* data,
+    const limits& l,
+    std::FILE* out
+) -> print_stats;
+
+// Same as print(), but returns the output.
+[[nodiscard]]
+auto format(
+    target::target& debugee,
+    const types::type_graph& graph,
+    types::type_id t,
+    const std::byte* data,
+    const limits& l
+) -> std::string;
+
+}
@@ -0,0 +1,35 @@
+#pragma once
+#include "nkgt/error_codes.hpp"
+
+#include <tl/expected.hpp>
+
+#include <filesystem>
+#include <string>
+#include <sys/types.h>
+#include <vector>
+
+namespace nkgt::process {
+
+// Everything needed to start the debugee again, kept by the session so that
+// the run command does not need to be given the same arguments every time.
+struct launch_options {
+    std::filesystem::path program;
+    // argv[1] onwards, argv[0] is the program path.
+    std::vector<std::string> arguments;
+    // NAME=value entries.
+    std::vector<std::string> environment;
+};
+
+// Copy of the environment of the debugger.
+[[nodiscard]]
+auto current_environment() -> std::vector<std::string>;
+
+// Forks and executes the program traced by the calling thread. On success the
+// debugee is stopped at its first instruction, with PTRACE_O_EXITKILL set.
+//
+// Nothing is allocated between fork() and execve(), which makes it safe to
+// call while other threads of the debugger are running.
+[[nodiscard]]
+auto launch(const launch_options& options) -> tl::expected<pid_t, error::launch>;
+
+}
@@ -1,11 +1,14 @@
 #pragma once
 #include "nkgt/error_codes.hpp"
+#include "nkgt/target.hpp"
 
 #include <tl/expected.hpp>
 
+#include <cstddef>
 #include <cstdint>
 #include <string>
 #include <string_view>
+#include <sys/user.h>
 
 namespace nkgt::registers {
 
@@ -20,36 +23,74 @@ enum class reg {
     fs, gs, ss, ds, es
 };
 
+constexpr std::size_t register_count = 27;
+
+// Everything there is to know about a general purpose register. offset and
+// size locate the register inside user_regs_struct, dwarf_r is -1 for the
+// registers without a DWARF number.
 struct reg_descriptor {
     reg r;
     int dwarf_r;
+    std::string_view name;
+    std::size_t offset;
+    std::size_t size;
 };
 
+[[nodiscard]]
+auto descriptor(reg r) -> const reg_descriptor&;
+
 [[nodiscard]]
 auto get_register_value(
-    pid_t pid,
+    target::target& debugee,
     reg r
 ) -> tl::expected<uint64_t, error::registers>;
 
+// Value of r in an already fetched register set.
+[[nodiscard]]
+auto get_register_value(const user_regs_struct& regs, reg r) -> uint64_t;
+
+[[nodiscard]]
+auto from_dwarf_number(unsigned dwarf_number) -> tl::expected<reg, error::registers>;
+
 [[nodiscard]]
 auto get_register_value_from_dwarf_number(
-    pid_t pid,
+    target::target& debugee,
     unsigned dwarf_number
 ) -> tl::expected<uint64_t, error::registers>;
 
 [[nodiscard]]
 auto set_register_value(
-    pid_t pid,
+    target::target& debugee,
     reg r,
     uint64_t value
 ) -> tl::expected<void, error::registers>;
 
+// Reads all the count registers in regs with a single PTRACE_GETREGS and
+// stores their values in values, in the same order.
+[[nodiscard]]
+auto read_registers(
+    target::target& debugee,
+    const reg* regs,
+    uint64_t* values,
+    std::size_t count
+) -> tl::expected<void, error::registers>;
+
+// Sets all the count registers in regs to the corresponding values with one
+// PTRACE_GETREGS and one PTRACE_SETREGS.
+[[nodiscard]]
+auto write_registers(
+    target::target& debugee,
+    const reg* regs,
+    const uint64_t* values,
+    std::size_t count
+) -> tl::expected<void, error::registers>;
+
 [[nodiscard]]
 auto to_string(reg r) -> std::string;
 
 [[nodiscard]]
 auto from_string(std::string_view r) -> tl::expected<reg, error::registers>;
 
-auto dump_registers(pid_t pid) -> void;
+auto dump_registers(target::target& debugee) -> void;
 
 }
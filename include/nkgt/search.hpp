@@ -0,0 +1,81 @@
+#pragma once
+#include "nkgt/error_codes.hpp"
+#include "nkgt/target.hpp"
+
+#include <tl/expected.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace nkgt::search {
+
+// Sequence of bytes to look for. A byte of memory m matches position i of the
+// pattern when (m & mask[i]) == bytes[i]. bytes is always already masked.
+struct pattern {
+    std::vector<uint8_t> bytes;
+    std::vector<uint8_t> mask;
+};
+
+// [start, end) in the address space of the debugee.
+struct address_range {
+    std::uintptr_t start;
+    std::uintptr_t end;
+};
+
+// Parses a pattern in one of the following formats:
+//   str:text          the bytes of text, without a terminator
+//   bytes:de??beef    hex bytes, ? matches any nibble
+//   u8:value          little endian integers of the given width, the value is
+//   u16:value         hex if it starts with 0x and decimal otherwise
+//   u32:value
+//   u64:value
+[[nodiscard]]
+auto parse_pattern(std::string_view s) -> tl::expected<pattern, error::search>;
+
+// Appends to out the address of every match of p starting in the first
+// search_size bytes of data. The bytes after search_size are only used to
+// verify matches that start before it, this is how matches straddling two
+// chunks are found. base is the address of data[0].
+//
+// The first byte of p without wildcards is looked for with AVX2 or SSE2
+// depending on what the CPU supports and every hit is then verified against
+// the whole pattern.
+auto scan(
+    const uint8_t* data,
+    std::size_t search_size,
+    std::size_t size,
+    const pattern& p,
+    std::uintptr_t base,
+    std::vector<std::uintptr_t>& out
+) -> void;
+
+struct find_result {
+    // Sorted addresses of the matches, only the lowest ones past the limit.
+    std::vector<std::uintptr_t> matches;
+    // Number of matches, including the ones that were not kept.
+    std::size_t count = 0;
+    // Bytes of the ranges that could not be read, and so were not searched.
+    std::size_t unreadable = 0;
+};
+
+// Looks for all the matches of p in ranges. The ranges are split in large
+// chunks that are read and scanned by a pool of threads. The threads are not
+// the tracer, so the memory of a live debugee is read with process_vm_readv
+// and not through the target, whose PTRACE_PEEKDATA fallback would fail.
+// Other targets must support concurrent reads, a mapped core file does.
+// Pages that cannot be read are skipped and counted.
+//
+// At most max_matches addresses are kept, the other matches are only
+// counted, so that a pattern matching most of the memory does not need as
+// much memory to hold the result.
+[[nodiscard]]
+auto find(
+    target::target& debugee,
+    const std::vector<address_range>& ranges,
+    const pattern& p,
+    std::size_t max_matches
+) -> find_result;
+
+}
@@ -0,0 +1,165 @@
+#pragma once
+#include "nkgt/error_codes.hpp"
+#include "nkgt/maps.hpp"
+#include "nkgt/symbols.hpp"
+#include "nkgt/target.hpp"
+
+#include <tl/expected.hpp>
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace nkgt::shared_libraries {
+
+// Node of the list of loaded objects kept by the dynamic loader, struct
+// link_map in <link.h>.
+struct link_entry {
+    // Address of the node in the debugee.
+    std::uintptr_t node;
+    // l_addr, the difference between the addresses in the debugee and the
+    // ones in the file.
+    std::uintptr_t load_bias;
+    // l_name and the path read from it. The path is empty for the program
+    // itself.
+    std::uintptr_t name_address;
+    std::string path;
+};
+
+[[nodiscard]]
+auto operator==(const link_entry& a, const link_entry& b) -> bool;
+
+// Reads the chain of link_map nodes starting at head. The path of a node that
+// is in known (same node, bias and name pointer) is taken from there instead
+// of being read again, so that following a program that loads hundreds of
+// libraries costs one small read per library and per change.
+[[nodiscard]]
+auto read_link_map(
+    target::target& debugee,
+    std::uintptr_t head,
+    const std::vector<link_entry>& known
+) -> tl::expected<std::vector<link_entry>, error::shared_libraries>;
+
+struct link_map_diff {
+    std::vector<link_entry> added;
+    std::vector<link_entry> removed;
+};
+
+[[nodiscard]]
+auto diff(
+    const std::vector<link_entry>& before,
+    const std::vector<link_entry>& after
+) -> link_map_diff;
+
+// A shared library of the debugee. Its symbols are read on a background
+// thread and symbols() only blocks if that has not finished yet.
+class library {
+public:
+    library(
+        link_entry entry,
+        std::shared_future<std::optional<symbols::symbol_table>> symbols
+    ) : entry_(std::move(entry)), symbols_(std::move(symbols)) {}
+
+    [[nodiscard]]
+    auto entry() const -> const link_entry& { return entry_; }
+
+    // Returns nullptr if the file could not be read.
+    [[nodiscard]]
+    auto symbols() const -> const symbols::symbol_table*;
+
+    // Returns the address in the debugee of the function called name.
+    [[nodiscard]]
+    auto resolve(std::string_view name) const -> std::optional<std::uintptr_t>;
+
+    // Returns true if address, in the debugee, falls in one of the functions
+    // of the library.
+    [[nodiscard]]
+    auto contains(std::uintptr_t address) const -> bool;
+
+private:
+    link_entry entry_;
+    std::shared_future<std::optional<symbols::symbol_table>> symbols_;
+};
+
+// Changes to the libraries of the debugee, see tracker::update().
+struct library_changes {
+    std::vector<const library*> loaded;
+    std::vector<std::unique_ptr<library>> unloaded;
+};
+
+// Follows the libraries the debugee loads and unloads through the rendezvous
+// protocol of the dynamic loader (see <link.h>). The loader calls
+// _dl_debug_state() before and after every change to its list of objects,
+// so a breakpoint there reports each dlopen() and dlclose(), as well as the
+// libraries loaded at startup.
+class tracker {
+public:
+    tracker(std::uintptr_t breakpoint_address, std::uintptr_t dynamic_address);
+    tracker(const tracker&) = delete;
+    tracker& operator=(const tracker&) = delete;
+    ~tracker();
+
+    // Address of _dl_debug_state() in the debugee.
+    [[nodiscard]]
+    auto breakpoint_address() const -> std::uintptr_t { return breakpoint_address_; }
+
+    // Must be called when the debugee stops at breakpoint_address(). Compares
+    // the list of objects of the loader with the one of the previous call and
+    // queues the symbols of the new libraries for loading. Returns no changes
+    // while the loader is in the middle of an update.
+    [[nodiscard]]
+    auto update(target::target& debugee) -> tl::expected<library_changes, error::shared_libraries>;
+
+    // In load order.
+    [[nodiscard]]
+    auto libraries() const -> const std::vector<std::unique_ptr<library>>& { return libraries_; }
+
+    // Returns the address of the function called name in the first library
+    // defining it, and that library. Waits for the symbols of the libraries
+    // that are still being loaded.
+    [[nodiscard]]
+    auto resolve(std::string_view name) const -> std::optional<std::pair<std::uintptr_t, const library*>>;
+
+private:
+    struct job {
+        std::filesystem::path path;
+        std::promise<std::optional<symbols::symbol_table>> symbols;
+    };
+
+    auto load_symbols() -> void;
+
+    std::uintptr_t breakpoint_address_;
+    // Runtime address of the dynamic section of the program, where the loader
+    // stores the address of its r_debug (DT_DEBUG).
+    std::uintptr_t dynamic_address_;
+    std::uintptr_t r_debug_address_ = 0;
+
+    std::vector<link_entry> entries_;
+    std::vector<std::unique_ptr<library>> libraries_;
+
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::deque<job> jobs_;
+    bool stopping_ = false;
+    std::thread loader_;
+};
+
+// Locates the dynamic loader of the debugee, which must be a live process,
+// through its auxiliary vector. Fails for statically linked programs.
+[[nodiscard]]
+auto start_tracking(
+    target::target& debugee,
+    maps::address_space& memory_map
+) -> tl::expected<std::unique_ptr<tracker>, error::shared_libraries>;
+
+}
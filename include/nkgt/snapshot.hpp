@@ -0,0 +1,75 @@
+#pragma once
+#include "nkgt/error_codes.hpp"
+#include "nkgt/target.hpp"
+
+#include <tl/expected.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <sys/types.h>
+#include <vector>
+
+namespace nkgt::snapshot {
+
+// [start, start + size) in the address space of the debugee.
+struct byte_range {
+    std::uintptr_t start;
+    std::size_t size;
+};
+
+// Byte of the debugee that the debugger replaced, like the 0xcc of a
+// breakpoint, and its original value.
+struct patch {
+    std::uintptr_t address;
+    uint8_t original;
+};
+
+// Takes a snapshot of the whole memory of the stopped debugee and returns the
+// PID of the process holding it.
+//
+// The snapshot is a fork of the debugee (see checkpoint::fork_debugee()), so
+// the old content of every page is preserved by copy on write without being
+// copied upfront. Right after the fork the soft-dirty bits of the debugee are
+// cleared, so that diff() only needs to look at the pages written since then.
+[[nodiscard]]
+auto take(target::target& debugee) -> tl::expected<pid_t, error::snapshot>;
+
+// Returns the ranges of bytes that differ between the current memory of the
+// debugee and the snapshot, sorted by address. Only the pages marked as
+// soft-dirty in /proc/pid/pagemap are read and compared, so the cost is
+// proportional to the amount of memory written since take().
+//
+// Pages that were not mapped when the snapshot was taken are reported as a
+// single range covering them.
+//
+// The original bytes of patches are put back on both sides before comparing,
+// so that breakpoints set or removed since take() are not reported. They
+// should include the patches present at the time of the snapshot.
+[[nodiscard]]
+auto diff(
+    target::target& debugee,
+    pid_t snapshot_pid,
+    const std::vector<patch>& patches
+) -> tl::expected<std::vector<byte_range>, error::snapshot>;
+
+// Puts back the original bytes of the patches that fall in the size bytes at
+// buffer, which were read from address.
+auto hide_patches(
+    std::byte* buffer,
+    std::uintptr_t address,
+    std::size_t size,
+    const std::vector<patch>& patches
+) -> void;
+
+// Appends to out the ranges where the size bytes at a and b differ. Ranges are
+// expressed as addresses relative to base, which is the address of a[0]. It
+// uses SSE2 when available to skip 16 identical bytes per comparison.
+auto diff_bytes(
+    const std::byte* a,
+    const std::byte* b,
+    std::size_t size,
+    std::uintptr_t base,
+    std::vector<byte_range>& out
+) -> void;
+
+}
@@ -0,0 +1,186 @@
+#pragma once
+#include "nkgt/error_codes.hpp"
+
+#include <tl/expected.hpp>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace nkgt::stats {
+
+// Whether the library was built with the instrumentation (-DDEBUGGER_STATS=ON).
+#ifdef NKGT_STATS
+inline constexpr bool enabled = true;
+#else
+inline constexpr bool enabled = false;
+#endif
+
+// Latency histogram with log-linear buckets: every power of two is split in
+// sub_buckets linear buckets, so values are kept with a relative error of at
+// most 1 / sub_buckets whatever their magnitude. Values are updated with
+// relaxed atomics, so that any thread can record without locking.
+class histogram {
+public:
+    static constexpr std::size_t sub_bucket_bits = 4;
+    static constexpr std::size_t sub_buckets = std::size_t{1} << sub_bucket_bits;
+    // Values of 2^(max_exponent + 1) and above (about 36 minutes in ns) all
+    // land in the last bucket.
+    static constexpr std::size_t max_exponent = 40;
+    static constexpr std::size_t bucket_count = (max_exponent - sub_bucket_bits + 2) * sub_buckets;
+
+    auto record(uint64_t value) -> void {
+        buckets_[bucket_of(value)].fetch_add(1, std::memory_order_relaxed);
+        count_.fetch_add(1, std::memory_order_relaxed);
+        sum_.fetch_add(value, std::memory_order_relaxed);
+
+        uint64_t current = max_.load(std::memory_order_relaxed);
+        while(value > current && !max_.compare_exchange_weak(current, value, std::memory_order_relaxed)) {}
+    }
+
+    [[nodiscard]]
+    auto count() const -> uint64_t { return count_.load(std::memory_order_relaxed); }
+
+    [[nodiscard]]
+    auto sum() const -> uint64_t { return sum_.load(std::memory_order_relaxed); }
+
+    [[nodiscard]]
+    auto max() const -> uint64_t { return max_.load(std::memory_order_relaxed); }
+
+    // Returns the upper bound of the bucket holding the value below which a
+    // fraction p of the recorded values fall, capped at max(). 0 when
+    // nothing has been recorded.
+    [[nodiscard]]
+    auto percentile(double p) const -> uint64_t;
+
+    auto reset() -> void;
+
+    [[nodiscard]]
+    static constexpr auto bucket_of(uint64_t value) -> std::size_t {
+        if(value < sub_buckets) {
+            return value;
+        }
+
+        const auto exponent = static_cast<std::size_t>(63 - __builtin_clzll(value));
+        if(exponent > max_exponent) {
+            return bucket_count - 1;
+        }
+
+        const auto sub_bucket = (value >> (exponent - sub_bucket_bits)) & (sub_buckets - 1);
+        return (exponent - sub_bucket_bits + 1) * sub_buckets + sub_bucket;
+    }
+
+    // Largest value that falls in bucket.
+    [[nodiscard]]
+    static constexpr auto bucket_upper_bound(std::size_t bucket) -> uint64_t {
+        if(bucket < sub_buckets) {
+            return bucket;
+        }
+
+        const std::size_t exponent = bucket / sub_buckets + sub_bucket_bits - 1;
+        const uint64_t sub_bucket = bucket % sub_buckets;
+        return ((sub_buckets + sub_bucket + 1) << (exponent - sub_bucket_bits)) - 1;
+    }
+
+private:
+    std::array<std::atomic<uint64_t>, bucket_count> buckets_ = {};
+    std::atomic<uint64_t> count_ = 0;
+    std::atomic<uint64_t> sum_ = 0;
+    std::atomic<uint64_t> max_ = 0;
+};
+
+// A place in the code whose latency is measured. Call sites are static
+// objects created by NKGT_STATS_SCOPE() where they are used, which add
+// themselves to a global list the first time they are reached.
+class call_site {
+public:
+    call_site(const char* name, const char* file, int line);
+
+    call_site(const call_site&) = delete;
+    call_site& operator=(const call_site&) = delete;
+
+    const char* const name;
+    const char* const file;
+    const int line;
+    histogram latency;
+
+private:
+    friend auto sites() -> std::vector<const call_site*>;
+    friend auto reset() -> void;
+
+    call_site* next_ = nullptr;
+};
+
+// Records in site the time elapsed between its construction and destruction,
+// in nanoseconds.
+class scoped_timer {
+public:
+    explicit scoped_timer(call_site& site)
+        : site_(site), start_(std::chrono::steady_clock::now()) {}
+
+    scoped_timer(const scoped_timer&) = delete;
+    scoped_timer& operator=(const scoped_timer&) = delete;
+
+    ~scoped_timer() {
+        const auto elapsed = std::chrono::steady_clock::now() - start_;
+        site_.latency.record(static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()
+        ));
+    }
+
+private:
+    call_site& site_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+// Formats a duration in nanoseconds with the most readable unit, e.g. 1.5us.
+[[nodiscard]]
+auto format_duration(uint64_t ns) -> std::string;
+
+// All the call sites reached so far, sorted by name and then by location.
+[[nodiscard]]
+auto sites() -> std::vector<const call_site*>;
+
+// Clears the histograms of all the call sites.
+auto reset() -> void;
+
+// Prints a table with count, p50, p99 and max of every call site.
+auto print(std::FILE* out) -> void;
+
+// Same data as print(), as a JSON document. Times are in nanoseconds.
+[[nodiscard]]
+auto to_json() -> std::string;
+
+[[nodiscard]]
+auto dump(const std::filesystem::path& path) -> tl::expected<void, error::stats>;
+
+}
+
+// Instrumentation points. NKGT_STATS_SCOPE(name) times the rest of the
+// enclosing scope, NKGT_STATS_TIME(name, expression) evaluates and times a
+// single expression. Without NKGT_STATS they expand to nothing and to the
+// bare expression.
+#ifdef NKGT_STATS
+#define NKGT_STATS_CONCAT_IMPL(a, b) a##b
+#define NKGT_STATS_CONCAT(a, b) NKGT_STATS_CONCAT_IMPL(a, b)
+
+#define NKGT_STATS_SCOPE(name)                                                                 \
+    static ::nkgt::stats::call_site NKGT_STATS_CONCAT(nkgt_stats_site_, __LINE__)(             \
+        name, __FILE__, __LINE__                                                               \
+    );                                                                                         \
+    const ::nkgt::stats::scoped_timer NKGT_STATS_CONCAT(nkgt_stats_timer_, __LINE__)(          \
+        NKGT_STATS_CONCAT(nkgt_stats_site_, __LINE__)                                          \
+    )
+
+#define NKGT_STATS_TIME(name, ...) \
+    [&]() { NKGT_STATS_SCOPE(name); return __VA_ARGS__; }()
+#else
+#define NKGT_STATS_SCOPE(name) static_cast<void>(0)
+#define NKGT_STATS_TIME(name, ...) (__VA_ARGS__)
+#endif
@@ -0,0 +1,96 @@
+#pragma once
+#include "nkgt/symbols.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace nkgt::symbol_index {
+
+// Case insensitive substring search over the demangled names of the
+// functions of a symbol table.
+//
+// Every trigram of every name maps to the list of the functions containing
+// it, stored as delta encoded varints. A query intersects the lists of its
+// trigrams, starting from the shortest, and only checks the few names that
+// survive. Queries shorter than a trigram are answered from the names sorted
+// alphabetically instead.
+class symbol_index {
+public:
+    // The symbols must outlive the index, their names are not copied.
+    explicit symbol_index(const std::vector<symbols::symbol>& functions);
+
+    // Returns up to max_results names (mangled, as in the symbol table) whose
+    // demangled form contains query, best matches first: exact matches, then
+    // names whose unqualified part starts with query, then names starting
+    // with it, then names where it starts a scope or a word, then the others.
+    // Ties go to the shortest name. Only the first few thousand candidates, in
+    // order of length, are looked at.
+    [[nodiscard]]
+    auto search(std::string_view query, std::size_t max_results) const -> std::vector<std::string_view>;
+
+    [[nodiscard]]
+    auto size() const -> std::size_t { return names_.size(); }
+
+    // Position in postings_ of an id of a posting list, and the previous id
+    // of the list plus one, from which decoding can resume.
+    struct skip {
+        uint64_t offset;
+        uint32_t base;
+    };
+
+private:
+    // Mangled names.
+    std::vector<std::string_view> names_;
+    // Demangled and case folded names, one after the other.
+    std::string folded_;
+    std::vector<std::size_t> folded_offsets_;
+    // Ids of the names sorted by folded name.
+    std::vector<uint32_t> sorted_;
+
+    // Postings of trigram t are the bytes [posting_offsets_[t],
+    // posting_offsets_[t + 1]) of postings_, posting_counts_[t] ids.
+    std::vector<uint64_t> posting_offsets_;
+    std::vector<uint32_t> posting_counts_;
+    std::vector<uint8_t> postings_;
+    // Skips of trigram t are [skip_offsets_[t], skip_offsets_[t + 1]).
+    std::vector<skip> skips_;
+    std::vector<uint64_t> skip_offsets_;
+
+    [[nodiscard]]
+    auto folded(uint32_t id) const -> std::string_view;
+
+    [[nodiscard]]
+    auto rank_matches(
+        std::string_view q,
+        const std::vector<uint32_t>& candidates,
+        std::size_t max_results
+    ) const -> std::vector<std::string_view>;
+};
+
+// Builds a symbol_index on a separate thread, so that loading a large program
+// does not delay the prompt.
+class background_index {
+public:
+    // The symbols must outlive this object.
+    explicit background_index(const std::vector<symbols::symbol>& functions);
+    background_index(const background_index&) = delete;
+    background_index& operator=(const background_index&) = delete;
+    ~background_index();
+
+    // Returns the index, or nullptr while it is still being built.
+    [[nodiscard]]
+    auto get() const -> const symbol_index* { return ready_.load(std::memory_order_acquire); }
+
+private:
+    std::unique_ptr<symbol_index> index_;
+    std::atomic<const symbol_index*> ready_ = nullptr;
+    std::thread thread_;
+};
+
+}
@@ -0,0 +1,64 @@
+#pragma once
+#include "nkgt/error_codes.hpp"
+
+#include <tl/expected.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace nkgt::symbols {
+
+// Function symbol from the ELF symbol table. address is the link time one, it
+// has to be translated by the load bias of the module to obtain the address
+// in the running process.
+struct symbol {
+    std::string name;
+    std::uintptr_t address;
+    std::size_t size;
+};
+
+class symbol_table {
+public:
+    // Returns the function containing address, or nullptr if there is none.
+    // Symbols with a size of 0 are considered to extend until the next one.
+    [[nodiscard]]
+    auto lookup(std::uintptr_t address) const -> const symbol*;
+
+    // Returns the first function with the given name, or nullptr.
+    [[nodiscard]]
+    auto find(std::string_view name) const -> const symbol*;
+
+    // Sorted by address.
+    [[nodiscard]]
+    auto functions() const -> const std::vector<symbol>& { return functions_; }
+
+    // Virtual address the file expects to be loaded at, that is the address
+    // of its first byte. It is 0 for PIE and shared libraries.
+    [[nodiscard]]
+    auto load_base() const -> std::uintptr_t { return load_base_; }
+
+    [[nodiscard]]
+    auto path() const -> const std::filesystem::path& { return path_; }
+
+private:
+    friend auto load_symbols(
+        const std::filesystem::path& path
+    ) -> tl::expected<symbol_table, error::debug_symbols>;
+
+    std::filesystem::path path_;
+    std::uintptr_t load_base_ = 0;
+    std::vector<symbol> functions_;
+};
+
+// Reads the function symbols of an ELF file from .symtab, or from .dynsym
+// when the file has been stripped.
+[[nodiscard]]
+auto load_symbols(
+    const std::filesystem::path& path
+) -> tl::expected<symbol_table, error::debug_symbols>;
+
+}
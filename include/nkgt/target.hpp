@@ -0,0 +1,227 @@
+#pragma once
+#include "nkgt/error_codes.hpp"
+#include "nkgt/maps.hpp"
+
+#include <tl/expected.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <sys/types.h>
+#include <sys/user.h>
+#include <vector>
+
+namespace nkgt::target {
+
+// Raw x87/SSE/AVX state of the debugee. When is_xsave is true data is an XSAVE
+// area in standard format, as returned by PTRACE_GETREGSET with NT_X86_XSTATE.
+// Otherwise it only holds the 512 bytes FXSAVE area (user_fpregs_struct).
+struct extended_state {
+    std::vector<std::byte> data;
+    bool is_xsave;
+};
+
+// One element of a scatter read, see target::read_memory_scatter().
+struct memory_request {
+    std::uintptr_t address;
+    void* buffer;
+    std::size_t size;
+};
+
+// Everything the debugger needs to know about the debugee (its registers and
+// its memory) goes through this interface. This way the same commands work on
+// a live process traced with ptrace and on a core file.
+class target {
+public:
+    virtual ~target() = default;
+
+    [[nodiscard]]
+    virtual auto read_registers(
+    ) -> tl::expected<user_regs_struct, error::registers> = 0;
+
+    [[nodiscard]]
+    virtual auto write_registers(
+        const user_regs_struct& regs
+    ) -> tl::expected<void, error::registers> = 0;
+
+    // The extended state is several KB, so it is only fetched the first time
+    // it is requested and then cached until invalidate_caches() is called.
+    // The returned pointer is valid until then.
+    [[nodiscard]]
+    virtual auto read_extended_state(
+    ) -> tl::expected<const extended_state*, error::registers> = 0;
+
+    // Must be called every time the debugee runs, even for a single step.
+    virtual auto invalidate_caches() -> void = 0;
+
+    // Copies size bytes starting at address in the debugee into buffer. The
+    // read either succeeds completely or fails, partial reads are reported as
+    // errors.
+    [[nodiscard]]
+    virtual auto read_memory(
+        std::uintptr_t address,
+        void* buffer,
+        std::size_t size
+    ) -> tl::expected<void, error::memory> = 0;
+
+    [[nodiscard]]
+    virtual auto write_memory(
+        std::uintptr_t address,
+        const void* buffer,
+        std::size_t size
+    ) -> tl::expected<void, error::memory> = 0;
+
+    // Performs all the count reads at once. The default implementation simply
+    // calls read_memory() for each of them.
+    [[nodiscard]]
+    virtual auto read_memory_scatter(
+        const memory_request* requests,
+        std::size_t count
+    ) -> tl::expected<void, error::memory>;
+
+    // A live target can be resumed and can have breakpoints inserted. A core
+    // file can only be inspected.
+    [[nodiscard]]
+    virtual auto is_live() const -> bool = 0;
+
+    [[nodiscard]]
+    virtual auto pid() const -> pid_t = 0;
+};
+
+// Target backed by a live process. The process must already be stopped and
+// traced by the calling thread.
+class ptrace_target final : public target {
+public:
+    explicit ptrace_target(pid_t pid) : pid_(pid) {}
+
+    // The general purpose registers are fetched once per stop and cached, so
+    // that the checks done every time the debugee stops (breakpoint, dynamic
+    // loader, condition) share a single PTRACE_GETREGS.
+    auto read_registers(
+    ) -> tl::expected<user_regs_struct, error::registers> override;
+
+    auto write_registers(
+        const user_regs_struct& regs
+    ) -> tl::expected<void, error::registers> override;
+
+    auto read_extended_state(
+    ) -> tl::expected<const extended_state*, error::registers> override;
+
+    auto invalidate_caches() -> void override {
+        regs_.reset();
+        extended_state_.reset();
+    }
+
+    auto read_memory(
+        std::uintptr_t address,
+        void* buffer,
+        std::size_t size
+    ) -> tl::expected<void, error::memory> override;
+
+    auto write_memory(
+        std::uintptr_t address,
+        const void* buffer,
+        std::size_t size
+    ) -> tl::expected<void, error::memory> override;
+
+    // Moves all the requests with as few process_vm_readv calls as possible
+    // (IOV_MAX requests per call).
+    auto read_memory_scatter(
+        const memory_request* requests,
+        std::size_t count
+    ) -> tl::expected<void, error::memory> override;
+
+    auto is_live() const -> bool override { return true; }
+    auto pid() const -> pid_t override { return pid_; }
+
+private:
+    pid_t pid_;
+    std::optional<user_regs_struct> regs_;
+    std::optional<extended_state> extended_state_;
+};
+
+// Target backed by an ELF core file. The file is mapped read only and every
+// query is answered directly from the mapping: the registers come from the
+// NT_PRSTATUS note and the memory from the PT_LOAD segments. Nothing is copied
+// upfront, so opening a multi-GB core is instantaneous.
+class core_target final : public target {
+public:
+    struct segment {
+        std::uintptr_t address;
+        std::size_t memory_size;
+        std::size_t file_offset;
+        std::size_t file_size;
+    };
+
+    core_target(const core_target&) = delete;
+    core_target& operator=(const core_target&) = delete;
+    ~core_target() override;
+
+    auto read_registers(
+    ) -> tl::expected<user_regs_struct, error::registers> override;
+
+    auto write_registers(
+        const user_regs_struct& regs
+    ) -> tl::expected<void, error::registers> override;
+
+    // From the NT_X86_XSTATE note, or NT_PRFPREG when it is missing.
+    auto read_extended_state(
+    ) -> tl::expected<const extended_state*, error::registers> override;
+
+    // The content of a core file never changes.
+    auto invalidate_caches() -> void override {}
+
+    auto read_memory(
+        std::uintptr_t address,
+        void* buffer,
+        std::size_t size
+    ) -> tl::expected<void, error::memory> override;
+
+    auto write_memory(
+        std::uintptr_t address,
+        const void* buffer,
+        std::size_t size
+    ) -> tl::expected<void, error::memory> override;
+
+    auto is_live() const -> bool override { return false; }
+    auto pid() const -> pid_t override { return pid_; }
+
+    // Returns a pointer inside the mapped core file for the size bytes at
+    // address, or nullptr if the range is not entirely backed by the file
+    // (e.g. it crosses a segment boundary or it falls in a zero filled tail).
+    [[nodiscard]]
+    auto view(std::uintptr_t address, std::size_t size) const -> const std::byte*;
+
+    [[nodiscard]]
+    auto segments() const -> const std::vector<segment>& { return segments_; }
+
+    // File backed mappings of the process, from the NT_FILE note. Only the
+    // address range, the offset and the path of each region are known.
+    [[nodiscard]]
+    auto mappings() const -> const std::vector<maps::region>& { return mappings_; }
+
+private:
+    friend auto load_core(
+        const std::filesystem::path& core_path
+    ) -> tl::expected<std::unique_ptr<core_target>, error::core_file>;
+
+    core_target() = default;
+
+    const std::byte* data_ = nullptr;
+    std::size_t size_ = 0;
+    pid_t pid_ = 0;
+    user_regs_struct regs_ = {};
+    std::optional<extended_state> extended_state_;
+    // Sorted by address.
+    std::vector<segment> segments_;
+    std::vector<maps::region> mappings_;
+};
+
+[[nodiscard]]
+auto load_core(
+    const std::filesystem::path& core_path
+) -> tl::expected<std::unique_ptr<core_target>, error::core_file>;
+
+}
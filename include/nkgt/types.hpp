@@ -0,0 +1,106 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace nkgt::types {
+
+// Index of a type in its type_graph.
+using type_id = uint32_t;
+
+// Stands for void, e.g. as the target of a void*.
+constexpr type_id no_type = std::numeric_limits<type_id>::max();
+
+enum class kind : uint8_t {
+    signed_integer,
+    unsigned_integer,
+    floating_point,
+    boolean,
+    character,
+    pointer,
+    reference,
+    structure,   // struct and class
+    union_type,
+    array,
+    enumeration,
+    typedef_alias,
+    qualified,   // const, volatile and restrict, name holds the qualifier
+    opaque,      // anything that can only be printed as bytes
+};
+
+struct member {
+    std::string name;
+    type_id type;
+    uint64_t offset;
+    // Bit fields only, the offset of the first bit from offset.
+    uint16_t bit_size;
+    uint16_t bit_offset;
+    // True for base classes, whose name is the one of the class.
+    bool is_base;
+};
+
+struct enumerator {
+    std::string name;
+    int64_t value;
+};
+
+struct type {
+    kind k;
+    std::string name;
+    std::size_t size;
+    // Pointee, array element, underlying type of enumerations, typedefs and
+    // qualifiers.
+    type_id target = no_type;
+    // Number of elements of an array. Arrays with more dimensions are arrays of
+    // arrays.
+    uint64_t count = 0;
+    std::vector<member> members;
+    std::vector<enumerator> enumerators;
+    std::vector<type_id> template_arguments;
+};
+
+// Member found by type_graph::find_member(), offset is relative to the start
+// of the object it was looked up in.
+struct member_location {
+    uint64_t offset;
+    type_id type;
+};
+
+// Every type reachable from the variables printed so far. Types refer to each
+// other by id, so the graph can be cyclic (a struct with a pointer to itself).
+class type_graph {
+public:
+    // The reference returned by at() is invalidated by add().
+    auto add(type t) -> type_id;
+
+    [[nodiscard]]
+    auto at(type_id id) const -> const type& { return types_[id]; }
+
+    [[nodiscard]]
+    auto at(type_id id) -> type& { return types_[id]; }
+
+    [[nodiscard]]
+    auto size() const -> std::size_t { return types_.size(); }
+
+    // Follows typedefs and qualifiers.
+    [[nodiscard]]
+    auto strip(type_id id) const -> type_id;
+
+    // The name of the type as it would be written in C++, e.g. "const char*".
+    [[nodiscard]]
+    auto display_name(type_id id) const -> std::string;
+
+    // Looks name up between the data members of a struct, class or union and
+    // then, recursively, between the ones of its base classes.
+    [[nodiscard]]
+    auto find_member(type_id id, std::string_view name) const -> std::optional<member_location>;
+
+private:
+    std::vector<type> types_;
+};
+
+}
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <array>
+#include <cstddef>
 #include <vector>
 #include <string_view>
 
@@ -18,6 +20,45 @@ void print_error_message(const char* procedure_name, int error_number);
 // Example: split("  a   bb ", ' ') -> {"a", "bb"}
 std::vector<std::string_view> split(std::string_view source, char delimiter);
 
+// Fields of a command line, filled by tokenize(). The storage is fixed, so that
+// tokenizing a line never allocates.
+class tokens {
+public:
+    static constexpr std::size_t capacity = 16;
+
+    [[nodiscard]]
+    auto size() const -> std::size_t { return size_; }
+
+    [[nodiscard]]
+    auto empty() const -> bool { return size_ == 0; }
+
+    auto operator[](std::size_t i) const -> std::string_view { return tokens_[i]; }
+
+    auto begin() const -> const std::string_view* { return tokens_.data(); }
+    auto end() const -> const std::string_view* { return tokens_.data() + size_; }
+
+    auto clear() -> void { size_ = 0; }
+
+    // Returns false when the capacity is exhausted.
+    [[nodiscard]]
+    auto push_back(std::string_view token) -> bool {
+        if(size_ == capacity) {
+            return false;
+        }
+
+        tokens_[size_++] = token;
+        return true;
+    }
+
+private:
+    std::array<std::string_view, capacity> tokens_;
+    std::size_t size_ = 0;
+};
+
+// Same as split(source, ' '), but the fields are stored in out. Returns false
+// if there are more than tokens::capacity of them.
+bool tokenize(std::string_view source, tokens& out);
+
 // Check if prefix is a prefix of full. That is, if full is equal to or starts
 // with prefix.
 bool is_prefix(std::string_view prefix, std::string_view full);
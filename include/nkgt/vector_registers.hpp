@@ -0,0 +1,56 @@
+#pragma once
+#include "nkgt/error_codes.hpp"
+#include "nkgt/target.hpp"
+
+#include <tl/expected.hpp>
+
+#include <array>
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+namespace nkgt::registers {
+
+enum class vector_kind {
+    st,  // x87 st0-st7, 80 bits
+    xmm, // xmm0-xmm31, 128 bits
+    ymm, // ymm0-ymm31, 256 bits
+    zmm, // zmm0-zmm31, 512 bits
+    k,   // AVX-512 opmask k0-k7, 64 bits
+};
+
+struct vector_reg {
+    vector_kind kind;
+    unsigned index;
+};
+
+struct vector_value {
+    std::array<std::byte, 64> bytes;
+    std::size_t size;
+};
+
+// Parses names such as xmm0, ymm3, zmm17, k1 or st7.
+[[nodiscard]]
+auto vector_from_string(std::string_view name) -> tl::expected<vector_reg, error::registers>;
+
+// Reads the register from the extended state of the debugee. The XSAVE area is
+// decoded according to the XCR0 value the kernel stores in it, registers whose
+// component is enabled but in its initial state read as zero. Registers not
+// supported by the CPU fail with unavailable_register.
+[[nodiscard]]
+auto get_vector_register_value(
+    target::target& debugee,
+    vector_reg r
+) -> tl::expected<vector_value, error::registers>;
+
+// Formats the value according to a view such as v8_float or v4_int64, that
+// is v<lanes>_<type> with type one of int8/16/32/64, uint8/16/32/64, float and
+// double. The lanes must cover the register exactly. An empty view prints
+// 64 bit hex lanes (or the floating point value for st registers).
+[[nodiscard]]
+auto format_vector_value(
+    const vector_value& value,
+    std::string_view view
+) -> tl::expected<std::string, error::registers>;
+
+}
@@ -0,0 +1,120 @@
+#include "nkgt/checkpoint.hpp"
+#include "nkgt/error_codes.hpp"
+#include "nkgt/target.hpp"
+#include "nkgt/util.hpp"
+
+#include <tl/expected.hpp>
+
+#include <array>
+#include <cerrno>
+#include <csignal>
+#include <cstdint>
+#include <sys/ptrace.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+
+namespace {
+
+// Encoding of the x86_64 syscall instruction.
+constexpr std::array<uint8_t, 2> syscall_instruction = {0x0f, 0x05};
+
+// Puts back the code and the registers the debugee had before the injection.
+[[nodiscard]]
+auto restore(
+    nkgt::target::target& process,
+    std::uintptr_t pc,
+    const std::array<uint8_t, 2>& code,
+    const user_regs_struct& regs
+) -> bool {
+    return process.write_memory(pc, code.data(), code.size()) &&
+           process.write_registers(regs);
+}
+
+[[nodiscard]]
+auto step(pid_t pid, int& wait_status) -> bool {
+    if(ptrace(PTRACE_SINGLESTEP, pid, nullptr, nullptr) == -1) {
+        nkgt::util::print_error_message("ptrace", errno);
+        return false;
+    }
+
+    return waitpid(pid, &wait_status, 0) == pid && WIFSTOPPED(wait_status);
+}
+
+}
+
+namespace nkgt::checkpoint {
+
+auto fork_debugee(
+    target::target& debugee
+) -> tl::expected<pid_t, error::checkpoint> {
+    const pid_t pid = debugee.pid();
+
+    const auto saved_regs = debugee.read_registers();
+    if(!saved_regs) {
+        return tl::make_unexpected(error::checkpoint::inject_fail);
+    }
+
+    const std::uintptr_t pc = saved_regs->rip;
+    std::array<uint8_t, 2> saved_code;
+    if(!debugee.read_memory(pc, saved_code.data(), saved_code.size())) {
+        return tl::make_unexpected(error::checkpoint::inject_fail);
+    }
+
+    user_regs_struct regs = *saved_regs;
+    regs.rax = SYS_fork;
+
+    if(!debugee.write_memory(pc, syscall_instruction.data(), syscall_instruction.size()) ||
+       !debugee.write_registers(regs)) {
+        (void)restore(debugee, pc, saved_code, *saved_regs);
+        return tl::make_unexpected(error::checkpoint::inject_fail);
+    }
+
+    // With PTRACE_O_TRACEFORK the child is traced from its very first
+    // instruction and the debugee reports the fork with PTRACE_EVENT_FORK.
+    if(ptrace(PTRACE_SETOPTIONS, pid, nullptr, PTRACE_O_EXITKILL | PTRACE_O_TRACEFORK) == -1) {
+        util::print_error_message("ptrace", errno);
+        (void)restore(debugee, pc, saved_code, *saved_regs);
+        return tl::make_unexpected(error::checkpoint::inject_fail);
+    }
+
+    int wait_status = 0;
+    pid_t child = -1;
+    const bool stepped = step(pid, wait_status);
+
+    if(stepped && wait_status >> 8 == (SIGTRAP | (PTRACE_EVENT_FORK << 8))) {
+        unsigned long message = 0;
+        if(ptrace(PTRACE_GETEVENTMSG, pid, nullptr, &message) == -1) {
+            util::print_error_message("ptrace", errno);
+        } else {
+            child = static_cast<pid_t>(message);
+        }
+
+        // The event stop happens inside the syscall, one more step completes it.
+        (void)step(pid, wait_status);
+    }
+
+    ptrace(PTRACE_SETOPTIONS, pid, nullptr, PTRACE_O_EXITKILL);
+    debugee.invalidate_caches();
+
+    const bool restored = restore(debugee, pc, saved_code, *saved_regs);
+
+    if(child == -1) {
+        return tl::make_unexpected(error::checkpoint::fork_fail);
+    }
+
+    // The child starts with a SIGSTOP that must be consumed before it can be
+    // manipulated. __WALL is needed since the child is not ours.
+    waitpid(child, &wait_status, __WALL);
+    ptrace(PTRACE_SETOPTIONS, child, nullptr, PTRACE_O_EXITKILL);
+
+    target::ptrace_target child_process(child);
+    if(!restored || !restore(child_process, pc, saved_code, *saved_regs)) {
+        kill(child, SIGKILL);
+        waitpid(child, &wait_status, __WALL);
+        return tl::make_unexpected(error::checkpoint::inject_fail);
+    }
+
+    return child;
+}
+
+}
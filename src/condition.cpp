@@ -0,0 +1,448 @@
+#include "nkgt/condition.hpp"
+#include "nkgt/error_codes.hpp"
+#include "nkgt/registers.hpp"
+
+#include <tl/expected.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <charconv>
+#include <cstring>
+#include <optional>
+
+namespace {
+
+using nkgt::condition::instruction;
+using nkgt::condition::max_loads;
+using nkgt::condition::max_registers;
+using nkgt::condition::opcode;
+
+struct binary_operator {
+    std::string_view token;
+    opcode op;
+    int precedence;
+};
+
+// Same precedence as in C. Tokens that are a prefix of others come after them,
+// so that the first match is the longest one.
+constexpr std::array<binary_operator, 18> binary_operators = {{
+    {"||", opcode::logical_or, 1},
+    {"&&", opcode::logical_and, 2},
+    {"==", opcode::eq, 6},
+    {"!=", opcode::ne, 6},
+    {"<=", opcode::le, 7},
+    {">=", opcode::ge, 7},
+    {"<<", opcode::shl, 8},
+    {">>", opcode::shr, 8},
+    {"|", opcode::bit_or, 3},
+    {"^", opcode::bit_xor, 4},
+    {"&", opcode::bit_and, 5},
+    {"<", opcode::lt, 7},
+    {">", opcode::gt, 7},
+    {"+", opcode::add, 9},
+    {"-", opcode::sub, 9},
+    {"*", opcode::mul, 10},
+    {"/", opcode::div, 10},
+    {"%", opcode::mod, 10},
+}};
+
+using register_file = std::array<uint64_t, max_registers>;
+
+// Memory operands of one evaluation. The first phase writes the addresses,
+// the second one reads the values.
+struct load_state {
+    std::array<uint64_t, max_loads> addresses = {};
+    std::array<uint64_t, max_loads> values = {};
+    // Why a memory operand has no value, reported only if it is used.
+    std::array<std::optional<nkgt::error::condition>, max_loads> errors = {};
+};
+
+// Runs one phase of a program. In the first phase an error only makes the
+// memory operand being computed unavailable.
+[[nodiscard]]
+auto execute(
+    const std::vector<instruction>& code,
+    const std::vector<uint64_t>& constants,
+    const user_regs_struct& regs,
+    bool first_phase,
+    load_state& loads,
+    register_file& r
+) -> tl::expected<void, nkgt::error::condition> {
+    std::optional<nkgt::error::condition> address_error;
+
+    for(std::size_t pc = 0; pc < code.size(); ++pc) {
+        const instruction& i = code[pc];
+        const uint64_t a = r[i.a];
+        const uint64_t b = r[i.b];
+        uint64_t& dst = r[i.dst];
+
+        switch(i.op) {
+        case opcode::constant:
+            dst = constants[i.operand];
+            break;
+        case opcode::reg:
+            std::memcpy(&dst, reinterpret_cast<const std::byte*>(&regs) + i.operand, sizeof(dst));
+            break;
+        case opcode::load:
+            if(loads.errors[i.operand]) {
+                return tl::make_unexpected(*loads.errors[i.operand]);
+            }
+
+            dst = loads.values[i.operand];
+            break;
+        case opcode::address:
+            loads.addresses[i.operand] = a;
+            loads.errors[i.operand] = address_error;
+            address_error.reset();
+            break;
+        case opcode::add:
+            dst = a + b;
+            break;
+        case opcode::sub:
+            dst = a - b;
+            break;
+        case opcode::mul:
+            dst = a * b;
+            break;
+        case opcode::div:
+        case opcode::mod:
+            if(b == 0 && first_phase) {
+                address_error = nkgt::error::condition::division_by_zero;
+                dst = 0;
+                break;
+            }
+
+            if(b == 0) {
+                return tl::make_unexpected(nkgt::error::condition::division_by_zero);
+            }
+
+            dst = i.op == opcode::div ? a / b : a % b;
+            break;
+        case opcode::bit_and:
+            dst = a & b;
+            break;
+        case opcode::bit_or:
+            dst = a | b;
+            break;
+        case opcode::bit_xor:
+            dst = a ^ b;
+            break;
+        // Shifting by 64 or more is undefined in C++, here it clears all the
+        // bits.
+        case opcode::shl:
+            dst = b < 64 ? a << b : 0;
+            break;
+        case opcode::shr:
+            dst = b < 64 ? a >> b : 0;
+            break;
+        case opcode::eq:
+            dst = a == b;
+            break;
+        case opcode::ne:
+            dst = a != b;
+            break;
+        case opcode::lt:
+            dst = a < b;
+            break;
+        case opcode::le:
+            dst = a <= b;
+            break;
+        case opcode::gt:
+            dst = a > b;
+            break;
+        case opcode::ge:
+            dst = a >= b;
+            break;
+        case opcode::logical_and:
+            dst = a != 0 && b != 0;
+            break;
+        case opcode::logical_or:
+            dst = a != 0 || b != 0;
+            break;
+        case opcode::neg:
+            dst = 0 - a;
+            break;
+        case opcode::bit_not:
+            dst = ~a;
+            break;
+        case opcode::logical_not:
+            dst = a == 0;
+            break;
+        case opcode::skip_if_false:
+            if(a == 0) {
+                dst = 0;
+                pc += i.operand;
+            }
+            break;
+        case opcode::skip_if_true:
+            if(a != 0) {
+                dst = 1;
+                pc += i.operand;
+            }
+            break;
+        }
+    }
+
+    return {};
+}
+
+}
+
+namespace nkgt::condition {
+
+// Recursive descent parser emitting code as it goes. Every subexpression is
+// compiled into the register given to it, and uses the following ones for its
+// temporaries, so that registers are allocated like a stack.
+class compiler {
+public:
+    explicit compiler(std::string_view source) : source_(source) {
+        program_.source_ = std::string(source);
+    }
+
+    [[nodiscard]]
+    auto compile() -> tl::expected<program, error::condition> {
+        if(!expression(0, 0)) {
+            return tl::make_unexpected(error_);
+        }
+
+        skip_spaces();
+        if(position_ != source_.size()) {
+            return tl::make_unexpected(error::condition::syntax_error);
+        }
+
+        return std::move(program_);
+    }
+
+private:
+    // Compiles into r[dst] the expression at the current position, up to the
+    // first binary operator binding less tightly than min_precedence.
+    [[nodiscard]]
+    auto expression(uint8_t dst, int min_precedence) -> bool {
+        if(!unary(dst)) {
+            return false;
+        }
+
+        while(true) {
+            skip_spaces();
+
+            const auto* op = std::find_if(binary_operators.cbegin(), binary_operators.cend(), [&](const auto& o) {
+                return source_.substr(position_, o.token.size()) == o.token;
+            });
+
+            if(op == binary_operators.cend() || op->precedence < min_precedence) {
+                return true;
+            }
+
+            if(dst + 1u >= max_registers) {
+                return fail(error::condition::too_complex);
+            }
+
+            position_ += op->token.size();
+            const auto rhs = static_cast<uint8_t>(dst + 1);
+
+            // The right operand of && and || is skipped when the left one
+            // decides the result. The length of the jump is known once it has
+            // been compiled.
+            const bool short_circuit = op->op == opcode::logical_and || op->op == opcode::logical_or;
+            const std::size_t skip = code_->size();
+            if(short_circuit) {
+                emit({op->op == opcode::logical_and ? opcode::skip_if_false : opcode::skip_if_true, dst, dst, 0, 0});
+            }
+
+            if(!expression(rhs, op->precedence + 1)) {
+                return false;
+            }
+
+            emit({op->op, dst, dst, rhs, 0});
+            if(short_circuit) {
+                (*code_)[skip].operand = static_cast<uint32_t>(code_->size() - skip - 1);
+            }
+        }
+    }
+
+    [[nodiscard]]
+    auto unary(uint8_t dst) -> bool {
+        skip_spaces();
+        if(position_ == source_.size()) {
+            return fail(error::condition::syntax_error);
+        }
+
+        const char c = source_[position_];
+
+        if(c == '-' || c == '~' || c == '!') {
+            position_ += 1;
+            if(!unary(dst)) {
+                return false;
+            }
+
+            const opcode op = c == '-' ? opcode::neg : c == '~' ? opcode::bit_not : opcode::logical_not;
+            emit({op, dst, dst, 0, 0});
+            return true;
+        }
+
+        if(c == '*') {
+            if(code_ == &program_.addresses_) {
+                return fail(error::condition::nested_load);
+            }
+
+            if(program_.loads_ == max_loads) {
+                return fail(error::condition::too_complex);
+            }
+
+            // The address goes to the first phase, which has registers of its
+            // own since it runs to completion before the second one starts.
+            position_ += 1;
+            code_ = &program_.addresses_;
+            const bool parsed = unary(0);
+            code_ = &program_.code_;
+
+            if(!parsed) {
+                return false;
+            }
+
+            const auto slot = static_cast<uint32_t>(program_.loads_++);
+            program_.addresses_.push_back({opcode::address, 0, 0, 0, slot});
+            emit({opcode::load, dst, 0, 0, slot});
+            return true;
+        }
+
+        return primary(dst);
+    }
+
+    [[nodiscard]]
+    auto primary(uint8_t dst) -> bool {
+        const char c = source_[position_];
+
+        if(c == '(') {
+            position_ += 1;
+            if(!expression(dst, 0)) {
+                return false;
+            }
+
+            skip_spaces();
+            if(position_ == source_.size() || source_[position_] != ')') {
+                return fail(error::condition::syntax_error);
+            }
+
+            position_ += 1;
+            return true;
+        }
+
+        if(std::isdigit(static_cast<unsigned char>(c)) != 0) {
+            const bool hex = source_.substr(position_, 2) == "0x" || source_.substr(position_, 2) == "0X";
+            const char* first = source_.data() + position_ + (hex ? 2 : 0);
+            const char* last = source_.data() + source_.size();
+
+            uint64_t value = 0;
+            const auto [end, ec] = std::from_chars(first, last, value, hex ? 16 : 10);
+            if(ec != std::errc() || (end != last && is_identifier(*end))) {
+                return fail(error::condition::syntax_error);
+            }
+
+            position_ = static_cast<std::size_t>(end - source_.data());
+            program_.constants_.push_back(value);
+            emit({opcode::constant, dst, 0, 0, static_cast<uint32_t>(program_.constants_.size() - 1)});
+            return true;
+        }
+
+        if(c == '$' || is_identifier(c)) {
+            position_ += c == '$' ? 1 : 0;
+            const std::size_t begin = position_;
+            while(position_ < source_.size() && is_identifier(source_[position_])) {
+                position_ += 1;
+            }
+
+            const auto r = registers::from_string(source_.substr(begin, position_ - begin));
+            if(!r) {
+                return fail(error::condition::unknown_register);
+            }
+
+            emit({opcode::reg, dst, 0, 0, static_cast<uint32_t>(registers::descriptor(*r).offset)});
+            return true;
+        }
+
+        return fail(error::condition::syntax_error);
+    }
+
+    [[nodiscard]]
+    static auto is_identifier(char c) -> bool {
+        return std::isalnum(static_cast<unsigned char>(c)) != 0 || c == '_';
+    }
+
+    auto skip_spaces() -> void {
+        while(position_ < source_.size() && source_[position_] == ' ') {
+            position_ += 1;
+        }
+    }
+
+    auto emit(const instruction& i) -> void {
+        code_->push_back(i);
+    }
+
+    [[nodiscard]]
+    auto fail(error::condition e) -> bool {
+        error_ = e;
+        return false;
+    }
+
+    std::string_view source_;
+    std::size_t position_ = 0;
+    program program_;
+    // Phase the code is emitted to.
+    std::vector<instruction>* code_ = &program_.code_;
+    error::condition error_ = error::condition::syntax_error;
+};
+
+auto program::evaluate(
+    const user_regs_struct& regs,
+    target::target& debugee
+) const -> tl::expected<bool, error::condition> {
+    register_file r = {};
+    load_state loads;
+
+    if(loads_ > 0) {
+        const auto computed = execute(addresses_, constants_, regs, true, loads, r);
+        if(!computed) {
+            return tl::make_unexpected(computed.error());
+        }
+
+        std::array<target::memory_request, max_loads> requests;
+        std::array<std::size_t, max_loads> slots;
+        std::size_t count = 0;
+        for(std::size_t i = 0; i < loads_; ++i) {
+            if(!loads.errors[i]) {
+                requests[count] = {loads.addresses[i], &loads.values[i], sizeof(uint64_t)};
+                slots[count] = i;
+                count += 1;
+            }
+        }
+
+        const bool read = count == 0 || (count == 1
+                        ? debugee.read_memory(requests[0].address, requests[0].buffer, requests[0].size).has_value()
+                        : debugee.read_memory_scatter(requests.data(), count).has_value());
+
+        // Only the operands that cannot be read are unavailable, which takes
+        // reading them one at a time to find out.
+        if(!read) {
+            for(std::size_t i = 0; i < count; ++i) {
+                if(!debugee.read_memory(requests[i].address, requests[i].buffer, requests[i].size)) {
+                    loads.errors[slots[i]] = error::condition::read_fail;
+                }
+            }
+        }
+    }
+
+    const auto result = execute(code_, constants_, regs, false, loads, r);
+    if(!result) {
+        return tl::make_unexpected(result.error());
+    }
+
+    return r[0] != 0;
+}
+
+auto compile(std::string_view expression) -> tl::expected<program, error::condition> {
+    return compiler(expression).compile();
+}
+
+}
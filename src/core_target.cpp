@@ -0,0 +1,365 @@
+#include "nkgt/target.hpp"
+#include "nkgt/error_codes.hpp"
+#include "nkgt/util.hpp"
+
+#include <tl/expected.hpp>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <elf.h>
+#include <fcntl.h>
+#include <optional>
+#include <sys/mman.h>
+#include <sys/procfs.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+// Notes are made of a header followed by the name and the descriptor, both
+// padded to a 4 bytes boundary. See the "Notes (Nhdr)" section of elf(5).
+constexpr auto note_align(std::size_t size) -> std::size_t {
+    return (size + 3) & ~std::size_t{3};
+}
+
+// Size of the legacy (FXSAVE) region, the whole NT_PRFPREG note and the start
+// of NT_X86_XSTATE. Shorter notes are ignored.
+constexpr std::size_t fxsave_size = 512;
+
+[[nodiscard]]
+auto is_valid_core(const std::byte* data, std::size_t size) -> bool {
+    if(size < sizeof(Elf64_Ehdr)) {
+        return false;
+    }
+
+    Elf64_Ehdr header;
+    std::memcpy(&header, data, sizeof(header));
+
+    return std::memcmp(header.e_ident, ELFMAG, SELFMAG) == 0 &&
+           header.e_ident[EI_CLASS] == ELFCLASS64 &&
+           header.e_type == ET_CORE &&
+           header.e_machine == EM_X86_64 &&
+           header.e_phentsize == sizeof(Elf64_Phdr) &&
+           header.e_phoff <= size &&
+           header.e_phnum <= (size - header.e_phoff) / sizeof(Elf64_Phdr);
+}
+
+// Calls f(header, descriptor) for every note in the size bytes at note.
+template<typename F>
+auto for_each_note(const std::byte* note, std::size_t size, F f) -> void {
+    std::size_t offset = 0;
+    while(offset + sizeof(Elf64_Nhdr) <= size) {
+        Elf64_Nhdr header;
+        std::memcpy(&header, note + offset, sizeof(header));
+
+        const std::size_t desc_offset = offset + sizeof(header) + note_align(header.n_namesz);
+        const std::size_t next = desc_offset + note_align(header.n_descsz);
+
+        if(next > size) {
+            return;
+        }
+
+        f(header, note + desc_offset);
+        offset = next;
+    }
+}
+
+// Looks for the first NT_PRSTATUS note, that is the one of the thread that
+// caused the dump, and extracts its registers. On x86_64 elf_gregset_t has the
+// same layout as user_regs_struct.
+[[nodiscard]]
+auto find_prstatus(
+    const std::byte* note,
+    std::size_t size
+) -> tl::expected<elf_prstatus, nkgt::error::core_file> {
+    static_assert(sizeof(elf_gregset_t) == sizeof(user_regs_struct));
+
+    std::optional<elf_prstatus> status;
+    for_each_note(note, size, [&](const Elf64_Nhdr& header, const std::byte* desc) {
+        if(!status && header.n_type == NT_PRSTATUS && header.n_descsz >= sizeof(elf_prstatus)) {
+            status.emplace();
+            std::memcpy(&*status, desc, sizeof(elf_prstatus));
+        }
+    });
+
+    if(!status) {
+        return tl::make_unexpected(nkgt::error::core_file::missing_registers);
+    }
+
+    return *status;
+}
+
+// The NT_FILE note is made of the number of mappings and the page size,
+// followed by a (start, end, offset in pages) triple for each mapping and then
+// by the NUL terminated paths in the same order.
+auto parse_file_note(
+    const std::byte* desc,
+    std::size_t size,
+    std::vector<nkgt::maps::region>& out
+) -> void {
+    uint64_t header[2];
+    if(size < sizeof(header)) {
+        return;
+    }
+
+    std::memcpy(header, desc, sizeof(header));
+    const uint64_t count = header[0];
+    const uint64_t page_size = header[1];
+
+    // Checked by division, a crafted count would overflow the size of the
+    // entries.
+    constexpr std::size_t entry_size = 3 * sizeof(uint64_t);
+    if(count > (size - sizeof(header)) / entry_size) {
+        return;
+    }
+
+    std::size_t names = sizeof(header) + count * entry_size;
+
+    for(std::size_t i = 0; i < count && names < size; ++i) {
+        uint64_t entry[3];
+        std::memcpy(entry, desc + sizeof(header) + i * sizeof(entry), sizeof(entry));
+
+        const auto* name = reinterpret_cast<const char*>(desc + names);
+        const std::size_t length = strnlen(name, size - names);
+
+        nkgt::maps::region r;
+        r.start = entry[0];
+        r.end = entry[1];
+        r.readable = true;
+        r.writable = false;
+        r.executable = false;
+        r.shared = false;
+        r.offset = entry[2] * page_size;
+        r.path = std::string(name, length);
+        out.push_back(std::move(r));
+
+        names += length + 1;
+    }
+}
+
+}
+
+namespace nkgt::target {
+
+core_target::~core_target() {
+    if(data_ != nullptr) {
+        munmap(const_cast<std::byte*>(data_), size_);
+    }
+}
+
+auto core_target::read_registers(
+) -> tl::expected<user_regs_struct, error::registers> {
+    return regs_;
+}
+
+auto core_target::write_registers(
+    const user_regs_struct&
+) -> tl::expected<void, error::registers> {
+    return tl::make_unexpected(error::registers::setregs_fail);
+}
+
+auto core_target::read_extended_state(
+) -> tl::expected<const extended_state*, error::registers> {
+    if(!extended_state_) {
+        return tl::make_unexpected(error::registers::getfpregs_fail);
+    }
+
+    return &*extended_state_;
+}
+
+auto core_target::view(
+    std::uintptr_t address,
+    std::size_t size
+) const -> const std::byte* {
+    // First segment whose start is past address, the candidate is the one
+    // right before it.
+    auto it = std::upper_bound(
+        segments_.cbegin(),
+        segments_.cend(),
+        address,
+        [](std::uintptr_t a, const segment& s) { return a < s.address; }
+    );
+
+    if(it == segments_.cbegin()) {
+        return nullptr;
+    }
+
+    --it;
+    const std::size_t delta = address - it->address;
+    if(delta > it->file_size || size > it->file_size - delta) {
+        return nullptr;
+    }
+
+    return data_ + it->file_offset + delta;
+}
+
+// Bytes that are part of a segment in memory but not in the file (e.g. .bss
+// pages that were never touched) read as zero, like they would in the process.
+auto core_target::read_memory(
+    std::uintptr_t address,
+    void* buffer,
+    std::size_t size
+) -> tl::expected<void, error::memory> {
+    if(const std::byte* source = view(address, size); source != nullptr) {
+        std::memcpy(buffer, source, size);
+        return {};
+    }
+
+    auto* out = static_cast<std::byte*>(buffer);
+    std::size_t done = 0;
+
+    while(done < size) {
+        const std::uintptr_t current = address + done;
+        auto it = std::upper_bound(
+            segments_.cbegin(),
+            segments_.cend(),
+            current,
+            [](std::uintptr_t a, const segment& s) { return a < s.address; }
+        );
+
+        if(it == segments_.cbegin()) {
+            return tl::make_unexpected(error::memory::unmapped_address);
+        }
+
+        --it;
+        const std::size_t delta = current - it->address;
+        if(delta >= it->memory_size) {
+            return tl::make_unexpected(error::memory::unmapped_address);
+        }
+
+        const std::size_t chunk = std::min(size - done, it->memory_size - delta);
+        const std::size_t from_file = delta < it->file_size
+                                    ? std::min(chunk, it->file_size - delta)
+                                    : 0;
+
+        std::memcpy(out + done, data_ + it->file_offset + delta, from_file);
+        std::memset(out + done + from_file, 0, chunk - from_file);
+        done += chunk;
+    }
+
+    return {};
+}
+
+auto core_target::write_memory(
+    std::uintptr_t,
+    const void*,
+    std::size_t
+) -> tl::expected<void, error::memory> {
+    return tl::make_unexpected(error::memory::write_fail);
+}
+
+auto load_core(
+    const std::filesystem::path& core_path
+) -> tl::expected<std::unique_ptr<core_target>, error::core_file> {
+    const int fd = open(core_path.c_str(), O_RDONLY | O_CLOEXEC);
+    if(fd == -1) {
+        util::print_error_message("open", errno);
+        return tl::make_unexpected(error::core_file::open_fail);
+    }
+
+    struct stat info;
+    if(fstat(fd, &info) == -1) {
+        util::print_error_message("fstat", errno);
+        close(fd);
+        return tl::make_unexpected(error::core_file::open_fail);
+    }
+
+    const auto size = static_cast<std::size_t>(info.st_size);
+    void* mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    // The mapping keeps its own reference to the file.
+    close(fd);
+
+    if(mapping == MAP_FAILED) {
+        util::print_error_message("mmap", errno);
+        return tl::make_unexpected(error::core_file::map_fail);
+    }
+
+    std::unique_ptr<core_target> core(new core_target());
+    core->data_ = static_cast<const std::byte*>(mapping);
+    core->size_ = size;
+
+    if(!is_valid_core(core->data_, size)) {
+        return tl::make_unexpected(error::core_file::invalid_format);
+    }
+
+    Elf64_Ehdr header;
+    std::memcpy(&header, core->data_, sizeof(header));
+
+    bool registers_found = false;
+    for(std::size_t i = 0; i < header.e_phnum; ++i) {
+        Elf64_Phdr program_header;
+        std::memcpy(
+            &program_header,
+            core->data_ + header.e_phoff + i * sizeof(Elf64_Phdr),
+            sizeof(program_header)
+        );
+
+        if(program_header.p_offset > size || program_header.p_filesz > size - program_header.p_offset) {
+            return tl::make_unexpected(error::core_file::invalid_format);
+        }
+
+        if(program_header.p_type == PT_LOAD) {
+            core->segments_.push_back({
+                program_header.p_vaddr,
+                program_header.p_memsz,
+                program_header.p_offset,
+                program_header.p_filesz
+            });
+        } else if(program_header.p_type == PT_NOTE && !registers_found) {
+            const auto status = find_prstatus(
+                core->data_ + program_header.p_offset,
+                program_header.p_filesz
+            );
+
+            if(status) {
+                std::memcpy(&core->regs_, &status->pr_reg, sizeof(core->regs_));
+                core->pid_ = status->pr_pid;
+                registers_found = true;
+            }
+
+            // Only the first NT_X86_XSTATE and NT_PRFPREG notes are used,
+            // they belong to the same thread as the first NT_PRSTATUS.
+            for_each_note(
+                core->data_ + program_header.p_offset,
+                program_header.p_filesz,
+                [&](const Elf64_Nhdr& note, const std::byte* desc) {
+                    if(note.n_type == NT_FILE) {
+                        parse_file_note(desc, note.n_descsz, core->mappings_);
+                    } else if(note.n_type == NT_X86_XSTATE && note.n_descsz >= fxsave_size &&
+                              (!core->extended_state_ || !core->extended_state_->is_xsave)) {
+                        core->extended_state_ = extended_state{
+                            std::vector<std::byte>(desc, desc + note.n_descsz),
+                            true
+                        };
+                    } else if(note.n_type == NT_PRFPREG && note.n_descsz >= fxsave_size && !core->extended_state_) {
+                        core->extended_state_ = extended_state{
+                            std::vector<std::byte>(desc, desc + note.n_descsz),
+                            false
+                        };
+                    }
+                }
+            );
+        }
+    }
+
+    if(!registers_found) {
+        return tl::make_unexpected(error::core_file::missing_registers);
+    }
+
+    std::sort(
+        core->mappings_.begin(),
+        core->mappings_.end(),
+        [](const maps::region& a, const maps::region& b) { return a.start < b.start; }
+    );
+
+    std::sort(
+        core->segments_.begin(),
+        core->segments_.end(),
+        [](const core_target::segment& a, const core_target::segment& b) { return a.address < b.address; }
+    );
+
+    return core;
+}
+
+}
@@ -0,0 +1,287 @@
+#include "nkgt/debug_file.hpp"
+#include "nkgt/error_codes.hpp"
+#include "nkgt/util.hpp"
+
+#include <tl/expected.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <system_error>
+#include <unistd.h>
+
+namespace {
+
+constexpr auto crc_table = [] {
+    std::array<uint32_t, 256> table = {};
+
+    for(uint32_t i = 0; i < table.size(); ++i) {
+        uint32_t crc = i;
+        for(int bit = 0; bit < 8; ++bit) {
+            crc = (crc & 1) != 0 ? 0xedb88320 ^ (crc >> 1) : crc >> 1;
+        }
+
+        table[i] = crc;
+    }
+
+    return table;
+}();
+
+[[nodiscard]]
+auto align_4(std::size_t value) -> std::size_t {
+    return (value + 3) & ~std::size_t{3};
+}
+
+// Only regular files are candidates, so that a missing candidate is not
+// reported as an error by open_elf().
+[[nodiscard]]
+auto is_file(const std::filesystem::path& path) -> bool {
+    std::error_code ec;
+    return std::filesystem::is_regular_file(path, ec);
+}
+
+[[nodiscard]]
+auto is_same_file(const std::filesystem::path& a, const std::filesystem::path& b) -> bool {
+    std::error_code ec;
+    return std::filesystem::equivalent(a, b, ec);
+}
+
+}
+
+namespace nkgt::debug_file {
+
+elf_file::~elf_file() {
+    munmap(const_cast<std::byte*>(data_), size_);
+}
+
+auto elf_file::section_name(const Elf64_Shdr& section) const -> std::string_view {
+    if(names_ == nullptr || section.sh_name >= names_->sh_size) {
+        return {};
+    }
+
+    const auto* table = contents(*names_);
+    if(table == nullptr) {
+        return {};
+    }
+
+    const auto* name = reinterpret_cast<const char*>(table + section.sh_name);
+    return std::string_view(name, strnlen(name, names_->sh_size - section.sh_name));
+}
+
+auto elf_file::find_section(std::string_view name) const -> const Elf64_Shdr* {
+    const auto it = std::find_if(sections_.cbegin(), sections_.cend(), [&](const Elf64_Shdr& s) {
+        return section_name(s) == name;
+    });
+
+    return it != sections_.cend() ? &*it : nullptr;
+}
+
+auto elf_file::contents(const Elf64_Shdr& section) const -> const std::byte* {
+    if(section.sh_type == SHT_NOBITS || section.sh_offset > size_ || section.sh_size > size_ - section.sh_offset) {
+        return nullptr;
+    }
+
+    return data_ + section.sh_offset;
+}
+
+auto elf_file::build_id() const -> std::vector<uint8_t> {
+    for(const auto& section : sections_) {
+        const auto* notes = section.sh_type == SHT_NOTE ? contents(section) : nullptr;
+        if(notes == nullptr) {
+            continue;
+        }
+
+        std::size_t offset = 0;
+        while(section.sh_size - offset >= sizeof(Elf64_Nhdr)) {
+            Elf64_Nhdr note;
+            std::memcpy(&note, notes + offset, sizeof(note));
+            offset += sizeof(note);
+
+            const std::size_t name_size = align_4(note.n_namesz);
+            const std::size_t descriptor_size = align_4(note.n_descsz);
+            if(name_size > section.sh_size - offset || descriptor_size > section.sh_size - offset - name_size) {
+                break;
+            }
+
+            if(note.n_type == NT_GNU_BUILD_ID && note.n_namesz == sizeof(ELF_NOTE_GNU) &&
+               std::memcmp(notes + offset, ELF_NOTE_GNU, sizeof(ELF_NOTE_GNU)) == 0) {
+                const auto* id = reinterpret_cast<const uint8_t*>(notes + offset + name_size);
+                return std::vector<uint8_t>(id, id + note.n_descsz);
+            }
+
+            offset += name_size + descriptor_size;
+        }
+    }
+
+    return {};
+}
+
+// The section holds the NUL terminated name, padded to 4 bytes, followed by
+// the CRC-32.
+auto elf_file::link() const -> std::optional<debuglink> {
+    const auto* section = find_section(".gnu_debuglink");
+    const auto* content = section != nullptr ? contents(*section) : nullptr;
+    if(content == nullptr) {
+        return std::nullopt;
+    }
+
+    const auto* name = reinterpret_cast<const char*>(content);
+    const std::size_t length = strnlen(name, section->sh_size);
+    const std::size_t crc_offset = align_4(length + 1);
+    if(length == 0 || crc_offset > section->sh_size || section->sh_size - crc_offset < sizeof(uint32_t)) {
+        return std::nullopt;
+    }
+
+    debuglink link = {std::string(name, length), 0};
+    std::memcpy(&link.crc, content + crc_offset, sizeof(link.crc));
+    return link;
+}
+
+auto elf_file::has_debug_info() const -> bool {
+    const auto* info = find_section(".debug_info");
+    return info != nullptr && info->sh_size != 0 && contents(*info) != nullptr;
+}
+
+auto open_elf(
+    const std::filesystem::path& path
+) -> tl::expected<std::unique_ptr<elf_file>, error::debug_file> {
+    const int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if(fd == -1) {
+        util::print_error_message("open", errno);
+        return tl::make_unexpected(error::debug_file::open_fail);
+    }
+
+    struct stat info;
+    if(fstat(fd, &info) == -1) {
+        util::print_error_message("fstat", errno);
+        close(fd);
+        return tl::make_unexpected(error::debug_file::open_fail);
+    }
+
+    const auto size = static_cast<std::size_t>(info.st_size);
+    if(size < sizeof(Elf64_Ehdr)) {
+        close(fd);
+        return tl::make_unexpected(error::debug_file::invalid_format);
+    }
+
+    void* mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if(mapping == MAP_FAILED) {
+        util::print_error_message("mmap", errno);
+        return tl::make_unexpected(error::debug_file::map_fail);
+    }
+
+    std::unique_ptr<elf_file> file(new elf_file(path, static_cast<const std::byte*>(mapping), size));
+
+    Elf64_Ehdr header;
+    std::memcpy(&header, file->data_, sizeof(header));
+    if(std::memcmp(header.e_ident, ELFMAG, SELFMAG) != 0 ||
+       header.e_ident[EI_CLASS] != ELFCLASS64 ||
+       header.e_ident[EI_DATA] != ELFDATA2LSB ||
+       header.e_shentsize != sizeof(Elf64_Shdr) ||
+       header.e_shoff > size ||
+       header.e_shnum > (size - header.e_shoff) / sizeof(Elf64_Shdr)) {
+        return tl::make_unexpected(error::debug_file::invalid_format);
+    }
+
+    file->sections_.resize(header.e_shnum);
+    std::memcpy(file->sections_.data(), file->data_ + header.e_shoff, header.e_shnum * sizeof(Elf64_Shdr));
+
+    if(header.e_shstrndx != SHN_UNDEF && header.e_shstrndx < header.e_shnum) {
+        file->names_ = &file->sections_[header.e_shstrndx];
+    }
+
+    return file;
+}
+
+auto crc32(const std::byte* data, std::size_t size, uint32_t crc) -> uint32_t {
+    crc = ~crc;
+    for(std::size_t i = 0; i < size; ++i) {
+        crc = crc_table[(crc ^ static_cast<uint8_t>(data[i])) & 0xff] ^ (crc >> 8);
+    }
+
+    return ~crc;
+}
+
+auto build_id_path(const std::filesystem::path& root, const std::vector<uint8_t>& build_id) -> std::filesystem::path {
+    std::string directory;
+    std::string name;
+
+    for(std::size_t i = 0; i < build_id.size(); ++i) {
+        constexpr std::string_view digits = "0123456789abcdef";
+        std::string& out = i == 0 ? directory : name;
+        out += digits[build_id[i] >> 4];
+        out += digits[build_id[i] & 0xf];
+    }
+
+    return root / ".build-id" / directory / (name + ".debug");
+}
+
+auto find_debuglink_file(
+    const std::filesystem::path& program_path,
+    const debuglink& link,
+    const std::vector<std::filesystem::path>& roots
+) -> std::optional<std::filesystem::path> {
+    std::error_code ec;
+    const auto directory = std::filesystem::absolute(program_path, ec).parent_path();
+    if(ec) {
+        return std::nullopt;
+    }
+
+    std::vector<std::filesystem::path> candidates = {
+        directory / link.name,
+        directory / ".debug" / link.name,
+    };
+
+    for(const auto& root : roots) {
+        candidates.push_back(root / directory.relative_path() / link.name);
+    }
+
+    for(const auto& candidate : candidates) {
+        if(!is_file(candidate) || is_same_file(candidate, program_path)) {
+            continue;
+        }
+
+        const auto file = open_elf(candidate);
+        if(file && crc32((*file)->data(), (*file)->size()) == link.crc) {
+            return candidate;
+        }
+    }
+
+    return std::nullopt;
+}
+
+auto find_separate_debug_file(
+    const elf_file& program,
+    const std::vector<std::filesystem::path>& roots
+) -> std::optional<std::filesystem::path> {
+    const auto build_id = program.build_id();
+
+    if(!build_id.empty()) {
+        for(const auto& root : roots) {
+            const auto candidate = build_id_path(root, build_id);
+            if(!is_file(candidate)) {
+                continue;
+            }
+
+            const auto file = open_elf(candidate);
+            if(file && (*file)->build_id() == build_id && (*file)->has_debug_info()) {
+                return candidate;
+            }
+        }
+    }
+
+    const auto link = program.link();
+    if(!link) {
+        return std::nullopt;
+    }
+
+    return find_debuglink_file(program.path(), *link, roots);
+}
+
+}
@@ -0,0 +1,1165 @@
+#include "nkgt/debug_info.hpp"
+#include "nkgt/debug_file.hpp"
+#include "nkgt/dwarf_expr.hpp"
+#include "nkgt/error_codes.hpp"
+
+#include <dwarf.h>
+#include <libdwarf.h>
+#include <fmt/core.h>
+#include <tl/expected.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <deque>
+#include <limits>
+#include <memory>
+#include <type_traits>
+#include <unordered_map>
+
+namespace {
+
+struct die_deleter {
+    auto operator()(Dwarf_Die die) const -> void { dwarf_dealloc_die(die); }
+};
+
+struct attribute_deleter {
+    auto operator()(Dwarf_Attribute attribute) const -> void { dwarf_dealloc_attribute(attribute); }
+};
+
+using die_ptr = std::unique_ptr<std::remove_pointer_t<Dwarf_Die>, die_deleter>;
+using attribute_ptr = std::unique_ptr<std::remove_pointer_t<Dwarf_Attribute>, attribute_deleter>;
+
+// Frees the error libdwarf allocates when a call fails. Returns true only for
+// DW_DLV_OK. error is taken by reference because it is written by the call
+// producing result, which may be evaluated after the other arguments.
+[[nodiscard]]
+auto succeeded(Dwarf_Debug dbg, int result, Dwarf_Error& error) -> bool {
+    if(result == DW_DLV_ERROR) {
+        dwarf_dealloc_error(dbg, error);
+    }
+
+    return result == DW_DLV_OK;
+}
+
+[[nodiscard]]
+auto tag_of(Dwarf_Debug dbg, Dwarf_Die die) -> Dwarf_Half {
+    Dwarf_Half tag = 0;
+    Dwarf_Error error = nullptr;
+
+    return succeeded(dbg, dwarf_tag(die, &tag, &error), error) ? tag : Dwarf_Half{0};
+}
+
+[[nodiscard]]
+auto offset_of(Dwarf_Debug dbg, Dwarf_Die die) -> uint64_t {
+    Dwarf_Off offset = 0;
+    Dwarf_Error error = nullptr;
+
+    return succeeded(dbg, dwarf_dieoffset(die, &offset, &error), error) ? offset : 0;
+}
+
+[[nodiscard]]
+auto die_at(Dwarf_Debug dbg, uint64_t offset) -> die_ptr {
+    Dwarf_Die die = nullptr;
+    Dwarf_Error error = nullptr;
+
+    if(!succeeded(dbg, dwarf_offdie_b(dbg, offset, true, &die, &error), error)) {
+        return nullptr;
+    }
+
+    return die_ptr(die);
+}
+
+[[nodiscard]]
+auto attribute_of(Dwarf_Debug dbg, Dwarf_Die die, Dwarf_Half name) -> attribute_ptr {
+    Dwarf_Attribute attribute = nullptr;
+    Dwarf_Error error = nullptr;
+
+    if(!succeeded(dbg, dwarf_attr(die, name, &attribute, &error), error)) {
+        return nullptr;
+    }
+
+    return attribute_ptr(attribute);
+}
+
+// Offset of the DIE referenced by the attribute, e.g. DW_AT_type.
+[[nodiscard]]
+auto reference_of(Dwarf_Debug dbg, Dwarf_Die die, Dwarf_Half name) -> std::optional<uint64_t> {
+    const auto attribute = attribute_of(dbg, die, name);
+    if(!attribute) {
+        return std::nullopt;
+    }
+
+    Dwarf_Off offset = 0;
+    Dwarf_Error error = nullptr;
+    if(!succeeded(dbg, dwarf_global_formref(attribute.get(), &offset, &error), error)) {
+        return std::nullopt;
+    }
+
+    return offset;
+}
+
+[[nodiscard]]
+auto unsigned_of(Dwarf_Debug dbg, Dwarf_Die die, Dwarf_Half name) -> std::optional<uint64_t> {
+    const auto attribute = attribute_of(dbg, die, name);
+    if(!attribute) {
+        return std::nullopt;
+    }
+
+    Dwarf_Unsigned value = 0;
+    Dwarf_Error error = nullptr;
+    if(!succeeded(dbg, dwarf_formudata(attribute.get(), &value, &error), error)) {
+        return std::nullopt;
+    }
+
+    return value;
+}
+
+// The name of the DIE, taken from the declaration it completes when it has
+// none of its own (out of line definitions and concrete instances of inlined
+// functions).
+[[nodiscard]]
+auto name_of(Dwarf_Debug dbg, Dwarf_Die die) -> std::string {
+    char* name = nullptr;
+    Dwarf_Error error = nullptr;
+
+    // The string belongs to libdwarf and must not be freed.
+    if(succeeded(dbg, dwarf_diename(die, &name, &error), error)) {
+        return name;
+    }
+
+    for(const Dwarf_Half origin : {Dwarf_Half{DW_AT_specification}, Dwarf_Half{DW_AT_abstract_origin}}) {
+        const auto offset = reference_of(dbg, die, origin);
+        if(offset) {
+            const auto declaration = die_at(dbg, *offset);
+            return declaration ? name_of(dbg, declaration.get()) : std::string();
+        }
+    }
+
+    return {};
+}
+
+template<typename F>
+auto for_each_child(Dwarf_Debug dbg, Dwarf_Die parent, F&& f) -> void {
+    Dwarf_Die child = nullptr;
+    Dwarf_Error error = nullptr;
+
+    if(!succeeded(dbg, dwarf_child(parent, &child, &error), error)) {
+        return;
+    }
+
+    die_ptr current(child);
+    while(current) {
+        f(current.get());
+
+        Dwarf_Die sibling = nullptr;
+        if(!succeeded(dbg, dwarf_siblingof_b(dbg, current.get(), true, &sibling, &error), error)) {
+            break;
+        }
+
+        current.reset(sibling);
+    }
+}
+
+// Decodes the location list or expression in the attribute. Entries using
+// operations the VM does not support evaluate to optimized out.
+[[nodiscard]]
+auto decode_location(
+    Dwarf_Debug dbg,
+    Dwarf_Die die,
+    Dwarf_Half name
+) -> nkgt::dwarf_expr::location {
+    nkgt::dwarf_expr::location location;
+
+    const auto attribute = attribute_of(dbg, die, name);
+    if(!attribute) {
+        return location;
+    }
+
+    Dwarf_Loc_Head_c head = nullptr;
+    Dwarf_Unsigned count = 0;
+    Dwarf_Error error = nullptr;
+    if(!succeeded(dbg, dwarf_get_loclist_c(attribute.get(), &head, &count, &error), error)) {
+        return location;
+    }
+
+    for(Dwarf_Unsigned i = 0; i < count; ++i) {
+        Dwarf_Small entry_kind = 0;
+        Dwarf_Unsigned raw_low_pc = 0;
+        Dwarf_Unsigned raw_high_pc = 0;
+        Dwarf_Bool address_unavailable = false;
+        Dwarf_Addr low_pc = 0;
+        Dwarf_Addr high_pc = 0;
+        Dwarf_Unsigned operation_count = 0;
+        Dwarf_Locdesc_c description = nullptr;
+        Dwarf_Small source = 0;
+        Dwarf_Unsigned expression_offset = 0;
+        Dwarf_Unsigned description_offset = 0;
+
+        const int result = dwarf_get_locdesc_entry_d(
+            head,
+            i,
+            &entry_kind,
+            &raw_low_pc,
+            &raw_high_pc,
+            &address_unavailable,
+            &low_pc,
+            &high_pc,
+            &operation_count,
+            &description,
+            &source,
+            &expression_offset,
+            &description_offset,
+            &error
+        );
+
+        if(!succeeded(dbg, result, error) || address_unavailable) {
+            continue;
+        }
+
+        if(source == DW_LKIND_expression) {
+            low_pc = 0;
+            high_pc = std::numeric_limits<uint64_t>::max();
+        } else if(low_pc >= high_pc) {
+            // Base address selection and end of list entries.
+            continue;
+        }
+
+        nkgt::dwarf_expr::program code;
+        code.reserve(operation_count);
+
+        for(Dwarf_Unsigned j = 0; j < operation_count; ++j) {
+            Dwarf_Small atom = 0;
+            Dwarf_Unsigned operand1 = 0;
+            Dwarf_Unsigned operand2 = 0;
+            Dwarf_Unsigned operand3 = 0;
+            Dwarf_Unsigned branch_offset = 0;
+
+            const int op_result = dwarf_get_location_op_value_c(
+                description,
+                j,
+                &atom,
+                &operand1,
+                &operand2,
+                &operand3,
+                &branch_offset,
+                &error
+            );
+
+            const auto decoded = succeeded(dbg, op_result, error)
+                               ? nkgt::dwarf_expr::decode(atom, operand1, operand2)
+                               : tl::expected<nkgt::dwarf_expr::instruction, nkgt::error::dwarf_expr>(
+                                     tl::make_unexpected(nkgt::error::dwarf_expr::unsupported_operation)
+                                 );
+
+            if(!decoded) {
+                code.assign(1, {nkgt::dwarf_expr::opcode::unavailable, 0, 0, 0, 0});
+                break;
+            }
+
+            code.push_back(*decoded);
+        }
+
+        location.entries.push_back({low_pc, high_pc, std::move(code)});
+    }
+
+    dwarf_dealloc_loc_head_c(head);
+    return location;
+}
+
+[[nodiscard]]
+auto signed_of(Dwarf_Debug dbg, Dwarf_Die die, Dwarf_Half name) -> std::optional<int64_t> {
+    const auto attribute = attribute_of(dbg, die, name);
+    if(!attribute) {
+        return std::nullopt;
+    }
+
+    Dwarf_Signed value = 0;
+    Dwarf_Error error = nullptr;
+    if(succeeded(dbg, dwarf_formsdata(attribute.get(), &value, &error), error)) {
+        return value;
+    }
+
+    Dwarf_Unsigned unsigned_value = 0;
+    if(succeeded(dbg, dwarf_formudata(attribute.get(), &unsigned_value, &error), error)) {
+        return static_cast<int64_t>(unsigned_value);
+    }
+
+    return std::nullopt;
+}
+
+[[nodiscard]]
+auto has_attribute(Dwarf_Debug dbg, Dwarf_Die die, Dwarf_Half name) -> bool {
+    Dwarf_Bool result = false;
+    Dwarf_Error error = nullptr;
+
+    return succeeded(dbg, dwarf_hasattr(die, name, &result, &error), error) && result;
+}
+
+[[nodiscard]]
+auto kind_of_encoding(uint64_t encoding) -> nkgt::types::kind {
+    using nkgt::types::kind;
+
+    switch(encoding) {
+    case DW_ATE_signed:        return kind::signed_integer;
+    case DW_ATE_unsigned:      return kind::unsigned_integer;
+    case DW_ATE_float:         return kind::floating_point;
+    case DW_ATE_boolean:       return kind::boolean;
+    case DW_ATE_signed_char:
+    case DW_ATE_unsigned_char:
+    case DW_ATE_UTF:           return kind::character;
+    case DW_ATE_address:       return kind::pointer;
+    default:                   return kind::opaque;
+    }
+}
+
+// The kind of the node for a type DIE, and the name of the qualifiers.
+[[nodiscard]]
+auto kind_of_tag(Dwarf_Half tag, std::string& name) -> nkgt::types::kind {
+    using nkgt::types::kind;
+
+    switch(tag) {
+    case DW_TAG_pointer_type:          return kind::pointer;
+    case DW_TAG_reference_type:
+    case DW_TAG_rvalue_reference_type: return kind::reference;
+    case DW_TAG_structure_type:
+    case DW_TAG_class_type:            return kind::structure;
+    case DW_TAG_union_type:            return kind::union_type;
+    case DW_TAG_array_type:            return kind::array;
+    case DW_TAG_enumeration_type:      return kind::enumeration;
+    case DW_TAG_typedef:               return kind::typedef_alias;
+    case DW_TAG_const_type:            name = "const";    return kind::qualified;
+    case DW_TAG_volatile_type:         name = "volatile"; return kind::qualified;
+    case DW_TAG_restrict_type:         name = "restrict"; return kind::qualified;
+    default:                           return kind::opaque;
+    }
+}
+
+[[nodiscard]]
+auto is_variable(Dwarf_Half tag) -> bool {
+    return tag == DW_TAG_formal_parameter || tag == DW_TAG_variable;
+}
+
+// Breadth first, so that a variable of the function is preferred over one
+// with the same name in a nested block.
+[[nodiscard]]
+auto find_in_scope(Dwarf_Debug dbg, Dwarf_Die scope, std::string_view name) -> std::optional<uint64_t> {
+    std::optional<uint64_t> found;
+    std::vector<uint64_t> blocks;
+
+    for_each_child(dbg, scope, [&](Dwarf_Die child) {
+        const Dwarf_Half tag = tag_of(dbg, child);
+
+        if(!found && is_variable(tag) && name_of(dbg, child) == name) {
+            found = offset_of(dbg, child);
+        } else if(tag == DW_TAG_lexical_block) {
+            blocks.push_back(offset_of(dbg, child));
+        }
+    });
+
+    for(std::size_t i = 0; !found && i < blocks.size(); ++i) {
+        const auto block = die_at(dbg, blocks[i]);
+        if(block) {
+            found = find_in_scope(dbg, block.get(), name);
+        }
+    }
+
+    return found;
+}
+
+[[nodiscard]]
+auto string_of(Dwarf_Debug dbg, Dwarf_Die die, Dwarf_Half name) -> std::string {
+    const auto attribute = attribute_of(dbg, die, name);
+    if(!attribute) {
+        return {};
+    }
+
+    char* value = nullptr;
+    Dwarf_Error error = nullptr;
+    return succeeded(dbg, dwarf_formstring(attribute.get(), &value, &error), error) ? value : std::string();
+}
+
+// See the comment of function in debug_info.hpp. DWARF offsets are far below
+// 2^48 in practice.
+constexpr unsigned file_shift = 48;
+
+[[nodiscard]]
+auto tag_offset(std::size_t file, uint64_t offset) -> uint64_t {
+    return uint64_t{file} << file_shift | offset;
+}
+
+[[nodiscard]]
+auto file_of(uint64_t die_offset) -> std::size_t {
+    return die_offset >> file_shift;
+}
+
+[[nodiscard]]
+auto offset_in(uint64_t die_offset) -> uint64_t {
+    return die_offset & ((uint64_t{1} << file_shift) - 1);
+}
+
+// Calls f with the root DIE, the signature and the type of each unit of
+// .debug_info (or .debug_info.dwo).
+template<typename F>
+auto for_each_unit(Dwarf_Debug dbg, F&& f) -> void {
+    Dwarf_Unsigned header_length = 0;
+    Dwarf_Half version = 0;
+    Dwarf_Off abbrev_offset = 0;
+    Dwarf_Half address_size = 0;
+    Dwarf_Half offset_size = 0;
+    Dwarf_Half extension_size = 0;
+    Dwarf_Sig8 signature;
+    Dwarf_Unsigned type_offset = 0;
+    Dwarf_Unsigned next_header = 0;
+    Dwarf_Half header_type = 0;
+    Dwarf_Error error = nullptr;
+
+    for(;;) {
+        const int result = dwarf_next_cu_header_d(
+            dbg,
+            true,
+            &header_length,
+            &version,
+            &abbrev_offset,
+            &address_size,
+            &offset_size,
+            &extension_size,
+            &signature,
+            &type_offset,
+            &next_header,
+            &header_type,
+            &error
+        );
+
+        if(!succeeded(dbg, result, error)) {
+            break;
+        }
+
+        Dwarf_Die cu = nullptr;
+        if(!succeeded(dbg, dwarf_siblingof_b(dbg, nullptr, true, &cu, &error), error)) {
+            continue;
+        }
+
+        const die_ptr cu_die(cu);
+        f(cu_die.get(), signature, header_type);
+    }
+}
+
+// Namespaces are walked recursively, functions and variables are only looked
+// for at the top level of each of them. Offsets are tagged with file.
+auto index_scope(
+    Dwarf_Debug dbg,
+    Dwarf_Die scope,
+    std::size_t file,
+    std::deque<nkgt::debug_info::function>& functions,
+    std::unordered_map<std::string, uint64_t>& globals
+) -> void {
+    for_each_child(dbg, scope, [&](Dwarf_Die die) {
+        const Dwarf_Half tag = tag_of(dbg, die);
+        Dwarf_Error error = nullptr;
+
+        if(tag == DW_TAG_namespace) {
+            index_scope(dbg, die, file, functions, globals);
+        } else if(tag == DW_TAG_variable) {
+            Dwarf_Bool has_location = false;
+            if(succeeded(dbg, dwarf_hasattr(die, DW_AT_location, &has_location, &error), error) &&
+               has_location) {
+                globals.emplace(name_of(dbg, die), tag_offset(file, offset_of(dbg, die)));
+            }
+        } else if(tag == DW_TAG_subprogram) {
+            Dwarf_Addr low_pc = 0;
+            Dwarf_Addr high_pc = 0;
+            Dwarf_Half form = 0;
+            Dwarf_Form_Class form_class = DW_FORM_CLASS_UNKNOWN;
+
+            // Declarations, inlined only functions and functions split in
+            // multiple ranges are skipped.
+            if(!succeeded(dbg, dwarf_lowpc(die, &low_pc, &error), error) ||
+               !succeeded(dbg, dwarf_highpc_b(die, &high_pc, &form, &form_class, &error), error)) {
+                return;
+            }
+
+            if(form_class == DW_FORM_CLASS_CONSTANT) {
+                high_pc += low_pc;
+            }
+
+            functions.push_back({name_of(dbg, die), low_pc, high_pc, tag_offset(file, offset_of(dbg, die))});
+        }
+    });
+}
+
+// libdwarf reads the sections through these callbacks instead of its own ELF
+// reader, which copies every section it loads to the heap. obj is the
+// elf_file: the sections are returned as pointers into its mapping, and only
+// the pages libdwarf touches are read from disk.
+auto section_info(void* obj, Dwarf_Half index, Dwarf_Obj_Access_Section_a* out, int*) -> int {
+    const auto* file = static_cast<const nkgt::debug_file::elf_file*>(obj);
+    if(index >= file->sections().size()) {
+        return DW_DLV_NO_ENTRY;
+    }
+
+    const Elf64_Shdr& section = file->sections()[index];
+    const std::string_view name = file->section_name(section);
+
+    out->as_name = name.empty() ? "" : name.data();
+    out->as_type = section.sh_type;
+    out->as_flags = section.sh_flags;
+    out->as_addr = section.sh_addr;
+    out->as_offset = section.sh_offset;
+    // Sections without content in the file, like the ones emptied by strip,
+    // are reported as empty so that libdwarf never loads them.
+    out->as_size = file->contents(section) != nullptr ? section.sh_size : 0;
+    out->as_link = section.sh_link;
+    out->as_info = section.sh_info;
+    out->as_addralign = section.sh_addralign;
+    out->as_entrysize = section.sh_entsize;
+    return DW_DLV_OK;
+}
+
+auto load_section(void* obj, Dwarf_Half index, Dwarf_Small** data, int*) -> int {
+    const auto* file = static_cast<const nkgt::debug_file::elf_file*>(obj);
+    const auto* content = index < file->sections().size() ? file->contents(file->sections()[index]) : nullptr;
+    if(content == nullptr) {
+        return DW_DLV_NO_ENTRY;
+    }
+
+    // libdwarf does not write to the sections of files it does not relocate.
+    *data = reinterpret_cast<Dwarf_Small*>(const_cast<std::byte*>(content));
+    return DW_DLV_OK;
+}
+
+// Only 64-bit little endian files are opened, see open_elf().
+auto byte_order(void*) -> Dwarf_Small {
+    return DW_END_little;
+}
+
+auto length_size(void*) -> Dwarf_Small {
+    return 4;
+}
+
+auto pointer_size(void*) -> Dwarf_Small {
+    return 8;
+}
+
+auto file_size(void* obj) -> Dwarf_Unsigned {
+    return static_cast<const nkgt::debug_file::elf_file*>(obj)->size();
+}
+
+auto section_count(void* obj) -> Dwarf_Unsigned {
+    return static_cast<const nkgt::debug_file::elf_file*>(obj)->sections().size();
+}
+
+// Executables, shared libraries and .dwo files need no relocation.
+[[nodiscard]]
+auto access_methods() -> const Dwarf_Obj_Access_Methods_a* {
+    static const Dwarf_Obj_Access_Methods_a methods = [] {
+        Dwarf_Obj_Access_Methods_a m = {};
+        m.om_get_section_info = section_info;
+        m.om_get_byte_order = byte_order;
+        m.om_get_length_size = length_size;
+        m.om_get_pointer_size = pointer_size;
+        m.om_get_filesize = file_size;
+        m.om_get_section_count = section_count;
+        m.om_load_section = load_section;
+        m.om_relocate_a_section = nullptr;
+        return m;
+    }();
+
+    return &methods;
+}
+
+}
+
+namespace nkgt::debug_info {
+
+struct dwarf_file {
+    ~dwarf_file() {
+        if(dbg != nullptr) {
+            dwarf_object_finish(dbg);
+        }
+    }
+
+    std::unique_ptr<debug_file::elf_file> elf;
+    Dwarf_Obj_Access_Interface_a access;
+    Dwarf_Debug dbg;
+};
+
+namespace {
+
+// Returns nullptr when the file has no DWARF information.
+[[nodiscard]]
+auto open_dwarf(std::unique_ptr<debug_file::elf_file> elf) -> std::unique_ptr<dwarf_file> {
+    std::unique_ptr<dwarf_file> file(new dwarf_file{std::move(elf), {}, nullptr});
+    file->access.ai_object = file->elf.get();
+    file->access.ai_methods = access_methods();
+
+    Dwarf_Error error = nullptr;
+    const int result = dwarf_object_init_b(&file->access, nullptr, nullptr, DW_GROUPNUMBER_ANY, &file->dbg, &error);
+
+    if(result == DW_DLV_ERROR) {
+        dwarf_dealloc_error(file->dbg, error);
+    }
+
+    if(result != DW_DLV_OK) {
+        file->dbg = nullptr;
+        return nullptr;
+    }
+
+    return file;
+}
+
+[[nodiscard]]
+auto open_dwarf(const std::filesystem::path& path) -> std::unique_ptr<dwarf_file> {
+    auto elf = debug_file::open_elf(path);
+    return elf ? open_dwarf(std::move(*elf)) : nullptr;
+}
+
+[[nodiscard]]
+auto is_file(const std::filesystem::path& path) -> bool {
+    std::error_code ec;
+    return std::filesystem::is_regular_file(path, ec);
+}
+
+}
+
+debug_info::debug_info(std::filesystem::path program_path) : program_path_(std::move(program_path)) {}
+
+// Split files are finished before the program they are tied to.
+debug_info::~debug_info() {
+    while(!dwarf_files_.empty()) {
+        dwarf_files_.pop_back();
+    }
+}
+
+auto debug_info::dbg_of(uint64_t die_offset) const -> Dwarf_Debug_s* {
+    const std::size_t file = file_of(die_offset);
+    return file < dwarf_files_.size() ? dwarf_files_[file]->dbg : nullptr;
+}
+
+// Skeleton units only hold the name of the .dwo file their DIEs are in: they
+// are recorded to be loaded on demand.
+auto debug_info::build_index() -> void {
+    indexed_ = true;
+    const Dwarf_Debug dbg = dwarf_files_.front()->dbg;
+
+    for_each_unit(dbg, [&](Dwarf_Die cu, const Dwarf_Sig8& signature, Dwarf_Half unit_type) {
+        auto dwo_name = string_of(dbg, cu, DW_AT_dwo_name);
+        if(dwo_name.empty()) {
+            dwo_name = string_of(dbg, cu, DW_AT_GNU_dwo_name);
+        }
+
+        if(dwo_name.empty()) {
+            index_scope(dbg, cu, 0, functions_, globals_);
+            return;
+        }
+
+        // DWARF 5 has the id in the header of the skeleton, the GNU extension
+        // for DWARF 4 in an attribute.
+        uint64_t dwo_id = 0;
+        if(unit_type == DW_UT_skeleton) {
+            std::memcpy(&dwo_id, signature.signature, sizeof(dwo_id));
+        } else {
+            dwo_id = unsigned_of(dbg, cu, DW_AT_GNU_dwo_id).value_or(0);
+        }
+
+        split_unit unit = {std::move(dwo_name), string_of(dbg, cu, DW_AT_comp_dir), dwo_id, 0, 0, false};
+
+        Dwarf_Addr low_pc = 0;
+        Dwarf_Addr high_pc = 0;
+        Dwarf_Half form = 0;
+        Dwarf_Form_Class form_class = DW_FORM_CLASS_UNKNOWN;
+        Dwarf_Error error = nullptr;
+
+        if(succeeded(dbg, dwarf_lowpc(cu, &low_pc, &error), error) &&
+           succeeded(dbg, dwarf_highpc_b(cu, &high_pc, &form, &form_class, &error), error)) {
+            unit.low_pc = low_pc;
+            unit.high_pc = form_class == DW_FORM_CLASS_CONSTANT ? low_pc + high_pc : high_pc;
+        }
+
+        split_units_.push_back(std::move(unit));
+    });
+
+    pending_split_units_ = split_units_.size();
+
+    for(const auto& f : functions_) {
+        functions_by_address_.push_back(&f);
+    }
+
+    std::sort(functions_by_address_.begin(), functions_by_address_.end(), [](const function* a, const function* b) {
+        return a->low_pc < b->low_pc;
+    });
+}
+
+// The DIEs are looked up by dwo_id in the .dwp package when there is one,
+// otherwise they are the only unit of the .dwo file. Either way the split
+// file is tied to the program, which holds the addresses the split DIEs
+// refer to.
+auto debug_info::load_split_unit(split_unit& unit) -> void {
+    unit.loaded = true;
+    --pending_split_units_;
+
+    const Dwarf_Debug program = dwarf_files_.front()->dbg;
+    Dwarf_Error error = nullptr;
+
+    if(!package_searched_) {
+        package_searched_ = true;
+
+        for(const auto& candidate : {
+            std::filesystem::path(program_path_.string() + ".dwp"),
+            std::filesystem::path(dwarf_files_.front()->elf->path().string() + ".dwp")
+        }) {
+            auto package = is_file(candidate) ? open_dwarf(candidate) : nullptr;
+            if(package && succeeded(package->dbg, dwarf_set_tied_dbg(package->dbg, program, &error), error)) {
+                package_ = dwarf_files_.size();
+                dwarf_files_.push_back(std::move(package));
+                break;
+            }
+        }
+    }
+
+    const std::size_t first_function = functions_.size();
+
+    if(package_) {
+        const Dwarf_Debug dbg = dwarf_files_[*package_]->dbg;
+        Dwarf_Sig8 signature;
+        std::memcpy(signature.signature, &unit.dwo_id, sizeof(signature.signature));
+
+        Dwarf_Die cu = nullptr;
+        if(succeeded(dbg, dwarf_die_from_hash_signature(dbg, &signature, "cu", &cu, &error), error)) {
+            const die_ptr cu_die(cu);
+            index_scope(dbg, cu_die.get(), *package_, functions_, globals_);
+        }
+    } else {
+        const std::filesystem::path name(unit.dwo_name);
+        std::unique_ptr<dwarf_file> dwo;
+
+        // Relative to the compilation directory, or next to the program when
+        // the build tree is gone.
+        for(const auto& candidate : {
+            std::filesystem::path(unit.comp_dir) / name,
+            program_path_.parent_path() / name.filename()
+        }) {
+            dwo = is_file(candidate) ? open_dwarf(candidate) : nullptr;
+            if(dwo) {
+                break;
+            }
+        }
+
+        if(!dwo || !succeeded(dwo->dbg, dwarf_set_tied_dbg(dwo->dbg, program, &error), error)) {
+            fmt::print("Could not open the split DWARF file {}.\n", unit.dwo_name);
+            return;
+        }
+
+        const std::size_t file = dwarf_files_.size();
+        const Dwarf_Debug dbg = dwo->dbg;
+        dwarf_files_.push_back(std::move(dwo));
+
+        for_each_unit(dbg, [&](Dwarf_Die cu, const Dwarf_Sig8& signature, Dwarf_Half unit_type) {
+            uint64_t dwo_id = 0;
+            if(unit_type == DW_UT_split_compile) {
+                std::memcpy(&dwo_id, signature.signature, sizeof(dwo_id));
+            } else {
+                dwo_id = unsigned_of(dbg, cu, DW_AT_GNU_dwo_id).value_or(0);
+            }
+
+            if(dwo_id != unit.dwo_id) {
+                fmt::print("The split DWARF file {} does not match the program.\n", unit.dwo_name);
+                return;
+            }
+
+            index_scope(dbg, cu, file, functions_, globals_);
+        });
+    }
+
+    for(std::size_t i = first_function; i < functions_.size(); ++i) {
+        functions_by_address_.push_back(&functions_[i]);
+    }
+}
+
+template<typename Predicate>
+auto debug_info::load_split_units(Predicate pred) -> bool {
+    if(pending_split_units_ == 0) {
+        return false;
+    }
+
+    bool loaded = false;
+    for(auto& unit : split_units_) {
+        if(!unit.loaded && pred(unit)) {
+            load_split_unit(unit);
+            loaded = true;
+        }
+    }
+
+    if(loaded) {
+        std::sort(functions_by_address_.begin(), functions_by_address_.end(), [](const function* a, const function* b) {
+            return a->low_pc < b->low_pc;
+        });
+    }
+
+    return loaded;
+}
+
+auto debug_info::build_line_table() -> void {
+    lines_read_ = true;
+    const Dwarf_Debug dbg = dwarf_files_.front()->dbg;
+
+    std::unordered_map<std::string, uint32_t> file_ids;
+
+    // Split units keep their line table in the program, with the skeleton.
+    for_each_unit(dbg, [&](Dwarf_Die cu, const Dwarf_Sig8&, Dwarf_Half) {
+        Dwarf_Unsigned line_version = 0;
+        Dwarf_Small table_count = 0;
+        Dwarf_Line_Context context = nullptr;
+        Dwarf_Error error = nullptr;
+
+        if(!succeeded(dbg, dwarf_srclines_b(cu, &line_version, &table_count, &context, &error), error)) {
+            return;
+        }
+
+        Dwarf_Line* rows = nullptr;
+        Dwarf_Signed row_count = 0;
+        if(!succeeded(dbg, dwarf_srclines_from_linecontext(context, &rows, &row_count, &error), error)) {
+            dwarf_srclines_dealloc_b(context);
+            return;
+        }
+
+        // File numbers are local to the compilation unit, names are only
+        // asked to libdwarf once per file and unit.
+        std::unordered_map<Dwarf_Unsigned, uint32_t> cu_files;
+
+        for(Dwarf_Signed i = 0; i < row_count; ++i) {
+            Dwarf_Line row = rows[i];
+            Dwarf_Addr address = 0;
+            Dwarf_Unsigned line = 0;
+            Dwarf_Unsigned file_number = 0;
+            Dwarf_Bool end_sequence = false;
+
+            if(!succeeded(dbg, dwarf_lineaddr(row, &address, &error), error) ||
+               !succeeded(dbg, dwarf_lineno(row, &line, &error), error) ||
+               !succeeded(dbg, dwarf_line_srcfileno(row, &file_number, &error), error) ||
+               !succeeded(dbg, dwarf_lineendsequence(row, &end_sequence, &error), error)) {
+                continue;
+            }
+
+            auto file = cu_files.find(file_number);
+            if(file == cu_files.end()) {
+                char* name = nullptr;
+                std::string file_name;
+
+                if(succeeded(dbg, dwarf_linesrc(row, &name, &error), error)) {
+                    file_name = name;
+                    dwarf_dealloc(dbg, name, DW_DLA_STRING);
+                }
+
+                const auto [id, inserted] = file_ids.emplace(file_name, static_cast<uint32_t>(files_.size()));
+                if(inserted) {
+                    files_.push_back(std::move(file_name));
+                }
+
+                file = cu_files.emplace(file_number, id->second).first;
+            }
+
+            lines_.push_back({address, line, file->second, end_sequence != 0});
+        }
+
+        dwarf_srclines_dealloc_b(context);
+    });
+
+    std::stable_sort(lines_.begin(), lines_.end(), [](const line_row& a, const line_row& b) {
+        return a.address < b.address;
+    });
+}
+
+auto debug_info::line_at(uint64_t pc) -> std::optional<source_line> {
+    if(!lines_read_) {
+        build_line_table();
+    }
+
+    auto it = std::upper_bound(lines_.begin(), lines_.end(), pc, [](uint64_t value, const line_row& row) {
+        return value < row.address;
+    });
+
+    if(it == lines_.begin()) {
+        return std::nullopt;
+    }
+
+    --it;
+    if(it->end_sequence) {
+        return std::nullopt;
+    }
+
+    return source_line{files_[it->file], it->line};
+}
+
+auto debug_info::lookup_function(uint64_t pc) const -> const function* {
+    auto it = std::upper_bound(
+        functions_by_address_.cbegin(),
+        functions_by_address_.cend(),
+        pc,
+        [](uint64_t value, const function* f) { return value < f->low_pc; }
+    );
+
+    if(it == functions_by_address_.cbegin()) {
+        return nullptr;
+    }
+
+    --it;
+    return pc < (*it)->high_pc ? *it : nullptr;
+}
+
+// Split units known to cover pc are loaded first, the ones whose range is not
+// known only when pc is not in any function loaded so far.
+auto debug_info::function_at(uint64_t pc) -> const function* {
+    if(!indexed_) {
+        build_index();
+    }
+
+    load_split_units([pc](const split_unit& unit) {
+        return unit.low_pc <= pc && pc < unit.high_pc;
+    });
+
+    const auto* f = lookup_function(pc);
+    if(f == nullptr && load_split_units([](const split_unit& unit) { return unit.high_pc == 0; })) {
+        f = lookup_function(pc);
+    }
+
+    return f;
+}
+
+auto debug_info::frame_base(const function& f) -> const dwarf_expr::location& {
+    const auto cached = frame_bases_.find(f.die_offset);
+    if(cached != frame_bases_.end()) {
+        return cached->second;
+    }
+
+    const Dwarf_Debug dbg = dbg_of(f.die_offset);
+    const auto die = die_at(dbg, offset_in(f.die_offset));
+    auto location = die ? decode_location(dbg, die.get(), DW_AT_frame_base) : dwarf_expr::location();
+
+    return frame_bases_.emplace(f.die_offset, std::move(location)).first->second;
+}
+
+auto debug_info::find_variable(const function* scope, std::string_view name) -> const variable* {
+    if(!indexed_) {
+        build_index();
+    }
+
+    const uint64_t scope_offset = scope != nullptr ? scope->die_offset : 0;
+    auto key = std::make_pair(scope_offset, std::string(name));
+
+    const auto cached = variables_.find(key);
+    if(cached != variables_.end()) {
+        return cached->second ? &*cached->second : nullptr;
+    }
+
+    std::optional<uint64_t> offset;
+    if(scope != nullptr) {
+        const Dwarf_Debug dbg = dbg_of(scope->die_offset);
+        const auto die = die_at(dbg, offset_in(scope->die_offset));
+        if(die) {
+            const auto local = find_in_scope(dbg, die.get(), name);
+            if(local) {
+                offset = tag_offset(file_of(scope->die_offset), *local);
+            }
+        }
+    }
+
+    if(!offset) {
+        auto global = globals_.find(key.second);
+        if(global == globals_.end() && load_split_units([](const split_unit&) { return true; })) {
+            global = globals_.find(key.second);
+        }
+
+        if(global != globals_.end()) {
+            offset = global->second;
+        }
+    }
+
+    std::optional<variable> result;
+    const Dwarf_Debug dbg = offset ? dbg_of(*offset) : nullptr;
+    const auto die = offset ? die_at(dbg, offset_in(*offset)) : nullptr;
+    if(die) {
+        const auto type = reference_of(dbg, die.get(), DW_AT_type);
+        result = variable{
+            key.second,
+            decode_location(dbg, die.get(), DW_AT_location),
+            type ? tag_offset(file_of(*offset), *type) : 0
+        };
+    }
+
+    const auto& inserted = variables_.emplace(std::move(key), std::move(result)).first->second;
+    return inserted ? &*inserted : nullptr;
+}
+
+auto debug_info::type_of(const variable& v) -> types::type_id {
+    return v.type_offset != 0 ? build_type(v.type_offset) : types::no_type;
+}
+
+// The node is added to the graph, and to the cache, before the types it
+// depends on, so that recursive types terminate.
+auto debug_info::build_type(uint64_t offset) -> types::type_id {
+    const auto cached = type_ids_.find(offset);
+    if(cached != type_ids_.end()) {
+        return cached->second;
+    }
+
+    const Dwarf_Debug dbg = dbg_of(offset);
+    const auto die = die_at(dbg, offset_in(offset));
+    if(!die) {
+        type_ids_.emplace(offset, types::no_type);
+        return types::no_type;
+    }
+
+    const Dwarf_Half tag = tag_of(dbg, die.get());
+
+    types::type node;
+    node.name = name_of(dbg, die.get());
+    node.size = unsigned_of(dbg, die.get(), DW_AT_byte_size).value_or(0);
+    node.k = tag == DW_TAG_base_type
+           ? kind_of_encoding(unsigned_of(dbg, die.get(), DW_AT_encoding).value_or(0))
+           : kind_of_tag(tag, node.name);
+
+    if((node.k == types::kind::pointer || node.k == types::kind::reference) && node.size == 0) {
+        node.size = sizeof(void*);
+    }
+
+    const types::type_id id = types_.add(std::move(node));
+    type_ids_.emplace(offset, id);
+
+    // References are within the same file.
+    const std::size_t file = file_of(offset);
+    const auto target_offset = reference_of(dbg, die.get(), DW_AT_type);
+    const types::type_id target = target_offset ? build_type(tag_offset(file, *target_offset)) : types::no_type;
+    types_.at(id).target = target;
+
+    const auto size_of = [this](types::type_id t) -> std::size_t {
+        t = types_.strip(t);
+        return t == types::no_type ? 0 : types_.at(t).size;
+    };
+
+    // Typedefs and qualifiers have no size of their own.
+    if(types_.at(id).size == 0) {
+        types_.at(id).size = size_of(target);
+    }
+
+    if(tag == DW_TAG_structure_type || tag == DW_TAG_class_type || tag == DW_TAG_union_type) {
+        std::vector<types::member> members;
+        std::vector<types::type_id> template_arguments;
+
+        for_each_child(dbg, die.get(), [&](Dwarf_Die child) {
+            const Dwarf_Half child_tag = tag_of(dbg, child);
+
+            if(child_tag == DW_TAG_template_type_parameter) {
+                const auto argument = reference_of(dbg, child, DW_AT_type);
+                template_arguments.push_back(argument ? build_type(tag_offset(file, *argument)) : types::no_type);
+                return;
+            }
+
+            // Static data members are declarations.
+            if((child_tag != DW_TAG_member && child_tag != DW_TAG_inheritance) ||
+               has_attribute(dbg, child, DW_AT_declaration)) {
+                return;
+            }
+
+            const auto member_type = reference_of(dbg, child, DW_AT_type);
+            types::member m = {
+                name_of(dbg, child),
+                member_type ? build_type(tag_offset(file, *member_type)) : types::no_type,
+                unsigned_of(dbg, child, DW_AT_data_member_location).value_or(0),
+                static_cast<uint16_t>(unsigned_of(dbg, child, DW_AT_bit_size).value_or(0)),
+                0,
+                child_tag == DW_TAG_inheritance
+            };
+
+            const auto bit_offset = unsigned_of(dbg, child, DW_AT_data_bit_offset);
+            if(bit_offset) {
+                m.offset = *bit_offset / 8;
+                m.bit_offset = static_cast<uint16_t>(*bit_offset % 8);
+            }
+
+            if(m.is_base) {
+                m.name = types_.display_name(m.type);
+            }
+
+            members.push_back(std::move(m));
+        });
+
+        types_.at(id).members = std::move(members);
+        types_.at(id).template_arguments = std::move(template_arguments);
+    } else if(tag == DW_TAG_enumeration_type) {
+        std::vector<types::enumerator> enumerators;
+
+        for_each_child(dbg, die.get(), [&](Dwarf_Die child) {
+            if(tag_of(dbg, child) == DW_TAG_enumerator) {
+                enumerators.push_back({name_of(dbg, child), signed_of(dbg, child, DW_AT_const_value).value_or(0)});
+            }
+        });
+
+        types_.at(id).enumerators = std::move(enumerators);
+    } else if(tag == DW_TAG_array_type) {
+        std::vector<uint64_t> dimensions;
+
+        for_each_child(dbg, die.get(), [&](Dwarf_Die child) {
+            if(tag_of(dbg, child) != DW_TAG_subrange_type) {
+                return;
+            }
+
+            const auto count = unsigned_of(dbg, child, DW_AT_count);
+            const auto upper_bound = unsigned_of(dbg, child, DW_AT_upper_bound);
+            dimensions.push_back(count ? *count : upper_bound ? *upper_bound + 1 : 0);
+        });
+
+        if(dimensions.empty()) {
+            dimensions.push_back(0);
+        }
+
+        // int a[2][3] is an array of 2 arrays of 3 int.
+        types::type_id element = target;
+        for(std::size_t i = dimensions.size() - 1; i > 0; --i) {
+            types::type row;
+            row.k = types::kind::array;
+            row.size = dimensions[i] * size_of(element);
+            row.target = element;
+            row.count = dimensions[i];
+            element = types_.add(std::move(row));
+        }
+
+        types_.at(id).target = element;
+        types_.at(id).count = dimensions[0];
+        types_.at(id).size = dimensions[0] * size_of(element);
+    }
+
+    return id;
+}
+
+auto load_debug_info(
+    const std::filesystem::path& path
+) -> tl::expected<std::unique_ptr<debug_info>, error::debug_symbols> {
+    auto program = debug_file::open_elf(path);
+    if(!program) {
+        return tl::make_unexpected(error::debug_symbols::load_fail);
+    }
+
+    auto elf = std::move(*program);
+    if(!elf->has_debug_info()) {
+        const auto separate = debug_file::find_separate_debug_file(*elf);
+        if(separate) {
+            auto debug = debug_file::open_elf(*separate);
+            if(debug) {
+                elf = std::move(*debug);
+            }
+        }
+    }
+
+    auto file = open_dwarf(std::move(elf));
+    if(!file) {
+        return tl::make_unexpected(error::debug_symbols::load_fail);
+    }
+
+    fmt::print("Loaded symbols from path: {}\n", file->elf->path().c_str());
+
+    std::unique_ptr<debug_info> info(new debug_info(path));
+    info->dwarf_files_.push_back(std::move(file));
+    return info;
+}
+
+}
@@ -1,98 +1,195 @@
 #include "nkgt/debugger.hpp"
+#include "nkgt/checkpoint.hpp"
+#include "nkgt/condition.hpp"
+#include "nkgt/debug_info.hpp"
+#include "nkgt/disassembler.hpp"
+#include "nkgt/dwarf_expr.hpp"
 #include "nkgt/error_codes.hpp"
+#include "nkgt/event_log.hpp"
+#include "nkgt/function_timer.hpp"
+#include "nkgt/gdb_server.hpp"
+#include "nkgt/maps.hpp"
+#include "nkgt/pretty_printer.hpp"
+#include "nkgt/process.hpp"
 #include "nkgt/registers.hpp"
+#include "nkgt/search.hpp"
+#include "nkgt/shared_libraries.hpp"
+#include "nkgt/snapshot.hpp"
+#include "nkgt/stats.hpp"
+#include "nkgt/symbol_index.hpp"
+#include "nkgt/symbols.hpp"
+#include "nkgt/target.hpp"
 #include "nkgt/util.hpp"
+#include "nkgt/vector_registers.hpp"
 
 #include <cstdint>
-#include <libdwarf.h>
 #include <linenoise.h>
 #include <fmt/core.h>
 #include <tl/expected.hpp>
 
+#include <algorithm>
+#include <array>
 #include <cerrno>
 #include <charconv>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <optional>
+#include <string>
 #include <sys/ptrace.h>
 #include <sys/wait.h>
 #include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
 namespace {
 
-auto wait_for_signal(pid_t pid) -> void {
-    int wait_status = 0;
-    int options = 0;
-
-    waitpid(pid, &wait_status, options);
-}
-
-auto step_over_breakpoint(
-    pid_t pid,
-    std::unordered_map<std::intptr_t, nkgt::debugger::breakpoint>& breakpoint_list
-) -> bool {
-    const auto current_pc = nkgt::registers::get_register_value(pid, nkgt::registers::reg::rip);
-
-    if(!current_pc) {
-        fmt::print("Failed to get current Program Counter value.\n");
-        return false;
+// A process forked from the debugee by the checkpoint command. It stays
+// stopped and is never resumed: restarting from it forks it once more, so that
+// the same checkpoint can be used any number of times.
+// Decides, without entering the REPL, whether a hit of a breakpoint is
+// reported. Hits that are not are counted and timed, to show what the filter
+// costs compared to a plain breakpoint.
+struct stop_filter {
+    std::optional<nkgt::condition::program> condition;
+    // Number of hits still to be skipped, set by the ignore command.
+    uint64_t ignore_count = 0;
+    // Hits skipped since the last reported one, the time from the resume of
+    // the debugee to the decision of skipping each of them, and the part of it
+    // spent evaluating the condition.
+    uint64_t skipped = 0;
+    std::chrono::nanoseconds skipped_time{};
+    std::chrono::nanoseconds condition_time{};
+};
+
+// Breakpoint on a function that no loaded library defines. It keeps the filter
+// it had when its library was unloaded or the debugee restarted, if any.
+struct pending_breakpoint {
+    std::string function;
+    std::optional<stop_filter> filter;
+};
+
+struct checkpoint {
+    pid_t pid;
+    uint64_t pc;
+    // Copy of the breakpoint table at the time of the checkpoint. It matches
+    // the 0xcc instructions present in the memory of the checkpoint.
+    std::unordered_map<std::intptr_t, nkgt::debugger::breakpoint> breakpoint_list;
+    std::unordered_set<std::intptr_t> timer_breakpoints;
+    // The breakpoints set by name in libraries, those still pending and the
+    // filters, with the counts they had at the time of the checkpoint.
+    std::unordered_map<std::intptr_t, std::string> library_breakpoints;
+    std::vector<pending_breakpoint> pending_breakpoints;
+    std::unordered_map<std::intptr_t, stop_filter> stop_filters;
+};
+
+// Everything the REPL commands operate on.
+struct session {
+    std::unique_ptr<nkgt::target::target> debugee;
+    std::unordered_map<std::intptr_t, nkgt::debugger::breakpoint> breakpoint_list;
+    std::vector<checkpoint> checkpoints;
+    // PID of the process holding the memory snapshot, if any, and the
+    // breakpoints enabled in it.
+    std::optional<pid_t> snapshot;
+    std::vector<nkgt::snapshot::patch> snapshot_patches;
+    nkgt::maps::address_space memory_map{std::vector<nkgt::maps::region>{}};
+    nkgt::symbols::symbol_table program_symbols;
+    std::unique_ptr<nkgt::debug_info::debug_info> debug_info;
+    // Absolute path of the program, as it appears in the memory map.
+    std::string program_path;
+    // How the debugee was started, to start it again. Empty for core files.
+    std::optional<nkgt::process::launch_options> launch;
+    // Libraries loaded by the debugee, null for static programs and core files.
+    std::unique_ptr<nkgt::shared_libraries::tracker> libraries;
+    // Functions passed to break that no loaded library defines yet.
+    std::vector<pending_breakpoint> pending_breakpoints;
+    // Breakpoints set by name in a library, so that they become pending again
+    // if the library is unloaded.
+    std::unordered_map<std::intptr_t, std::string> library_breakpoints;
+    // Conditions and ignore counts, by breakpoint address.
+    std::unordered_map<std::intptr_t, stop_filter> stop_filters;
+    // Functions timed by the timefunc command, and the breakpoints set for
+    // them, which never stop the debugee.
+    std::vector<std::unique_ptr<nkgt::function_timer::timer>> timers;
+    std::unordered_set<std::intptr_t> timer_breakpoints;
+    // Cost of a stop at a breakpoint, see calibrate_trap_cost(). Measured the
+    // first time a function is timed.
+    std::optional<uint64_t> trap_cost_ns;
+    // Number of times the debugee stopped since the start of the session, the
+    // time it stayed stopped, in the REPL or handling a stop, and when it last
+    // stopped. See continue_session().
+    uint64_t stop_count = 0;
+    uint64_t stopped_ns = 0;
+    std::optional<std::chrono::steady_clock::time_point> last_stop;
+    // Binary log of the stops, started by the log command.
+    std::unique_ptr<nkgt::event_log::writer> log;
+    // Code decoded by the disassemble command, without the 0xcc of the
+    // breakpoints. Writes of the debugger to the memory of the debugee drop
+    // the blocks of the pages written.
+    nkgt::disassembler::block_cache code_cache;
+    // Demangled names of program_symbols, for the completion of break.
+    std::unique_ptr<nkgt::symbol_index::background_index> function_index;
+};
+
+// Formats address as function+offset when it falls in the program and as
+// module+offset when it falls in any other mapped file. Returns an empty
+// string for anonymous memory.
+[[nodiscard]]
+auto describe_address(session& s, std::uintptr_t address) -> std::string {
+    const auto location = s.memory_map.to_module_offset(address);
+    if(!location) {
+        return {};
     }
 
-    uint64_t possible_bp_location = *current_pc - 1;
-
-    const auto& bp_it = breakpoint_list.find(possible_bp_location);
-    if(bp_it != breakpoint_list.cend() && bp_it->second.enabled) {
-        const auto pc_result = nkgt::registers::set_register_value(
-            pid,
-            nkgt::registers::reg::rip,
-            possible_bp_location
-        );
-
-        if(!pc_result) {
-            fmt::print("Failed to set Program Counter value.\n");
-            return false;
-        }
-
-        nkgt::debugger::breakpoint& bp = bp_it->second;
+    if(location->module->path == s.program_path) {
+        const auto bias = s.memory_map.load_bias(s.program_path, s.program_symbols.load_base());
+        const auto* function = bias ? s.program_symbols.lookup(address - *bias) : nullptr;
 
-        const auto bp_result = nkgt::debugger::disable_breakpoint(bp);
-        if(!bp_result) {
-            fmt::print("Failed to disable breakpoint at {}.\n", bp.address);
-            return false;
+        if(function != nullptr) {
+            return fmt::format("{}+{:#x}", function->name, address - *bias - function->address);
         }
+    }
 
-        if(ptrace(PTRACE_SINGLESTEP, pid, nullptr, nullptr) == -1) {
-            nkgt::util::print_error_message("ptrace", errno);
-            return false;
-        }
+    const std::string_view path = location->module->path;
+    return fmt::format("{}+{:#x}", path.substr(path.rfind('/') + 1), location->offset);
+}
 
-        wait_for_signal(pid);
+// Returns the address of the function called name in the running program.
+[[nodiscard]]
+auto resolve_function(session& s, std::string_view name) -> std::optional<std::uintptr_t> {
+    const auto* function = s.program_symbols.find(name);
+    if(function == nullptr) {
+        return std::nullopt;
+    }
 
-        const auto set_bp_result = nkgt::debugger::enable_breakpoint(bp);
-        if(!set_bp_result) {
-            fmt::print("Failed to re-enable breakpoint at {}.\n", bp.address);
-            return false;
-        }
+    const auto bias = s.memory_map.load_bias(s.program_path, s.program_symbols.load_base());
+    if(!bias) {
+        return std::nullopt;
     }
-    
-    return true;
-}
 
-auto continue_execution(
-    pid_t pid,
-    std::unordered_map<std::intptr_t, nkgt::debugger::breakpoint>& breakpoint_list
-) -> void {
-    const bool result = step_over_breakpoint(pid, breakpoint_list);
+    return function->address + *bias;
+}
 
-    if(!result) {
-        fmt::print("Failed to step over breakpoint. Continuing execution with in unknow state\n");
-    }
+auto kill_process(pid_t pid) -> void {
+    kill(pid, SIGKILL);
+    NKGT_STATS_TIME("waitpid", waitpid(pid, nullptr, __WALL));
+}
 
-    if(ptrace(PTRACE_CONT, pid, nullptr, nullptr) == -1) {
-        nkgt::util::print_error_message("ptrace", errno);
-        return;
-    }
-    
+auto wait_for_signal(pid_t pid) -> int {
     int wait_status = 0;
     int options = 0;
-    waitpid(pid, &wait_status, options);
+
+    NKGT_STATS_TIME("waitpid", waitpid(pid, &wait_status, options));
+    return wait_status;
+}
+
+// Signals raised by the instruction being executed, SIGTRAP included.
+[[nodiscard]]
+auto is_fault(int signal) -> bool {
+    return signal == SIGTRAP || signal == SIGSEGV || signal == SIGBUS || signal == SIGILL || signal == SIGFPE;
 }
 
 template<typename T>
@@ -121,23 +218,16 @@ auto hex_from_str(
 }
 
 auto try_set_breakpoint(
-    std::string_view address_str,
+    std::intptr_t address,
     pid_t pid,
     std::unordered_map<std::intptr_t, nkgt::debugger::breakpoint>& breakpoint_list
 ) -> void {
-    const auto address = hex_from_str<std::intptr_t>(address_str);
-
-    if(!address) {
-        fmt::print("Failed to parse address.\n");
-        return;
-    }
-
-    if(breakpoint_list.find(*address) != breakpoint_list.cend()) {
-        fmt::print("Breakpoint already active at {}.\n", address_str);
+    if(breakpoint_list.find(address) != breakpoint_list.cend()) {
+        fmt::print("Breakpoint already active at {:#x}.\n", address);
         return;
     }
 
-    nkgt::debugger::breakpoint bp = {pid, *address};
+    nkgt::debugger::breakpoint bp = {pid, address};
     const auto result = enable_breakpoint(bp);
 
     if(!result) {
@@ -145,27 +235,27 @@ auto try_set_breakpoint(
         case nkgt::error::breakpoint::peek_address_fail:
             fmt::print(
                 "Failed to retrieve instruction at address {} for PID {}",
-                *address,
+                address,
                 pid
             );
             break;
         case nkgt::error::breakpoint::poke_address_fail:
             fmt::print(
                 "Failed to modify instruction at address {} for PID {}",
-                *address,
+                address,
                 pid
             );
             break;
         }
     }
 
-    breakpoint_list[*address] = bp;
+    breakpoint_list[address] = bp;
 }
 
 auto try_set_register(
     std::string_view value_str,
     std::string_view reg_str,
-    pid_t pid
+    nkgt::target::target& debugee
 ) -> void {
     const auto value = hex_from_str<uint64_t>(value_str);
     
@@ -181,23 +271,59 @@ auto try_set_register(
         return;
     }
 
-    const auto result = nkgt::registers::set_register_value(pid, *reg, *value);
+    const auto result = nkgt::registers::set_register_value(debugee, *reg, *value);
 
     if(!result) {
         fmt::print("Failed to set the value for the register {}", reg_str);
     }
 }
 
+auto try_read_vector_register(
+    std::string_view reg_str,
+    std::string_view view,
+    nkgt::target::target& debugee
+) -> void {
+    const auto reg = nkgt::registers::vector_from_string(reg_str);
+
+    if(!reg) {
+        fmt::print("{} is not the name of a register.\n", reg_str);
+        return;
+    }
+
+    const auto value = nkgt::registers::get_vector_register_value(debugee, *reg);
+
+    if(!value) {
+        switch(value.error()) {
+        case nkgt::error::registers::unavailable_register:
+            fmt::print("The register {} is not supported by the CPU.\n", reg_str);
+            return;
+        default:
+            fmt::print("Failed to retrieve the extended register state.\n");
+            return;
+        }
+    }
+
+    const auto formatted = nkgt::registers::format_vector_value(*value, view);
+
+    if(!formatted) {
+        fmt::print("{} is not a valid view for the register {}.\n", view, reg_str);
+        return;
+    }
+
+    fmt::print("{} = {}\n", reg_str, *formatted);
+}
+
 auto try_read_register(
     std::string_view reg_str,
-    pid_t pid
+    std::string_view view,
+    nkgt::target::target& debugee
 ) -> void {
     const auto reg = nkgt::registers::from_string(reg_str);
 
     if(!reg) {
         switch(reg.error()) {
         case nkgt::error::registers::unknown_reg_name:
-            fmt::print("{} is not the name of a register.\n", reg_str);
+            try_read_vector_register(reg_str, view, debugee);
             return;
         default:
             fmt::print("Unknown error while paring the register name {}.\n", reg_str);
@@ -205,7 +331,7 @@ auto try_read_register(
         }
     }
 
-    const auto value = nkgt::registers::get_register_value(pid, *reg);
+    const auto value = nkgt::registers::get_register_value(debugee, *reg);
 
     if(!value) {
         switch(value.error()) {
@@ -222,287 +348,2368 @@ auto try_read_register(
     return;
 }
 
+[[nodiscard]]
+auto describe_condition_error(nkgt::error::condition error) -> std::string_view {
+    switch(error) {
+    case nkgt::error::condition::syntax_error:
+        return "syntax error";
+    case nkgt::error::condition::unknown_register:
+        return "unknown register";
+    case nkgt::error::condition::nested_load:
+        return "the address of a memory operand cannot read memory";
+    case nkgt::error::condition::too_complex:
+        return "expression too complex";
+    case nkgt::error::condition::division_by_zero:
+        return "division by zero";
+    case nkgt::error::condition::read_fail:
+        return "failed to read memory";
+    }
+
+    return "unknown error";
+}
+
+// Replaces the condition of the breakpoint at address, which is removed when
+// condition is empty. The ignore count is kept.
+auto set_condition(
+    session& s,
+    std::intptr_t address,
+    std::optional<nkgt::condition::program> condition
+) -> void {
+    if(s.breakpoint_list.find(address) == s.breakpoint_list.cend()) {
+        return;
+    }
+
+    if(condition) {
+        fmt::print("Condition {} ({} instructions).\n", condition->source(), condition->size());
+        s.stop_filters[address].condition = std::move(condition);
+        return;
+    }
+
+    const auto it = s.stop_filters.find(address);
+    if(it != s.stop_filters.end()) {
+        it->second.condition.reset();
+        if(it->second.ignore_count == 0) {
+            s.stop_filters.erase(it);
+        }
+    }
+}
+
 auto handle_break_command(
-    std::vector<std::string_view> args,
-    pid_t pid,
-    std::unordered_map<std::intptr_t, nkgt::debugger::breakpoint>& breakpoint_list
+    const nkgt::util::tokens& args,
+    session& s
 ) -> void {
-    if(args.size() != 2) {
+    if(!s.debugee->is_live()) {
+        fmt::print("Breakpoints cannot be set on a core file.\n");
+        return;
+    }
+
+    const bool conditional = args.size() >= 4 && args[2] == "if";
+
+    if(args.size() != 2 && !conditional) {
         fmt::print(
             "Wrong number of arguments for register command {}. Allowed usages are\n"
-            "\tbreak address\n",
+            "\tbreak address\n"
+            "\tbreak function_name\n"
+            "\tbreak address|function_name if condition\n",
             "break"
         );
 
         return;
     }
 
-    try_set_breakpoint(args[1], pid, breakpoint_list);
-    return;
-}
+    std::optional<nkgt::condition::program> condition;
 
-auto handle_register_command(
-    std::vector<std::string_view> args,
-    pid_t pid
-) -> void {
-    if(args.size() == 2 && nkgt::util::is_prefix(args[1], "dump")) {
-        nkgt::registers::dump_registers(pid);
-    } else if (args.size() == 3 && nkgt::util::is_prefix(args[1], "read")) {
-        try_read_register(args[2], pid);
-    } else if (args.size() == 4 && nkgt::util::is_prefix(args[1], "write")) {
-        try_set_register(args[3], args[2], pid);
-    } else {
-        fmt::print(
-            "Wrong number of arguments for register command {}. Allowed usages are\n"
-            "\tregister dump\n"
-            "\tregister read register_name\n"
-            "\tregister write register_name value\n",
-            "register"
+    if(conditional) {
+        // The tokens are views of the same line, the condition is all of it
+        // from the first token after if.
+        const auto& last = args[args.size() - 1];
+        const std::string_view source(
+            args[3].data(),
+            static_cast<std::size_t>(last.data() + last.size() - args[3].data())
         );
+
+        auto compiled = nkgt::condition::compile(source);
+        if(!compiled) {
+            fmt::print("Invalid condition {}: {}.\n", source, describe_condition_error(compiled.error()));
+            return;
+        }
+
+        condition = std::move(*compiled);
     }
-}
 
-// Parses the user input and then dispatches to the appropriate command logic.
-// Return true if the "quit" command has been issued, false otherwise.
-auto handle_command(
-    const std::string& line,
-    pid_t pid,
-    std::unordered_map<std::intptr_t, nkgt::debugger::breakpoint>& breakpoint_list
-) -> bool {
-    std::vector<std::string_view> args = nkgt::util::split(line, ' ');
+    if(args[1].substr(0, 2) == "0x") {
+        const auto address = hex_from_str<std::intptr_t>(args[1]);
 
-    if(args.empty()) {
-        return false;
+        if(!address) {
+            fmt::print("Failed to parse address.\n");
+            return;
+        }
+
+        try_set_breakpoint(*address, s.debugee->pid(), s.breakpoint_list);
+        set_condition(s, *address, std::move(condition));
+        return;
     }
 
-    std::string_view command = args[0];
+    const auto address = resolve_function(s, args[1]);
 
-    if(nkgt::util::is_prefix(command, "continue")) {
-        continue_execution(pid, breakpoint_list);
-    } else if(nkgt::util::is_prefix(command, "break")) {
-        handle_break_command(args, pid, breakpoint_list);
-    } else if(nkgt::util::is_prefix(command, "register")) {
-        handle_register_command(args, pid);
-    } else if(nkgt::util::is_prefix(command, "quit")) {
-        return true;
-    } else {
-        fmt::print("Unknow command\n");
+    if(address) {
+        try_set_breakpoint(static_cast<std::intptr_t>(*address), s.debugee->pid(), s.breakpoint_list);
+        fmt::print("Breakpoint at {:#018x}.\n", *address);
+        set_condition(s, static_cast<std::intptr_t>(*address), std::move(condition));
+        return;
     }
 
-    return false;
-}
+    if(!s.libraries) {
+        fmt::print("No function named {} in the program.\n", args[1]);
+        return;
+    }
 
-[[nodiscard]]
-auto init_debug_symbols(
-    const std::filesystem::path& program_path
-) -> tl::expected<Dwarf_Debug, nkgt::error::debug_symbols> {
-    char actual_path[FILENAME_MAX];
-    Dwarf_Handler error_handler = 0;
-    Dwarf_Ptr error_arg = 0;
-    Dwarf_Error error = 0;
-    Dwarf_Debug dbg = 0;
-
-    int result = dwarf_init_path(
-        program_path.c_str(),
-        actual_path,
-        FILENAME_MAX,
-        DW_GROUPNUMBER_ANY,
-        error_handler,
-        error_arg,
-        &dbg,
-        &error
-    );
+    const auto found = s.libraries->resolve(args[1]);
 
-    if(result == DW_DLV_ERROR) {
-        dwarf_dealloc_error(dbg, error);
-        return tl::make_unexpected(nkgt::error::debug_symbols::load_fail);
+    if(!found && condition) {
+        fmt::print("No function named {} is loaded, conditions can only be set on loaded functions.\n", args[1]);
+        return;
     }
 
-    if(result == DW_DLV_NO_ENTRY) {
-        return tl::make_unexpected(nkgt::error::debug_symbols::load_fail);
+    if(!found) {
+        s.pending_breakpoints.push_back({std::string(args[1]), std::nullopt});
+        fmt::print("No function named {} is loaded, the breakpoint will be set when a library defining it is.\n", args[1]);
+        return;
     }
 
-    fmt::print("Loaded symbols from path: {}", actual_path);
-    return dbg;
+    const auto& [library_address, library] = *found;
+    try_set_breakpoint(static_cast<std::intptr_t>(library_address), s.debugee->pid(), s.breakpoint_list);
+    s.library_breakpoints[static_cast<std::intptr_t>(library_address)] = std::string(args[1]);
+    fmt::print("Breakpoint at {:#018x} in {}.\n", library_address, library->entry().path);
+    set_condition(s, static_cast<std::intptr_t>(library_address), std::move(condition));
 }
 
-// Taken from https://www.prevanders.net/libdwarfdoc/group__examplecuhdr.html
+// Address of an address or a function, in the program or in a loaded library.
 [[nodiscard]]
-auto get_func_die_from_pc(
-    const Dwarf_Debug& symbols,
-    std::uint64_t pc
-) -> int {
-    Dwarf_Unsigned abbrev_offset = 0;
-    Dwarf_Half address_size = 0;
-    Dwarf_Half version_stamp = 0;
-    Dwarf_Half offset_size = 0;
-    Dwarf_Half extension_size = 0;
-    Dwarf_Sig8 signature;
-    Dwarf_Unsigned typeoffset = 0;
-    Dwarf_Unsigned next_cu_header = 0;
-    Dwarf_Half header_cu_type = 0;
-    Dwarf_Bool is_info = 1;
-    Dwarf_Error error;
-
-    bool function_found = false;
-    int result = 0;
-
-    while(!function_found) {
-        Dwarf_Die no_die = 0;
-        Dwarf_Die cu_die = 0;
-        Dwarf_Unsigned cu_header_length = 0;
-
-        result = dwarf_next_cu_header_d(
-            symbols,
-            is_info,
-            &cu_header_length,
-            &version_stamp,
-            &abbrev_offset,
-            &address_size,
-            &offset_size,
-            &extension_size,
-            &signature,
-            &typeoffset,
-            &next_cu_header,
-            &header_cu_type,
-            &error
-        );
-
-        if(result == DW_DLV_ERROR) {
-            // TODO
-        }
+auto resolve_location(session& s, std::string_view location) -> std::optional<std::intptr_t> {
+    if(location.substr(0, 2) == "0x") {
+        const auto address = hex_from_str<std::intptr_t>(location);
+        return address ? std::make_optional(*address) : std::nullopt;
+    }
 
-        if(result == DW_DLV_NO_ENTRY) {
-            if(is_info) {
-                fmt::print("Finished searching pc {} in .debug_info. Switching to .debug_types\n", pc);
-                is_info = 0;
-            }
+    if(const auto address = resolve_function(s, location)) {
+        return static_cast<std::intptr_t>(*address);
+    }
 
-            fmt::print("Finished searching for pc {}\n", pc);
-            return result;
+    if(s.libraries) {
+        if(const auto found = s.libraries->resolve(location)) {
+            return static_cast<std::intptr_t>(found->first);
         }
+    }
+
+    return std::nullopt;
+}
 
-        result = dwarf_siblingof_b(
-            symbols,
-            no_die,
-            is_info,
-            &cu_die,
-            &error
+auto handle_ignore_command(
+    const nkgt::util::tokens& args,
+    session& s
+) -> void {
+    if(args.size() != 3) {
+        fmt::print(
+            "Wrong number of arguments for ignore command {}. Allowed usages are\n"
+            "\tignore address|function_name count\n",
+            "ignore"
         );
 
-        if(result == DW_DLV_ERROR) {
-            //
-        }
+        return;
+    }
 
-        if(result == DW_DLV_NO_ENTRY) {
-            // FATAL ERROR
-        }
+    const auto address = resolve_location(s, args[1]);
+    if(!address || s.breakpoint_list.find(*address) == s.breakpoint_list.cend()) {
+        fmt::print("No breakpoint at {}.\n", args[1]);
+        return;
+    }
 
-        // CHECK FOR FUNCTION PC!
+    uint64_t count = 0;
+    const auto [_, ec] = std::from_chars(args[2].data(), args[2].data() + args[2].size(), count);
+    if(ec != std::errc()) {
+        fmt::print("{} is not a valid count.\n", args[2]);
+        return;
     }
 
-    return result;
-}
+    auto& filter = s.stop_filters[*address];
+    filter.ignore_count = count;
+    if(count == 0 && !filter.condition) {
+        s.stop_filters.erase(*address);
+    }
 
+    fmt::print("Will ignore the next {} hits of the breakpoint at {:#x}.\n", count, *address);
 }
 
-namespace nkgt::debugger {
-
-// In x86 0xcc is the instruction that identifies a breakpoint. So enabling
-// a breakpoint simply means replacing whatever instruction is at
-// bp.address with 0xcc.
+// Removes the filter of the breakpoint at address from the session and
+// returns it, for a breakpoint that becomes pending.
 [[nodiscard]]
-auto enable_breakpoint(
-    breakpoint& bp
-) -> tl::expected<void, error::breakpoint> {
-    // Calling ptrace with PTRACE_PEEKDATA retrieves the word at bp.address for
-    // the process identified by bp.pid. This means that -1 is a valid return
-    // value and does not necessarily describe an error. To solve this we clear
-    // errno before calling ptrace and we check it right after.
-    // More info at RETURN_VALUE in ptrace(2).
-    errno = 0;
-    long data = ptrace(PTRACE_PEEKDATA, bp.pid, bp.address, nullptr);
-    if(data == -1 && errno != 0) {
-        util::print_error_message("ptrace", errno);
-        return tl::unexpected(error::breakpoint::peek_address_fail);
+auto take_stop_filter(session& s, std::intptr_t address) -> std::optional<stop_filter> {
+    const auto it = s.stop_filters.find(address);
+    if(it == s.stop_filters.end()) {
+        return std::nullopt;
     }
 
-    long data_with_trap = ((data & ~0xff) | 0xcc);
-    if(ptrace(PTRACE_POKEDATA, bp.pid, bp.address, data_with_trap) == -1) {
-        util::print_error_message("ptrace", errno);
-        return tl::unexpected(error::breakpoint::poke_address_fail);
-    }
+    std::optional<stop_filter> filter = std::move(it->second);
+    s.stop_filters.erase(it);
+    return filter;
+}
 
-    // The breakpoint is modified at the end so that in case of errors there is
-    // no leftover data in it.
-    bp.saved_data = static_cast<uint8_t>(data & 0xff);
-    bp.enabled = true;
+// Brings the libraries of the session up to date when the debugee stops at
+// the breakpoint of the dynamic loader. The symbols of new libraries are only
+// waited for when there are pending breakpoints, which are set in the first
+// library defining their function. Breakpoints in unloaded libraries become
+// pending again.
+auto handle_library_event(session& s) -> void {
+    // Libraries have been mapped or unmapped.
+    s.memory_map.invalidate();
 
-    return {};
-}
+    auto changes = s.libraries->update(*s.debugee);
 
-// Disables a breakpoint by restoring the original data (bp.saved_data) in the
-// location bp.address.
-[[nodiscard]]
-auto disable_breakpoint(
-    breakpoint& bp
-) -> tl::expected<void, error::breakpoint> {
-    // See comment in enable_breakpoint() for more info.
-    errno = 0;
-    long data = ptrace(PTRACE_PEEKDATA, bp.pid, bp.address, nullptr);
-    if(data == -1 && errno != 0) {
-        util::print_error_message("ptrace", errno);
-        return tl::unexpected(error::breakpoint::peek_address_fail);
+    if(!changes) {
+        fmt::print("Failed to read the list of shared libraries of the debugee.\n");
+        return;
     }
 
-    long restored_data = ((data & ~0xff) | bp.saved_data);
+    // Another library may be mapped where the unloaded ones were.
+    if(!changes->unloaded.empty()) {
+        s.code_cache.clear();
+    }
 
-    if(ptrace(PTRACE_POKEDATA, bp.pid, bp.address, restored_data) == -1) {
-        util::print_error_message("ptrace", errno);
-        return tl::unexpected(error::breakpoint::poke_address_fail);
+    for(const auto& library : changes->unloaded) {
+        for(auto it = s.library_breakpoints.begin(); it != s.library_breakpoints.end();) {
+            if(!library->contains(static_cast<std::uintptr_t>(it->first))) {
+                ++it;
+                continue;
+            }
+
+            // The code is gone together with the 0xcc, nothing to restore.
+            s.breakpoint_list.erase(it->first);
+            fmt::print("{} was unloaded, the breakpoint on {} is pending.\n", library->entry().path, it->second);
+            s.pending_breakpoints.push_back({std::move(it->second), take_stop_filter(s, it->first)});
+            it = s.library_breakpoints.erase(it);
+        }
     }
 
-    bp.enabled = false;
+    for(const auto* library : changes->loaded) {
+        for(auto it = s.pending_breakpoints.begin(); it != s.pending_breakpoints.end();) {
+            const auto address = library->resolve(it->function);
 
-    return {};
+            if(!address) {
+                ++it;
+                continue;
+            }
+
+            const auto bp_address = static_cast<std::intptr_t>(*address);
+            try_set_breakpoint(bp_address, s.debugee->pid(), s.breakpoint_list);
+            fmt::print("Breakpoint at {:#018x} on {} in {}.\n", *address, it->function, library->entry().path);
+            if(it->filter) {
+                s.stop_filters[bp_address] = std::move(*it->filter);
+            }
+
+            s.library_breakpoints[bp_address] = std::move(it->function);
+            it = s.pending_breakpoints.erase(it);
+        }
+
+        if(s.pending_breakpoints.empty()) {
+            break;
+        }
+    }
 }
 
-auto run(
-    pid_t pid,
-    const std::filesystem::path& program_path
-) -> void {
-    // wait for the child process to finish launching the program we want to debug
-    wait_for_signal(pid);
+// Returns true if the hit of a breakpoint with filter must be reported. A
+// condition that cannot be evaluated stops the debugee, as a true one would.
+[[nodiscard]]
+auto should_stop(
+    stop_filter& filter,
+    const user_regs_struct& regs,
+    nkgt::target::target& debugee
+) -> bool {
+    if(filter.ignore_count > 0) {
+        filter.ignore_count -= 1;
+        return false;
+    }
 
-    // Setting the option PTRACE_O_EXITKILL to the debugee ensures that it will
-    // exit when the debugger itself exits.
-    if(ptrace(PTRACE_SETOPTIONS, pid, nullptr, PTRACE_O_EXITKILL) == -1) {
-        util::print_error_message("ptrace", errno);
-        return;
+    if(!filter.condition) {
+        return true;
     }
 
-    const auto symbols = init_debug_symbols(program_path);
+    const auto start = std::chrono::steady_clock::now();
+    const auto result = filter.condition->evaluate(regs, debugee);
+    filter.condition_time += std::chrono::steady_clock::now() - start;
 
-    if(!symbols) {
-        fmt::print("Failed to load the debug symbols.\n");
-        return;
+    if(!result) {
+        fmt::print(
+            "Failed to evaluate the condition {}: {}.\n",
+            filter.condition->source(),
+            describe_condition_error(result.error())
+        );
+        return true;
     }
 
-    std::unordered_map<std::intptr_t, breakpoint> breakpoint_list;
+    return *result;
+}
 
-    char* line = nullptr;
-    while((line = linenoise("dbg> ")) != nullptr) {
-        if(handle_command(line, pid, breakpoint_list)) {
-            linenoiseFree(line);
-            break;
+// Prints and resets the statistics of the hits skipped since the last stop.
+auto report_skipped_hits(session& s) -> void {
+    for(auto& [address, filter] : s.stop_filters) {
+        if(filter.skipped == 0) {
+            continue;
         }
 
-        linenoiseHistoryAdd(line);
-        linenoiseFree(line);
-    }
+        using microseconds = std::chrono::duration<double, std::micro>;
+        const auto hits = static_cast<double>(filter.skipped);
 
-    dwarf_finish(*symbols);
-    return;
+        fmt::print(
+            "Skipped {} hits of the breakpoint at {:#x}, {:.2f} us per hit of which {:.3f} us in the condition.\n",
+            filter.skipped,
+            address,
+            microseconds(filter.skipped_time).count() / hits,
+            microseconds(filter.condition_time).count() / hits
+        );
+
+        filter.skipped = 0;
+        filter.skipped_time = {};
+        filter.condition_time = {};
+    }
+}
+
+[[nodiscard]]
+auto to_ns(std::chrono::steady_clock::time_point t) -> uint64_t {
+    return static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(t.time_since_epoch()).count()
+    );
+}
+
+// True if a timer still needs the breakpoint at address.
+[[nodiscard]]
+auto timers_use(const session& s, std::intptr_t address) -> bool {
+    return std::any_of(s.timers.cbegin(), s.timers.cend(), [&](const auto& t) {
+        return t->entry() == static_cast<std::uintptr_t>(address) ||
+               t->is_return_address(static_cast<std::uintptr_t>(address));
+    });
+}
+
+// Sets a breakpoint for the timers, unless there is one at address already.
+auto arm_timer_breakpoint(session& s, std::intptr_t address) -> void {
+    if(s.breakpoint_list.find(address) != s.breakpoint_list.cend()) {
+        return;
+    }
+
+    nkgt::debugger::breakpoint bp = {s.debugee->pid(), address};
+    if(!nkgt::debugger::enable_breakpoint(bp)) {
+        fmt::print("Failed to set the timing breakpoint at {:#x}.\n", address);
+        return;
+    }
+
+    s.breakpoint_list[address] = bp;
+    s.timer_breakpoints.insert(address);
+}
+
+// Removes the breakpoint the timers set at address if none of them needs it
+// anymore. When the debugee is stopped right after it, the program counter is
+// moved back to the original instruction, which is not executed yet.
+auto release_timer_breakpoint(session& s, std::intptr_t address, uint64_t pc) -> void {
+    if(s.timer_breakpoints.find(address) == s.timer_breakpoints.cend() || timers_use(s, address)) {
+        return;
+    }
+
+    const auto bp = s.breakpoint_list.find(address);
+    if(bp != s.breakpoint_list.end()) {
+        if(bp->second.enabled && !nkgt::debugger::disable_breakpoint(bp->second)) {
+            fmt::print("Failed to remove the timing breakpoint at {:#x}.\n", address);
+            return;
+        }
+
+        s.breakpoint_list.erase(bp);
+    }
+
+    s.timer_breakpoints.erase(address);
+    s.stop_filters.erase(address);
+
+    if(pc - 1 == static_cast<std::uintptr_t>(address)) {
+        (void)nkgt::registers::set_register_value(*s.debugee, nkgt::registers::reg::rip, pc - 1);
+    }
+}
+
+// Updates the timers when the debugee stops at now_ns. Returns true if the
+// stop is due to a breakpoint that only the timers use, so that the debugee
+// can be resumed.
+[[nodiscard]]
+auto handle_timer_stop(session& s, const user_regs_struct& regs, uint64_t now_ns) -> bool {
+    const nkgt::function_timer::timestamp now = {now_ns, s.stop_count, s.stopped_ns};
+    const auto address = static_cast<std::intptr_t>(regs.rip - 1);
+    const bool owned = s.timer_breakpoints.find(address) != s.timer_breakpoints.cend();
+    // Only the thread being traced can stop for now.
+    const pid_t thread = s.debugee->pid();
+    const uint64_t trap_cost = s.trap_cost_ns.value_or(0);
+
+    for(auto& t : s.timers) {
+        if(t->entry() == static_cast<std::uintptr_t>(address)) {
+            // The call has just pushed the return address.
+            uint64_t return_address = 0;
+            if(!s.debugee->read_memory(regs.rsp, &return_address, sizeof(return_address))) {
+                continue;
+            }
+
+            if(t->enter(thread, return_address, regs.rsp, now)) {
+                arm_timer_breakpoint(s, static_cast<std::intptr_t>(return_address));
+            }
+        } else if(t->is_return_address(static_cast<std::uintptr_t>(address))) {
+            for(const auto released : t->leave(thread, static_cast<std::uintptr_t>(address), regs.rsp, now, trap_cost)) {
+                release_timer_breakpoint(s, static_cast<std::intptr_t>(released), regs.rip);
+            }
+        }
+    }
+
+    // Also removes the return breakpoints no call is waiting for anymore, e.g.
+    // those inherited from a checkpoint.
+    release_timer_breakpoint(s, address, regs.rip);
+    return owned;
+}
+
+// Measures how long the debugee takes to stop at a breakpoint once resumed
+// from another one, the time added to a call by each stop of the debugee
+// during it. The debugee runs a nop and an int3 written at the program
+// counter, from a breakpoint on the nop, exactly as continue_session() would.
+// Returns the median of the samples.
+[[nodiscard]]
+auto calibrate_trap_cost(nkgt::target::target& debugee) -> std::optional<uint64_t> {
+    constexpr std::size_t samples = 101;
+    constexpr std::array<uint8_t, 2> code = {0x90, 0xcc};
+
+    const auto saved_regs = debugee.read_registers();
+    if(!saved_regs) {
+        return std::nullopt;
+    }
+
+    const std::uintptr_t pc = saved_regs->rip;
+    std::array<uint8_t, 2> saved_code;
+    if(!debugee.read_memory(pc, saved_code.data(), saved_code.size()) ||
+       !debugee.write_memory(pc, code.data(), code.size())) {
+        return std::nullopt;
+    }
+
+    const auto address = static_cast<std::intptr_t>(pc);
+    std::unordered_map<std::intptr_t, nkgt::debugger::breakpoint> breakpoint_list;
+    breakpoint_list[address] = {debugee.pid(), address};
+
+    std::vector<uint64_t> times;
+    times.reserve(samples);
+
+    if(nkgt::debugger::enable_breakpoint(breakpoint_list[address])) {
+        for(std::size_t i = 0; i < samples; ++i) {
+            if(!nkgt::registers::set_register_value(debugee, nkgt::registers::reg::rip, pc + 1)) {
+                break;
+            }
+
+            const auto start = std::chrono::steady_clock::now();
+            nkgt::debugger::continue_execution(debugee, breakpoint_list);
+            times.push_back(to_ns(std::chrono::steady_clock::now()) - to_ns(start));
+
+            const auto stopped_at = nkgt::registers::get_register_value(debugee, nkgt::registers::reg::rip);
+            if(!stopped_at || *stopped_at != pc + 2) {
+                times.clear();
+                break;
+            }
+        }
+    }
+
+    const bool restored = debugee.write_memory(pc, saved_code.data(), saved_code.size()) &&
+                          debugee.write_registers(*saved_regs);
+
+    if(!restored || times.size() != samples) {
+        return std::nullopt;
+    }
+
+    std::nth_element(times.begin(), times.begin() + samples / 2, times.end());
+    return times[samples / 2];
+}
+
+// Appends an event to the log of the session, if any, followed by a snapshot
+// of regs when given.
+auto log_event(
+    session& s,
+    nkgt::event_log::event type,
+    uint64_t time_ns,
+    uint64_t address,
+    const std::array<uint64_t, nkgt::event_log::record_values>& values,
+    const user_regs_struct* regs
+) -> void {
+    if(!s.log) {
+        return;
+    }
+
+    const pid_t thread = s.debugee->pid();
+    s.log->append({time_ns, type, 0, static_cast<uint32_t>(thread), address, values});
+    if(regs != nullptr) {
+        s.log->append_registers(time_ns, thread, *regs);
+    }
+}
+
+// Resumes the debugee until it stops for any reason other than the dynamic
+// loader reporting a change to its libraries, which is handled on the way, a
+// breakpoint whose filter skips the hit or a breakpoint of the timers, which
+// are resumed right away. Every stop goes to the event log when there is one.
+auto continue_session(session& s) -> void {
+    using nkgt::event_log::event;
+
+    while(true) {
+        const auto resumed = std::chrono::steady_clock::now();
+        if(s.last_stop) {
+            s.stopped_ns += to_ns(resumed) - to_ns(*s.last_stop);
+        }
+
+        // The debugee shares the standard output, what has been printed so far
+        // has to come before what it prints. This only matters in batch mode,
+        // where the output is block buffered.
+        std::fflush(stdout);
+        const auto status = nkgt::debugger::continue_execution(*s.debugee, s.breakpoint_list);
+        const auto stopped = std::chrono::steady_clock::now();
+        const uint64_t stopped_ns = to_ns(stopped);
+        const uint64_t ran_ns = stopped_ns - to_ns(resumed);
+        s.stop_count += 1;
+        s.last_stop = stopped;
+
+        if(!status) {
+            break;
+        }
+
+        // The debugee may have mapped or unmapped memory while running.
+        s.memory_map.invalidate();
+
+        if(!WIFSTOPPED(*status)) {
+            const bool killed = WIFSIGNALED(*status);
+            const auto code = static_cast<uint64_t>(killed ? WTERMSIG(*status) : WEXITSTATUS(*status));
+            log_event(s, event::exit, stopped_ns, 0, {code, killed ? 1u : 0u}, nullptr);
+            // The last mappings read are kept, run moves the breakpoints with
+            // them.
+            s.memory_map.freeze();
+            break;
+        }
+
+        const bool timing = !s.timers.empty() || !s.timer_breakpoints.empty();
+        if(!s.libraries && s.stop_filters.empty() && !timing && !s.log) {
+            break;
+        }
+
+        // Cached by the target, continue_execution() uses the same set to
+        // step over the breakpoint.
+        const auto regs = s.debugee->read_registers();
+        if(!regs) {
+            break;
+        }
+
+        const auto address = static_cast<std::intptr_t>(regs->rip - 1);
+        const int signal = WSTOPSIG(*status);
+        const bool at_breakpoint = signal == SIGTRAP && s.breakpoint_list.find(address) != s.breakpoint_list.cend();
+
+        if(!at_breakpoint) {
+            log_event(s, event::signal, stopped_ns, regs->rip, {static_cast<uint64_t>(signal)}, &*regs);
+            break;
+        }
+
+        if(s.libraries && static_cast<std::uintptr_t>(address) == s.libraries->breakpoint_address()) {
+            log_event(s, event::library, stopped_ns, static_cast<uint64_t>(address), {}, nullptr);
+            handle_library_event(s);
+            continue;
+        }
+
+        if(timing && handle_timer_stop(s, *regs, stopped_ns)) {
+            log_event(s, event::timer, stopped_ns, static_cast<uint64_t>(address), {ran_ns}, &*regs);
+            continue;
+        }
+
+        const auto filter = s.stop_filters.find(address);
+        if(filter == s.stop_filters.end()) {
+            log_event(s, event::breakpoint, stopped_ns, static_cast<uint64_t>(address), {ran_ns}, &*regs);
+            break;
+        }
+
+        const auto condition_time = filter->second.condition_time;
+        if(should_stop(filter->second, *regs, *s.debugee)) {
+            log_event(s, event::breakpoint, stopped_ns, static_cast<uint64_t>(address), {ran_ns}, &*regs);
+            break;
+        }
+
+        filter->second.skipped += 1;
+        filter->second.skipped_time += std::chrono::steady_clock::now() - resumed;
+        const auto evaluation = std::chrono::duration_cast<std::chrono::nanoseconds>(filter->second.condition_time - condition_time);
+        log_event(s, event::skipped, stopped_ns, static_cast<uint64_t>(address), {ran_ns, static_cast<uint64_t>(evaluation.count())}, &*regs);
+    }
+
+    report_skipped_hits(s);
+}
+
+// Locates the dynamic loader of a new debugee and adds the breakpoint that
+// reports library changes to the list, still disabled.
+auto start_library_tracking(session& s) -> void {
+    auto libraries = nkgt::shared_libraries::start_tracking(*s.debugee, s.memory_map);
+
+    if(!libraries) {
+        if(libraries.error() != nkgt::error::shared_libraries::static_program) {
+            fmt::print("Failed to locate the dynamic loader, shared libraries will not be tracked.\n");
+        }
+
+        return;
+    }
+
+    s.libraries = std::move(*libraries);
+    const auto address = static_cast<std::intptr_t>(s.libraries->breakpoint_address());
+    s.breakpoint_list[address] = {s.debugee->pid(), address};
+}
+
+// Enables the disabled breakpoints of the session in one batch. Those that
+// cannot be set, e.g. because their address is not mapped yet, are removed.
+auto try_enable_breakpoints(session& s) -> void {
+    if(nkgt::debugger::enable_breakpoints(*s.debugee, s.breakpoint_list)) {
+        return;
+    }
+
+    for(auto it = s.breakpoint_list.begin(); it != s.breakpoint_list.end();) {
+        if(it->second.enabled) {
+            ++it;
+            continue;
+        }
+
+        fmt::print("Failed to set the breakpoint at {:#x}, it has been removed.\n", it->first);
+        s.stop_filters.erase(it->first);
+        it = s.breakpoint_list.erase(it);
+    }
+}
+
+// Kills the debugee and starts the program again, with new arguments if any
+// are given. Symbols and debug information are kept. The breakpoints are
+// carried over to the new process in one batch, except those set by name in a
+// library, which become pending until the library is loaded again.
+auto try_rerun(
+    const nkgt::util::tokens& args,
+    session& s
+) -> void {
+    if(!s.launch) {
+        fmt::print("The program of a core file cannot be run.\n");
+        return;
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+
+    // With address space randomization the modules are loaded at different
+    // addresses in the new process, so breakpoints are kept as module +
+    // offset. After the debugee has exited its map cannot be read anymore,
+    // the last one read is used (see continue_session()).
+    struct kept_breakpoint {
+        std::intptr_t address;
+        // Empty for anonymous memory, where the address is kept as is.
+        std::string module;
+        std::uintptr_t offset;
+    };
+
+    const bool exited = kill(s.debugee->pid(), 0) == -1;
+    const std::uintptr_t loader_breakpoint = s.libraries ? s.libraries->breakpoint_address() : 0;
+    std::vector<kept_breakpoint> kept;
+    std::vector<pending_breakpoint> unloaded;
+
+    // Calls in progress die with the process, only the entry breakpoints of
+    // the timers are carried over.
+    for(auto& t : s.timers) {
+        (void)t->clear_calls();
+    }
+
+    for(const auto& [address, _] : s.breakpoint_list) {
+        if(static_cast<std::uintptr_t>(address) == loader_breakpoint) {
+            continue;
+        }
+
+        const bool timer = s.timer_breakpoints.find(address) != s.timer_breakpoints.cend();
+        if(timer && !timers_use(s, address)) {
+            continue;
+        }
+
+        const auto name = s.library_breakpoints.find(address);
+        if(name != s.library_breakpoints.cend()) {
+            unloaded.push_back({name->second, take_stop_filter(s, address)});
+            continue;
+        }
+
+        const auto location = s.memory_map.to_module_offset(static_cast<std::uintptr_t>(address));
+        if(location) {
+            kept.push_back({address, location->module->path, location->offset});
+        } else {
+            kept.push_back({address, {}, 0});
+        }
+    }
+
+    if(args.size() > 1) {
+        s.launch->arguments.assign(args.begin() + 1, args.end());
+    }
+
+    if(!exited) {
+        kill_process(s.debugee->pid());
+    }
+
+    // The soft-dirty bits the snapshot relies on belong to the old process.
+    if(s.snapshot) {
+        kill_process(*s.snapshot);
+        s.snapshot.reset();
+    }
+
+    const auto pid = nkgt::process::launch(*s.launch);
+    if(!pid) {
+        fmt::print("Failed to start {}.\n", s.launch->program.c_str());
+        return;
+    }
+
+    s.libraries.reset();
+    s.debugee = std::make_unique<nkgt::target::ptrace_target>(*pid);
+    s.memory_map = nkgt::maps::address_space(*pid);
+    s.code_cache.clear();
+
+    s.breakpoint_list.clear();
+    std::unordered_map<std::intptr_t, stop_filter> stop_filters;
+    std::unordered_set<std::intptr_t> timer_breakpoints;
+    // New address of the entry breakpoint of each timer.
+    std::unordered_map<std::uintptr_t, std::uintptr_t> timer_entries;
+    for(const auto& k : kept) {
+        std::intptr_t moved = k.address;
+
+        if(!k.module.empty()) {
+            // Libraries are mapped later by the loader, only the breakpoints
+            // set by name follow them.
+            const auto module_start = s.memory_map.module_start(k.module);
+            if(!module_start) {
+                fmt::print("{} is not mapped in the new process, the breakpoint at {:#x} has been removed.\n", k.module, k.address);
+                continue;
+            }
+
+            moved = static_cast<std::intptr_t>(*module_start + k.offset);
+        }
+
+        s.breakpoint_list[moved] = {*pid, moved};
+
+        if(s.timer_breakpoints.find(k.address) != s.timer_breakpoints.cend()) {
+            timer_breakpoints.insert(moved);
+            timer_entries[static_cast<std::uintptr_t>(k.address)] = static_cast<std::uintptr_t>(moved);
+        }
+
+        const auto filter = s.stop_filters.find(k.address);
+        if(filter != s.stop_filters.end()) {
+            stop_filters[moved] = std::move(filter->second);
+        }
+    }
+
+    s.stop_filters = std::move(stop_filters);
+    s.timer_breakpoints = std::move(timer_breakpoints);
+    for(auto& t : s.timers) {
+        const auto entry = timer_entries.find(t->entry());
+        if(entry != timer_entries.cend()) {
+            t->move_entry(entry->second);
+        }
+    }
+
+    s.library_breakpoints.clear();
+    s.pending_breakpoints.insert(
+        s.pending_breakpoints.end(),
+        std::make_move_iterator(unloaded.begin()),
+        std::make_move_iterator(unloaded.end())
+    );
+
+    start_library_tracking(s);
+    try_enable_breakpoints(s);
+    if(s.libraries) {
+        handle_library_event(s);
+    }
+
+    const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    fmt::print(
+        "Started {} (PID {}) with {} breakpoints in {:.3f} ms.\n",
+        s.launch->program.c_str(),
+        *pid,
+        s.breakpoint_list.size() - (s.libraries ? 1 : 0),
+        elapsed.count()
+    );
+}
+
+auto handle_register_command(
+    const nkgt::util::tokens& args,
+    nkgt::target::target& debugee
+) -> void {
+    if(args.size() == 2 && nkgt::util::is_prefix(args[1], "dump")) {
+        nkgt::registers::dump_registers(debugee);
+    } else if (args.size() == 3 && nkgt::util::is_prefix(args[1], "read")) {
+        try_read_register(args[2], "", debugee);
+    } else if (args.size() == 4 && nkgt::util::is_prefix(args[1], "read")) {
+        try_read_register(args[2], args[3], debugee);
+    } else if (args.size() == 4 && nkgt::util::is_prefix(args[1], "write")) {
+        try_set_register(args[3], args[2], debugee);
+    } else {
+        fmt::print(
+            "Wrong number of arguments for register command {}. Allowed usages are\n"
+            "\tregister dump\n"
+            "\tregister read register_name\n"
+            "\tregister read vector_register_name [view]\n"
+            "\tregister write register_name value\n",
+            "register"
+        );
+    }
+}
+
+auto try_read_memory(
+    std::string_view address_str,
+    std::string_view size_str,
+    nkgt::target::target& debugee
+) -> void {
+    const auto address = hex_from_str<std::uintptr_t>(address_str);
+
+    if(!address) {
+        fmt::print("Failed to parse address.\n");
+        return;
+    }
+
+    std::size_t size = 0;
+    auto [_, ec] = std::from_chars(
+        size_str.data(),
+        size_str.data() + size_str.size(),
+        size
+    );
+
+    if(ec != std::errc() || size == 0) {
+        fmt::print("Invalid size {} passed to memory read.\n", size_str);
+        return;
+    }
+
+    std::vector<uint8_t> buffer(size);
+    if(!NKGT_STATS_TIME("target/read_memory", debugee.read_memory(*address, buffer.data(), size))) {
+        fmt::print("Failed to read {} bytes at address {:#018x}.\n", size, *address);
+        return;
+    }
+
+    constexpr std::size_t bytes_per_line = 16;
+    for(std::size_t line = 0; line < size; line += bytes_per_line) {
+        fmt::print("{:#018x}:", *address + line);
+
+        for(std::size_t i = line; i < std::min(size, line + bytes_per_line); ++i) {
+            fmt::print(" {:02x}", buffer[i]);
+        }
+
+        fmt::print("\n");
+    }
+}
+
+auto try_write_memory(
+    std::string_view address_str,
+    std::string_view value_str,
+    session& s
+) -> void {
+    const auto address = hex_from_str<std::uintptr_t>(address_str);
+
+    if(!address) {
+        fmt::print("Failed to parse address.\n");
+        return;
+    }
+
+    const auto value = hex_from_str<uint64_t>(value_str);
+
+    if(!value) {
+        fmt::print("Failed to parse value.\n");
+        return;
+    }
+
+    // Dropped even if the write fails, as part of it may have been done.
+    s.code_cache.invalidate(*address, sizeof(*value));
+
+    if(!NKGT_STATS_TIME("target/write_memory", s.debugee->write_memory(*address, &*value, sizeof(*value)))) {
+        fmt::print("Failed to write memory at address {:#018x}.\n", *address);
+    }
+}
+
+auto handle_memory_command(
+    const nkgt::util::tokens& args,
+    session& s
+) -> void {
+    if(args.size() == 3 && nkgt::util::is_prefix(args[1], "read")) {
+        try_read_memory(args[2], "8", *s.debugee);
+    } else if(args.size() == 4 && nkgt::util::is_prefix(args[1], "read")) {
+        try_read_memory(args[2], args[3], *s.debugee);
+    } else if(args.size() == 4 && nkgt::util::is_prefix(args[1], "write")) {
+        try_write_memory(args[2], args[3], s);
+    } else {
+        fmt::print(
+            "Wrong number of arguments for memory command {}. Allowed usages are\n"
+            "\tmemory read address [size]\n"
+            "\tmemory write address value\n",
+            "memory"
+        );
+    }
+}
+
+// Walks the stack following the chain of saved frame pointers: at every frame
+// rbp points to the caller's rbp, immediately followed by the return address.
+// This only works for code compiled with frame pointers, which is what -Og and
+// -O0 produce.
+auto print_backtrace(session& s) -> void {
+    nkgt::target::target& debugee = *s.debugee;
+    const auto regs = NKGT_STATS_TIME("target/read_registers", debugee.read_registers());
+
+    if(!regs) {
+        fmt::print("Unable to retrieve register values\n");
+        return;
+    }
+
+    constexpr std::size_t max_frames = 256;
+    uint64_t pc = regs->rip;
+    uint64_t frame = regs->rbp;
+
+    for(std::size_t i = 0; i < max_frames; ++i) {
+        fmt::print("#{:<3} {:#018x} {}\n", i, pc, describe_address(s, pc));
+
+        if(frame == 0) {
+            return;
+        }
+
+        uint64_t saved[2];
+        if(!NKGT_STATS_TIME("target/read_memory", debugee.read_memory(frame, saved, sizeof(saved)))) {
+            return;
+        }
+
+        // The stack grows downward, so the caller's frame must be above ours.
+        if(saved[0] <= frame || saved[1] == 0) {
+            return;
+        }
+
+        frame = saved[0];
+        pc = saved[1];
+    }
+}
+
+// Reads memory as it was before the debugger replaced some of its bytes with
+// the 0xcc of the enabled breakpoints.
+[[nodiscard]]
+auto read_original_memory(
+    session& s,
+    std::uintptr_t address,
+    uint8_t* buffer,
+    std::size_t size
+) -> bool {
+    if(!NKGT_STATS_TIME("target/read_memory", s.debugee->read_memory(address, buffer, size))) {
+        return false;
+    }
+
+    for(const auto& [bp_address, bp] : s.breakpoint_list) {
+        const auto bp_uaddress = static_cast<std::uintptr_t>(bp_address);
+
+        if(bp.enabled && bp_uaddress >= address && bp_uaddress - address < size) {
+            buffer[bp_uaddress - address] = bp.saved_data;
+        }
+    }
+
+    return true;
+}
+
+// Canonical frame address of the frame of the function starting at low_pc.
+// There is no unwinder, so this relies on the usual frame pointer prologue
+// "[endbr64] push %rbp; mov %rsp,%rbp" and is only exact for code compiled
+// with frame pointers.
+[[nodiscard]]
+auto frame_cfa(
+    session& s,
+    const user_regs_struct& regs,
+    std::uintptr_t low_pc
+) -> uint64_t {
+    constexpr uint8_t endbr64[] = {0xf3, 0x0f, 0x1e, 0xfa};
+    constexpr uint8_t push_rbp = 0x55;
+
+    uint8_t code[sizeof(endbr64) + 1] = {};
+    if(!read_original_memory(s, low_pc, code, sizeof(code))) {
+        return regs.rbp + 16;
+    }
+
+    const std::size_t push_offset = std::equal(std::begin(endbr64), std::end(endbr64), code)
+                                  ? sizeof(endbr64)
+                                  : 0;
+    const uint64_t offset = regs.rip - low_pc;
+
+    if(offset <= push_offset) {
+        return regs.rsp + 8;
+    }
+
+    if(code[push_offset] == push_rbp && offset == push_offset + 1) {
+        return regs.rsp + 16;
+    }
+
+    return regs.rbp + 16;
+}
+
+// Evaluates the location of the variable at the current pc and prints its
+// value. Everything decoded from DWARF is cached, so after the first time a
+// print only costs the register read and the reads of the value itself.
+auto try_print_variable(
+    session& s,
+    std::string_view name,
+    const nkgt::pretty_printer::limits& limits
+) -> void {
+    const auto regs = NKGT_STATS_TIME("target/read_registers", s.debugee->read_registers());
+    if(!regs) {
+        fmt::print("Unable to retrieve register values\n");
+        return;
+    }
+
+    const uint64_t bias = s.memory_map.load_bias(s.program_path, s.program_symbols.load_base()).value_or(0);
+    const uint64_t pc = regs->rip - bias;
+
+    const auto* function = NKGT_STATS_TIME("dwarf/function_at", s.debug_info->function_at(pc));
+    const auto* variable = NKGT_STATS_TIME("dwarf/find_variable", s.debug_info->find_variable(function, name));
+    if(variable == nullptr) {
+        fmt::print("No variable named {} in the current scope.\n", name);
+        return;
+    }
+
+    const auto& graph = s.debug_info->graph();
+    const auto type = NKGT_STATS_TIME("dwarf/type_of", s.debug_info->type_of(*variable));
+    const std::size_t size = nkgt::pretty_printer::footprint(graph, type, limits);
+    if(size == 0) {
+        fmt::print("Unable to determine the type of {}.\n", name);
+        return;
+    }
+
+    const auto* code = variable->location.at(pc);
+    if(code == nullptr) {
+        fmt::print("{} = <optimized out>\n", name);
+        return;
+    }
+
+    nkgt::dwarf_expr::context ctx = {*s.debugee, *regs, bias, 0, 0};
+    if(function != nullptr) {
+        ctx.cfa = frame_cfa(s, *regs, function->low_pc + bias);
+
+        const auto* frame_base = NKGT_STATS_TIME("dwarf/frame_base", s.debug_info->frame_base(*function).at(pc));
+        if(frame_base != nullptr) {
+            ctx.frame_base = nkgt::dwarf_expr::evaluate_value(*frame_base, ctx).value_or(0);
+        }
+    }
+
+    const auto pieces = NKGT_STATS_TIME("dwarf/evaluate", nkgt::dwarf_expr::evaluate(*code, ctx));
+    if(!pieces) {
+        fmt::print("Unable to evaluate the location of {}.\n", name);
+        return;
+    }
+
+    std::vector<std::byte> bytes(size);
+    const auto result = NKGT_STATS_TIME(
+        "target/read_pieces",
+        nkgt::dwarf_expr::read_pieces(*pieces, ctx, bytes.data(), bytes.size())
+    );
+    if(!result) {
+        switch(result.error()) {
+        case nkgt::error::dwarf_expr::optimized_out:
+            fmt::print("{} = <optimized out>\n", name);
+            return;
+        default:
+            fmt::print("Unable to read the value of {}.\n", name);
+            return;
+        }
+    }
+
+    fmt::print("({}) {} = ", graph.display_name(type), name);
+    std::fflush(stdout);
+    NKGT_STATS_TIME(
+        "format/print",
+        nkgt::pretty_printer::print(*s.debugee, graph, type, bytes.data(), limits, stdout)
+    );
+    fmt::print("\n");
+}
+
+auto handle_print_command(
+    const nkgt::util::tokens& args,
+    session& s
+) -> void {
+    if(args.size() < 2 || args.size() > 4) {
+        fmt::print(
+            "Wrong number of arguments for print command {}. Allowed usages are\n"
+            "\tprint variable_name\n"
+            "\tprint variable_name max_elements\n"
+            "\tprint variable_name max_elements max_depth\n",
+            "print"
+        );
+
+        return;
+    }
+
+    nkgt::pretty_printer::limits limits;
+    std::size_t* const settings[] = {&limits.max_elements, &limits.max_depth};
+
+    for(std::size_t i = 2; i < args.size(); ++i) {
+        auto [_, ec] = std::from_chars(
+            args[i].data(),
+            args[i].data() + args[i].size(),
+            *settings[i - 2]
+        );
+
+        if(ec != std::errc()) {
+            fmt::print("Invalid limit {} passed to print.\n", args[i]);
+            return;
+        }
+    }
+
+    limits.max_string = std::max(limits.max_string, limits.max_elements);
+    try_print_variable(s, args[1], limits);
+}
+
+// Number of instructions shown by disassemble from an address, or from the pc
+// outside of the functions of the program.
+constexpr std::size_t default_disassemble_count = 16;
+
+// Largest read of code done at once by disassemble.
+constexpr std::size_t max_code_read = 1 << 16;
+
+struct function_code {
+    std::string_view name;
+    std::uintptr_t start;
+    std::uintptr_t end;
+};
+
+// Code of the function of the program containing address.
+[[nodiscard]]
+auto find_function_code(session& s, std::uintptr_t address) -> std::optional<function_code> {
+    const auto bias = s.memory_map.load_bias(s.program_path, s.program_symbols.load_base());
+    const auto* function = bias ? s.program_symbols.lookup(address - *bias) : nullptr;
+
+    if(function == nullptr || function->size == 0) {
+        return std::nullopt;
+    }
+
+    const std::uintptr_t start = function->address + *bias;
+    return function_code{function->name, start, start + function->size};
+}
+
+auto print_instruction(
+    session& s,
+    const nkgt::disassembler::instruction& i,
+    std::optional<std::uintptr_t> pc,
+    std::optional<std::uintptr_t> function_start
+) -> void {
+    const auto bp = s.breakpoint_list.find(static_cast<std::intptr_t>(i.address));
+    const bool breakpoint = bp != s.breakpoint_list.cend() && bp->second.enabled;
+
+    std::string bytes;
+    for(std::size_t b = 0; b < i.size; ++b) {
+        bytes += fmt::format("{:02x} ", i.bytes[b]);
+    }
+
+    const auto location = function_start
+                        ? fmt::format("<+{}>", i.address - *function_start)
+                        : fmt::format("<{}>", describe_address(s, i.address));
+
+    fmt::print(
+        "{}{} {:#018x} {:<7} {:<21} {}",
+        pc == i.address ? "=>" : "  ",
+        breakpoint ? '*' : ' ',
+        i.address,
+        location,
+        bytes,
+        i.text
+    );
+
+    if(i.target) {
+        const auto target = describe_address(s, *i.target);
+        fmt::print("  # {:#x}{}{}{}", *i.target, target.empty() ? "" : " <", target, target.empty() ? "" : ">");
+    }
+
+    fmt::print("\n");
+}
+
+// Prints the instructions of [address, end), but no more than count of them.
+// Blocks already decoded come from the cache of the session, the others are
+// decoded from one read of the whole range, taken without the 0xcc of the
+// breakpoints. Showing the same code again at every stop then costs no read of
+// the memory of the debugee.
+auto disassemble(
+    session& s,
+    std::uintptr_t address,
+    std::uintptr_t end,
+    std::size_t count,
+    std::optional<std::uintptr_t> pc,
+    std::optional<std::uintptr_t> function_start
+) -> void {
+    NKGT_STATS_SCOPE("command/disassemble");
+    constexpr std::uintptr_t page_size = 4096;
+
+    std::vector<uint8_t> code;
+    std::uintptr_t code_start = 0;
+    std::uintptr_t at = address;
+    std::size_t shown = 0;
+
+    while(at < end && shown < count) {
+        const auto* block = s.code_cache.find(at);
+
+        if(block == nullptr && (at < code_start || at >= code_start + code.size())) {
+            // Enough for the rest of the range, and for the last instruction to
+            // cross its end. Near the end of a mapping, the read is cut at the
+            // end of the page.
+            const std::size_t left = count - shown;
+            const std::size_t wanted = std::min({
+                end - at,
+                left < max_code_read ? left * nkgt::disassembler::max_instruction_size : max_code_read,
+                max_code_read
+            }) + nkgt::disassembler::max_instruction_size;
+
+            code_start = at;
+            code.resize(wanted);
+
+            if(!read_original_memory(s, at, code.data(), code.size())) {
+                code.resize(std::min<std::size_t>(wanted, page_size - at % page_size));
+                if(!read_original_memory(s, at, code.data(), code.size())) {
+                    fmt::print("Failed to read the code at {:#018x}.\n", at);
+                    return;
+                }
+            }
+        }
+
+        if(block == nullptr) {
+            const std::size_t offset = at - code_start;
+            block = s.code_cache.insert(code.data() + offset, code.size() - offset, at);
+
+            if(block == nullptr) {
+                return;
+            }
+        }
+
+        for(const auto& i : block->instructions) {
+            if(i.address >= end || shown == count) {
+                break;
+            }
+
+            print_instruction(s, i, pc, function_start);
+            shown += 1;
+        }
+
+        at = block->end();
+    }
+}
+
+auto handle_disassemble_command(
+    const nkgt::util::tokens& args,
+    session& s
+) -> void {
+    if(args.size() > 3) {
+        fmt::print(
+            "Wrong number of arguments for disassemble command {}. Allowed usages are\n"
+            "\tdisassemble\n"
+            "\tdisassemble function_name [count]\n"
+            "\tdisassemble address [count]\n",
+            "disassemble"
+        );
+
+        return;
+    }
+
+    const auto regs = NKGT_STATS_TIME("target/read_registers", s.debugee->read_registers());
+    std::optional<std::uintptr_t> pc;
+
+    if(regs) {
+        // After a breakpoint stop the pc is past the 0xcc.
+        const auto bp = s.breakpoint_list.find(static_cast<std::intptr_t>(regs->rip - 1));
+        pc = bp != s.breakpoint_list.cend() && bp->second.enabled ? regs->rip - 1 : regs->rip;
+    }
+
+    std::size_t count = default_disassemble_count;
+    if(args.size() == 3) {
+        auto [_, ec] = std::from_chars(args[2].data(), args[2].data() + args[2].size(), count);
+
+        if(ec != std::errc() || count == 0) {
+            fmt::print("Invalid count {} passed to disassemble.\n", args[2]);
+            return;
+        }
+    }
+
+    std::optional<std::uintptr_t> start = pc;
+    if(args.size() > 1) {
+        const auto location = resolve_location(s, args[1]);
+        if(!location) {
+            fmt::print("Unknown function or address {}.\n", args[1]);
+            return;
+        }
+
+        start = static_cast<std::uintptr_t>(*location);
+    }
+
+    if(!start) {
+        fmt::print("Unable to retrieve register values\n");
+        return;
+    }
+
+    // Without an address or a count, the whole function.
+    const bool whole_function = args.size() < 3 && (args.size() == 1 || args[1].substr(0, 2) != "0x");
+    const auto function = whole_function ? find_function_code(s, *start) : std::nullopt;
+
+    if(function) {
+        fmt::print("{}:\n", function->name);
+        disassemble(s, function->start, function->end, SIZE_MAX, pc, function->start);
+    } else {
+        disassemble(s, *start, UINTPTR_MAX, count, pc, std::nullopt);
+    }
+}
+
+auto try_create_checkpoint(session& s) -> void {
+    if(!s.debugee->is_live()) {
+        fmt::print("Checkpoints cannot be created from a core file.\n");
+        return;
+    }
+
+    const auto pc = nkgt::registers::get_register_value(*s.debugee, nkgt::registers::reg::rip);
+    const auto child = nkgt::checkpoint::fork_debugee(*s.debugee);
+
+    if(!pc || !child) {
+        fmt::print("Failed to create the checkpoint.\n");
+        return;
+    }
+
+    s.checkpoints.push_back({
+        *child,
+        *pc,
+        s.breakpoint_list,
+        s.timer_breakpoints,
+        s.library_breakpoints,
+        s.pending_breakpoints,
+        s.stop_filters
+    });
+    fmt::print("Checkpoint {} at {:#018x} (PID {}).\n", s.checkpoints.size() - 1, *pc, *child);
+}
+
+// Replaces the current debugee with a fresh fork of the given checkpoint. The
+// current debugee is killed, so it should be checkpointed first if it is
+// needed again.
+auto try_restart_from_checkpoint(
+    std::string_view index_str,
+    session& s
+) -> void {
+    std::size_t index = 0;
+    auto [_, ec] = std::from_chars(
+        index_str.data(),
+        index_str.data() + index_str.size(),
+        index
+    );
+
+    if(ec != std::errc() || index >= s.checkpoints.size()) {
+        fmt::print("{} is not a valid checkpoint number.\n", index_str);
+        return;
+    }
+
+    const checkpoint& origin = s.checkpoints[index];
+    nkgt::target::ptrace_target origin_process(origin.pid);
+    const auto child = nkgt::checkpoint::fork_debugee(origin_process);
+
+    if(!child) {
+        fmt::print("Failed to restart from checkpoint {}.\n", index);
+        return;
+    }
+
+    kill_process(s.debugee->pid());
+
+    // The soft-dirty bits the snapshot relies on belong to the old process.
+    if(s.snapshot) {
+        kill_process(*s.snapshot);
+        s.snapshot.reset();
+    }
+
+    s.debugee = std::make_unique<nkgt::target::ptrace_target>(*child);
+    s.memory_map = nkgt::maps::address_space(*child);
+    // Memory written since the checkpoint was taken is back as it was.
+    s.code_cache.clear();
+
+    // The libraries are read again from the list of the dynamic loader of the
+    // checkpoint, as after a run. The breakpoint of the loader added here is
+    // replaced by the one of the checkpoint, which is already in its memory.
+    s.libraries.reset();
+    start_library_tracking(s);
+    s.breakpoint_list = origin.breakpoint_list;
+    s.library_breakpoints = origin.library_breakpoints;
+    s.pending_breakpoints = origin.pending_breakpoints;
+    s.stop_filters = origin.stop_filters;
+    // The calls in progress in the checkpoint are not known, their return
+    // breakpoints are removed when they are hit.
+    s.timer_breakpoints = origin.timer_breakpoints;
+    for(auto& t : s.timers) {
+        (void)t->clear_calls();
+    }
+
+    for(auto& [_, bp] : s.breakpoint_list) {
+        bp.pid = *child;
+    }
+
+    if(s.libraries) {
+        handle_library_event(s);
+    }
+
+    fmt::print("Restarted from checkpoint {} at {:#018x} (PID {}).\n", index, origin.pc, *child);
+}
+
+auto handle_checkpoint_command(
+    const nkgt::util::tokens& args,
+    session& s
+) -> void {
+    if(args.size() == 1) {
+        try_create_checkpoint(s);
+    } else if(args.size() == 2 && nkgt::util::is_prefix(args[1], "list")) {
+        for(std::size_t i = 0; i < s.checkpoints.size(); ++i) {
+            fmt::print(
+                "{}: {:#018x} (PID {})\n",
+                i,
+                s.checkpoints[i].pc,
+                s.checkpoints[i].pid
+            );
+        }
+    } else {
+        fmt::print(
+            "Wrong number of arguments for checkpoint command {}. Allowed usages are\n"
+            "\tcheckpoint\n"
+            "\tcheckpoint list\n",
+            "checkpoint"
+        );
+    }
+}
+
+auto handle_restart_command(
+    const nkgt::util::tokens& args,
+    session& s
+) -> void {
+    if(args.size() == 1) {
+        try_rerun(args, s);
+        return;
+    }
+
+    if(args.size() != 2) {
+        fmt::print(
+            "Wrong number of arguments for restart command {}. Allowed usages are\n"
+            "\trestart\n"
+            "\trestart checkpoint_number\n",
+            "restart"
+        );
+
+        return;
+    }
+
+    try_restart_from_checkpoint(args[1], s);
+}
+
+[[nodiscard]]
+auto enabled_breakpoint_patches(const session& s) -> std::vector<nkgt::snapshot::patch> {
+    std::vector<nkgt::snapshot::patch> patches;
+    for(const auto& [address, bp] : s.breakpoint_list) {
+        if(bp.enabled) {
+            patches.push_back({static_cast<std::uintptr_t>(address), bp.saved_data});
+        }
+    }
+
+    return patches;
+}
+
+auto try_take_snapshot(session& s) -> void {
+    if(!s.debugee->is_live()) {
+        fmt::print("Snapshots cannot be taken from a core file.\n");
+        return;
+    }
+
+    const auto snapshot = nkgt::snapshot::take(*s.debugee);
+
+    if(!snapshot) {
+        switch(snapshot.error()) {
+        case nkgt::error::snapshot::clear_refs_fail:
+            fmt::print("Failed to clear the soft-dirty bits. Is CONFIG_MEM_SOFT_DIRTY enabled?\n");
+            return;
+        default:
+            fmt::print("Failed to take the snapshot.\n");
+            return;
+        }
+    }
+
+    if(s.snapshot) {
+        kill_process(*s.snapshot);
+    }
+
+    s.snapshot = *snapshot;
+    s.snapshot_patches = enabled_breakpoint_patches(s);
+    fmt::print("Snapshot taken.\n");
+}
+
+auto try_diff_snapshot(session& s) -> void {
+    if(!s.snapshot) {
+        fmt::print("No snapshot has been taken yet.\n");
+        return;
+    }
+
+    // The breakpoints enabled on either side are hidden.
+    auto patches = enabled_breakpoint_patches(s);
+    patches.insert(patches.end(), s.snapshot_patches.cbegin(), s.snapshot_patches.cend());
+
+    const auto ranges = nkgt::snapshot::diff(*s.debugee, *s.snapshot, patches);
+
+    if(!ranges) {
+        fmt::print("Failed to compare the memory with the snapshot.\n");
+        return;
+    }
+
+    std::size_t total = 0;
+    for(const auto& range : *ranges) {
+        fmt::print(
+            "{:#018x} - {:#018x} ({} bytes)\n",
+            range.start,
+            range.start + range.size,
+            range.size
+        );
+
+        total += range.size;
+    }
+
+    fmt::print("{} bytes changed in {} ranges.\n", total, ranges->size());
+}
+
+auto handle_snapshot_command(
+    const nkgt::util::tokens& args,
+    session& s
+) -> void {
+    if(args.size() == 1) {
+        try_take_snapshot(s);
+    } else if(args.size() == 2 && nkgt::util::is_prefix(args[1], "diff")) {
+        try_diff_snapshot(s);
+    } else {
+        fmt::print(
+            "Wrong number of arguments for snapshot command {}. Allowed usages are\n"
+            "\tsnapshot\n"
+            "\tsnapshot diff\n",
+            "snapshot"
+        );
+    }
+}
+
+auto print_timers(const session& s) -> void {
+    if(s.timers.empty()) {
+        fmt::print("No function is being timed.\n");
+        return;
+    }
+
+    fmt::print(
+        "{:<32} {:>10} {:>10} {:>10} {:>10} {:>10} {:>10} {:>10}\n",
+        "function", "calls", "mean", "p50", "p90", "p99", "p99.9", "max"
+    );
+
+    for(const auto& t : s.timers) {
+        const auto& h = t->latency();
+        const uint64_t mean = h.count() == 0 ? 0 : h.sum() / h.count();
+
+        fmt::print(
+            "{:<32} {:>10} {:>10} {:>10} {:>10} {:>10} {:>10} {:>10}\n",
+            t->name(),
+            h.count(),
+            nkgt::stats::format_duration(mean),
+            nkgt::stats::format_duration(h.percentile(0.5)),
+            nkgt::stats::format_duration(h.percentile(0.9)),
+            nkgt::stats::format_duration(h.percentile(0.99)),
+            nkgt::stats::format_duration(h.percentile(0.999)),
+            nkgt::stats::format_duration(h.max())
+        );
+
+        if(t->dropped() > 0) {
+            fmt::print("  {} calls did not return normally and are not counted.\n", t->dropped());
+        }
+    }
+
+    fmt::print(
+        "A stop of the debugee costs {}, subtracted for every stop during a call.\n",
+        nkgt::stats::format_duration(s.trap_cost_ns.value_or(0))
+    );
+}
+
+// Starts timing the calls of function.
+auto try_time_function(std::string_view function, session& s) -> void {
+    if(!s.debugee->is_live()) {
+        fmt::print("Functions cannot be timed on a core file.\n");
+        return;
+    }
+
+    const auto address = resolve_location(s, function);
+    if(!address) {
+        fmt::print("No function named {} is loaded.\n", function);
+        return;
+    }
+
+    const auto same = std::find_if(s.timers.cbegin(), s.timers.cend(), [&](const auto& t) {
+        return t->entry() == static_cast<std::uintptr_t>(*address);
+    });
+
+    if(same != s.timers.cend()) {
+        fmt::print("{} is already being timed.\n", function);
+        return;
+    }
+
+    if(!s.trap_cost_ns) {
+        s.trap_cost_ns = calibrate_trap_cost(*s.debugee);
+        if(!s.trap_cost_ns) {
+            fmt::print("Failed to measure the cost of a breakpoint, times will include it.\n");
+        }
+    }
+
+    s.timers.push_back(std::make_unique<nkgt::function_timer::timer>(std::string(function), *address));
+    arm_timer_breakpoint(s, *address);
+    fmt::print("Timing {} at {:#x}.\n", function, *address);
+}
+
+// Stops timing all the functions and removes their breakpoints.
+auto clear_timers(session& s) -> void {
+    const auto pc = nkgt::registers::get_register_value(*s.debugee, nkgt::registers::reg::rip);
+    s.timers.clear();
+
+    const std::vector<std::intptr_t> addresses(s.timer_breakpoints.cbegin(), s.timer_breakpoints.cend());
+    for(const auto address : addresses) {
+        release_timer_breakpoint(s, address, pc.value_or(0));
+    }
+}
+
+auto handle_timefunc_command(
+    const nkgt::util::tokens& args,
+    session& s
+) -> void {
+    if(args.size() == 1) {
+        print_timers(s);
+    } else if(args.size() == 2 && args[1] == "reset") {
+        for(auto& t : s.timers) {
+            t->reset();
+        }
+    } else if(args.size() == 2 && args[1] == "clear") {
+        clear_timers(s);
+    } else if(args.size() == 2) {
+        try_time_function(args[1], s);
+    } else {
+        fmt::print(
+            "Wrong number of arguments for timefunc command {}. Allowed usages are\n"
+            "\ttimefunc\n"
+            "\ttimefunc function_name\n"
+            "\ttimefunc reset\n"
+            "\ttimefunc clear\n",
+            "timefunc"
+        );
+    }
+}
+
+// Records of the ring of a new event log, 64 MiB. A stop at a breakpoint takes
+// 1 + register_records of them.
+constexpr uint64_t default_log_records = uint64_t{1} << 20;
+
+auto print_log_status(const session& s) -> void {
+    if(!s.log) {
+        fmt::print("No event log, start one with log start file.\n");
+        return;
+    }
+
+    const uint64_t written = s.log->written();
+    const uint64_t capacity = s.log->capacity();
+    fmt::print(
+        "Logging to {}: {} records written, {} overwritten.\n",
+        s.log->path().c_str(),
+        written,
+        written > capacity ? written - capacity : 0
+    );
+}
+
+auto try_start_log(
+    const nkgt::util::tokens& args,
+    session& s
+) -> void {
+    uint64_t records = default_log_records;
+    if(args.size() == 4) {
+        const auto [_, ec] = std::from_chars(args[3].data(), args[3].data() + args[3].size(), records);
+        if(ec != std::errc() || records == 0) {
+            fmt::print("{} is not a valid number of records.\n", args[3]);
+            return;
+        }
+    }
+
+    // The old log is complete once unmapped.
+    s.log.reset();
+
+    auto log = nkgt::event_log::create(std::string(args[2]), records);
+    if(!log) {
+        fmt::print("Failed to create the event log {}.\n", args[2]);
+        return;
+    }
+
+    s.log = std::move(*log);
+    fmt::print("Logging the stops to {}, {} records.\n", args[2], s.log->capacity());
+}
+
+auto handle_log_command(
+    const nkgt::util::tokens& args,
+    session& s
+) -> void {
+    if(args.size() == 1) {
+        print_log_status(s);
+    } else if((args.size() == 3 || args.size() == 4) && args[1] == "start") {
+        try_start_log(args, s);
+    } else if(args.size() == 2 && args[1] == "stop") {
+        print_log_status(s);
+        s.log.reset();
+    } else {
+        fmt::print(
+            "Wrong number of arguments for log command {}. Allowed usages are\n"
+            "\tlog\n"
+            "\tlog start file [records]\n"
+            "\tlog stop\n",
+            "log"
+        );
+    }
+}
+
+auto handle_stats_command(
+    const nkgt::util::tokens& args
+) -> void {
+    if(!nkgt::stats::enabled) {
+        fmt::print("The debugger was built without instrumentation, configure it with -DDEBUGGER_STATS=ON.\n");
+        return;
+    }
+
+    if(args.size() == 1) {
+        nkgt::stats::print(stdout);
+    } else if(args.size() == 2 && nkgt::util::is_prefix(args[1], "reset")) {
+        nkgt::stats::reset();
+    } else if(args.size() == 3 && nkgt::util::is_prefix(args[1], "dump")) {
+        const std::filesystem::path path = args[2];
+
+        if(!nkgt::stats::dump(path)) {
+            fmt::print("Failed to write the statistics to {}.\n", path.c_str());
+        }
+    } else {
+        fmt::print(
+            "Wrong number of arguments for stats command {}. Allowed usages are\n"
+            "\tstats\n"
+            "\tstats dump file\n"
+            "\tstats reset\n",
+            "stats"
+        );
+    }
+}
+
+// Readable memory of the debugee: the PT_LOAD segments of a core file or the
+// readable mappings of a live process.
+[[nodiscard]]
+auto readable_ranges(session& s) -> std::vector<nkgt::search::address_range> {
+    std::vector<nkgt::search::address_range> ranges;
+
+    if(const auto* core = dynamic_cast<const nkgt::target::core_target*>(s.debugee.get())) {
+        for(const auto& segment : core->segments()) {
+            ranges.push_back({segment.address, segment.address + segment.memory_size});
+        }
+
+        return ranges;
+    }
+
+    for(const auto& region : s.memory_map.regions()) {
+        // [vvar] is readable according to maps but reading it from another
+        // process always fails.
+        if(region.readable && region.path != "[vvar]") {
+            ranges.push_back({region.start, region.end});
+        }
+    }
+
+    return ranges;
+}
+
+auto handle_find_command(
+    const nkgt::util::tokens& args,
+    session& s
+) -> void {
+    if(args.size() != 4) {
+        fmt::print(
+            "Wrong number of arguments for find command {}. Allowed usages are\n"
+            "\tfind start_address end_address pattern\n"
+            "\tfind start_address all pattern\n"
+            "where pattern is one of str:text, bytes:de??beef, u8/u16/u32/u64:value\n",
+            "find"
+        );
+
+        return;
+    }
+
+    const auto start = hex_from_str<std::uintptr_t>(args[1]);
+    if(!start) {
+        fmt::print("Failed to parse start address.\n");
+        return;
+    }
+
+    std::uintptr_t end = UINTPTR_MAX;
+    if(args[2] != "all") {
+        const auto parsed_end = hex_from_str<std::uintptr_t>(args[2]);
+        if(!parsed_end) {
+            fmt::print("Failed to parse end address.\n");
+            return;
+        }
+
+        end = *parsed_end;
+    }
+
+    const auto pattern = nkgt::search::parse_pattern(args[3]);
+    if(!pattern) {
+        fmt::print("Invalid pattern {}.\n", args[3]);
+        return;
+    }
+
+    std::vector<nkgt::search::address_range> ranges;
+    std::size_t total_size = 0;
+    for(auto range : readable_ranges(s)) {
+        range.start = std::max(range.start, *start);
+        range.end = std::min(range.end, end);
+
+        if(range.start < range.end) {
+            ranges.push_back(range);
+            total_size += range.end - range.start;
+        }
+    }
+
+    constexpr std::size_t max_printed = 64;
+
+    const auto begin_time = std::chrono::steady_clock::now();
+    const auto result = nkgt::search::find(*s.debugee, ranges, *pattern, max_printed);
+    const auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin_time);
+
+    for(const auto address : result.matches) {
+        fmt::print("{:#018x}\n", address);
+    }
+
+    if(result.count > result.matches.size()) {
+        fmt::print("... and {} more.\n", result.count - result.matches.size());
+    }
+
+    fmt::print(
+        "{} matches in {} MiB ({:.3f} s).\n",
+        result.count,
+        total_size >> 20,
+        elapsed.count()
+    );
+
+    if(result.unreadable > 0) {
+        fmt::print("{} bytes could not be read and were not searched.\n", result.unreadable);
+    }
+}
+
+// Every command takes the whole line, name included. Returns true if the REPL
+// must stop.
+using command_handler = auto (*)(const nkgt::util::tokens& args, session& s) -> bool;
+
+struct command {
+    std::string_view name;
+    command_handler handler;
+};
+
+// In the order in which abbreviations are resolved, e.g. b is break and not
+// backtrace.
+const std::array<command, 17> commands = {{
+    {"continue", [](const nkgt::util::tokens&, session& s) { continue_session(s); return false; }},
+    {"break", [](const nkgt::util::tokens& args, session& s) { handle_break_command(args, s); return false; }},
+    {"ignore", [](const nkgt::util::tokens& args, session& s) { handle_ignore_command(args, s); return false; }},
+    {"register", [](const nkgt::util::tokens& args, session& s) { handle_register_command(args, *s.debugee); return false; }},
+    {"memory", [](const nkgt::util::tokens& args, session& s) { handle_memory_command(args, s); return false; }},
+    {"find", [](const nkgt::util::tokens& args, session& s) { handle_find_command(args, s); return false; }},
+    {"backtrace", [](const nkgt::util::tokens&, session& s) { print_backtrace(s); return false; }},
+    {"print", [](const nkgt::util::tokens& args, session& s) { handle_print_command(args, s); return false; }},
+    {"checkpoint", [](const nkgt::util::tokens& args, session& s) { handle_checkpoint_command(args, s); return false; }},
+    {"restart", [](const nkgt::util::tokens& args, session& s) { handle_restart_command(args, s); return false; }},
+    {"run", [](const nkgt::util::tokens& args, session& s) { try_rerun(args, s); return false; }},
+    {"snapshot", [](const nkgt::util::tokens& args, session& s) { handle_snapshot_command(args, s); return false; }},
+    {"stats", [](const nkgt::util::tokens& args, session&) { handle_stats_command(args); return false; }},
+    {"timefunc", [](const nkgt::util::tokens& args, session& s) { handle_timefunc_command(args, s); return false; }},
+    {"log", [](const nkgt::util::tokens& args, session& s) { handle_log_command(args, s); return false; }},
+    {"disassemble", [](const nkgt::util::tokens& args, session& s) { handle_disassemble_command(args, s); return false; }},
+    {"quit", [](const nkgt::util::tokens&, session&) { return true; }},
+}};
+
+// Every abbreviation of every command, sorted, so that a command is found with
+// a binary search instead of trying the names one after the other.
+class command_table {
+public:
+    command_table() {
+        for(const auto& c : commands) {
+            for(std::size_t length = 1; length <= c.name.size(); ++length) {
+                const auto abbreviation = c.name.substr(0, length);
+                const bool taken = std::any_of(entries_.cbegin(), entries_.cend(), [&](const auto& e) {
+                    return e.first == abbreviation;
+                });
+
+                if(!taken) {
+                    entries_.emplace_back(abbreviation, &c);
+                }
+            }
+        }
+
+        std::sort(entries_.begin(), entries_.end());
+    }
+
+    [[nodiscard]]
+    auto find(std::string_view name) const -> const command* {
+        const auto it = std::lower_bound(
+            entries_.cbegin(),
+            entries_.cend(),
+            name,
+            [](const auto& e, std::string_view n) { return e.first < n; }
+        );
+
+        return it != entries_.cend() && it->first == name ? it->second : nullptr;
+    }
+
+private:
+    std::vector<std::pair<std::string_view, const command*>> entries_;
+};
+
+// Parses the user input and then dispatches to the appropriate command logic.
+// Return true if the "quit" command has been issued, false otherwise.
+auto handle_command(
+    std::string_view line,
+    session& s
+) -> bool {
+    static const command_table table;
+    nkgt::util::tokens args;
+
+    if(!nkgt::util::tokenize(line, args)) {
+        fmt::print("Too many arguments, at most {} are allowed.\n", nkgt::util::tokens::capacity);
+        return false;
+    }
+
+    if(args.empty()) {
+        return false;
+    }
+
+    const auto* c = table.find(args[0]);
+
+    if(c == nullptr) {
+        fmt::print("Unknow command\n");
+        return false;
+    }
+
+    return c->handler(args, s);
+}
+
+// Completions offered for the function name of break.
+constexpr std::size_t max_completions = 32;
+
+// linenoise's completion callback takes no user data, so the index of the
+// session is reached through this while the REPL runs.
+const nkgt::symbol_index::background_index* completion_index = nullptr;
+
+// Completes break followed by part of a function name with the best matching
+// functions. Nothing is offered while the index is still being built.
+auto complete_line(const char* buffer, linenoiseCompletions* completions) -> void {
+    if(completion_index == nullptr) {
+        return;
+    }
+
+    const auto* index = completion_index->get();
+    if(index == nullptr) {
+        return;
+    }
+
+    const std::string_view line(buffer);
+    const auto args = nkgt::util::split(line, ' ');
+    if(args.size() != 2 || line.back() == ' ' || !nkgt::util::is_prefix(args[0], "break")) {
+        return;
+    }
+
+    for(const auto name : index->search(args[1], max_completions)) {
+        const auto completion = fmt::format("{} {}", args[0], name);
+        linenoiseAddCompletion(completions, completion.c_str());
+    }
+}
+
+// Runs the commands of script, one per line, until quit or the end of the
+// input. Blank lines and lines starting with # are skipped. The line buffer is
+// reused and tokenizing does not allocate, so that long scripts are bound by
+// the commands themselves.
+auto run_script(session& s, std::FILE* script) -> void {
+    char* line = nullptr;
+    std::size_t capacity = 0;
+    ssize_t length = 0;
+
+    while((length = getline(&line, &capacity, script)) != -1) {
+        std::string_view command(line, static_cast<std::size_t>(length));
+
+        while(!command.empty() && (command.back() == '\n' || command.back() == '\r')) {
+            command.remove_suffix(1);
+        }
+
+        const auto first = command.find_first_not_of(' ');
+        if(first == std::string_view::npos || command[first] == '#') {
+            continue;
+        }
+
+        if(handle_command(command, s)) {
+            break;
+        }
+    }
+
+    std::free(line);
+    std::fflush(stdout);
+}
+
+// Main REPL loop, shared by live processes and core files. When script is not
+// null the commands are read from it instead of the terminal.
+auto repl(
+    std::unique_ptr<nkgt::target::target> debugee,
+    const std::filesystem::path& program_path,
+    std::optional<nkgt::process::launch_options> launch,
+    std::FILE* script
+) -> void {
+    auto debug_info = NKGT_STATS_TIME("dwarf/load", nkgt::debug_info::load_debug_info(program_path));
+
+    if(!debug_info) {
+        fmt::print("Failed to load the debug symbols.\n");
+        return;
+    }
+
+    auto program_symbols = NKGT_STATS_TIME("elf/load_symbols", nkgt::symbols::load_symbols(program_path));
+    if(!program_symbols) {
+        fmt::print("Failed to load the ELF symbols of {}.\n", program_path.c_str());
+        program_symbols = nkgt::symbols::symbol_table();
+    }
+
+    const auto* core = dynamic_cast<const nkgt::target::core_target*>(debugee.get());
+    nkgt::maps::address_space memory_map = core != nullptr
+                                         ? nkgt::maps::address_space(core->mappings())
+                                         : nkgt::maps::address_space(debugee->pid());
+
+    std::error_code ec;
+    const auto absolute_path = std::filesystem::canonical(program_path, ec);
+
+    session s;
+    s.debugee = std::move(debugee);
+    s.memory_map = std::move(memory_map);
+    s.program_symbols = std::move(*program_symbols);
+    s.debug_info = std::move(*debug_info);
+    s.program_path = ec ? program_path.string() : absolute_path.string();
+    s.launch = std::move(launch);
+
+    if(s.debugee->is_live()) {
+        start_library_tracking(s);
+        try_enable_breakpoints(s);
+
+        if(s.libraries) {
+            handle_library_event(s);
+        }
+    }
+
+    if(script != nullptr) {
+        run_script(s, script);
+        return;
+    }
+
+    s.function_index = std::make_unique<nkgt::symbol_index::background_index>(
+        s.program_symbols.functions()
+    );
+    completion_index = s.function_index.get();
+    linenoiseSetCompletionCallback(complete_line);
+
+    char* line = nullptr;
+    while((line = linenoise("dbg> ")) != nullptr) {
+        if(handle_command(line, s)) {
+            linenoiseFree(line);
+            break;
+        }
+
+        linenoiseHistoryAdd(line);
+        linenoiseFree(line);
+    }
+
+    completion_index = nullptr;
+}
+
+}
+
+namespace nkgt::debugger {
+
+// In x86 0xcc is the instruction that identifies a breakpoint. So enabling
+// a breakpoint simply means replacing whatever instruction is at
+// bp.address with 0xcc.
+[[nodiscard]]
+auto enable_breakpoint(
+    breakpoint& bp
+) -> tl::expected<void, error::breakpoint> {
+    // Calling ptrace with PTRACE_PEEKDATA retrieves the word at bp.address for
+    // the process identified by bp.pid. This means that -1 is a valid return
+    // value and does not necessarily describe an error. To solve this we clear
+    // errno before calling ptrace and we check it right after.
+    // More info at RETURN_VALUE in ptrace(2).
+    errno = 0;
+    long data = NKGT_STATS_TIME("ptrace/PEEKDATA", ptrace(PTRACE_PEEKDATA, bp.pid, bp.address, nullptr));
+    if(data == -1 && errno != 0) {
+        util::print_error_message("ptrace", errno);
+        return tl::unexpected(error::breakpoint::peek_address_fail);
+    }
+
+    long data_with_trap = ((data & ~0xff) | 0xcc);
+    if(NKGT_STATS_TIME("ptrace/POKEDATA", ptrace(PTRACE_POKEDATA, bp.pid, bp.address, data_with_trap)) == -1) {
+        util::print_error_message("ptrace", errno);
+        return tl::unexpected(error::breakpoint::poke_address_fail);
+    }
+
+    // The breakpoint is modified at the end so that in case of errors there is
+    // no leftover data in it.
+    bp.saved_data = static_cast<uint8_t>(data & 0xff);
+    bp.enabled = true;
+
+    return {};
+}
+
+// Disables a breakpoint by restoring the original data (bp.saved_data) in the
+// location bp.address.
+[[nodiscard]]
+auto disable_breakpoint(
+    breakpoint& bp
+) -> tl::expected<void, error::breakpoint> {
+    // See comment in enable_breakpoint() for more info.
+    errno = 0;
+    long data = NKGT_STATS_TIME("ptrace/PEEKDATA", ptrace(PTRACE_PEEKDATA, bp.pid, bp.address, nullptr));
+    if(data == -1 && errno != 0) {
+        util::print_error_message("ptrace", errno);
+        return tl::unexpected(error::breakpoint::peek_address_fail);
+    }
+
+    long restored_data = ((data & ~0xff) | bp.saved_data);
+
+    if(NKGT_STATS_TIME("ptrace/POKEDATA", ptrace(PTRACE_POKEDATA, bp.pid, bp.address, restored_data)) == -1) {
+        util::print_error_message("ptrace", errno);
+        return tl::unexpected(error::breakpoint::poke_address_fail);
+    }
+
+    bp.enabled = false;
+
+    return {};
+}
+
+auto enable_breakpoints(
+    target::target& debugee,
+    std::unordered_map<std::intptr_t, breakpoint>& breakpoint_list
+) -> tl::expected<void, error::breakpoint> {
+    NKGT_STATS_SCOPE("breakpoints/enable_all");
+    constexpr std::uintptr_t page_mask = ~std::uintptr_t{4095};
+
+    std::vector<breakpoint*> disabled;
+    for(auto& [_, bp] : breakpoint_list) {
+        if(!bp.enabled) {
+            disabled.push_back(&bp);
+        }
+    }
+
+    std::sort(disabled.begin(), disabled.end(), [](const breakpoint* a, const breakpoint* b) {
+        return a->address < b->address;
+    });
+
+    tl::expected<void, error::breakpoint> result;
+    std::vector<uint8_t> original;
+    std::vector<uint8_t> code;
+
+    for(std::size_t begin = 0, end = 0; begin < disabled.size(); begin = end) {
+        const auto page = static_cast<std::uintptr_t>(disabled[begin]->address) & page_mask;
+        end = begin + 1;
+        while(end < disabled.size() && (static_cast<std::uintptr_t>(disabled[end]->address) & page_mask) == page) {
+            ++end;
+        }
+
+        // Only the span between the first and the last breakpoint of the page.
+        const auto first = static_cast<std::uintptr_t>(disabled[begin]->address);
+        const auto last = static_cast<std::uintptr_t>(disabled[end - 1]->address);
+        original.resize(last - first + 1);
+
+        if(!debugee.read_memory(first, original.data(), original.size())) {
+            if(result) {
+                result = tl::unexpected(error::breakpoint::peek_address_fail);
+            }
+
+            continue;
+        }
+
+        code = original;
+        for(std::size_t i = begin; i < end; ++i) {
+            code[static_cast<std::uintptr_t>(disabled[i]->address) - first] = 0xcc;
+        }
+
+        if(!debugee.write_memory(first, code.data(), code.size())) {
+            if(result) {
+                result = tl::unexpected(error::breakpoint::poke_address_fail);
+            }
+
+            continue;
+        }
+
+        for(std::size_t i = begin; i < end; ++i) {
+            disabled[i]->pid = debugee.pid();
+            disabled[i]->saved_data = original[static_cast<std::uintptr_t>(disabled[i]->address) - first];
+            disabled[i]->enabled = true;
+        }
+    }
+
+    return result;
+}
+
+auto step_over_breakpoint(
+    target::target& debugee,
+    std::unordered_map<std::intptr_t, breakpoint>& breakpoint_list
+) -> std::optional<int> {
+    const auto current_pc = registers::get_register_value(debugee, registers::reg::rip);
+
+    if(!current_pc) {
+        fmt::print("Failed to get current Program Counter value.\n");
+        return std::nullopt;
+    }
+
+    int pending_signal = 0;
+
+    uint64_t possible_bp_location = *current_pc - 1;
+
+    const auto& bp_it = breakpoint_list.find(static_cast<std::intptr_t>(possible_bp_location));
+    if(bp_it != breakpoint_list.cend() && bp_it->second.enabled) {
+        const auto pc_result = registers::set_register_value(
+            debugee,
+            registers::reg::rip,
+            possible_bp_location
+        );
+
+        if(!pc_result) {
+            fmt::print("Failed to set Program Counter value.\n");
+            return std::nullopt;
+        }
+
+        breakpoint& bp = bp_it->second;
+
+        const auto bp_result = disable_breakpoint(bp);
+        if(!bp_result) {
+            fmt::print("Failed to disable breakpoint at {}.\n", bp.address);
+            return std::nullopt;
+        }
+
+        // A signal sent to the debugee (e.g. SIGCHLD from one of its
+        // children) stops it before the instruction is executed: the step is
+        // retried without it, otherwise its handler would run first and the
+        // breakpoint would be hit a second time on return. The first such
+        // signal is returned to be delivered by the next resume, later ones
+        // are sent again once the step is done. Faults of the instruction
+        // itself are left to the next resume.
+        std::vector<int> deferred;
+        int wait_status = 0;
+        while(true) {
+            if(NKGT_STATS_TIME("ptrace/SINGLESTEP", ptrace(PTRACE_SINGLESTEP, debugee.pid(), nullptr, nullptr)) == -1) {
+                util::print_error_message("ptrace", errno);
+                return std::nullopt;
+            }
+
+            wait_status = wait_for_signal(debugee.pid());
+            if(!WIFSTOPPED(wait_status) || is_fault(WSTOPSIG(wait_status))) {
+                break;
+            }
+
+            const int signal = WSTOPSIG(wait_status);
+            if(pending_signal == 0) {
+                pending_signal = signal;
+            } else if(signal != pending_signal &&
+                      std::find(deferred.cbegin(), deferred.cend(), signal) == deferred.cend()) {
+                deferred.push_back(signal);
+            }
+        }
+
+        for(const int signal : deferred) {
+            kill(debugee.pid(), signal);
+        }
+
+        debugee.invalidate_caches();
+
+        const auto set_bp_result = enable_breakpoint(bp);
+        if(!set_bp_result) {
+            fmt::print("Failed to re-enable breakpoint at {}.\n", bp.address);
+            return std::nullopt;
+        }
+    }
+
+    return pending_signal;
+}
+
+auto continue_execution(
+    target::target& debugee,
+    std::unordered_map<std::intptr_t, breakpoint>& breakpoint_list
+) -> std::optional<int> {
+    if(!debugee.is_live()) {
+        fmt::print("The debugee is a core file and cannot be resumed.\n");
+        return std::nullopt;
+    }
+
+    const auto signal = step_over_breakpoint(debugee, breakpoint_list);
+
+    if(!signal) {
+        fmt::print("Failed to step over breakpoint. Continuing execution with in unknow state\n");
+    }
+
+    if(NKGT_STATS_TIME("ptrace/CONT", ptrace(PTRACE_CONT, debugee.pid(), nullptr, signal.value_or(0))) == -1) {
+        util::print_error_message("ptrace", errno);
+        return std::nullopt;
+    }
+    
+    const int wait_status = wait_for_signal(debugee.pid());
+    debugee.invalidate_caches();
+    return wait_status;
+}
+
+auto run(
+    pid_t pid,
+    const process::launch_options& options
+) -> void {
+    repl(std::make_unique<target::ptrace_target>(pid), options.program, options, nullptr);
+}
+
+auto run_batch(
+    pid_t pid,
+    const process::launch_options& options,
+    std::FILE* script
+) -> void {
+    repl(std::make_unique<target::ptrace_target>(pid), options.program, options, script);
+}
+
+auto run_server(
+    pid_t pid,
+    std::string_view address
+) -> void {
+    const auto result = gdb_server::serve(pid, address);
+
+    if(!result) {
+        switch(result.error()) {
+        case error::gdb_server::invalid_address:
+            fmt::print("Invalid address {}, expected a socket path or [host]:port on the loopback interface.\n", address);
+            return;
+        case error::gdb_server::socket_fail:
+        case error::gdb_server::bind_fail:
+        case error::gdb_server::listen_fail:
+        case error::gdb_server::accept_fail:
+            fmt::print("Failed to accept a connection on {}.\n", address);
+            return;
+        }
+    }
+}
+
+auto run_core(
+    const std::filesystem::path& core_path,
+    const std::filesystem::path& program_path
+) -> void {
+    auto core = target::load_core(core_path);
+
+    if(!core) {
+        switch(core.error()) {
+        case error::core_file::open_fail:
+        case error::core_file::map_fail:
+            fmt::print("Failed to open the core file {}.\n", core_path.c_str());
+            return;
+        case error::core_file::invalid_format:
+            fmt::print("{} is not a x86_64 ELF core file.\n", core_path.c_str());
+            return;
+        case error::core_file::missing_registers:
+            fmt::print("The core file {} contains no NT_PRSTATUS note.\n", core_path.c_str());
+            return;
+        }
+    }
+
+    fmt::print("Loaded core file of process {}.\n", (*core)->pid());
+    repl(std::move(*core), program_path, std::nullopt, nullptr);
 }
 
 }
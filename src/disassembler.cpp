@@ -0,0 +1,1906 @@
+#include "nkgt/disassembler.hpp"
+
+#include <fmt/core.h>
+
+#include <algorithm>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <string_view>
+
+namespace {
+
+// Operands as named in the opcode maps of the Intel manual (volume 2, appendix
+// A): the letter tells where the operand is encoded, the rest its size.
+enum operand : uint8_t {
+    none,
+    // ModRM rm, general purpose register or memory. v is the operand size,
+    // y 32 or 64 bits with REX.W/VEX.W.
+    Eb, Ew, Ed, Eq, Ev, Ey,
+    // ModRM rm, memory only. x is the vector size.
+    M, Md, Mq, Mdq, Mx,
+    // ModRM reg, general purpose register.
+    Gb, Gw, Gd, Gv, Gy,
+    // Immediates. Ibs is sign extended to the operand size, Iz is 16 or 32
+    // bits (sign extended to 64), Iv 16, 32 or 64 bits.
+    Ib, Ibs, Iw, Iz, Iv,
+    // Relative branch offsets.
+    Jb, Jz,
+    // Register in the low 3 bits of the opcode.
+    Zb, Zv,
+    // Fixed registers. eAX is rAX capped at 32 bits.
+    AL, rAX, eAX, CL, DX, one,
+    // Absolute memory offset.
+    Ob, Ov,
+    // Segment register in ModRM reg.
+    Sw,
+    // MMX register in ModRM reg, register or memory in ModRM rm, register in
+    // ModRM rm.
+    Pq, Qq, Nq,
+    // Vector register in ModRM reg, of the vector size or always xmm.
+    Vx, Vdq,
+    // Vector register or memory in ModRM rm. The suffix is the size of the
+    // memory operand.
+    Wx, Wdq, Wb, Ww, Wd, Wq,
+    // Vector register in ModRM rm.
+    Ux, Udq,
+    // Vector register in VEX.vvvv.
+    Hx, Hdq,
+    // General purpose register in VEX.vvvv.
+    By,
+    // Mask register in ModRM reg, or register or memory in ModRM rm, or in
+    // VEX.vvvv.
+    Kg, Ke, Kh,
+};
+
+// The operand size is 64 bits unless overridden by 0x66 (d64) or always
+// (f64).
+constexpr uint16_t d64 = 1 << 0;
+constexpr uint16_t f64 = 1 << 1;
+// Not valid in 64-bit mode.
+constexpr uint16_t invalid = 1 << 2;
+// Ends a basic block.
+constexpr uint16_t jump = 1 << 3;
+// String instruction, the name is suffixed by the operand size and it can be
+// prefixed by rep.
+constexpr uint16_t string = 1 << 4;
+// The name is suffixed by the operand size.
+constexpr uint16_t sized = 1 << 5;
+// With VEX and EVEX, vvvv is the first source (inserted as second operand),
+// always or only when ModRM rm is a register.
+constexpr uint16_t nds = 1 << 6;
+constexpr uint16_t nds_reg = 1 << 7;
+// Only valid with VEX or EVEX.
+constexpr uint16_t vex_only = 1 << 8;
+// The last d of the name becomes q with REX.W/VEX.W.
+constexpr uint16_t wide_q = 1 << 9;
+// The VEX form does not take the v prefix (general purpose instructions).
+constexpr uint16_t no_v = 1 << 10;
+// Has a ModRM byte even if no operand is encoded in it.
+constexpr uint16_t modrm = 1 << 11;
+// Compares with a mask register destination when EVEX encoded.
+constexpr uint16_t mask_compare = 1 << 12;
+// The last b of the name becomes w with VEX.W/EVEX.W.
+constexpr uint16_t wide_w = 1 << 13;
+// Mask register instruction, suffixed by the size of the mask.
+constexpr uint16_t mask_size = 1 << 14;
+// The last s of the name becomes d with VEX.W, as do the dword memory
+// operands (ps to pd, ss to sd).
+constexpr uint16_t wide_s = 1 << 15;
+
+using group = std::array<std::string_view, 8>;
+
+struct entry {
+    std::string_view name;
+    std::array<operand, 3> operands;
+    uint16_t flags;
+    // Instructions told apart by ModRM reg, replacing name. An empty name is
+    // an invalid instruction.
+    const group* names;
+};
+
+constexpr std::array<std::string_view, 16> condition_codes = {
+    "o", "no", "b", "ae", "e", "ne", "be", "a", "s", "ns", "p", "np", "l", "ge", "le", "g",
+};
+
+constexpr std::array<std::string_view, 16> jcc_names = {
+    "jo", "jno", "jb", "jae", "je", "jne", "jbe", "ja", "js", "jns", "jp", "jnp", "jl", "jge", "jle", "jg",
+};
+
+constexpr std::array<std::string_view, 16> cmov_names = {
+    "cmovo", "cmovno", "cmovb", "cmovae", "cmove", "cmovne", "cmovbe", "cmova",
+    "cmovs", "cmovns", "cmovp", "cmovnp", "cmovl", "cmovge", "cmovle", "cmovg",
+};
+
+constexpr std::array<std::string_view, 16> set_names = {
+    "seto", "setno", "setb", "setae", "sete", "setne", "setbe", "seta",
+    "sets", "setns", "setp", "setnp", "setl", "setge", "setle", "setg",
+};
+
+constexpr group group1 = {"add", "or", "adc", "sbb", "and", "sub", "xor", "cmp"};
+constexpr group group1a = {"pop", "", "", "", "", "", "", ""};
+constexpr group group2 = {"rol", "ror", "rcl", "rcr", "shl", "shr", "sal", "sar"};
+constexpr group group3 = {"test", "test", "not", "neg", "mul", "imul", "div", "idiv"};
+constexpr group group4 = {"inc", "dec", "", "", "", "", "", ""};
+constexpr group group5 = {"inc", "dec", "call", "call far", "jmp", "jmp far", "push", ""};
+constexpr group group6 = {"sldt", "str", "lldt", "ltr", "verr", "verw", "", ""};
+constexpr group group7 = {"sgdt", "sidt", "lgdt", "lidt", "smsw", "", "lmsw", "invlpg"};
+constexpr group group8 = {"", "", "", "", "bt", "bts", "btr", "btc"};
+constexpr group group9 = {"", "cmpxchg8b", "", "", "", "", "rdrand", "rdseed"};
+constexpr group group11b = {"mov", "", "", "", "", "", "", "xabort"};
+constexpr group group11v = {"mov", "", "", "", "", "", "", "xbegin"};
+constexpr group group15 = {"fxsave", "fxrstor", "ldmxcsr", "stmxcsr", "xsave", "xrstor", "xsaveopt", "clflush"};
+constexpr group group15_vex = {"", "", "ldmxcsr", "stmxcsr", "", "", "", ""};
+constexpr group group16 = {"prefetchnta", "prefetcht0", "prefetcht1", "prefetcht2", "nop", "nop", "nop", "nop"};
+constexpr group group17 = {"", "blsr", "blsmsk", "blsi", "", "", "", ""};
+// Shifts of vector registers by an immediate, 0F 71, 72 and 73.
+constexpr group shift_words = {"", "", "psrlw", "", "psraw", "", "psllw", ""};
+constexpr group shift_dwords = {"", "", "psrld", "", "psrad", "", "pslld", ""};
+constexpr group shift_qwords = {"", "", "psrlq", "psrldq", "", "", "psllq", "pslldq"};
+
+struct tables {
+    std::array<entry, 256> one_byte;
+    // 0F map, ignoring the mandatory prefixes.
+    std::array<entry, 256> two_byte;
+    // 0F, 0F38 and 0F3A maps by mandatory prefix: none, 66, F3, F2. Entries
+    // take precedence over two_byte.
+    std::array<std::array<std::array<entry, 4>, 256>, 3> prefixed;
+};
+
+constexpr uint8_t no_prefix = 0;
+constexpr uint8_t p66 = 1;
+constexpr uint8_t pf3 = 2;
+constexpr uint8_t pf2 = 3;
+
+auto build_one_byte(std::array<entry, 256>& t) -> void {
+    constexpr std::array<std::string_view, 8> alu = {"add", "or", "adc", "sbb", "and", "sub", "xor", "cmp"};
+
+    for(std::size_t i = 0; i < 8; ++i) {
+        const std::size_t base = i * 8;
+        t[base + 0] = {alu[i], {Eb, Gb}, 0, nullptr};
+        t[base + 1] = {alu[i], {Ev, Gv}, 0, nullptr};
+        t[base + 2] = {alu[i], {Gb, Eb}, 0, nullptr};
+        t[base + 3] = {alu[i], {Gv, Ev}, 0, nullptr};
+        t[base + 4] = {alu[i], {AL, Ib}, 0, nullptr};
+        t[base + 5] = {alu[i], {rAX, Iz}, 0, nullptr};
+        // Segment pushes and pops, BCD adjustments and the segment prefixes,
+        // which never reach the table.
+        t[base + 6] = {"(bad)", {}, invalid, nullptr};
+        t[base + 7] = {"(bad)", {}, invalid, nullptr};
+    }
+
+    for(std::size_t i = 0; i < 8; ++i) {
+        t[0x50 + i] = {"push", {Zv}, d64, nullptr};
+        t[0x58 + i] = {"pop", {Zv}, d64, nullptr};
+        t[0x91 + i] = {"xchg", {Zv, rAX}, 0, nullptr};
+        t[0xb0 + i] = {"mov", {Zb, Ib}, 0, nullptr};
+        t[0xb8 + i] = {"mov", {Zv, Iv}, 0, nullptr};
+    }
+
+    for(std::size_t i = 0; i < 16; ++i) {
+        t[0x70 + i] = {jcc_names[i], {Jb}, f64 | jump, nullptr};
+    }
+
+    for(const std::size_t i : {0x60u, 0x61u, 0x62u, 0x82u, 0x9au, 0xc4u, 0xc5u, 0xceu, 0xd4u, 0xd5u, 0xd6u, 0xeau}) {
+        t[i] = {"(bad)", {}, invalid, nullptr};
+    }
+
+    t[0x63] = {"movsxd", {Gv, Ed}, 0, nullptr};
+    t[0x68] = {"push", {Iz}, d64, nullptr};
+    t[0x69] = {"imul", {Gv, Ev, Iz}, 0, nullptr};
+    t[0x6a] = {"push", {Ibs}, d64, nullptr};
+    t[0x6b] = {"imul", {Gv, Ev, Ibs}, 0, nullptr};
+    t[0x6c] = {"insb", {}, string, nullptr};
+    t[0x6d] = {"ins", {}, string | sized, nullptr};
+    t[0x6e] = {"outsb", {}, string, nullptr};
+    t[0x6f] = {"outs", {}, string | sized, nullptr};
+    t[0x80] = {"", {Eb, Ib}, 0, &group1};
+    t[0x81] = {"", {Ev, Iz}, 0, &group1};
+    t[0x83] = {"", {Ev, Ibs}, 0, &group1};
+    t[0x84] = {"test", {Eb, Gb}, 0, nullptr};
+    t[0x85] = {"test", {Ev, Gv}, 0, nullptr};
+    t[0x86] = {"xchg", {Eb, Gb}, 0, nullptr};
+    t[0x87] = {"xchg", {Ev, Gv}, 0, nullptr};
+    t[0x88] = {"mov", {Eb, Gb}, 0, nullptr};
+    t[0x89] = {"mov", {Ev, Gv}, 0, nullptr};
+    t[0x8a] = {"mov", {Gb, Eb}, 0, nullptr};
+    t[0x8b] = {"mov", {Gv, Ev}, 0, nullptr};
+    t[0x8c] = {"mov", {Ew, Sw}, 0, nullptr};
+    t[0x8d] = {"lea", {Gv, M}, 0, nullptr};
+    t[0x8e] = {"mov", {Sw, Ew}, 0, nullptr};
+    t[0x8f] = {"", {Ev}, d64, &group1a};
+    t[0x90] = {"nop", {}, 0, nullptr};
+    t[0x98] = {"cbw", {}, 0, nullptr};
+    t[0x99] = {"cwd", {}, 0, nullptr};
+    t[0x9b] = {"fwait", {}, 0, nullptr};
+    t[0x9c] = {"pushf", {}, d64 | sized, nullptr};
+    t[0x9d] = {"popf", {}, d64 | sized, nullptr};
+    t[0x9e] = {"sahf", {}, 0, nullptr};
+    t[0x9f] = {"lahf", {}, 0, nullptr};
+    t[0xa0] = {"mov", {AL, Ob}, 0, nullptr};
+    t[0xa1] = {"mov", {rAX, Ov}, 0, nullptr};
+    t[0xa2] = {"mov", {Ob, AL}, 0, nullptr};
+    t[0xa3] = {"mov", {Ov, rAX}, 0, nullptr};
+    t[0xa4] = {"movsb", {}, string, nullptr};
+    t[0xa5] = {"movs", {}, string | sized, nullptr};
+    t[0xa6] = {"cmpsb", {}, string, nullptr};
+    t[0xa7] = {"cmps", {}, string | sized, nullptr};
+    t[0xa8] = {"test", {AL, Ib}, 0, nullptr};
+    t[0xa9] = {"test", {rAX, Iz}, 0, nullptr};
+    t[0xaa] = {"stosb", {}, string, nullptr};
+    t[0xab] = {"stos", {}, string | sized, nullptr};
+    t[0xac] = {"lodsb", {}, string, nullptr};
+    t[0xad] = {"lods", {}, string | sized, nullptr};
+    t[0xae] = {"scasb", {}, string, nullptr};
+    t[0xaf] = {"scas", {}, string | sized, nullptr};
+    t[0xc0] = {"", {Eb, Ib}, 0, &group2};
+    t[0xc1] = {"", {Ev, Ib}, 0, &group2};
+    t[0xc2] = {"ret", {Iw}, f64 | jump, nullptr};
+    t[0xc3] = {"ret", {}, f64 | jump, nullptr};
+    t[0xc6] = {"", {Eb, Ib}, 0, &group11b};
+    t[0xc7] = {"", {Ev, Iz}, 0, &group11v};
+    t[0xc8] = {"enter", {Iw, Ib}, 0, nullptr};
+    t[0xc9] = {"leave", {}, 0, nullptr};
+    t[0xca] = {"retf", {Iw}, jump, nullptr};
+    t[0xcb] = {"retf", {}, jump, nullptr};
+    t[0xcc] = {"int3", {}, 0, nullptr};
+    t[0xcd] = {"int", {Ib}, 0, nullptr};
+    t[0xcf] = {"iret", {}, sized | jump, nullptr};
+    t[0xd0] = {"", {Eb, one}, 0, &group2};
+    t[0xd1] = {"", {Ev, one}, 0, &group2};
+    t[0xd2] = {"", {Eb, CL}, 0, &group2};
+    t[0xd3] = {"", {Ev, CL}, 0, &group2};
+    t[0xd7] = {"xlatb", {}, 0, nullptr};
+    t[0xe0] = {"loopne", {Jb}, f64 | jump, nullptr};
+    t[0xe1] = {"loope", {Jb}, f64 | jump, nullptr};
+    t[0xe2] = {"loop", {Jb}, f64 | jump, nullptr};
+    t[0xe3] = {"jrcxz", {Jb}, f64 | jump, nullptr};
+    t[0xe4] = {"in", {AL, Ib}, 0, nullptr};
+    t[0xe5] = {"in", {eAX, Ib}, 0, nullptr};
+    t[0xe6] = {"out", {Ib, AL}, 0, nullptr};
+    t[0xe7] = {"out", {Ib, eAX}, 0, nullptr};
+    t[0xe8] = {"call", {Jz}, f64, nullptr};
+    t[0xe9] = {"jmp", {Jz}, f64 | jump, nullptr};
+    t[0xeb] = {"jmp", {Jb}, f64 | jump, nullptr};
+    t[0xec] = {"in", {AL, DX}, 0, nullptr};
+    t[0xed] = {"in", {eAX, DX}, 0, nullptr};
+    t[0xee] = {"out", {DX, AL}, 0, nullptr};
+    t[0xef] = {"out", {DX, eAX}, 0, nullptr};
+    t[0xf1] = {"int1", {}, 0, nullptr};
+    t[0xf4] = {"hlt", {}, jump, nullptr};
+    t[0xf5] = {"cmc", {}, 0, nullptr};
+    t[0xf6] = {"", {Eb}, 0, &group3};
+    t[0xf7] = {"", {Ev}, 0, &group3};
+    t[0xf8] = {"clc", {}, 0, nullptr};
+    t[0xf9] = {"stc", {}, 0, nullptr};
+    t[0xfa] = {"cli", {}, 0, nullptr};
+    t[0xfb] = {"sti", {}, 0, nullptr};
+    t[0xfc] = {"cld", {}, 0, nullptr};
+    t[0xfd] = {"std", {}, 0, nullptr};
+    t[0xfe] = {"", {Eb}, 0, &group4};
+    t[0xff] = {"", {Ev}, 0, &group5};
+}
+
+auto build_two_byte(std::array<entry, 256>& t) -> void {
+    for(std::size_t i = 0; i < 16; ++i) {
+        t[0x40 + i] = {cmov_names[i], {Gv, Ev}, 0, nullptr};
+        t[0x80 + i] = {jcc_names[i], {Jz}, f64 | jump, nullptr};
+        t[0x90 + i] = {set_names[i], {Eb}, 0, nullptr};
+    }
+
+    for(std::size_t i = 0; i < 8; ++i) {
+        t[0xc8 + i] = {"bswap", {Zv}, 0, nullptr};
+    }
+
+    for(std::size_t i = 0x19; i <= 0x1f; ++i) {
+        t[i] = {"nop", {Ev}, 0, nullptr};
+    }
+
+    t[0x00] = {"", {Ew}, 0, &group6};
+    t[0x01] = {"", {M}, 0, &group7};
+    t[0x05] = {"syscall", {}, 0, nullptr};
+    t[0x06] = {"clts", {}, 0, nullptr};
+    t[0x07] = {"sysret", {}, jump, nullptr};
+    t[0x08] = {"invd", {}, 0, nullptr};
+    t[0x09] = {"wbinvd", {}, 0, nullptr};
+    t[0x0b] = {"ud2", {}, jump, nullptr};
+    t[0x0d] = {"prefetchw", {M}, 0, nullptr};
+    t[0x18] = {"", {M}, 0, &group16};
+    t[0x30] = {"wrmsr", {}, 0, nullptr};
+    t[0x31] = {"rdtsc", {}, 0, nullptr};
+    t[0x32] = {"rdmsr", {}, 0, nullptr};
+    t[0x33] = {"rdpmc", {}, 0, nullptr};
+    t[0x34] = {"sysenter", {}, 0, nullptr};
+    t[0x35] = {"sysexit", {}, jump, nullptr};
+    t[0xa2] = {"cpuid", {}, 0, nullptr};
+    t[0xa3] = {"bt", {Ev, Gv}, 0, nullptr};
+    t[0xa4] = {"shld", {Ev, Gv, Ib}, 0, nullptr};
+    t[0xa5] = {"shld", {Ev, Gv, CL}, 0, nullptr};
+    t[0xab] = {"bts", {Ev, Gv}, 0, nullptr};
+    t[0xac] = {"shrd", {Ev, Gv, Ib}, 0, nullptr};
+    t[0xad] = {"shrd", {Ev, Gv, CL}, 0, nullptr};
+    t[0xae] = {"", {M}, 0, &group15};
+    t[0xaf] = {"imul", {Gv, Ev}, 0, nullptr};
+    t[0xb0] = {"cmpxchg", {Eb, Gb}, 0, nullptr};
+    t[0xb1] = {"cmpxchg", {Ev, Gv}, 0, nullptr};
+    t[0xb3] = {"btr", {Ev, Gv}, 0, nullptr};
+    t[0xb6] = {"movzx", {Gv, Eb}, 0, nullptr};
+    t[0xb7] = {"movzx", {Gv, Ew}, 0, nullptr};
+    t[0xb9] = {"ud1", {Gv, Ev}, jump, nullptr};
+    t[0xba] = {"", {Ev, Ib}, 0, &group8};
+    t[0xbb] = {"btc", {Ev, Gv}, 0, nullptr};
+    t[0xbc] = {"bsf", {Gv, Ev}, 0, nullptr};
+    t[0xbd] = {"bsr", {Gv, Ev}, 0, nullptr};
+    t[0xbe] = {"movsx", {Gv, Eb}, 0, nullptr};
+    t[0xbf] = {"movsx", {Gv, Ew}, 0, nullptr};
+    t[0xc0] = {"xadd", {Eb, Gb}, 0, nullptr};
+    t[0xc1] = {"xadd", {Ev, Gv}, 0, nullptr};
+    t[0xc3] = {"movnti", {Ey, Gy}, 0, nullptr};
+    t[0xc7] = {"", {Ev}, 0, &group9};
+    t[0xff] = {"ud0", {Gd, Ed}, jump, nullptr};
+}
+
+struct prefixed_entry {
+    uint8_t map;
+    uint8_t opcode;
+    uint8_t prefix;
+    entry e;
+};
+
+// SSE, AVX and other instructions whose meaning depends on the mandatory
+// prefix (or VEX.pp). VEX forms take a v in front of the name.
+auto build_prefixed(std::array<std::array<std::array<entry, 4>, 256>, 3>& t) -> void {
+    auto add = [&](uint8_t map, uint8_t opcode, uint8_t prefix, entry e) {
+        t[map - 1u][opcode][prefix] = e;
+    };
+
+    // Floating point arithmetic: packed single, packed double, scalar single,
+    // scalar double.
+    constexpr std::array<std::pair<uint8_t, std::string_view>, 6> arithmetic = {{
+        {0x58, "add"}, {0x59, "mul"}, {0x5c, "sub"}, {0x5d, "min"}, {0x5e, "div"}, {0x5f, "max"},
+    }};
+
+    constexpr std::array<std::array<std::string_view, 4>, 6> arithmetic_names = {{
+        {"addps", "addpd", "addss", "addsd"},
+        {"mulps", "mulpd", "mulss", "mulsd"},
+        {"subps", "subpd", "subss", "subsd"},
+        {"minps", "minpd", "minss", "minsd"},
+        {"divps", "divpd", "divss", "divsd"},
+        {"maxps", "maxpd", "maxss", "maxsd"},
+    }};
+
+    // Fused multiply-add, the digits give the order in which the operands are
+    // multiplied and added. Packed and scalar forms alternate from 0F38 98.
+    constexpr std::array<std::pair<uint8_t, std::array<std::string_view, 10>>, 3> fma = {{
+        {0x96, {"fmaddsub132ps", "fmsubadd132ps", "fmadd132ps", "fmadd132ss", "fmsub132ps",
+                "fmsub132ss", "fnmadd132ps", "fnmadd132ss", "fnmsub132ps", "fnmsub132ss"}},
+        {0xa6, {"fmaddsub213ps", "fmsubadd213ps", "fmadd213ps", "fmadd213ss", "fmsub213ps",
+                "fmsub213ss", "fnmadd213ps", "fnmadd213ss", "fnmsub213ps", "fnmsub213ss"}},
+        {0xb6, {"fmaddsub231ps", "fmsubadd231ps", "fmadd231ps", "fmadd231ss", "fmsub231ps",
+                "fmsub231ss", "fnmadd231ps", "fnmadd231ss", "fnmsub231ps", "fnmsub231ss"}},
+    }};
+
+    for(const auto& [first, names] : fma) {
+        for(std::size_t i = 0; i < names.size(); ++i) {
+            const auto opcode = static_cast<uint8_t>(first + i);
+            const bool scalar = i >= 3 && i % 2 == 1;
+            add(2, opcode, p66, {names[i], {scalar ? Vdq : Vx, scalar ? Wd : Wx}, nds | vex_only | wide_s, nullptr});
+        }
+    }
+
+    for(std::size_t i = 0; i < arithmetic.size(); ++i) {
+        const uint8_t opcode = arithmetic[i].first;
+        add(1, opcode, no_prefix, {arithmetic_names[i][0], {Vx, Wx}, nds, nullptr});
+        add(1, opcode, p66, {arithmetic_names[i][1], {Vx, Wx}, nds, nullptr});
+        add(1, opcode, pf3, {arithmetic_names[i][2], {Vdq, Wd}, nds, nullptr});
+        add(1, opcode, pf2, {arithmetic_names[i][3], {Vdq, Wq}, nds, nullptr});
+    }
+
+    // Integer instructions on MMX registers without prefix and on vector
+    // registers with 66.
+    constexpr std::array<std::pair<uint8_t, std::string_view>, 56> packed_integer = {{
+        {0x60, "punpcklbw"}, {0x61, "punpcklwd"}, {0x62, "punpckldq"}, {0x63, "packsswb"},
+        {0x64, "pcmpgtb"}, {0x65, "pcmpgtw"}, {0x66, "pcmpgtd"}, {0x67, "packuswb"},
+        {0x68, "punpckhbw"}, {0x69, "punpckhwd"}, {0x6a, "punpckhdq"}, {0x6b, "packssdw"},
+        {0x74, "pcmpeqb"}, {0x75, "pcmpeqw"}, {0x76, "pcmpeqd"},
+        {0xd1, "psrlw"}, {0xd2, "psrld"}, {0xd3, "psrlq"}, {0xd4, "paddq"}, {0xd5, "pmullw"},
+        {0xd8, "psubusb"}, {0xd9, "psubusw"}, {0xda, "pminub"}, {0xdb, "pand"},
+        {0xdc, "paddusb"}, {0xdd, "paddusw"}, {0xde, "pmaxub"}, {0xdf, "pandn"},
+        {0xe0, "pavgb"}, {0xe1, "psraw"}, {0xe2, "psrad"}, {0xe3, "pavgw"},
+        {0xe4, "pmulhuw"}, {0xe5, "pmulhw"},
+        {0xe8, "psubsb"}, {0xe9, "psubsw"}, {0xea, "pminsw"}, {0xeb, "por"},
+        {0xec, "paddsb"}, {0xed, "paddsw"}, {0xee, "pmaxsw"}, {0xef, "pxor"},
+        {0xf1, "psllw"}, {0xf2, "pslld"}, {0xf3, "psllq"}, {0xf4, "pmuludq"},
+        {0xf5, "pmaddwd"}, {0xf6, "psadbw"},
+        {0xf8, "psubb"}, {0xf9, "psubw"}, {0xfa, "psubd"}, {0xfb, "psubq"},
+        {0xfc, "paddb"}, {0xfd, "paddw"}, {0xfe, "paddd"}, {0x6c, "punpcklqdq"},
+    }};
+
+    for(const auto& [opcode, name] : packed_integer) {
+        const bool compare = (opcode >= 0x64 && opcode <= 0x66) || (opcode >= 0x74 && opcode <= 0x76);
+        if(opcode != 0x6c) {
+            add(1, opcode, no_prefix, {name, {Pq, Qq}, 0, nullptr});
+        }
+
+        add(1, opcode, p66, {name, {Vx, Wx}, static_cast<uint16_t>(nds | (compare ? mask_compare : 0)), nullptr});
+    }
+
+    add(1, 0x6d, p66, {"punpckhqdq", {Vx, Wx}, nds, nullptr});
+
+    // Mask register instructions, the size of the mask is given by the prefix
+    // and W.
+    constexpr std::array<std::pair<uint8_t, std::string_view>, 11> masks = {{
+        {0x41, "kand"}, {0x42, "kandn"}, {0x45, "kor"}, {0x46, "kxnor"}, {0x47, "kxor"},
+        {0x4a, "kadd"}, {0x4b, "kunpck"}, {0x44, "knot"}, {0x90, "kmov"}, {0x98, "kortest"}, {0x99, "ktest"},
+    }};
+
+    for(const auto& [opcode, name] : masks) {
+        const bool binary = opcode < 0x44 || (opcode > 0x44 && opcode < 0x90);
+        const entry e = {name, {Kg, binary ? Kh : Ke, binary ? Ke : operand::none}, vex_only | no_v | mask_size, nullptr};
+        add(1, opcode, no_prefix, e);
+        add(1, opcode, p66, e);
+    }
+
+    for(const uint8_t prefix : {no_prefix, p66, pf2}) {
+        add(1, 0x91, prefix, {"kmov", {Ke, Kg}, vex_only | no_v | mask_size, nullptr});
+        add(1, 0x92, prefix, {"kmov", {Kg, Ey}, vex_only | no_v | mask_size, nullptr});
+        add(1, 0x93, prefix, {"kmov", {Gy, Ke}, vex_only | no_v | mask_size, nullptr});
+    }
+
+    const std::initializer_list<prefixed_entry> entries = {
+        {1, 0x10, no_prefix, {"movups", {Vx, Wx}, 0, nullptr}},
+        {1, 0x10, p66, {"movupd", {Vx, Wx}, 0, nullptr}},
+        {1, 0x10, pf3, {"movss", {Vdq, Wd}, nds_reg, nullptr}},
+        {1, 0x10, pf2, {"movsd", {Vdq, Wq}, nds_reg, nullptr}},
+        {1, 0x11, no_prefix, {"movups", {Wx, Vx}, 0, nullptr}},
+        {1, 0x11, p66, {"movupd", {Wx, Vx}, 0, nullptr}},
+        {1, 0x11, pf3, {"movss", {Wd, Vdq}, nds_reg, nullptr}},
+        {1, 0x11, pf2, {"movsd", {Wq, Vdq}, nds_reg, nullptr}},
+        {1, 0x12, no_prefix, {"movlps", {Vdq, Mq}, nds, nullptr}},
+        {1, 0x12, p66, {"movlpd", {Vdq, Mq}, nds, nullptr}},
+        {1, 0x12, pf3, {"movsldup", {Vx, Wx}, 0, nullptr}},
+        {1, 0x12, pf2, {"movddup", {Vx, Wq}, 0, nullptr}},
+        {1, 0x13, no_prefix, {"movlps", {Mq, Vdq}, 0, nullptr}},
+        {1, 0x13, p66, {"movlpd", {Mq, Vdq}, 0, nullptr}},
+        {1, 0x14, no_prefix, {"unpcklps", {Vx, Wx}, nds, nullptr}},
+        {1, 0x14, p66, {"unpcklpd", {Vx, Wx}, nds, nullptr}},
+        {1, 0x15, no_prefix, {"unpckhps", {Vx, Wx}, nds, nullptr}},
+        {1, 0x15, p66, {"unpckhpd", {Vx, Wx}, nds, nullptr}},
+        {1, 0x16, no_prefix, {"movhps", {Vdq, Mq}, nds, nullptr}},
+        {1, 0x16, p66, {"movhpd", {Vdq, Mq}, nds, nullptr}},
+        {1, 0x16, pf3, {"movshdup", {Vx, Wx}, 0, nullptr}},
+        {1, 0x17, no_prefix, {"movhps", {Mq, Vdq}, 0, nullptr}},
+        {1, 0x17, p66, {"movhpd", {Mq, Vdq}, 0, nullptr}},
+        {1, 0x28, no_prefix, {"movaps", {Vx, Wx}, 0, nullptr}},
+        {1, 0x28, p66, {"movapd", {Vx, Wx}, 0, nullptr}},
+        {1, 0x29, no_prefix, {"movaps", {Wx, Vx}, 0, nullptr}},
+        {1, 0x29, p66, {"movapd", {Wx, Vx}, 0, nullptr}},
+        {1, 0x2a, no_prefix, {"cvtpi2ps", {Vdq, Qq}, 0, nullptr}},
+        {1, 0x2a, p66, {"cvtpi2pd", {Vdq, Qq}, 0, nullptr}},
+        {1, 0x2a, pf3, {"cvtsi2ss", {Vdq, Ey}, nds, nullptr}},
+        {1, 0x2a, pf2, {"cvtsi2sd", {Vdq, Ey}, nds, nullptr}},
+        {1, 0x2b, no_prefix, {"movntps", {Mx, Vx}, 0, nullptr}},
+        {1, 0x2b, p66, {"movntpd", {Mx, Vx}, 0, nullptr}},
+        {1, 0x2c, no_prefix, {"cvttps2pi", {Pq, Wq}, 0, nullptr}},
+        {1, 0x2c, p66, {"cvttpd2pi", {Pq, Wdq}, 0, nullptr}},
+        {1, 0x2c, pf3, {"cvttss2si", {Gy, Wd}, 0, nullptr}},
+        {1, 0x2c, pf2, {"cvttsd2si", {Gy, Wq}, 0, nullptr}},
+        {1, 0x2d, no_prefix, {"cvtps2pi", {Pq, Wq}, 0, nullptr}},
+        {1, 0x2d, p66, {"cvtpd2pi", {Pq, Wdq}, 0, nullptr}},
+        {1, 0x2d, pf3, {"cvtss2si", {Gy, Wd}, 0, nullptr}},
+        {1, 0x2d, pf2, {"cvtsd2si", {Gy, Wq}, 0, nullptr}},
+        {1, 0x2e, no_prefix, {"ucomiss", {Vdq, Wd}, 0, nullptr}},
+        {1, 0x2e, p66, {"ucomisd", {Vdq, Wq}, 0, nullptr}},
+        {1, 0x2f, no_prefix, {"comiss", {Vdq, Wd}, 0, nullptr}},
+        {1, 0x2f, p66, {"comisd", {Vdq, Wq}, 0, nullptr}},
+        {1, 0x50, no_prefix, {"movmskps", {Gd, Ux}, 0, nullptr}},
+        {1, 0x50, p66, {"movmskpd", {Gd, Ux}, 0, nullptr}},
+        {1, 0x51, no_prefix, {"sqrtps", {Vx, Wx}, 0, nullptr}},
+        {1, 0x51, p66, {"sqrtpd", {Vx, Wx}, 0, nullptr}},
+        {1, 0x51, pf3, {"sqrtss", {Vdq, Wd}, nds, nullptr}},
+        {1, 0x51, pf2, {"sqrtsd", {Vdq, Wq}, nds, nullptr}},
+        {1, 0x52, no_prefix, {"rsqrtps", {Vx, Wx}, 0, nullptr}},
+        {1, 0x52, pf3, {"rsqrtss", {Vdq, Wd}, nds, nullptr}},
+        {1, 0x53, no_prefix, {"rcpps", {Vx, Wx}, 0, nullptr}},
+        {1, 0x53, pf3, {"rcpss", {Vdq, Wd}, nds, nullptr}},
+        {1, 0x54, no_prefix, {"andps", {Vx, Wx}, nds, nullptr}},
+        {1, 0x54, p66, {"andpd", {Vx, Wx}, nds, nullptr}},
+        {1, 0x55, no_prefix, {"andnps", {Vx, Wx}, nds, nullptr}},
+        {1, 0x55, p66, {"andnpd", {Vx, Wx}, nds, nullptr}},
+        {1, 0x56, no_prefix, {"orps", {Vx, Wx}, nds, nullptr}},
+        {1, 0x56, p66, {"orpd", {Vx, Wx}, nds, nullptr}},
+        {1, 0x57, no_prefix, {"xorps", {Vx, Wx}, nds, nullptr}},
+        {1, 0x57, p66, {"xorpd", {Vx, Wx}, nds, nullptr}},
+        {1, 0x5a, no_prefix, {"cvtps2pd", {Vx, Wq}, 0, nullptr}},
+        {1, 0x5a, p66, {"cvtpd2ps", {Vdq, Wx}, 0, nullptr}},
+        {1, 0x5a, pf3, {"cvtss2sd", {Vdq, Wd}, nds, nullptr}},
+        {1, 0x5a, pf2, {"cvtsd2ss", {Vdq, Wq}, nds, nullptr}},
+        {1, 0x5b, no_prefix, {"cvtdq2ps", {Vx, Wx}, 0, nullptr}},
+        {1, 0x5b, p66, {"cvtps2dq", {Vx, Wx}, 0, nullptr}},
+        {1, 0x5b, pf3, {"cvttps2dq", {Vx, Wx}, 0, nullptr}},
+        {1, 0x6e, no_prefix, {"movd", {Pq, Ey}, wide_q, nullptr}},
+        {1, 0x6e, p66, {"movd", {Vdq, Ey}, wide_q, nullptr}},
+        {1, 0x6f, no_prefix, {"movq", {Pq, Qq}, 0, nullptr}},
+        {1, 0x6f, p66, {"movdqa", {Vx, Wx}, 0, nullptr}},
+        {1, 0x6f, pf3, {"movdqu", {Vx, Wx}, 0, nullptr}},
+        {1, 0x6f, pf2, {"movdqu", {Vx, Wx}, vex_only, nullptr}},
+        {1, 0x70, no_prefix, {"pshufw", {Pq, Qq, Ib}, 0, nullptr}},
+        {1, 0x70, p66, {"pshufd", {Vx, Wx, Ib}, 0, nullptr}},
+        {1, 0x70, pf3, {"pshufhw", {Vx, Wx, Ib}, 0, nullptr}},
+        {1, 0x70, pf2, {"pshuflw", {Vx, Wx, Ib}, 0, nullptr}},
+        {1, 0x71, no_prefix, {"", {Nq, Ib}, 0, &shift_words}},
+        {1, 0x71, p66, {"", {Hx, Ux, Ib}, 0, &shift_words}},
+        {1, 0x72, no_prefix, {"", {Nq, Ib}, 0, &shift_dwords}},
+        {1, 0x72, p66, {"", {Hx, Ux, Ib}, 0, &shift_dwords}},
+        {1, 0x73, no_prefix, {"", {Nq, Ib}, 0, &shift_qwords}},
+        {1, 0x73, p66, {"", {Hx, Ux, Ib}, 0, &shift_qwords}},
+        {1, 0x77, no_prefix, {"emms", {}, 0, nullptr}},
+        {1, 0x7e, no_prefix, {"movd", {Ey, Pq}, wide_q, nullptr}},
+        {1, 0x7e, p66, {"movd", {Ey, Vdq}, wide_q, nullptr}},
+        {1, 0x7e, pf3, {"movq", {Vdq, Wq}, 0, nullptr}},
+        {1, 0x7f, no_prefix, {"movq", {Qq, Pq}, 0, nullptr}},
+        {1, 0x7f, p66, {"movdqa", {Wx, Vx}, 0, nullptr}},
+        {1, 0x7f, pf3, {"movdqu", {Wx, Vx}, 0, nullptr}},
+        {1, 0x7f, pf2, {"movdqu", {Wx, Vx}, vex_only, nullptr}},
+        {1, 0xae, no_prefix, {"", {Md}, vex_only, &group15_vex}},
+        {1, 0xb8, pf3, {"popcnt", {Gv, Ev}, no_v, nullptr}},
+        {1, 0xbc, pf3, {"tzcnt", {Gv, Ev}, no_v, nullptr}},
+        {1, 0xbd, pf3, {"lzcnt", {Gv, Ev}, no_v, nullptr}},
+        {1, 0xc2, no_prefix, {"cmpps", {Vx, Wx, Ib}, nds, nullptr}},
+        {1, 0xc2, p66, {"cmppd", {Vx, Wx, Ib}, nds, nullptr}},
+        {1, 0xc2, pf3, {"cmpss", {Vdq, Wd, Ib}, nds, nullptr}},
+        {1, 0xc2, pf2, {"cmpsd", {Vdq, Wq, Ib}, nds, nullptr}},
+        {1, 0xc4, no_prefix, {"pinsrw", {Pq, Ed, Ib}, 0, nullptr}},
+        {1, 0xc4, p66, {"pinsrw", {Vdq, Ed, Ib}, nds, nullptr}},
+        {1, 0xc5, no_prefix, {"pextrw", {Gd, Nq, Ib}, 0, nullptr}},
+        {1, 0xc5, p66, {"pextrw", {Gd, Udq, Ib}, 0, nullptr}},
+        {1, 0xc6, no_prefix, {"shufps", {Vx, Wx, Ib}, nds, nullptr}},
+        {1, 0xc6, p66, {"shufpd", {Vx, Wx, Ib}, nds, nullptr}},
+        {1, 0xd0, p66, {"addsubpd", {Vx, Wx}, nds, nullptr}},
+        {1, 0xd0, pf2, {"addsubps", {Vx, Wx}, nds, nullptr}},
+
+        {1, 0xd6, p66, {"movq", {Wq, Vdq}, 0, nullptr}},
+        {1, 0xd7, no_prefix, {"pmovmskb", {Gd, Nq}, 0, nullptr}},
+        {1, 0xd7, p66, {"pmovmskb", {Gd, Ux}, 0, nullptr}},
+        {1, 0xe6, p66, {"cvttpd2dq", {Vdq, Wx}, 0, nullptr}},
+        {1, 0xe6, pf3, {"cvtdq2pd", {Vx, Wq}, 0, nullptr}},
+        {1, 0xe6, pf2, {"cvtpd2dq", {Vdq, Wx}, 0, nullptr}},
+        {1, 0xe7, no_prefix, {"movntq", {Mq, Pq}, 0, nullptr}},
+        {1, 0xe7, p66, {"movntdq", {Mx, Vx}, 0, nullptr}},
+        {1, 0xf0, pf2, {"lddqu", {Vx, Mx}, 0, nullptr}},
+        {1, 0xf7, no_prefix, {"maskmovq", {Pq, Nq}, 0, nullptr}},
+        {1, 0xf7, p66, {"maskmovdqu", {Vdq, Udq}, 0, nullptr}},
+
+        {2, 0x00, p66, {"pshufb", {Vx, Wx}, nds, nullptr}},
+        {2, 0x01, p66, {"phaddw", {Vx, Wx}, nds, nullptr}},
+        {2, 0x02, p66, {"phaddd", {Vx, Wx}, nds, nullptr}},
+        {2, 0x03, p66, {"phaddsw", {Vx, Wx}, nds, nullptr}},
+        {2, 0x04, p66, {"pmaddubsw", {Vx, Wx}, nds, nullptr}},
+        {2, 0x05, p66, {"phsubw", {Vx, Wx}, nds, nullptr}},
+        {2, 0x06, p66, {"phsubd", {Vx, Wx}, nds, nullptr}},
+        {2, 0x07, p66, {"phsubsw", {Vx, Wx}, nds, nullptr}},
+        {2, 0x08, p66, {"psignb", {Vx, Wx}, nds, nullptr}},
+        {2, 0x09, p66, {"psignw", {Vx, Wx}, nds, nullptr}},
+        {2, 0x0a, p66, {"psignd", {Vx, Wx}, nds, nullptr}},
+        {2, 0x0b, p66, {"pmulhrsw", {Vx, Wx}, nds, nullptr}},
+        {2, 0x10, p66, {"pblendvb", {Vdq, Wdq}, 0, nullptr}},
+        {2, 0x14, p66, {"blendvps", {Vdq, Wdq}, 0, nullptr}},
+        {2, 0x15, p66, {"blendvpd", {Vdq, Wdq}, 0, nullptr}},
+        {2, 0x17, p66, {"ptest", {Vx, Wx}, 0, nullptr}},
+        {2, 0x18, p66, {"broadcastss", {Vx, Wd}, vex_only, nullptr}},
+        {2, 0x19, p66, {"broadcastsd", {Vx, Wq}, vex_only, nullptr}},
+        {2, 0x1a, p66, {"broadcastf128", {Vx, Mdq}, vex_only, nullptr}},
+        {2, 0x1c, p66, {"pabsb", {Vx, Wx}, 0, nullptr}},
+        {2, 0x1d, p66, {"pabsw", {Vx, Wx}, 0, nullptr}},
+        {2, 0x1e, p66, {"pabsd", {Vx, Wx}, 0, nullptr}},
+        {2, 0x20, p66, {"pmovsxbw", {Vx, Wq}, 0, nullptr}},
+        {2, 0x21, p66, {"pmovsxbd", {Vx, Wd}, 0, nullptr}},
+        {2, 0x22, p66, {"pmovsxbq", {Vx, Ww}, 0, nullptr}},
+        {2, 0x23, p66, {"pmovsxwd", {Vx, Wq}, 0, nullptr}},
+        {2, 0x24, p66, {"pmovsxwq", {Vx, Wd}, 0, nullptr}},
+        {2, 0x25, p66, {"pmovsxdq", {Vx, Wq}, 0, nullptr}},
+        {2, 0x26, p66, {"ptestmb", {Kg, Wx}, nds | vex_only | wide_w, nullptr}},
+        {2, 0x26, pf3, {"ptestnmb", {Kg, Wx}, nds | vex_only | wide_w, nullptr}},
+        {2, 0x27, p66, {"ptestmd", {Kg, Wx}, nds | vex_only | wide_q, nullptr}},
+        {2, 0x27, pf3, {"ptestnmd", {Kg, Wx}, nds | vex_only | wide_q, nullptr}},
+        {2, 0x28, p66, {"pmuldq", {Vx, Wx}, nds, nullptr}},
+        {2, 0x29, p66, {"pcmpeqq", {Vx, Wx}, nds | mask_compare, nullptr}},
+        {2, 0x2a, p66, {"movntdqa", {Vx, Mx}, 0, nullptr}},
+        {2, 0x2b, p66, {"packusdw", {Vx, Wx}, nds, nullptr}},
+        {2, 0x30, p66, {"pmovzxbw", {Vx, Wq}, 0, nullptr}},
+        {2, 0x31, p66, {"pmovzxbd", {Vx, Wd}, 0, nullptr}},
+        {2, 0x32, p66, {"pmovzxbq", {Vx, Ww}, 0, nullptr}},
+        {2, 0x33, p66, {"pmovzxwd", {Vx, Wq}, 0, nullptr}},
+        {2, 0x34, p66, {"pmovzxwq", {Vx, Wd}, 0, nullptr}},
+        {2, 0x35, p66, {"pmovzxdq", {Vx, Wq}, 0, nullptr}},
+        {2, 0x36, p66, {"permd", {Vx, Wx}, nds | vex_only, nullptr}},
+        {2, 0x37, p66, {"pcmpgtq", {Vx, Wx}, nds | mask_compare, nullptr}},
+        {2, 0x38, p66, {"pminsb", {Vx, Wx}, nds, nullptr}},
+        {2, 0x39, p66, {"pminsd", {Vx, Wx}, nds, nullptr}},
+        {2, 0x3a, p66, {"pminuw", {Vx, Wx}, nds, nullptr}},
+        {2, 0x3b, p66, {"pminud", {Vx, Wx}, nds, nullptr}},
+        {2, 0x3c, p66, {"pmaxsb", {Vx, Wx}, nds, nullptr}},
+        {2, 0x3d, p66, {"pmaxsd", {Vx, Wx}, nds, nullptr}},
+        {2, 0x3e, p66, {"pmaxuw", {Vx, Wx}, nds, nullptr}},
+        {2, 0x3f, p66, {"pmaxud", {Vx, Wx}, nds, nullptr}},
+        {2, 0x40, p66, {"pmulld", {Vx, Wx}, nds, nullptr}},
+        {2, 0x45, p66, {"psrlvd", {Vx, Wx}, nds | vex_only | wide_q, nullptr}},
+        {2, 0x46, p66, {"psravd", {Vx, Wx}, nds | vex_only, nullptr}},
+        {2, 0x47, p66, {"psllvd", {Vx, Wx}, nds | vex_only | wide_q, nullptr}},
+        {2, 0x58, p66, {"pbroadcastd", {Vx, Wd}, vex_only, nullptr}},
+        {2, 0x59, p66, {"pbroadcastq", {Vx, Wq}, vex_only, nullptr}},
+        {2, 0x5a, p66, {"broadcasti128", {Vx, Mdq}, vex_only, nullptr}},
+        {2, 0x78, p66, {"pbroadcastb", {Vx, Wb}, vex_only, nullptr}},
+        {2, 0x79, p66, {"pbroadcastw", {Vx, Ww}, vex_only, nullptr}},
+        {2, 0x7a, p66, {"pbroadcastb", {Vx, Ed}, vex_only, nullptr}},
+        {2, 0x7b, p66, {"pbroadcastw", {Vx, Ed}, vex_only, nullptr}},
+        {2, 0x7c, p66, {"pbroadcastd", {Vx, Ey}, vex_only | wide_q, nullptr}},
+        {2, 0xdb, p66, {"aesimc", {Vdq, Wdq}, 0, nullptr}},
+        {2, 0xdc, p66, {"aesenc", {Vx, Wx}, nds, nullptr}},
+        {2, 0xdd, p66, {"aesenclast", {Vx, Wx}, nds, nullptr}},
+        {2, 0xde, p66, {"aesdec", {Vx, Wx}, nds, nullptr}},
+        {2, 0xdf, p66, {"aesdeclast", {Vx, Wx}, nds, nullptr}},
+        {2, 0xf0, no_prefix, {"movbe", {Gv, M}, 0, nullptr}},
+        {2, 0xf1, no_prefix, {"movbe", {M, Gv}, 0, nullptr}},
+        {2, 0xf0, pf2, {"crc32", {Gy, Eb}, 0, nullptr}},
+        {2, 0xf1, pf2, {"crc32", {Gy, Ev}, 0, nullptr}},
+        {2, 0xf2, no_prefix, {"andn", {Gy, By, Ey}, vex_only | no_v, nullptr}},
+        {2, 0xf3, no_prefix, {"", {By, Ey}, vex_only | no_v, &group17}},
+        {2, 0xf5, no_prefix, {"bzhi", {Gy, Ey, By}, vex_only | no_v, nullptr}},
+        {2, 0xf5, pf3, {"pext", {Gy, By, Ey}, vex_only | no_v, nullptr}},
+        {2, 0xf5, pf2, {"pdep", {Gy, By, Ey}, vex_only | no_v, nullptr}},
+        {2, 0xf6, p66, {"adcx", {Gy, Ey}, 0, nullptr}},
+        {2, 0xf6, pf3, {"adox", {Gy, Ey}, 0, nullptr}},
+        {2, 0xf6, pf2, {"mulx", {Gy, By, Ey}, vex_only | no_v, nullptr}},
+        {2, 0xf7, no_prefix, {"bextr", {Gy, Ey, By}, vex_only | no_v, nullptr}},
+        {2, 0xf7, p66, {"shlx", {Gy, Ey, By}, vex_only | no_v, nullptr}},
+        {2, 0xf7, pf3, {"sarx", {Gy, Ey, By}, vex_only | no_v, nullptr}},
+        {2, 0xf7, pf2, {"shrx", {Gy, Ey, By}, vex_only | no_v, nullptr}},
+
+        {3, 0x00, p66, {"permq", {Vx, Wx, Ib}, vex_only, nullptr}},
+        {3, 0x01, p66, {"permpd", {Vx, Wx, Ib}, vex_only, nullptr}},
+        {3, 0x02, p66, {"pblendd", {Vx, Wx, Ib}, nds | vex_only, nullptr}},
+        {3, 0x06, p66, {"perm2f128", {Vx, Wx, Ib}, nds | vex_only, nullptr}},
+        {3, 0x08, p66, {"roundps", {Vx, Wx, Ib}, 0, nullptr}},
+        {3, 0x09, p66, {"roundpd", {Vx, Wx, Ib}, 0, nullptr}},
+        {3, 0x0a, p66, {"roundss", {Vdq, Wd, Ib}, nds, nullptr}},
+        {3, 0x0b, p66, {"roundsd", {Vdq, Wq, Ib}, nds, nullptr}},
+        {3, 0x0c, p66, {"blendps", {Vx, Wx, Ib}, nds, nullptr}},
+        {3, 0x0d, p66, {"blendpd", {Vx, Wx, Ib}, nds, nullptr}},
+        {3, 0x0e, p66, {"pblendw", {Vx, Wx, Ib}, nds, nullptr}},
+        {3, 0x0f, p66, {"palignr", {Vx, Wx, Ib}, nds, nullptr}},
+        {3, 0x14, p66, {"pextrb", {Ed, Vdq, Ib}, 0, nullptr}},
+        {3, 0x15, p66, {"pextrw", {Ed, Vdq, Ib}, 0, nullptr}},
+        {3, 0x16, p66, {"pextrd", {Ey, Vdq, Ib}, wide_q, nullptr}},
+        {3, 0x17, p66, {"extractps", {Ed, Vdq, Ib}, 0, nullptr}},
+        {3, 0x18, p66, {"insertf128", {Vx, Wdq, Ib}, nds | vex_only, nullptr}},
+        {3, 0x19, p66, {"extractf128", {Wdq, Vx, Ib}, vex_only, nullptr}},
+
+        {3, 0x1e, p66, {"pcmpud", {Kg, Wx, Ib}, nds | vex_only | wide_q, nullptr}},
+        {3, 0x1f, p66, {"pcmpd", {Kg, Wx, Ib}, nds | vex_only | wide_q, nullptr}},
+        {3, 0x20, p66, {"pinsrb", {Vdq, Ed, Ib}, nds, nullptr}},
+        {3, 0x21, p66, {"insertps", {Vdq, Wd, Ib}, nds, nullptr}},
+        {3, 0x22, p66, {"pinsrd", {Vdq, Ey, Ib}, nds | wide_q, nullptr}},
+        {3, 0x25, p66, {"pternlogd", {Vx, Wx, Ib}, nds | vex_only | wide_q, nullptr}},
+        {3, 0x38, p66, {"inserti128", {Vx, Wdq, Ib}, nds | vex_only, nullptr}},
+        {3, 0x39, p66, {"extracti128", {Wdq, Vx, Ib}, vex_only, nullptr}},
+        {3, 0x3e, p66, {"pcmpub", {Kg, Wx, Ib}, nds | vex_only | wide_w, nullptr}},
+        {3, 0x3f, p66, {"pcmpb", {Kg, Wx, Ib}, nds | vex_only | wide_w, nullptr}},
+        {3, 0x40, p66, {"dpps", {Vx, Wx, Ib}, nds, nullptr}},
+        {3, 0x41, p66, {"dppd", {Vdq, Wdq, Ib}, nds, nullptr}},
+        {3, 0x42, p66, {"mpsadbw", {Vx, Wx, Ib}, nds, nullptr}},
+        {3, 0x44, p66, {"pclmulqdq", {Vx, Wx, Ib}, nds, nullptr}},
+        {3, 0x46, p66, {"perm2i128", {Vx, Wx, Ib}, nds | vex_only, nullptr}},
+        {3, 0x60, p66, {"pcmpestrm", {Vdq, Wdq, Ib}, 0, nullptr}},
+        {3, 0x61, p66, {"pcmpestri", {Vdq, Wdq, Ib}, 0, nullptr}},
+        {3, 0x62, p66, {"pcmpistrm", {Vdq, Wdq, Ib}, 0, nullptr}},
+        {3, 0x63, p66, {"pcmpistri", {Vdq, Wdq, Ib}, 0, nullptr}},
+        {3, 0xdf, p66, {"aeskeygenassist", {Vdq, Wdq, Ib}, 0, nullptr}},
+    };
+
+    for(const auto& p : entries) {
+        add(p.map, p.opcode, p.prefix, p.e);
+    }
+
+    add(3, 0xf0, pf2, {"rorx", {Gy, Ey, Ib}, vex_only | no_v, nullptr});
+}
+
+[[nodiscard]]
+auto opcode_tables() -> const tables& {
+    static const auto t = [] {
+        auto result = std::make_unique<tables>();
+        build_one_byte(result->one_byte);
+        build_two_byte(result->two_byte);
+        build_prefixed(result->prefixed);
+        return result;
+    }();
+
+    return *t;
+}
+
+// 0F opcodes without a ModRM byte.
+[[nodiscard]]
+auto two_byte_without_modrm(uint8_t opcode) -> bool {
+    return (opcode >= 0x05 && opcode <= 0x09) || opcode == 0x0b || opcode == 0x0e ||
+           (opcode >= 0x30 && opcode <= 0x37) || opcode == 0x77 ||
+           (opcode >= 0x80 && opcode <= 0x8f) || (opcode >= 0xa0 && opcode <= 0xa2) ||
+           (opcode >= 0xa8 && opcode <= 0xaa) || (opcode >= 0xc8 && opcode <= 0xcf);
+}
+
+// 0F opcodes followed by an 8-bit immediate.
+[[nodiscard]]
+auto two_byte_with_immediate(uint8_t opcode) -> bool {
+    return (opcode >= 0x70 && opcode <= 0x73) || opcode == 0xa4 || opcode == 0xac ||
+           opcode == 0xba || opcode == 0xc2 || (opcode >= 0xc4 && opcode <= 0xc6);
+}
+
+[[nodiscard]]
+auto has_modrm_operand(operand o) -> bool {
+    switch(o) {
+    case Eb: case Ew: case Ed: case Eq: case Ev: case Ey:
+    case M: case Md: case Mq: case Mdq: case Mx:
+    case Gb: case Gw: case Gd: case Gv: case Gy:
+    case Sw: case Pq: case Qq: case Nq:
+    case Vx: case Vdq: case Wx: case Wdq: case Wb: case Ww: case Wd: case Wq:
+    case Ux: case Udq: case Kg: case Ke:
+        return true;
+    default:
+        return false;
+    }
+}
+
+constexpr std::array<std::string_view, 16> registers64 = {
+    "rax", "rcx", "rdx", "rbx", "rsp", "rbp", "rsi", "rdi",
+    "r8", "r9", "r10", "r11", "r12", "r13", "r14", "r15",
+};
+
+constexpr std::array<std::string_view, 16> registers32 = {
+    "eax", "ecx", "edx", "ebx", "esp", "ebp", "esi", "edi",
+    "r8d", "r9d", "r10d", "r11d", "r12d", "r13d", "r14d", "r15d",
+};
+
+constexpr std::array<std::string_view, 16> registers16 = {
+    "ax", "cx", "dx", "bx", "sp", "bp", "si", "di",
+    "r8w", "r9w", "r10w", "r11w", "r12w", "r13w", "r14w", "r15w",
+};
+
+constexpr std::array<std::string_view, 16> registers8 = {
+    "al", "cl", "dl", "bl", "spl", "bpl", "sil", "dil",
+    "r8b", "r9b", "r10b", "r11b", "r12b", "r13b", "r14b", "r15b",
+};
+
+// Without REX, 4 to 7 are the high bytes of the first four registers.
+constexpr std::array<std::string_view, 4> high_bytes = {"ah", "ch", "dh", "bh"};
+
+constexpr std::array<std::string_view, 8> segment_registers = {"es", "cs", "ss", "ds", "fs", "gs", "(bad)", "(bad)"};
+
+enum class encoding { legacy, vex, evex };
+
+// Everything known about the instruction being decoded.
+struct decoder {
+    const uint8_t* code;
+    std::size_t size;
+    std::uintptr_t address;
+    std::size_t position = 0;
+    bool truncated = false;
+
+    bool operand_size = false;
+    bool address_size = false;
+    bool lock = false;
+    // 0xf2 or 0xf3, the last one.
+    uint8_t repeat = 0;
+    // 0x64 or 0x65, the only ones that matter in 64-bit mode.
+    uint8_t segment = 0;
+    uint8_t rex = 0;
+
+    encoding enc = encoding::legacy;
+    // 0 for the one byte map, 1 for 0F, 2 for 0F38 and 3 for 0F3A.
+    uint8_t map = 0;
+    uint8_t opcode = 0;
+    // Index in the prefixed tables, from the legacy prefixes or VEX.pp.
+    uint8_t prefix = no_prefix;
+    bool w = false;
+    // Extensions of ModRM reg and rm and of SIB index and base, as added to
+    // the register numbers.
+    uint8_t r = 0;
+    uint8_t x = 0;
+    uint8_t b = 0;
+    // EVEX only: bit 4 of ModRM reg and of a register in ModRM rm.
+    uint8_t r2 = 0;
+    uint8_t x2 = 0;
+    uint8_t vvvv = 0;
+    // 0 for 128 bits, 1 for 256 and 2 for 512.
+    uint8_t vector_length = 0;
+    uint8_t mask = 0;
+    bool zeroing = false;
+    bool broadcast = false;
+
+    bool has_modrm = false;
+    uint8_t mod = 0;
+    uint8_t reg = 0;
+    uint8_t rm = 0;
+    bool has_sib = false;
+    int base = -1;
+    int index = -1;
+    uint8_t scale = 0;
+    int64_t displacement = 0;
+    std::size_t displacement_size = 0;
+    bool rip_relative = false;
+
+    std::array<uint64_t, 2> immediates = {};
+    std::array<std::size_t, 2> immediate_sizes = {};
+    std::size_t immediate_count = 0;
+
+    [[nodiscard]]
+    auto peek() const -> int {
+        return position < size ? code[position] : -1;
+    }
+
+    auto u8() -> uint8_t {
+        if(position >= size) {
+            truncated = true;
+            return 0;
+        }
+
+        return code[position++];
+    }
+
+    auto little_endian(std::size_t bytes) -> uint64_t {
+        uint64_t value = 0;
+        for(std::size_t i = 0; i < bytes; ++i) {
+            value |= uint64_t{u8()} << (8 * i);
+        }
+
+        return value;
+    }
+};
+
+[[nodiscard]]
+auto sign_extend(uint64_t value, std::size_t bytes) -> int64_t {
+    if(bytes == 0 || bytes >= 8) {
+        return static_cast<int64_t>(value);
+    }
+
+    const unsigned shift = static_cast<unsigned>(64 - 8 * bytes);
+    return static_cast<int64_t>(value << shift) >> shift;
+}
+
+auto read_prefixes(decoder& d) -> void {
+    while(d.position < nkgt::disassembler::max_instruction_size) {
+        const int byte = d.peek();
+
+        switch(byte) {
+        case 0xf0:
+            d.lock = true;
+            break;
+        case 0xf2:
+        case 0xf3:
+            d.repeat = static_cast<uint8_t>(byte);
+            break;
+        case 0x66:
+            d.operand_size = true;
+            break;
+        case 0x67:
+            d.address_size = true;
+            break;
+        case 0x64:
+        case 0x65:
+            d.segment = static_cast<uint8_t>(byte);
+            break;
+        case 0x26:
+        case 0x2e:
+        case 0x36:
+        case 0x3e:
+            break;
+        default:
+            if(byte >= 0x40 && byte <= 0x4f) {
+                d.rex = static_cast<uint8_t>(byte);
+                d.position += 1;
+                // A REX prefix followed by another prefix is ignored.
+                const int next = d.peek();
+                const bool legacy = next == 0xf0 || next == 0xf2 || next == 0xf3 || next == 0x66 ||
+                                    next == 0x67 || next == 0x64 || next == 0x65 || next == 0x26 ||
+                                    next == 0x2e || next == 0x36 || next == 0x3e;
+                if(legacy) {
+                    d.rex = 0;
+                    continue;
+                }
+            }
+
+            return;
+        }
+
+        // A legacy prefix after REX cancels it.
+        d.rex = 0;
+        d.position += 1;
+    }
+}
+
+// Reads the opcode, including the VEX and EVEX prefixes and the escape bytes.
+auto read_opcode(decoder& d) -> void {
+    if(d.rex != 0) {
+        d.w = (d.rex & 0x08) != 0;
+        d.r = (d.rex & 0x04) != 0 ? 8 : 0;
+        d.x = (d.rex & 0x02) != 0 ? 8 : 0;
+        d.b = (d.rex & 0x01) != 0 ? 8 : 0;
+    }
+
+    uint8_t byte = d.u8();
+
+    if(d.rex == 0 && (byte == 0xc4 || byte == 0xc5)) {
+        d.enc = encoding::vex;
+        const uint8_t p1 = d.u8();
+        d.r = (p1 & 0x80) == 0 ? 8 : 0;
+
+        uint8_t p2 = p1;
+        if(byte == 0xc4) {
+            d.x = (p1 & 0x40) == 0 ? 8 : 0;
+            d.b = (p1 & 0x20) == 0 ? 8 : 0;
+            d.map = p1 & 0x1f;
+            p2 = d.u8();
+            d.w = (p2 & 0x80) != 0;
+        } else {
+            d.map = 1;
+        }
+
+        d.vvvv = static_cast<uint8_t>((~p2 >> 3) & 0x0f);
+        d.vector_length = (p2 & 0x04) != 0 ? 1 : 0;
+        d.prefix = p2 & 0x03;
+        d.opcode = d.u8();
+        return;
+    }
+
+    if(d.rex == 0 && byte == 0x62) {
+        d.enc = encoding::evex;
+        const uint8_t p0 = d.u8();
+        const uint8_t p1 = d.u8();
+        const uint8_t p2 = d.u8();
+
+        d.r = (p0 & 0x80) == 0 ? 8 : 0;
+        d.x = (p0 & 0x40) == 0 ? 8 : 0;
+        d.b = (p0 & 0x20) == 0 ? 8 : 0;
+        d.r2 = (p0 & 0x10) == 0 ? 16 : 0;
+        d.x2 = (p0 & 0x40) == 0 ? 16 : 0;
+        d.map = p0 & 0x07;
+        d.w = (p1 & 0x80) != 0;
+        d.vvvv = static_cast<uint8_t>(((~p1 >> 3) & 0x0f) | ((p2 & 0x08) == 0 ? 16 : 0));
+        d.prefix = p1 & 0x03;
+        d.zeroing = (p2 & 0x80) != 0;
+        d.vector_length = (p2 >> 5) & 0x03;
+        d.broadcast = (p2 & 0x10) != 0;
+        d.mask = p2 & 0x07;
+        d.opcode = d.u8();
+        return;
+    }
+
+    if(byte == 0x0f) {
+        byte = d.u8();
+        if(byte == 0x38 || byte == 0x3a) {
+            d.map = byte == 0x38 ? 2 : 3;
+            d.opcode = d.u8();
+        } else {
+            d.map = 1;
+            d.opcode = byte;
+        }
+    } else {
+        d.opcode = byte;
+    }
+
+    // The last of F2 and F3 wins over 66 as mandatory prefix.
+    d.prefix = d.repeat == 0xf3 ? pf3 : d.repeat == 0xf2 ? pf2 : d.operand_size ? p66 : no_prefix;
+}
+
+auto read_modrm(decoder& d) -> void {
+    const uint8_t modrm = d.u8();
+    d.has_modrm = true;
+    d.mod = modrm >> 6;
+    d.reg = (modrm >> 3) & 0x07;
+    d.rm = modrm & 0x07;
+
+    if(d.mod == 3) {
+        return;
+    }
+
+    if(d.rm == 4) {
+        const uint8_t sib = d.u8();
+        d.has_sib = true;
+        d.scale = static_cast<uint8_t>(1u << (sib >> 6));
+
+        const uint8_t index = ((sib >> 3) & 0x07) | d.x;
+        d.index = index == 4 ? -1 : index;
+
+        const uint8_t base = sib & 0x07;
+        d.base = base == 5 && d.mod == 0 ? -1 : base | d.b;
+
+        if(base == 5 && d.mod == 0) {
+            d.displacement_size = 4;
+        }
+    } else if(d.rm == 5 && d.mod == 0) {
+        d.rip_relative = true;
+        d.displacement_size = 4;
+    } else {
+        d.base = d.rm | d.b;
+    }
+
+    if(d.mod == 1) {
+        d.displacement_size = 1;
+    } else if(d.mod == 2) {
+        d.displacement_size = 4;
+    }
+
+    d.displacement = sign_extend(d.little_endian(d.displacement_size), d.displacement_size);
+}
+
+// Size in bits of the v operands.
+[[nodiscard]]
+auto operand_bits(const decoder& d, uint16_t flags) -> unsigned {
+    if((flags & f64) != 0 || d.w) {
+        return 64;
+    }
+
+    if(d.operand_size) {
+        return 16;
+    }
+
+    return (flags & d64) != 0 ? 64 : 32;
+}
+
+auto read_immediate(decoder& d, std::size_t bytes) -> void {
+    if(d.immediate_count == d.immediates.size()) {
+        return;
+    }
+
+    d.immediate_sizes[d.immediate_count] = bytes;
+    d.immediates[d.immediate_count] = d.little_endian(bytes);
+    d.immediate_count += 1;
+}
+
+auto read_immediates(decoder& d, const entry& e) -> void {
+    const unsigned bits = operand_bits(d, e.flags);
+
+    for(const auto o : e.operands) {
+        switch(o) {
+        case Ib: case Ibs: case Jb:
+            read_immediate(d, 1);
+            break;
+        case Iw:
+            read_immediate(d, 2);
+            break;
+        case Iz: case Jz:
+            read_immediate(d, bits == 16 ? 2 : 4);
+            break;
+        case Iv:
+            read_immediate(d, bits / 8);
+            break;
+        case Ob: case Ov:
+            read_immediate(d, d.address_size ? 4 : 8);
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+// Formats instructions once decoded.
+class printer {
+public:
+    printer(const decoder& d, const entry& e, std::uintptr_t next) : d_(d), e_(e), next_(next) {}
+
+    auto add(std::string_view text) -> void {
+        separate();
+        text_ += text;
+    }
+
+    auto add_operand(operand o) -> void {
+        separate();
+
+        const unsigned bits = operand_bits(d_, e_.flags);
+        const unsigned y = d_.w ? 64 : 32;
+
+        switch(o) {
+        case operand::none:
+            break;
+        case Eb: rm_general(8); break;
+        case Ew: rm_general(16); break;
+        case Ed: rm_general(32); break;
+        case Eq: rm_general(64); break;
+        case Ev: rm_general(bits); break;
+        case Ey: rm_general(y); break;
+        case M: memory(0); break;
+        case Md: memory(4); break;
+        case Mq: memory(8); break;
+        case Mdq: memory(16); break;
+        case Mx: memory(vector_bytes()); break;
+        case Gb: text_ += byte_register(d_.reg | d_.r); break;
+        case Gw: text_ += general(d_.reg | d_.r, 16); break;
+        case Gd: text_ += general(d_.reg | d_.r, 32); break;
+        case Gv: text_ += general(d_.reg | d_.r, bits); break;
+        case Gy: text_ += general(d_.reg | d_.r, y); break;
+        case Ib: immediate(next_immediate(), 8, false); break;
+        case Ibs: immediate(next_immediate(), bits, true); break;
+        case Iw: immediate(next_immediate(), 16, false); break;
+        case Iz: immediate(next_immediate(), bits, bits == 64); break;
+        case Iv: immediate(next_immediate(), bits, false); break;
+        case Jb:
+        case Jz:
+            target_ = next_ + static_cast<uint64_t>(sign_extend(next_immediate(), d_.immediate_sizes[immediate_]));
+            text_ += fmt::format("{:#x}", *target_);
+            break;
+        case Zb: text_ += byte_register((d_.opcode & 7) | d_.b); break;
+        case Zv: text_ += general((d_.opcode & 7) | d_.b, bits); break;
+        case AL: text_ += "al"; break;
+        case rAX: text_ += general(0, bits); break;
+        case eAX: text_ += general(0, bits == 16 ? 16 : 32); break;
+        case CL: text_ += "cl"; break;
+        case DX: text_ += "dx"; break;
+        case one: text_ += "1"; break;
+        case Ob:
+        case Ov: {
+            const auto size = o == Ob ? 1u : bits / 8;
+            text_ += fmt::format("{} ptr {}[{:#x}]", size_name(size), segment(), next_immediate());
+            break;
+        }
+        case Sw: text_ += segment_registers[d_.reg]; break;
+        case Pq: text_ += fmt::format("mm{}", d_.reg); break;
+        case Qq: mmx_or_memory(8); break;
+        case Nq: mmx_or_memory(0); break;
+        case Vx: text_ += vector(d_.reg | d_.r | d_.r2, d_.vector_length); break;
+        case Vdq: text_ += vector(d_.reg | d_.r | d_.r2, 0); break;
+        case Wx: vector_or_memory(d_.vector_length, vector_bytes()); break;
+        case Wdq: vector_or_memory(0, 16); break;
+        case Wb: vector_or_memory(0, 1); break;
+        case Ww: vector_or_memory(0, 2); break;
+        case Wd: vector_or_memory(0, 4); break;
+        case Wq: vector_or_memory(0, 8); break;
+        case Ux: vector_or_memory(d_.vector_length, 0); break;
+        case Udq: vector_or_memory(0, 0); break;
+        case Hx: text_ += vector(d_.vvvv, d_.vector_length); break;
+        case Hdq: text_ += vector(d_.vvvv, 0); break;
+        case By: text_ += general(d_.vvvv & 0x0f, y); break;
+        case Kg: text_ += fmt::format("k{}", d_.reg); break;
+        case Ke:
+            if(d_.mod == 3) {
+                text_ += fmt::format("k{}", d_.rm);
+            } else {
+                memory(0);
+            }
+            break;
+        case Kh: text_ += fmt::format("k{}", d_.vvvv & 7); break;
+        }
+
+        // The mask of EVEX instructions goes with their destination.
+        if(operands_ == 1 && d_.enc == encoding::evex) {
+            if(d_.mask != 0) {
+                text_ += fmt::format(" {{k{}}}", d_.mask);
+            }
+
+            if(d_.zeroing) {
+                text_ += " {z}";
+            }
+        }
+    }
+
+    // Register forms of instructions that only accept memory are invalid.
+    [[nodiscard]]
+    auto valid() const -> bool {
+        return valid_;
+    }
+
+    [[nodiscard]]
+    auto text() -> std::string& { return text_; }
+
+    [[nodiscard]]
+    auto target() const -> std::optional<std::uintptr_t> { return target_; }
+
+    [[nodiscard]]
+    static auto general(unsigned number, unsigned bits) -> std::string_view {
+        return bits == 64 ? registers64[number]
+             : bits == 32 ? registers32[number]
+             : bits == 16 ? registers16[number]
+             : registers8[number];
+    }
+
+private:
+    auto separate() -> void {
+        text_ += operands_ == 0 ? " " : ", ";
+        operands_ += 1;
+    }
+
+    [[nodiscard]]
+    auto next_immediate() -> uint64_t {
+        const uint64_t value = d_.immediates[immediate_];
+        if(immediate_ + 1 < d_.immediate_count) {
+            immediate_ += 1;
+        }
+
+        return value;
+    }
+
+    [[nodiscard]]
+    auto vector_bytes() const -> unsigned {
+        return 16u << d_.vector_length;
+    }
+
+    [[nodiscard]]
+    static auto vector(unsigned number, unsigned length) -> std::string {
+        constexpr std::array<std::string_view, 4> names = {"xmm", "ymm", "zmm", "(bad)"};
+        return fmt::format("{}{}", names[length & 3], number);
+    }
+
+    [[nodiscard]]
+    static auto size_name(unsigned bytes) -> std::string_view {
+        switch(bytes) {
+        case 1: return "byte";
+        case 2: return "word";
+        case 4: return "dword";
+        case 8: return "qword";
+        case 10: return "tbyte";
+        case 16: return "xmmword";
+        case 32: return "ymmword";
+        case 64: return "zmmword";
+        default: return "";
+        }
+    }
+
+    [[nodiscard]]
+    auto segment() const -> std::string_view {
+        return d_.segment == 0x64 ? "fs:" : d_.segment == 0x65 ? "gs:" : "";
+    }
+
+    auto rm_general(unsigned bits) -> void {
+        if(d_.mod != 3) {
+            memory(bits / 8);
+            return;
+        }
+
+        const unsigned number = d_.rm | d_.b;
+        text_ += bits == 8 ? byte_register(number) : general(number, bits);
+    }
+
+    // spl, bpl, sil and dil need a REX prefix, without it these are the high
+    // bytes.
+    [[nodiscard]]
+    auto byte_register(unsigned number) const -> std::string_view {
+        if(d_.rex == 0 && d_.enc == encoding::legacy && number >= 4 && number < 8) {
+            return high_bytes[number - 4];
+        }
+
+        return general(number, 8);
+    }
+
+    auto mmx_or_memory(unsigned bytes) -> void {
+        if(d_.mod == 3) {
+            text_ += fmt::format("mm{}", d_.rm);
+        } else if(bytes == 0) {
+            valid_ = false;
+        } else {
+            memory(bytes);
+        }
+    }
+
+    auto vector_or_memory(unsigned length, unsigned bytes) -> void {
+        if(d_.mod == 3) {
+            text_ += vector(d_.rm | d_.b | d_.x2, length);
+        } else if(bytes == 0) {
+            valid_ = false;
+        } else {
+            memory(bytes);
+        }
+    }
+
+    auto memory(unsigned bytes) -> void {
+        if(d_.mod == 3) {
+            valid_ = false;
+            return;
+        }
+
+        int64_t displacement = d_.displacement;
+        // EVEX scales 8-bit displacements by the size of the memory operand,
+        // or of one element when it is broadcast.
+        if(d_.enc == encoding::evex && d_.displacement_size == 1) {
+            displacement *= d_.broadcast ? (d_.w ? 8 : 4) : (bytes == 0 ? 1 : bytes);
+        }
+
+        const auto bits = d_.address_size ? 32u : 64u;
+        if(bytes != 0) {
+            text_ += size_name(bytes);
+            text_ += " ptr ";
+        }
+
+        text_ += segment();
+        text_ += '[';
+
+        bool empty = true;
+        if(d_.rip_relative) {
+            text_ += d_.address_size ? "eip" : "rip";
+            target_ = next_ + static_cast<uint64_t>(displacement);
+            empty = false;
+        } else if(d_.base >= 0) {
+            text_ += general(static_cast<unsigned>(d_.base), bits);
+            empty = false;
+        }
+
+        if(d_.index >= 0) {
+            text_ += fmt::format("{}{}*{}", empty ? "" : " + ", general(static_cast<unsigned>(d_.index), bits), d_.scale);
+            empty = false;
+        }
+
+        if(empty) {
+            text_ += fmt::format("{:#x}", static_cast<uint64_t>(displacement) & (d_.address_size ? 0xffffffffu : ~uint64_t{0}));
+        } else if(displacement > 0) {
+            text_ += fmt::format(" + {:#x}", displacement);
+        } else if(displacement < 0) {
+            text_ += fmt::format(" - {:#x}", -static_cast<uint64_t>(displacement));
+        }
+
+        text_ += ']';
+    }
+
+    auto immediate(uint64_t value, unsigned bits, bool is_signed) -> void {
+        const std::size_t bytes = d_.immediate_sizes[immediate_];
+        if(is_signed) {
+            const int64_t v = sign_extend(value, bytes);
+            if(v < 0) {
+                text_ += fmt::format("-{:#x}", -static_cast<uint64_t>(v));
+                return;
+            }
+
+            value = static_cast<uint64_t>(v);
+        }
+
+        const uint64_t mask = bits >= 64 ? ~uint64_t{0} : (uint64_t{1} << bits) - 1;
+        text_ += fmt::format("{:#x}", value & mask);
+    }
+
+    const decoder& d_;
+    const entry& e_;
+    std::uintptr_t next_;
+    std::string text_;
+    std::size_t operands_ = 0;
+    std::size_t immediate_ = 0;
+    std::optional<std::uintptr_t> target_;
+    bool valid_ = true;
+};
+
+struct x87_memory {
+    std::string_view name;
+    unsigned bytes;
+};
+
+// Memory forms of D8 to DF, by opcode and ModRM reg.
+constexpr std::array<std::array<x87_memory, 8>, 8> x87_memory_forms = {{
+    {{{"fadd", 4}, {"fmul", 4}, {"fcom", 4}, {"fcomp", 4}, {"fsub", 4}, {"fsubr", 4}, {"fdiv", 4}, {"fdivr", 4}}},
+    {{{"fld", 4}, {"", 0}, {"fst", 4}, {"fstp", 4}, {"fldenv", 0}, {"fldcw", 2}, {"fnstenv", 0}, {"fnstcw", 2}}},
+    {{{"fiadd", 4}, {"fimul", 4}, {"ficom", 4}, {"ficomp", 4}, {"fisub", 4}, {"fisubr", 4}, {"fidiv", 4}, {"fidivr", 4}}},
+    {{{"fild", 4}, {"fisttp", 4}, {"fist", 4}, {"fistp", 4}, {"", 0}, {"fld", 10}, {"", 0}, {"fstp", 10}}},
+    {{{"fadd", 8}, {"fmul", 8}, {"fcom", 8}, {"fcomp", 8}, {"fsub", 8}, {"fsubr", 8}, {"fdiv", 8}, {"fdivr", 8}}},
+    {{{"fld", 8}, {"fisttp", 8}, {"fst", 8}, {"fstp", 8}, {"frstor", 0}, {"", 0}, {"fnsave", 0}, {"fnstsw", 2}}},
+    {{{"fiadd", 2}, {"fimul", 2}, {"ficom", 2}, {"ficomp", 2}, {"fisub", 2}, {"fisubr", 2}, {"fidiv", 2}, {"fidivr", 2}}},
+    {{{"fild", 2}, {"fisttp", 2}, {"fist", 2}, {"fistp", 2}, {"fbld", 10}, {"fild", 8}, {"fbstp", 10}, {"fistp", 8}}},
+}};
+
+// Register forms of D9 E0 to FF, without operands.
+constexpr std::array<std::string_view, 32> x87_constants = {
+    "fchs", "fabs", "", "", "ftst", "fxam", "", "",
+    "fld1", "fldl2t", "fldl2e", "fldpi", "fldlg2", "fldln2", "fldz", "",
+    "f2xm1", "fyl2x", "fptan", "fpatan", "fxtract", "fprem1", "fdecstp", "fincstp",
+    "fprem", "fyl2xp1", "fsqrt", "fsincos", "frndint", "fscale", "fsin", "fcos",
+};
+
+// Text of the x87 instructions, D8 to DF. The register forms that are not
+// named here are shown as unknown.
+[[nodiscard]]
+auto x87_text(const decoder& d, const entry& e, std::uintptr_t next, std::optional<std::uintptr_t>& target) -> std::string {
+    const unsigned escape = d.opcode - 0xd8u;
+
+    if(d.mod != 3) {
+        const auto& form = x87_memory_forms[escape][d.reg];
+        if(form.name.empty()) {
+            return "(bad)";
+        }
+
+        printer p(d, e, next);
+        p.text() += form.name;
+        p.add_operand(form.bytes == 4 ? Ed : form.bytes == 2 ? Ew : form.bytes == 8 ? Eq : M);
+        std::string text = std::move(p.text());
+        target = p.target();
+
+        // The printer knows no 10 bytes operands.
+        if(form.bytes == 10) {
+            text.insert(form.name.size() + 1, "tbyte ptr ");
+        }
+
+        return text;
+    }
+
+    const unsigned i = d.rm;
+    const auto st = [&](std::string_view name, bool reversed) {
+        return reversed ? fmt::format("{} st({}), st", name, i) : fmt::format("{} st, st({})", name, i);
+    };
+
+    constexpr std::array<std::string_view, 8> arithmetic = {"fadd", "fmul", "fcom", "fcomp", "fsub", "fsubr", "fdiv", "fdivr"};
+    // DC and DE swap the direction of the subtractions and divisions.
+    constexpr std::array<std::string_view, 8> reversed = {"fadd", "fmul", "fcom", "fcomp", "fsubr", "fsub", "fdivr", "fdiv"};
+    constexpr std::array<std::string_view, 8> popping = {"faddp", "fmulp", "", "", "fsubrp", "fsubp", "fdivrp", "fdivp"};
+
+    switch(d.opcode) {
+    case 0xd8:
+        return st(arithmetic[d.reg], false);
+    case 0xd9:
+        if(d.reg == 0) {
+            return fmt::format("fld st({})", i);
+        }
+        if(d.reg == 1) {
+            return fmt::format("fxch st({})", i);
+        }
+        if(d.reg == 2 && i == 0) {
+            return "fnop";
+        }
+        if(d.reg >= 4 && !x87_constants[(d.reg - 4u) * 8u + i].empty()) {
+            return std::string(x87_constants[(d.reg - 4u) * 8u + i]);
+        }
+        break;
+    case 0xda: {
+        constexpr std::array<std::string_view, 4> moves = {"fcmovb", "fcmove", "fcmovbe", "fcmovu"};
+        if(d.reg < 4) {
+            return st(moves[d.reg], false);
+        }
+        if(d.reg == 5 && i == 1) {
+            return "fucompp";
+        }
+        break;
+    }
+    case 0xdb: {
+        constexpr std::array<std::string_view, 4> moves = {"fcmovnb", "fcmovne", "fcmovnbe", "fcmovnu"};
+        if(d.reg < 4) {
+            return st(moves[d.reg], false);
+        }
+        if(d.reg == 4 && i == 2) {
+            return "fnclex";
+        }
+        if(d.reg == 4 && i == 3) {
+            return "fninit";
+        }
+        if(d.reg == 5) {
+            return st("fucomi", false);
+        }
+        if(d.reg == 6) {
+            return st("fcomi", false);
+        }
+        break;
+    }
+    case 0xdc:
+        if(d.reg != 2 && d.reg != 3) {
+            return st(reversed[d.reg], true);
+        }
+        break;
+    case 0xdd: {
+        constexpr std::array<std::string_view, 8> names = {"ffree", "", "fst", "fstp", "fucom", "fucomp", "", ""};
+        if(!names[d.reg].empty()) {
+            return fmt::format("{} st({})", names[d.reg], i);
+        }
+        break;
+    }
+    case 0xde:
+        if(d.reg == 3 && i == 1) {
+            return "fcompp";
+        }
+        if(!popping[d.reg].empty()) {
+            return st(popping[d.reg], true);
+        }
+        break;
+    case 0xdf:
+        if(d.reg == 0) {
+            return fmt::format("ffreep st({})", i);
+        }
+        if(d.reg == 4 && i == 0) {
+            return "fnstsw ax";
+        }
+        if(d.reg == 5) {
+            return st("fucomip", false);
+        }
+        if(d.reg == 6) {
+            return st("fcomip", false);
+        }
+        break;
+    default:
+        break;
+    }
+
+    return "(unknown)";
+}
+
+// Register forms of groups 7 and 15 (0F 01 and 0F AE), told apart by
+// the whole ModRM byte.
+[[nodiscard]]
+auto system_instruction(const decoder& d) -> std::string_view {
+    const unsigned modrm = 0xc0u | (d.reg << 3u) | d.rm;
+
+    if(d.opcode == 0xae) {
+        return d.reg == 5 ? "lfence" : d.reg == 6 ? "mfence" : d.reg == 7 ? "sfence" : "(unknown)";
+    }
+
+    switch(modrm) {
+    case 0xc8: return "monitor";
+    case 0xc9: return "mwait";
+    case 0xca: return "clac";
+    case 0xcb: return "stac";
+    case 0xd0: return "xgetbv";
+    case 0xd1: return "xsetbv";
+    case 0xd5: return "xend";
+    case 0xd6: return "xtest";
+    case 0xee: return "rdpkru";
+    case 0xef: return "wrpkru";
+    case 0xf8: return "swapgs";
+    case 0xf9: return "rdtscp";
+    default: return "(unknown)";
+    }
+}
+
+// Size of the mask of the mask register instructions.
+[[nodiscard]]
+auto mask_suffix(const decoder& d) -> std::string_view {
+    if(d.opcode == 0x4b) {
+        return d.prefix == p66 ? "bw" : d.w ? "dq" : "wd";
+    }
+
+    if(d.opcode == 0x92 || d.opcode == 0x93) {
+        return d.prefix == p66 ? "b" : d.prefix == pf2 ? (d.w ? "q" : "d") : "w";
+    }
+
+    return d.prefix == p66 ? (d.w ? "d" : "b") : (d.w ? "q" : "w");
+}
+
+// Name of the EVEX forms that differ from the VEX ones by the element size.
+[[nodiscard]]
+auto evex_name(const decoder& d) -> std::optional<std::string_view> {
+    if(d.map != 1) {
+        return std::nullopt;
+    }
+
+    switch(d.opcode) {
+    case 0x6f:
+    case 0x7f:
+        if(d.prefix == pf3) {
+            return d.w ? "vmovdqu64" : "vmovdqu32";
+        }
+        if(d.prefix == pf2) {
+            return d.w ? "vmovdqu16" : "vmovdqu8";
+        }
+        if(d.prefix == p66) {
+            return d.w ? "vmovdqa64" : "vmovdqa32";
+        }
+        return std::nullopt;
+    case 0xdb: return d.w ? "vpandq" : "vpandd";
+    case 0xdf: return d.w ? "vpandnq" : "vpandnd";
+    case 0xeb: return d.w ? "vporq" : "vpord";
+    case 0xef: return d.w ? "vpxorq" : "vpxord";
+    default: return std::nullopt;
+    }
+}
+
+[[nodiscard]]
+auto bad(std::uintptr_t address, const uint8_t* code) -> nkgt::disassembler::instruction {
+    nkgt::disassembler::instruction i = {address, 1, {}, "(bad)", std::nullopt, false};
+    i.bytes[0] = code[0];
+    return i;
+}
+
+}
+
+namespace nkgt::disassembler {
+
+auto decode(const uint8_t* code, std::size_t size, std::uintptr_t address) -> std::optional<instruction> {
+    if(size == 0) {
+        return std::nullopt;
+    }
+
+    // fwait followed by one of the x87 control instructions that do not wait
+    // is the waiting form, fstcw for fnstcw and so on.
+    if(code[0] == 0x9b && size > 1 && (code[1] & 0xf9) == 0xd9) {
+        auto waiting = decode(code + 1, size - 1, address + 1);
+        if(waiting && waiting->text.rfind("fn", 0) == 0 && waiting->text != "fnop" &&
+           waiting->size < max_instruction_size) {
+            waiting->text.erase(1, 1);
+            waiting->address = address;
+            waiting->size += 1;
+            std::copy_n(code, waiting->size, waiting->bytes.begin());
+            return waiting;
+        }
+    }
+
+    const auto& t = opcode_tables();
+    decoder d = {code, size, address};
+
+    read_prefixes(d);
+    read_opcode(d);
+
+    // Looks up the instruction. x87 instructions and the ModRM of the
+    // instructions that are not in the tables are handled separately.
+    entry e = {};
+    bool known = true;
+
+    if(d.map == 0) {
+        e = t.one_byte[d.opcode];
+        known = !e.name.empty() || e.names != nullptr || (d.opcode >= 0xd8 && d.opcode <= 0xdf);
+    } else if(d.map <= 3) {
+        e = t.prefixed[d.map - 1u][d.opcode][d.prefix];
+        if((e.flags & vex_only) != 0 && d.enc == encoding::legacy) {
+            e = {};
+        }
+
+        if(e.name.empty() && e.names == nullptr && d.map == 1 && d.enc == encoding::legacy) {
+            e = t.two_byte[d.opcode];
+        }
+
+        known = !e.name.empty() || e.names != nullptr;
+    } else {
+        known = false;
+    }
+
+    const bool x87 = d.map == 0 && d.opcode >= 0xd8 && d.opcode <= 0xdf;
+    const bool needs_modrm = x87 || (e.flags & modrm) != 0 || e.names != nullptr ||
+                             std::any_of(e.operands.cbegin(), e.operands.cend(), has_modrm_operand) ||
+                             (d.map == 1 && !two_byte_without_modrm(d.opcode)) ||
+                             (d.map == 1 && d.enc != encoding::legacy && d.opcode != 0x77) ||
+                             d.map >= 2;
+
+    if(needs_modrm) {
+        read_modrm(d);
+    }
+
+    if(known) {
+        read_immediates(d, e);
+
+        // test is the only instruction of group 3 with an immediate.
+        if(d.map == 0 && (d.opcode == 0xf6 || d.opcode == 0xf7) && d.reg < 2) {
+            read_immediate(d, d.opcode == 0xf6 ? 1 : (operand_bits(d, 0) == 16 ? 2 : 4));
+        }
+    } else if((d.map == 1 && two_byte_with_immediate(d.opcode)) || d.map == 3) {
+        read_immediate(d, 1);
+    }
+
+    if(d.truncated) {
+        return std::nullopt;
+    }
+
+    if(d.position > max_instruction_size || (e.flags & invalid) != 0 || d.map > 3 ||
+       (d.enc != encoding::legacy && d.map == 0)) {
+        return bad(address, code);
+    }
+
+    instruction result = {address, static_cast<uint8_t>(d.position), {}, {}, std::nullopt, (e.flags & jump) != 0};
+    std::copy_n(code, d.position, result.bytes.begin());
+    const std::uintptr_t next = address + d.position;
+
+    if(x87) {
+        result.text = x87_text(d, e, next, result.target);
+        return result;
+    }
+
+    if(d.enc == encoding::vex && d.map == 1 && d.opcode == 0x77) {
+        result.text = d.vector_length == 0 ? "vzeroupper" : "vzeroall";
+        return result;
+    }
+
+    if(d.enc == encoding::legacy && d.map == 1 && (d.opcode == 0x01 || d.opcode == 0xae) && d.mod == 3) {
+        result.text = system_instruction(d);
+        return result;
+    }
+
+    if(!known || ((e.flags & mask_size) != 0 && d.enc != encoding::vex)) {
+        result.text = "(unknown)";
+        return result;
+    }
+
+    // Names that depend on more than the opcode.
+    std::string name(e.name);
+    if(e.names != nullptr) {
+        name = (*e.names)[d.reg];
+        if(name.empty()) {
+            return bad(address, code);
+        }
+    }
+
+    if(d.map == 0) {
+        if(d.opcode == 0x90 && (d.b != 0 || d.repeat == 0xf3)) {
+            name = d.b != 0 ? "xchg" : "pause";
+            if(d.b != 0) {
+                e.operands = {operand::Zv, operand::rAX};
+            }
+        } else if(d.opcode == 0x98 || d.opcode == 0x99) {
+            constexpr std::array<std::array<std::string_view, 3>, 2> names = {{
+                {"cbw", "cwde", "cdqe"},
+                {"cwd", "cdq", "cqo"},
+            }};
+            const unsigned bits = operand_bits(d, 0);
+            name = names[d.opcode - 0x98u][bits == 16 ? 0 : bits == 32 ? 1 : 2];
+        } else if(d.opcode == 0xff) {
+            // Near calls and jumps are always 64 bits, push defaults to it.
+            if(d.reg == 2 || d.reg == 4) {
+                e.flags |= f64;
+                result.ends_block = d.reg == 4;
+            } else if(d.reg == 6) {
+                e.flags |= d64;
+            } else if(d.reg == 3 || d.reg == 5) {
+                e.operands = {operand::M};
+                result.ends_block = d.reg == 5;
+            }
+        } else if((d.opcode == 0xf6 || d.opcode == 0xf7) && d.reg < 2) {
+            e.operands[1] = d.opcode == 0xf6 ? Ib : Iz;
+        } else if((d.opcode == 0xc6 || d.opcode == 0xc7) && d.reg == 7) {
+            // Transactional memory, the immediate is the abort code or the
+            // fallback address.
+            if(d.mod != 3 || d.rm != 0) {
+                return bad(address, code);
+            }
+
+            e.operands = {d.opcode == 0xc6 ? Ib : Jz};
+        }
+    } else if(d.map == 1) {
+        if(d.opcode == 0x1e && d.repeat == 0xf3 && d.mod == 3 && (d.rm == 2 || d.rm == 3) && d.reg == 7) {
+            result.text = d.rm == 2 ? "endbr64" : "endbr32";
+            return result;
+        }
+
+        if(d.opcode == 0xc7) {
+            // cmpxchg8b only takes memory, rdrand and rdseed only registers.
+            if((d.reg == 1) == (d.mod == 3)) {
+                return bad(address, code);
+            }
+
+            if(d.reg == 1) {
+                name = d.w ? "cmpxchg16b" : "cmpxchg8b";
+                e.operands = {d.w ? Mdq : Mq};
+            }
+        }
+
+        if((d.opcode == 0x12 || d.opcode == 0x16) && d.prefix == no_prefix && d.mod == 3) {
+            name = d.opcode == 0x12 ? "movhlps" : "movlhps";
+            e.operands = {Vdq, Udq};
+        }
+    }
+
+    if(d.enc == encoding::evex) {
+        const auto special = evex_name(d);
+        if(special) {
+            name = *special;
+        } else if((e.flags & no_v) == 0) {
+            name.insert(0, "v");
+        }
+
+        if((e.flags & mask_compare) != 0) {
+            e.operands[0] = Kg;
+        }
+    } else if(d.enc == encoding::vex && (e.flags & no_v) == 0) {
+        name.insert(0, "v");
+    }
+
+    if((e.flags & wide_q) != 0 && d.w) {
+        const auto last = name.rfind('d');
+        if(last != std::string::npos) {
+            name[last] = 'q';
+        }
+    }
+
+    if((e.flags & wide_s) != 0 && d.w) {
+        const auto last = name.rfind('s');
+        if(last != std::string::npos) {
+            name[last] = 'd';
+        }
+
+        std::replace(e.operands.begin(), e.operands.end(), Wd, Wq);
+    }
+
+    if((e.flags & wide_w) != 0 && d.w) {
+        const auto last = name.rfind('b');
+        if(last != std::string::npos) {
+            name[last] = 'w';
+        }
+    }
+
+    if((e.flags & mask_size) != 0) {
+        name += mask_suffix(d);
+    }
+
+    if((e.flags & sized) != 0) {
+        const unsigned bits = operand_bits(d, e.flags);
+        name += bits == 16 ? "w" : bits == 32 ? "d" : "q";
+    }
+
+    std::string prefixes;
+    if(d.lock) {
+        prefixes += "lock ";
+    }
+
+    if((e.flags & string) != 0 && d.repeat != 0) {
+        const bool compares = d.opcode == 0xa6 || d.opcode == 0xa7 || d.opcode == 0xae || d.opcode == 0xaf;
+        prefixes += d.repeat == 0xf2 ? "repne " : compares ? "repe " : "rep ";
+    }
+
+    printer p(d, e, next);
+    p.text() = prefixes + name;
+
+    // The shifts by an immediate encode their destination in vvvv.
+    const bool vex_destination = d.map == 1 && d.opcode >= 0x71 && d.opcode <= 0x73 && d.enc != encoding::legacy;
+    const bool insert_source = d.enc != encoding::legacy &&
+                               ((e.flags & nds) != 0 || ((e.flags & nds_reg) != 0 && d.mod == 3));
+
+    for(std::size_t i = 0; i < e.operands.size(); ++i) {
+        const operand o = e.operands[i];
+        if(o == operand::none) {
+            break;
+        }
+
+        // Without VEX, vvvv does not exist and the destination is in rm.
+        if(o == Hx && !vex_destination) {
+            continue;
+        }
+
+        p.add_operand(o);
+
+        if(i == 0 && insert_source) {
+            p.add_operand((e.operands[1] == Vdq || e.operands[0] == Vdq || e.operands[1] == Wd || e.operands[1] == Wq) ? Hdq : Hx);
+        }
+    }
+
+    if(!p.valid()) {
+        return bad(address, code);
+    }
+
+    result.text = std::move(p.text());
+    result.target = p.target();
+    return result;
+}
+
+auto block_cache::find(std::uintptr_t address) const -> const block* {
+    const auto it = blocks_.find(address);
+    return it == blocks_.cend() ? nullptr : &it->second;
+}
+
+auto block_cache::insert(const uint8_t* code, std::size_t size, std::uintptr_t address) -> const block* {
+    block b;
+    std::size_t offset = 0;
+
+    while(b.instructions.size() < max_block_instructions) {
+        auto i = decode(code + offset, size - offset, address + offset);
+        if(!i) {
+            break;
+        }
+
+        offset += i->size;
+        const bool ends_block = i->ends_block;
+        b.instructions.push_back(std::move(*i));
+
+        if(ends_block) {
+            break;
+        }
+    }
+
+    if(b.instructions.empty()) {
+        return nullptr;
+    }
+
+    return &(blocks_[address] = std::move(b));
+}
+
+auto block_cache::invalidate(std::uintptr_t address, std::size_t size) -> void {
+    constexpr std::uintptr_t page_size = 4096;
+    // No block spans more than this, so that those starting before the first
+    // page are found too.
+    constexpr std::uintptr_t max_block_size = max_block_instructions * max_instruction_size;
+
+    const std::uintptr_t first = address & ~(page_size - 1);
+    const std::uintptr_t last = (address + std::max<std::size_t>(size, 1) + page_size - 1) & ~(page_size - 1);
+
+    auto it = blocks_.lower_bound(first > max_block_size ? first - max_block_size : 0);
+    while(it != blocks_.end() && it->first < last) {
+        if(it->second.end() > first) {
+            it = blocks_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+}
@@ -0,0 +1,453 @@
+#include "nkgt/dwarf_expr.hpp"
+#include "nkgt/error_codes.hpp"
+#include "nkgt/registers.hpp"
+#include "nkgt/target.hpp"
+#include "nkgt/vector_registers.hpp"
+
+#include <dwarf.h>
+#include <tl/expected.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <optional>
+
+namespace {
+
+using nkgt::dwarf_expr::instruction;
+using nkgt::dwarf_expr::opcode;
+using nkgt::dwarf_expr::piece;
+
+// DWARF numbers of xmm0-xmm15 in the x86-64 psABI.
+constexpr unsigned first_xmm_dwarf_number = 17;
+constexpr unsigned last_xmm_dwarf_number = 32;
+
+// Deep enough for anything a compiler emits, small enough to live on the stack
+// of evaluate().
+constexpr std::size_t max_stack_depth = 64;
+
+[[nodiscard]]
+constexpr auto make(opcode op, uint64_t operand = 0, uint16_t reg = 0, uint8_t size = 0) -> instruction {
+    return {op, size, reg, 0, operand};
+}
+
+[[nodiscard]]
+auto register_value(
+    const nkgt::dwarf_expr::context& ctx,
+    unsigned dwarf_number
+) -> tl::expected<uint64_t, nkgt::error::dwarf_expr> {
+    const auto r = nkgt::registers::from_dwarf_number(dwarf_number);
+
+    if(!r) {
+        return tl::make_unexpected(nkgt::error::dwarf_expr::unknown_register);
+    }
+
+    return nkgt::registers::get_register_value(ctx.registers, *r);
+}
+
+// Copies size bytes of the register into out. General purpose registers are
+// zero extended, xmm registers come from the extended state.
+[[nodiscard]]
+auto read_register_bytes(
+    const nkgt::dwarf_expr::context& ctx,
+    unsigned dwarf_number,
+    std::byte* out,
+    std::size_t size
+) -> tl::expected<void, nkgt::error::dwarf_expr> {
+    if(dwarf_number >= first_xmm_dwarf_number && dwarf_number <= last_xmm_dwarf_number) {
+        const auto value = nkgt::registers::get_vector_register_value(
+            ctx.debugee,
+            {nkgt::registers::vector_kind::xmm, dwarf_number - first_xmm_dwarf_number}
+        );
+
+        if(!value || size > value->size) {
+            return tl::make_unexpected(nkgt::error::dwarf_expr::unknown_register);
+        }
+
+        std::memcpy(out, value->bytes.data(), size);
+        return {};
+    }
+
+    const auto value = register_value(ctx, dwarf_number);
+    if(!value) {
+        return tl::make_unexpected(value.error());
+    }
+
+    if(size > sizeof(uint64_t)) {
+        return tl::make_unexpected(nkgt::error::dwarf_expr::unknown_register);
+    }
+
+    std::memcpy(out, &*value, size);
+    return {};
+}
+
+}
+
+namespace nkgt::dwarf_expr {
+
+auto decode(
+    uint8_t atom,
+    uint64_t operand1,
+    uint64_t operand2
+) -> tl::expected<instruction, error::dwarf_expr> {
+    if(atom >= DW_OP_lit0 && atom <= DW_OP_lit31) {
+        return make(opcode::push_constant, static_cast<uint64_t>(atom - DW_OP_lit0));
+    }
+
+    if(atom >= DW_OP_reg0 && atom <= DW_OP_reg31) {
+        return make(opcode::location_register, 0, static_cast<uint16_t>(atom - DW_OP_reg0));
+    }
+
+    if(atom >= DW_OP_breg0 && atom <= DW_OP_breg31) {
+        return make(opcode::push_register, operand1, static_cast<uint16_t>(atom - DW_OP_breg0));
+    }
+
+    switch(atom) {
+    case DW_OP_addr:           return make(opcode::push_address, operand1);
+    case DW_OP_const1u:
+    case DW_OP_const1s:
+    case DW_OP_const2u:
+    case DW_OP_const2s:
+    case DW_OP_const4u:
+    case DW_OP_const4s:
+    case DW_OP_const8u:
+    case DW_OP_const8s:
+    case DW_OP_constu:
+    case DW_OP_consts:         return make(opcode::push_constant, operand1);
+    case DW_OP_regx:           return make(opcode::location_register, 0, static_cast<uint16_t>(operand1));
+    case DW_OP_bregx:          return make(opcode::push_register, operand2, static_cast<uint16_t>(operand1));
+    case DW_OP_fbreg:          return make(opcode::push_frame_base, operand1);
+    case DW_OP_call_frame_cfa: return make(opcode::push_cfa);
+    case DW_OP_deref:          return make(opcode::dereference, 0, 0, sizeof(uint64_t));
+    case DW_OP_deref_size:
+        if(operand1 == 0 || operand1 > sizeof(uint64_t)) {
+            return tl::make_unexpected(error::dwarf_expr::unsupported_operation);
+        }
+        return make(opcode::dereference, 0, 0, static_cast<uint8_t>(operand1));
+    case DW_OP_dup:            return make(opcode::duplicate);
+    case DW_OP_drop:           return make(opcode::drop);
+    case DW_OP_over:           return make(opcode::over);
+    case DW_OP_pick:           return make(opcode::pick, operand1);
+    case DW_OP_swap:           return make(opcode::swap);
+    case DW_OP_rot:            return make(opcode::rotate);
+    case DW_OP_abs:            return make(opcode::absolute);
+    case DW_OP_and:            return make(opcode::bit_and);
+    case DW_OP_div:            return make(opcode::divide);
+    case DW_OP_minus:          return make(opcode::minus);
+    case DW_OP_mod:            return make(opcode::modulo);
+    case DW_OP_mul:            return make(opcode::multiply);
+    case DW_OP_neg:            return make(opcode::negate);
+    case DW_OP_not:            return make(opcode::bit_not);
+    case DW_OP_or:             return make(opcode::bit_or);
+    case DW_OP_plus:           return make(opcode::plus);
+    case DW_OP_plus_uconst:    return make(opcode::plus_constant, operand1);
+    case DW_OP_shl:            return make(opcode::shift_left);
+    case DW_OP_shr:            return make(opcode::shift_right);
+    case DW_OP_shra:           return make(opcode::shift_right_arithmetic);
+    case DW_OP_xor:            return make(opcode::bit_xor);
+    case DW_OP_stack_value:    return make(opcode::stack_value);
+    case DW_OP_piece:          return make(opcode::piece, operand1);
+    case DW_OP_nop:            return make(opcode::nop);
+    case DW_OP_entry_value:
+    case DW_OP_GNU_entry_value:
+    case DW_OP_implicit_pointer:
+    case DW_OP_GNU_implicit_pointer:
+                               return make(opcode::unavailable);
+    default:
+        return tl::make_unexpected(error::dwarf_expr::unsupported_operation);
+    }
+}
+
+auto location::at(uint64_t pc) const -> const program* {
+    for(const auto& entry : entries) {
+        if(pc >= entry.low_pc && pc < entry.high_pc) {
+            return &entry.code;
+        }
+    }
+
+    return nullptr;
+}
+
+auto evaluate(
+    const program& code,
+    const context& ctx
+) -> tl::expected<std::vector<piece>, error::dwarf_expr> {
+    std::array<uint64_t, max_stack_depth> stack;
+    std::size_t depth = 0;
+    std::vector<piece> pieces;
+
+    // Set by DW_OP_regx and DW_OP_stack_value: the location of the current
+    // piece is not the address on top of the stack.
+    std::optional<piece> pending;
+
+    const auto push = [&](uint64_t value) -> bool {
+        if(depth == stack.size()) {
+            return false;
+        }
+
+        stack[depth++] = value;
+        return true;
+    };
+
+    // Location of the piece described by the operations executed so far.
+    const auto current_piece = [&](std::size_t size) -> piece {
+        if(pending) {
+            return {pending->k, pending->value, size};
+        }
+
+        if(depth == 0) {
+            return {piece::kind::optimized_out, 0, size};
+        }
+
+        return {piece::kind::memory, stack[depth - 1], size};
+    };
+
+    for(const auto& ins : code) {
+        const std::size_t needed = [&]() -> std::size_t {
+            switch(ins.op) {
+            case opcode::dereference:
+            case opcode::duplicate:
+            case opcode::drop:
+            case opcode::absolute:
+            case opcode::negate:
+            case opcode::bit_not:
+            case opcode::plus_constant:
+            case opcode::stack_value:
+                return 1;
+            case opcode::pick:
+                return static_cast<std::size_t>(ins.operand) + 1;
+            case opcode::rotate:
+                return 3;
+            case opcode::over:
+            case opcode::swap:
+            case opcode::bit_and:
+            case opcode::divide:
+            case opcode::minus:
+            case opcode::modulo:
+            case opcode::multiply:
+            case opcode::bit_or:
+            case opcode::plus:
+            case opcode::shift_left:
+            case opcode::shift_right:
+            case opcode::shift_right_arithmetic:
+            case opcode::bit_xor:
+                return 2;
+            default:
+                return 0;
+            }
+        }();
+
+        if(depth < needed) {
+            return tl::make_unexpected(error::dwarf_expr::stack_underflow);
+        }
+
+        uint64_t& top = stack[depth > 0 ? depth - 1 : 0];
+        const uint64_t second = depth > 1 ? stack[depth - 2] : 0;
+        bool ok = true;
+
+        switch(ins.op) {
+        case opcode::push_address:
+            ok = push(ins.operand + ctx.load_bias);
+            break;
+        case opcode::push_constant:
+            ok = push(ins.operand);
+            break;
+        case opcode::push_register: {
+            const auto value = register_value(ctx, ins.reg);
+            if(!value) {
+                return tl::make_unexpected(value.error());
+            }
+            ok = push(*value + ins.operand);
+            break;
+        }
+        case opcode::push_frame_base:
+            ok = push(ctx.frame_base + ins.operand);
+            break;
+        case opcode::push_cfa:
+            ok = push(ctx.cfa);
+            break;
+        case opcode::location_register:
+            pending = piece{piece::kind::reg, ins.reg, 0};
+            break;
+        case opcode::dereference: {
+            uint64_t value = 0;
+            if(!ctx.debugee.read_memory(top, &value, ins.size)) {
+                return tl::make_unexpected(error::dwarf_expr::memory_read_fail);
+            }
+            top = value;
+            break;
+        }
+        case opcode::duplicate: ok = push(top); break;
+        case opcode::drop:      --depth; break;
+        case opcode::over:      ok = push(second); break;
+        case opcode::pick:      ok = push(stack[depth - 1 - ins.operand]); break;
+        case opcode::swap:      std::swap(stack[depth - 1], stack[depth - 2]); break;
+        case opcode::rotate:
+            std::rotate(stack.begin() + static_cast<std::ptrdiff_t>(depth - 3),
+                        stack.begin() + static_cast<std::ptrdiff_t>(depth - 1),
+                        stack.begin() + static_cast<std::ptrdiff_t>(depth));
+            break;
+        case opcode::absolute: {
+            // Negated as unsigned, INT64_MIN stays INT64_MIN instead of
+            // overflowing.
+            const auto value = static_cast<int64_t>(top);
+            top = value < 0 ? ~top + 1 : top;
+            break;
+        }
+        case opcode::negate:        top = ~top + 1; break;
+        case opcode::bit_not:       top = ~top; break;
+        case opcode::plus_constant: top += ins.operand; break;
+        case opcode::divide:
+        case opcode::modulo: {
+            const auto divisor = static_cast<int64_t>(top);
+            const auto dividend = static_cast<int64_t>(second);
+            if(divisor == 0) {
+                return tl::make_unexpected(error::dwarf_expr::division_by_zero);
+            }
+            --depth;
+            // INT64_MIN / -1 overflows, and traps on x86-64.
+            if(ins.op == opcode::divide && divisor == -1) {
+                stack[depth - 1] = ~second + 1;
+                break;
+            }
+
+            stack[depth - 1] = ins.op == opcode::divide
+                             ? static_cast<uint64_t>(dividend / divisor)
+                             : second % top;
+            break;
+        }
+        case opcode::bit_and:
+        case opcode::minus:
+        case opcode::multiply:
+        case opcode::bit_or:
+        case opcode::plus:
+        case opcode::shift_left:
+        case opcode::shift_right:
+        case opcode::shift_right_arithmetic:
+        case opcode::bit_xor: {
+            const uint64_t rhs = top;
+            const uint64_t shift = std::min<uint64_t>(rhs, 63);
+            uint64_t& lhs = stack[depth - 2];
+            --depth;
+
+            switch(ins.op) {
+            case opcode::bit_and:  lhs &= rhs; break;
+            case opcode::minus:    lhs -= rhs; break;
+            case opcode::multiply: lhs *= rhs; break;
+            case opcode::bit_or:   lhs |= rhs; break;
+            case opcode::plus:     lhs += rhs; break;
+            case opcode::bit_xor:  lhs ^= rhs; break;
+            case opcode::shift_left:
+                lhs = rhs > 63 ? 0 : lhs << shift;
+                break;
+            case opcode::shift_right:
+                lhs = rhs > 63 ? 0 : lhs >> shift;
+                break;
+            default:
+                lhs = static_cast<uint64_t>(static_cast<int64_t>(lhs) >> shift);
+                break;
+            }
+            break;
+        }
+        case opcode::stack_value:
+            pending = piece{piece::kind::value, top, 0};
+            break;
+        case opcode::piece:
+            pieces.push_back(current_piece(static_cast<std::size_t>(ins.operand)));
+            pending.reset();
+            depth = 0;
+            break;
+        case opcode::nop:
+            break;
+        case opcode::unavailable:
+            pending = piece{piece::kind::optimized_out, 0, 0};
+            break;
+        }
+
+        if(!ok) {
+            return tl::make_unexpected(error::dwarf_expr::stack_overflow);
+        }
+    }
+
+    if(pieces.empty()) {
+        pieces.push_back(current_piece(0));
+    }
+
+    return pieces;
+}
+
+auto evaluate_value(
+    const program& code,
+    const context& ctx
+) -> tl::expected<uint64_t, error::dwarf_expr> {
+    const auto pieces = evaluate(code, ctx);
+
+    if(!pieces) {
+        return tl::make_unexpected(pieces.error());
+    }
+
+    // A frame base is either an address left on the stack (DW_OP_breg*,
+    // DW_OP_call_frame_cfa) or a register holding it (DW_OP_reg*).
+    const piece& p = pieces->front();
+    switch(p.k) {
+    case piece::kind::memory:
+    case piece::kind::value:
+        return p.value;
+    case piece::kind::reg:
+        return register_value(ctx, static_cast<unsigned>(p.value));
+    case piece::kind::optimized_out:
+        break;
+    }
+
+    return tl::make_unexpected(error::dwarf_expr::optimized_out);
+}
+
+auto read_pieces(
+    const std::vector<piece>& pieces,
+    const context& ctx,
+    std::byte* buffer,
+    std::size_t size
+) -> tl::expected<void, error::dwarf_expr> {
+    std::vector<target::memory_request> requests;
+    std::size_t offset = 0;
+
+    for(const auto& p : pieces) {
+        if(offset >= size) {
+            break;
+        }
+
+        const std::size_t piece_size = p.size == 0 ? size - offset
+                                                   : std::min(p.size, size - offset);
+        std::byte* out = buffer + offset;
+
+        switch(p.k) {
+        case piece::kind::memory:
+            requests.push_back({p.value, out, piece_size});
+            break;
+        case piece::kind::reg: {
+            const auto result = read_register_bytes(ctx, static_cast<unsigned>(p.value), out, piece_size);
+            if(!result) {
+                return result;
+            }
+            break;
+        }
+        case piece::kind::value:
+            std::memset(out, 0, piece_size);
+            std::memcpy(out, &p.value, std::min(piece_size, sizeof(p.value)));
+            break;
+        case piece::kind::optimized_out:
+            return tl::make_unexpected(error::dwarf_expr::optimized_out);
+        }
+
+        offset += piece_size;
+    }
+
+    if(!requests.empty() &&
+       !ctx.debugee.read_memory_scatter(requests.data(), requests.size())) {
+        return tl::make_unexpected(error::dwarf_expr::memory_read_fail);
+    }
+
+    return {};
+}
+
+}
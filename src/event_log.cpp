@@ -0,0 +1,232 @@
+#include "nkgt/event_log.hpp"
+#include "nkgt/error_codes.hpp"
+#include "nkgt/util.hpp"
+
+#include <tl/expected.hpp>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <map>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utility>
+
+namespace {
+
+using nkgt::event_log::event;
+
+constexpr std::array<char, 8> magic = {'N', 'K', 'G', 'T', 'L', 'O', 'G', '\0'};
+constexpr uint32_t version = 1;
+
+constexpr std::array<std::string_view, nkgt::event_log::event_count> event_names = {
+    "breakpoint",
+    "skipped",
+    "timer",
+    "library",
+    "signal",
+    "exit",
+    "registers",
+};
+
+[[nodiscard]]
+auto round_up_to_power_of_two(uint64_t value) -> uint64_t {
+    uint64_t result = 1;
+    while(result < value) {
+        result <<= 1;
+    }
+
+    return result;
+}
+
+}
+
+namespace nkgt::event_log {
+
+writer::~writer() {
+    if(mapping_ != nullptr) {
+        munmap(mapping_, size_);
+    }
+}
+
+auto writer::append_registers(uint64_t time_ns, pid_t thread, const user_regs_struct& regs) -> void {
+    std::array<uint64_t, register_records * record_values> words = {};
+    std::memcpy(words.data(), &regs, sizeof(regs));
+
+    for(std::size_t part = 0; part < register_records; ++part) {
+        record r = {time_ns, event::registers, static_cast<uint16_t>(part), static_cast<uint32_t>(thread), regs.rip, {}};
+        std::copy_n(words.cbegin() + static_cast<std::ptrdiff_t>(part * record_values), record_values, r.values.begin());
+        append(r);
+    }
+}
+
+auto create(
+    const std::filesystem::path& path,
+    uint64_t capacity
+) -> tl::expected<std::unique_ptr<writer>, error::event_log> {
+    capacity = round_up_to_power_of_two(std::max<uint64_t>(capacity, register_records));
+
+    const int fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if(fd == -1) {
+        util::print_error_message("open", errno);
+        return tl::make_unexpected(error::event_log::open_fail);
+    }
+
+    const std::size_t size = sizeof(file_header) + capacity * sizeof(record);
+    if(ftruncate(fd, static_cast<off_t>(size)) == -1) {
+        util::print_error_message("ftruncate", errno);
+        close(fd);
+        return tl::make_unexpected(error::event_log::open_fail);
+    }
+
+    void* mapping = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    // The mapping keeps its own reference to the file.
+    close(fd);
+
+    if(mapping == MAP_FAILED) {
+        util::print_error_message("mmap", errno);
+        return tl::make_unexpected(error::event_log::map_fail);
+    }
+
+    std::unique_ptr<writer> w(new writer());
+    w->path_ = path;
+    w->mapping_ = mapping;
+    w->size_ = size;
+    w->header_ = static_cast<file_header*>(mapping);
+    w->records_ = reinterpret_cast<record*>(static_cast<std::byte*>(mapping) + sizeof(file_header));
+    *w->header_ = {magic, version, sizeof(record), capacity, 0, {}};
+
+    return w;
+}
+
+auto read(const std::filesystem::path& path) -> tl::expected<contents, error::event_log> {
+    const int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if(fd == -1) {
+        util::print_error_message("open", errno);
+        return tl::make_unexpected(error::event_log::open_fail);
+    }
+
+    struct stat info;
+    if(fstat(fd, &info) == -1) {
+        util::print_error_message("fstat", errno);
+        close(fd);
+        return tl::make_unexpected(error::event_log::open_fail);
+    }
+
+    const auto size = static_cast<std::size_t>(info.st_size);
+    if(size < sizeof(file_header)) {
+        close(fd);
+        return tl::make_unexpected(error::event_log::invalid_format);
+    }
+
+    void* mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if(mapping == MAP_FAILED) {
+        util::print_error_message("mmap", errno);
+        return tl::make_unexpected(error::event_log::map_fail);
+    }
+
+    const auto* data = static_cast<const std::byte*>(mapping);
+    file_header header;
+    std::memcpy(&header, data, sizeof(header));
+
+    const bool valid = header.magic == magic &&
+                       header.version == version &&
+                       header.record_size == sizeof(record) &&
+                       header.capacity != 0 &&
+                       (header.capacity & (header.capacity - 1)) == 0 &&
+                       header.capacity <= (size - sizeof(file_header)) / sizeof(record);
+
+    if(!valid) {
+        munmap(mapping, size);
+        return tl::make_unexpected(error::event_log::invalid_format);
+    }
+
+    contents result = {header.capacity, header.written, {}};
+    const uint64_t count = std::min(header.written, header.capacity);
+    const uint64_t first = header.written - count;
+    result.records.resize(count);
+
+    // The records are in a ring, the oldest one is at first % capacity.
+    const auto* records = data + sizeof(file_header);
+    const uint64_t start = first & (header.capacity - 1);
+    const uint64_t head = std::min(count, header.capacity - start);
+    std::memcpy(result.records.data(), records + start * sizeof(record), head * sizeof(record));
+    std::memcpy(result.records.data() + head, records, (count - head) * sizeof(record));
+
+    munmap(mapping, size);
+    return result;
+}
+
+auto snapshot_registers(const record* first, std::size_t count) -> std::optional<user_regs_struct> {
+    if(count < register_records) {
+        return std::nullopt;
+    }
+
+    std::array<uint64_t, register_records * record_values> words = {};
+    for(std::size_t part = 0; part < register_records; ++part) {
+        if(first[part].type != event::registers || first[part].part != part) {
+            return std::nullopt;
+        }
+
+        std::copy(first[part].values.cbegin(), first[part].values.cend(), words.begin() + static_cast<std::ptrdiff_t>(part * record_values));
+    }
+
+    user_regs_struct regs;
+    std::memcpy(&regs, words.data(), sizeof(regs));
+    return regs;
+}
+
+auto to_string(event e) -> std::string_view {
+    const auto index = static_cast<std::size_t>(e);
+    return index < event_names.size() ? event_names[index] : "unknown";
+}
+
+auto from_string(std::string_view name) -> std::optional<event> {
+    const auto* it = std::find(event_names.cbegin(), event_names.cend(), name);
+    if(it == event_names.cend()) {
+        return std::nullopt;
+    }
+
+    return static_cast<event>(it - event_names.cbegin());
+}
+
+auto summarize(const std::vector<record>& records) -> std::vector<summary> {
+    std::map<std::pair<event, uint64_t>, summary> groups;
+
+    for(const auto& r : records) {
+        if(r.type == event::registers) {
+            continue;
+        }
+
+        const summary empty = {r.type, r.address, 0, r.time_ns, 0, 0, 0};
+        auto& s = groups.try_emplace({r.type, r.address}, empty).first->second;
+        s.count += 1;
+        s.last_ns = r.time_ns;
+
+        if(r.type == event::breakpoint || r.type == event::skipped || r.type == event::timer) {
+            s.total_run_ns += r.values[0];
+        }
+
+        if(r.type == event::skipped) {
+            s.total_condition_ns += r.values[1];
+        }
+    }
+
+    std::vector<summary> result;
+    result.reserve(groups.size());
+    for(auto& [_, s] : groups) {
+        result.push_back(s);
+    }
+
+    std::stable_sort(result.begin(), result.end(), [](const auto& a, const auto& b) {
+        return a.count > b.count;
+    });
+
+    return result;
+}
+
+}
@@ -0,0 +1,92 @@
+#include "nkgt/function_timer.hpp"
+
+namespace nkgt::function_timer {
+
+auto timer::enter(
+    pid_t thread,
+    std::uintptr_t return_address,
+    std::uintptr_t stack_pointer,
+    const timestamp& now
+) -> bool {
+    calls_[thread].push_back({return_address, stack_pointer, now});
+    return return_addresses_[return_address]++ == 0;
+}
+
+auto timer::leave(
+    pid_t thread,
+    std::uintptr_t address,
+    std::uintptr_t stack_pointer,
+    const timestamp& now,
+    uint64_t trap_cost_ns
+) -> std::vector<std::uintptr_t> {
+    std::vector<std::uintptr_t> released;
+
+    const auto it = calls_.find(thread);
+    if(it == calls_.end()) {
+        return released;
+    }
+
+    auto& stack = it->second;
+
+    // The stack grows down: a frame whose return address lies below the
+    // current stack pointer has been discarded without returning.
+    while(!stack.empty() && stack.back().stack_pointer + sizeof(std::uintptr_t) < stack_pointer) {
+        release(stack.back(), released);
+        stack.pop_back();
+        dropped_ += 1;
+    }
+
+    // The code at a return address can also be reached without returning
+    // there, e.g. by a loop in the caller.
+    if(stack.empty() ||
+       stack.back().return_address != address ||
+       stack.back().stack_pointer + sizeof(std::uintptr_t) != stack_pointer) {
+        return released;
+    }
+
+    const frame& f = stack.back();
+    const uint64_t elapsed = now.now_ns - f.start.now_ns;
+    const uint64_t overhead = (now.stopped_ns - f.start.stopped_ns) +
+                              (now.stops - f.start.stops) * trap_cost_ns;
+    latency_.record(elapsed > overhead ? elapsed - overhead : 0);
+
+    release(f, released);
+    stack.pop_back();
+
+    if(stack.empty()) {
+        calls_.erase(it);
+    }
+
+    return released;
+}
+
+auto timer::clear_calls() -> std::vector<std::uintptr_t> {
+    std::vector<std::uintptr_t> released;
+    released.reserve(return_addresses_.size());
+
+    for(const auto& [address, _] : return_addresses_) {
+        released.push_back(address);
+    }
+
+    for(const auto& [_, stack] : calls_) {
+        dropped_ += stack.size();
+    }
+
+    calls_.clear();
+    return_addresses_.clear();
+    return released;
+}
+
+auto timer::release(const frame& f, std::vector<std::uintptr_t>& released) -> void {
+    const auto it = return_addresses_.find(f.return_address);
+    if(it == return_addresses_.end()) {
+        return;
+    }
+
+    if(--it->second == 0) {
+        return_addresses_.erase(it);
+        released.push_back(f.return_address);
+    }
+}
+
+}
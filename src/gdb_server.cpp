@@ -0,0 +1,1433 @@
+#include "nkgt/gdb_server.hpp"
+#include "nkgt/debugger.hpp"
+#include "nkgt/error_codes.hpp"
+#include "nkgt/registers.hpp"
+#include "nkgt/target.hpp"
+#include "nkgt/util.hpp"
+#include "nkgt/vector_registers.hpp"
+
+#include <fmt/core.h>
+#include <tl/expected.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <charconv>
+#include <csignal>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/ptrace.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/user.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace {
+
+using nkgt::registers::reg;
+using nkgt::registers::vector_kind;
+
+// Largest packet the client may send us, advertised in qSupported.
+constexpr std::size_t packet_size = 0x4000;
+
+// Where the value of a register of the g packet comes from.
+enum class source {
+    general,  // user_regs_struct, through the register layer
+    st,       // x87 stack register
+    xmm,      // SSE register
+    fxsave,   // field of the FXSAVE area
+    tag,      // x87 tag word, rebuilt from the abridged one of FXSAVE
+};
+
+struct gdb_register {
+    std::string_view name;
+    std::string_view feature;
+    std::string_view type;
+    std::string_view group;
+    // Size in the g packet.
+    std::size_t size;
+    source from;
+    reg r;
+    // Index of st and xmm registers, offset in the FXSAVE area of the others.
+    std::size_t index;
+    // Bytes taken in the FXSAVE area, when smaller than size.
+    std::size_t width;
+};
+
+#define NKGT_GDB_GENERAL(name, feature, type, size) \
+    gdb_register{#name, feature, type, "", size, source::general, reg::name, 0, 0}
+#define NKGT_GDB_ST(i) \
+    gdb_register{"st" #i, "core", "i387_ext", "float", 10, source::st, reg::rax, i, 0}
+#define NKGT_GDB_FXSAVE(name, offset, width) \
+    gdb_register{#name, "core", "int", "float", 4, source::fxsave, reg::rax, offset, width}
+#define NKGT_GDB_XMM(i) \
+    gdb_register{"xmm" #i, "sse", "vec128", "vector", 16, source::xmm, reg::rax, i, 0}
+
+// Registers in the order of the g packet, which is the one of the amd64 Linux
+// target description of GDB.
+constexpr gdb_register gdb_registers[] = {
+    NKGT_GDB_GENERAL(rax, "core", "int64", 8),
+    NKGT_GDB_GENERAL(rbx, "core", "int64", 8),
+    NKGT_GDB_GENERAL(rcx, "core", "int64", 8),
+    NKGT_GDB_GENERAL(rdx, "core", "int64", 8),
+    NKGT_GDB_GENERAL(rsi, "core", "int64", 8),
+    NKGT_GDB_GENERAL(rdi, "core", "int64", 8),
+    NKGT_GDB_GENERAL(rbp, "core", "data_ptr", 8),
+    NKGT_GDB_GENERAL(rsp, "core", "data_ptr", 8),
+    NKGT_GDB_GENERAL(r8,  "core", "int64", 8),
+    NKGT_GDB_GENERAL(r9,  "core", "int64", 8),
+    NKGT_GDB_GENERAL(r10, "core", "int64", 8),
+    NKGT_GDB_GENERAL(r11, "core", "int64", 8),
+    NKGT_GDB_GENERAL(r12, "core", "int64", 8),
+    NKGT_GDB_GENERAL(r13, "core", "int64", 8),
+    NKGT_GDB_GENERAL(r14, "core", "int64", 8),
+    NKGT_GDB_GENERAL(r15, "core", "int64", 8),
+    NKGT_GDB_GENERAL(rip, "core", "code_ptr", 8),
+    NKGT_GDB_GENERAL(eflags, "core", "int32", 4),
+    NKGT_GDB_GENERAL(cs, "core", "int32", 4),
+    NKGT_GDB_GENERAL(ss, "core", "int32", 4),
+    NKGT_GDB_GENERAL(ds, "core", "int32", 4),
+    NKGT_GDB_GENERAL(es, "core", "int32", 4),
+    NKGT_GDB_GENERAL(fs, "core", "int32", 4),
+    NKGT_GDB_GENERAL(gs, "core", "int32", 4),
+    NKGT_GDB_ST(0), NKGT_GDB_ST(1), NKGT_GDB_ST(2), NKGT_GDB_ST(3),
+    NKGT_GDB_ST(4), NKGT_GDB_ST(5), NKGT_GDB_ST(6), NKGT_GDB_ST(7),
+    NKGT_GDB_FXSAVE(fctrl, 0, 2),
+    NKGT_GDB_FXSAVE(fstat, 2, 2),
+    gdb_register{"ftag", "core", "int", "float", 4, source::tag, reg::rax, 4, 1},
+    NKGT_GDB_FXSAVE(fiseg, 12, 4),
+    NKGT_GDB_FXSAVE(fioff, 8, 4),
+    NKGT_GDB_FXSAVE(foseg, 20, 4),
+    NKGT_GDB_FXSAVE(fooff, 16, 4),
+    NKGT_GDB_FXSAVE(fop, 6, 2),
+    NKGT_GDB_XMM(0),  NKGT_GDB_XMM(1),  NKGT_GDB_XMM(2),  NKGT_GDB_XMM(3),
+    NKGT_GDB_XMM(4),  NKGT_GDB_XMM(5),  NKGT_GDB_XMM(6),  NKGT_GDB_XMM(7),
+    NKGT_GDB_XMM(8),  NKGT_GDB_XMM(9),  NKGT_GDB_XMM(10), NKGT_GDB_XMM(11),
+    NKGT_GDB_XMM(12), NKGT_GDB_XMM(13), NKGT_GDB_XMM(14), NKGT_GDB_XMM(15),
+    gdb_register{"mxcsr", "sse", "int", "vector", 4, source::fxsave, reg::rax, 24, 4},
+    NKGT_GDB_GENERAL(orig_rax, "linux", "int", 8),
+    NKGT_GDB_GENERAL(fs_base, "segments", "int", 8),
+    NKGT_GDB_GENERAL(gs_base, "segments", "int", 8),
+};
+
+#undef NKGT_GDB_GENERAL
+#undef NKGT_GDB_ST
+#undef NKGT_GDB_FXSAVE
+#undef NKGT_GDB_XMM
+
+constexpr std::size_t gdb_register_count = std::size(gdb_registers);
+
+// Numbers of the registers sent along with every stop reply, so that the
+// client does not need to ask for the whole register file to show where the
+// debugee stopped.
+constexpr std::size_t rbp_number = 6;
+constexpr std::size_t rsp_number = 7;
+constexpr std::size_t rip_number = 16;
+
+constexpr std::size_t fxsave_st_offset = 32;
+constexpr std::size_t fxsave_size = 512;
+
+// GDB has its own numbering of the signals, which only partially matches the
+// Linux one.
+struct signal_number {
+    int host;
+    int gdb;
+};
+
+constexpr signal_number signal_numbers[] = {
+    {SIGHUP, 1},     {SIGINT, 2},     {SIGQUIT, 3},    {SIGILL, 4},
+    {SIGTRAP, 5},    {SIGABRT, 6},    {SIGFPE, 8},     {SIGKILL, 9},
+    {SIGBUS, 10},    {SIGSEGV, 11},   {SIGSYS, 12},    {SIGPIPE, 13},
+    {SIGALRM, 14},   {SIGTERM, 15},   {SIGURG, 16},    {SIGSTOP, 17},
+    {SIGTSTP, 18},   {SIGCONT, 19},   {SIGCHLD, 20},   {SIGTTIN, 21},
+    {SIGTTOU, 22},   {SIGIO, 23},     {SIGXCPU, 24},   {SIGXFSZ, 25},
+    {SIGVTALRM, 26}, {SIGPROF, 27},   {SIGWINCH, 28},  {SIGUSR1, 30},
+    {SIGUSR2, 31},   {SIGPWR, 32},
+};
+
+// GDB_SIGNAL_UNKNOWN.
+constexpr int unknown_gdb_signal = 143;
+
+auto to_gdb_signal(int host) -> int {
+    for(const auto& s : signal_numbers) {
+        if(s.host == host) {
+            return s.gdb;
+        }
+    }
+
+    return unknown_gdb_signal;
+}
+
+auto to_host_signal(int gdb) -> int {
+    for(const auto& s : signal_numbers) {
+        if(s.gdb == gdb) {
+            return s.host;
+        }
+    }
+
+    return 0;
+}
+
+constexpr char hex_digits[] = "0123456789abcdef";
+
+auto append_hex(const void* data, std::size_t size, std::string& out) -> void {
+    const auto* bytes = static_cast<const uint8_t*>(data);
+
+    for(std::size_t i = 0; i < size; ++i) {
+        out += hex_digits[bytes[i] >> 4];
+        out += hex_digits[bytes[i] & 0xf];
+    }
+}
+
+auto hex_value(char c) -> int {
+    if(c >= '0' && c <= '9') {
+        return c - '0';
+    }
+
+    if(c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+
+    if(c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+
+    return -1;
+}
+
+[[nodiscard]]
+auto decode_hex(std::string_view hex, std::vector<uint8_t>& out) -> bool {
+    if(hex.size() % 2 != 0) {
+        return false;
+    }
+
+    out.resize(hex.size() / 2);
+    for(std::size_t i = 0; i < out.size(); ++i) {
+        const int high = hex_value(hex[2 * i]);
+        const int low = hex_value(hex[2 * i + 1]);
+
+        if(high < 0 || low < 0) {
+            return false;
+        }
+
+        out[i] = static_cast<uint8_t>((high << 4) | low);
+    }
+
+    return true;
+}
+
+template<typename T>
+[[nodiscard]]
+auto parse_hex(std::string_view text) -> std::optional<T> {
+    T value = 0;
+    const auto [end, ec] = std::from_chars(text.data(), text.data() + text.size(), value, 16);
+
+    if(ec != std::errc() || end != text.data() + text.size()) {
+        return std::nullopt;
+    }
+
+    return value;
+}
+
+// Splits "address,length" as found in memory and breakpoint packets.
+[[nodiscard]]
+auto parse_range(std::string_view text) -> std::optional<std::pair<uint64_t, std::size_t>> {
+    const auto comma = text.find(',');
+    if(comma == std::string_view::npos) {
+        return std::nullopt;
+    }
+
+    const auto address = parse_hex<uint64_t>(text.substr(0, comma));
+    const auto length = parse_hex<std::size_t>(text.substr(comma + 1));
+    if(!address || !length) {
+        return std::nullopt;
+    }
+
+    return std::make_pair(*address, *length);
+}
+
+// Rebuilds the full x87 tag word, 2 bits per physical register, from the
+// abridged one FXSAVE stores, 1 bit per register telling if it is empty.
+auto full_tag_word(const std::byte* fxsave) -> uint32_t {
+    uint16_t status = 0;
+    std::memcpy(&status, fxsave + 2, sizeof(status));
+    const auto abridged = static_cast<unsigned>(fxsave[4]);
+    const unsigned top = (status >> 11) & 7;
+
+    uint32_t tag = 0;
+    for(unsigned physical = 0; physical < 8; ++physical) {
+        // Empty.
+        uint32_t t = 3;
+
+        if(abridged & (1u << physical)) {
+            const std::byte* st = fxsave + fxsave_st_offset + 16 * ((physical - top) & 7);
+            uint64_t mantissa = 0;
+            uint16_t exponent = 0;
+            std::memcpy(&mantissa, st, sizeof(mantissa));
+            std::memcpy(&exponent, st + 8, sizeof(exponent));
+            exponent &= 0x7fff;
+
+            if(exponent == 0x7fff) {
+                t = 2;
+            } else if(exponent == 0) {
+                t = mantissa == 0 ? 1 : 2;
+            } else {
+                t = (mantissa >> 63) != 0 ? 0 : 2;
+            }
+        }
+
+        tag |= t << (2 * physical);
+    }
+
+    return tag;
+}
+
+auto build_target_description() -> std::string {
+    std::string xml =
+        "<?xml version=\"1.0\"?>\n"
+        "<!DOCTYPE target SYSTEM \"gdb-target.dtd\">\n"
+        "<target version=\"1.0\">\n"
+        "  <architecture>i386:x86-64</architecture>\n"
+        "  <osabi>GNU/Linux</osabi>\n";
+
+    std::string_view feature;
+    for(const auto& r : gdb_registers) {
+        if(r.feature != feature) {
+            if(!feature.empty()) {
+                xml += "  </feature>\n";
+            }
+
+            feature = r.feature;
+            xml += fmt::format("  <feature name=\"org.gnu.gdb.i386.{}\">\n", feature);
+
+            if(feature == "sse") {
+                xml +=
+                    "    <vector id=\"v4f\" type=\"ieee_single\" count=\"4\"/>\n"
+                    "    <vector id=\"v2d\" type=\"ieee_double\" count=\"2\"/>\n"
+                    "    <vector id=\"v16i8\" type=\"int8\" count=\"16\"/>\n"
+                    "    <vector id=\"v8i16\" type=\"int16\" count=\"8\"/>\n"
+                    "    <vector id=\"v4i32\" type=\"int32\" count=\"4\"/>\n"
+                    "    <vector id=\"v2i64\" type=\"int64\" count=\"2\"/>\n"
+                    "    <union id=\"vec128\">\n"
+                    "      <field name=\"v4_float\" type=\"v4f\"/>\n"
+                    "      <field name=\"v2_double\" type=\"v2d\"/>\n"
+                    "      <field name=\"v16_int8\" type=\"v16i8\"/>\n"
+                    "      <field name=\"v8_int16\" type=\"v8i16\"/>\n"
+                    "      <field name=\"v4_int32\" type=\"v4i32\"/>\n"
+                    "      <field name=\"v2_int64\" type=\"v2i64\"/>\n"
+                    "      <field name=\"uint128\" type=\"uint128\"/>\n"
+                    "    </union>\n";
+            }
+        }
+
+        xml += fmt::format(
+            "    <reg name=\"{}\" bitsize=\"{}\" type=\"{}\"{}/>\n",
+            r.name,
+            r.size * 8,
+            r.type,
+            r.group.empty() ? std::string() : fmt::format(" group=\"{}\"", r.group)
+        );
+    }
+
+    xml += "  </feature>\n</target>\n";
+    return xml;
+}
+
+// Contents of /proc/pid/<name>, for the qXfer objects that are simply files.
+auto read_proc_file(pid_t pid, const char* name) -> std::string {
+    std::ifstream file(fmt::format("/proc/{}/{}", pid, name), std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+// Hardware watchpoint slots, the x86 debug registers DR0-DR3.
+constexpr std::size_t watchpoint_slots = 4;
+
+auto debug_register_offset(std::size_t i) -> std::size_t {
+    return offsetof(struct user, u_debugreg) + i * sizeof(user::u_debugreg[0]);
+}
+
+class server {
+public:
+    server(int socket, int signal_fd, pid_t pid)
+        : socket_(socket), signal_fd_(signal_fd), pid_(pid), debugee_(pid) {
+        last_stop_ = stop_reply(SIGTRAP);
+    }
+
+    auto run() -> void {
+        std::array<char, packet_size> buffer;
+
+        while(!done_) {
+            // Everything that has been received is handled before replying,
+            // so that pipelined requests are answered with a single write.
+            while(!done_) {
+                auto e = pending_.empty() ? reader_.next() : take_pending();
+                if(!e) {
+                    break;
+                }
+
+                handle_event(*e);
+            }
+
+            if(!flush() || done_) {
+                return;
+            }
+
+            const ssize_t size = read(socket_, buffer.data(), buffer.size());
+            if(size <= 0) {
+                return;
+            }
+
+            reader_.feed(buffer.data(), static_cast<std::size_t>(size));
+        }
+    }
+
+private:
+    auto take_pending() -> std::optional<nkgt::gdb_server::event> {
+        auto e = std::move(pending_.front());
+        pending_.erase(pending_.begin());
+        return e;
+    }
+
+    auto handle_event(const nkgt::gdb_server::event& e) -> void {
+        using kind = nkgt::gdb_server::event::kind;
+
+        switch(e.k) {
+        case kind::packet:
+            if(ack_mode_) {
+                output_ += '+';
+            }
+
+            handle_packet(e.payload);
+            return;
+        case kind::nack:
+            output_ += last_packet_;
+            return;
+        case kind::corrupted:
+            if(ack_mode_) {
+                output_ += '-';
+            }
+            return;
+        case kind::ack:
+        case kind::interrupt:
+            return;
+        }
+    }
+
+    auto reply(std::string_view payload) -> void {
+        last_packet_.clear();
+        nkgt::gdb_server::append_packet(payload, last_packet_);
+        output_ += last_packet_;
+    }
+
+    [[nodiscard]]
+    auto flush() -> bool {
+        std::size_t written = 0;
+
+        while(written < output_.size()) {
+            const ssize_t result = write(socket_, output_.data() + written, output_.size() - written);
+
+            if(result < 0 && errno == EINTR) {
+                continue;
+            }
+
+            if(result <= 0) {
+                return false;
+            }
+
+            written += static_cast<std::size_t>(result);
+        }
+
+        output_.clear();
+        return true;
+    }
+
+    auto handle_packet(std::string_view p) -> void {
+        if(p.empty()) {
+            reply("");
+            return;
+        }
+
+        const std::string_view args = p.substr(1);
+
+        switch(p[0]) {
+        case '?':
+            reply(last_stop_);
+            return;
+        case 'g':
+            read_all_registers();
+            return;
+        case 'G':
+            write_all_registers(args);
+            return;
+        case 'p':
+            read_one_register(args);
+            return;
+        case 'P':
+            write_one_register(args);
+            return;
+        case 'm':
+        case 'x':
+            read_memory(args, p[0] == 'x');
+            return;
+        case 'M':
+        case 'X':
+            write_memory(args, p[0] == 'X');
+            return;
+        case 'Z':
+        case 'z':
+            handle_breakpoint(args, p[0] == 'Z');
+            return;
+        case 'c':
+            resume(false, 0);
+            return;
+        case 's':
+            resume(true, 0);
+            return;
+        case 'C':
+        case 'S': {
+            const auto gdb_signal = parse_hex<int>(args.substr(0, args.find(';')));
+            resume(p[0] == 'S', gdb_signal ? to_host_signal(*gdb_signal) : 0);
+            return;
+        }
+        case 'H':
+        case 'T':
+            // There is a single thread.
+            reply("OK");
+            return;
+        case 'D':
+            detach();
+            return;
+        case 'k':
+            kill_debugee();
+            return;
+        case 'q':
+        case 'Q':
+            handle_query(p);
+            return;
+        case 'v':
+            handle_v_packet(p);
+            return;
+        default:
+            reply("");
+            return;
+        }
+    }
+
+    auto handle_query(std::string_view p) -> void {
+        if(nkgt::util::is_prefix("qSupported", p)) {
+            reply(fmt::format(
+                "PacketSize={:x};QStartNoAckMode+;qXfer:features:read+;qXfer:auxv:read+;"
+                "qXfer:exec-file:read+;binary-upload+;vContSupported+",
+                packet_size
+            ));
+        } else if(p == "QStartNoAckMode") {
+            reply("OK");
+            ack_mode_ = false;
+        } else if(nkgt::util::is_prefix("qXfer:", p)) {
+            handle_xfer(p.substr(6));
+        } else if(p == "qAttached") {
+            // We started the debugee, so the client kills it when it quits.
+            reply("0");
+        } else if(p == "qC") {
+            reply(fmt::format("QC{:x}", pid_));
+        } else if(p == "qfThreadInfo") {
+            reply(fmt::format("m{:x}", pid_));
+        } else if(p == "qsThreadInfo") {
+            reply("l");
+        } else {
+            reply("");
+        }
+    }
+
+    // object:read:annex:offset,length
+    auto handle_xfer(std::string_view p) -> void {
+        // The annex can be empty, so util::split() cannot be used.
+        std::array<std::string_view, 4> parts;
+        for(std::size_t i = 0; i < parts.size() - 1; ++i) {
+            const auto colon = p.find(':');
+            if(colon == std::string_view::npos) {
+                reply("");
+                return;
+            }
+
+            parts[i] = p.substr(0, colon);
+            p.remove_prefix(colon + 1);
+        }
+        parts[3] = p;
+
+        if(parts[1] != "read") {
+            reply("");
+            return;
+        }
+
+        const auto range = parse_range(parts[3]);
+        if(!range) {
+            reply("E00");
+            return;
+        }
+
+        std::string data;
+        if(parts[0] == "features" && parts[2] == "target.xml") {
+            data = nkgt::gdb_server::target_description();
+        } else if(parts[0] == "auxv") {
+            data = read_proc_file(pid_, "auxv");
+        } else if(parts[0] == "exec-file") {
+            std::error_code ec;
+            data = std::filesystem::read_symlink(fmt::format("/proc/{}/exe", pid_), ec).string();
+        } else {
+            reply("E00");
+            return;
+        }
+
+        const auto [offset, length] = *range;
+        if(offset >= data.size()) {
+            reply("l");
+            return;
+        }
+
+        const std::string_view chunk = std::string_view(data).substr(offset, length);
+        const bool last = offset + chunk.size() >= data.size();
+        reply((last ? "l" : "m") + std::string(chunk));
+    }
+
+    auto handle_v_packet(std::string_view p) -> void {
+        if(p == "vCont?") {
+            reply("vCont;c;C;s;S");
+        } else if(nkgt::util::is_prefix("vCont;", p)) {
+            // All-stop with a single thread: the first action is the one for
+            // the whole process, the thread ids can be ignored.
+            std::string_view action = p.substr(6);
+            action = action.substr(0, action.find(';'));
+            action = action.substr(0, action.find(':'));
+
+            if(action.empty()) {
+                reply("E00");
+                return;
+            }
+
+            int signal = 0;
+            if(action[0] == 'C' || action[0] == 'S') {
+                signal = to_host_signal(parse_hex<int>(action.substr(1)).value_or(0));
+            }
+
+            resume(action[0] == 's' || action[0] == 'S', signal);
+        } else if(nkgt::util::is_prefix("vKill", p)) {
+            kill_debugee();
+            reply("OK");
+        } else {
+            reply("");
+        }
+    }
+
+    // Fills out with the value of r as it appears in the g packet. Returns
+    // false when the register cannot be read.
+    [[nodiscard]]
+    auto register_bytes(
+        const gdb_register& r,
+        const user_regs_struct& regs,
+        std::array<std::byte, 16>& out
+    ) -> bool {
+        out = {};
+
+        if(r.from == source::general) {
+            const uint64_t value = nkgt::registers::get_register_value(regs, r.r);
+            std::memcpy(out.data(), &value, r.size);
+            return true;
+        }
+
+        if(r.from == source::st || r.from == source::xmm) {
+            const auto kind = r.from == source::st ? vector_kind::st : vector_kind::xmm;
+            const auto value = nkgt::registers::get_vector_register_value(
+                debugee_,
+                {kind, static_cast<unsigned>(r.index)}
+            );
+
+            if(!value) {
+                return false;
+            }
+
+            std::memcpy(out.data(), value->bytes.data(), r.size);
+            return true;
+        }
+
+        const auto state = debugee_.read_extended_state();
+        if(!state || (*state)->data.size() < fxsave_size) {
+            return false;
+        }
+
+        const std::byte* fxsave = (*state)->data.data();
+        if(r.from == source::tag) {
+            const uint32_t tag = full_tag_word(fxsave);
+            std::memcpy(out.data(), &tag, sizeof(tag));
+        } else {
+            std::memcpy(out.data(), fxsave + r.index, r.width);
+        }
+
+        // Only the low 11 bits of the FXSAVE fop are the opcode.
+        if(r.name == "fop") {
+            out[1] &= std::byte{0x07};
+        }
+
+        return true;
+    }
+
+    auto append_register(const gdb_register& r, const user_regs_struct& regs, std::string& out) -> void {
+        std::array<std::byte, 16> bytes;
+
+        if(register_bytes(r, regs, bytes)) {
+            append_hex(bytes.data(), r.size, out);
+        } else {
+            // Unavailable.
+            out.append(2 * r.size, 'x');
+        }
+    }
+
+    auto read_all_registers() -> void {
+        const auto regs = debugee_.read_registers();
+        if(!regs) {
+            reply("E01");
+            return;
+        }
+
+        std::string out;
+        for(const auto& r : gdb_registers) {
+            append_register(r, *regs, out);
+        }
+
+        reply(out);
+    }
+
+    // Only the general purpose registers can be written, the values of the
+    // others are ignored.
+    auto write_all_registers(std::string_view hex) -> void {
+        std::vector<uint8_t> bytes;
+        if(!decode_hex(hex, bytes)) {
+            reply("E00");
+            return;
+        }
+
+        std::array<reg, gdb_register_count> regs;
+        std::array<uint64_t, gdb_register_count> values;
+        std::size_t count = 0;
+        std::size_t offset = 0;
+
+        for(const auto& r : gdb_registers) {
+            if(offset + r.size > bytes.size()) {
+                break;
+            }
+
+            if(r.from == source::general) {
+                uint64_t value = 0;
+                std::memcpy(&value, bytes.data() + offset, r.size);
+                regs[count] = r.r;
+                values[count] = value;
+                ++count;
+            }
+
+            offset += r.size;
+        }
+
+        const auto result = nkgt::registers::write_registers(debugee_, regs.data(), values.data(), count);
+        reply(result ? "OK" : "E01");
+    }
+
+    auto read_one_register(std::string_view args) -> void {
+        const auto number = parse_hex<std::size_t>(args);
+        const auto regs = debugee_.read_registers();
+
+        if(!number || *number >= gdb_register_count || !regs) {
+            reply("E01");
+            return;
+        }
+
+        std::string out;
+        append_register(gdb_registers[*number], *regs, out);
+        reply(out);
+    }
+
+    auto write_one_register(std::string_view args) -> void {
+        const auto equal = args.find('=');
+        const auto number = parse_hex<std::size_t>(args.substr(0, std::min(equal, args.size())));
+
+        std::vector<uint8_t> bytes;
+        if(equal == std::string_view::npos || !number || *number >= gdb_register_count ||
+           !decode_hex(args.substr(equal + 1), bytes)) {
+            reply("E00");
+            return;
+        }
+
+        const gdb_register& r = gdb_registers[*number];
+        if(r.from != source::general || bytes.size() != r.size) {
+            reply("E01");
+            return;
+        }
+
+        uint64_t value = 0;
+        std::memcpy(&value, bytes.data(), r.size);
+
+        const auto result = nkgt::registers::set_register_value(debugee_, r.r, value);
+        reply(result ? "OK" : "E01");
+    }
+
+    // Reads as much as possible of [address, address + size) into
+    // memory_buffer_ and returns how many bytes it read. Our breakpoints are
+    // hidden: the client sees the original code.
+    auto read_original(uint64_t address, std::size_t size) -> std::size_t {
+        memory_buffer_.resize(size);
+        std::size_t done = 0;
+
+        if(debugee_.read_memory(address, memory_buffer_.data(), size)) {
+            done = size;
+        } else {
+            // The range crosses into unmapped memory, read a page at a time.
+            constexpr uint64_t page = 4096;
+
+            while(done < size) {
+                const uint64_t start = address + done;
+                const std::size_t chunk = std::min<std::size_t>(size - done, page - start % page);
+
+                if(!debugee_.read_memory(start, memory_buffer_.data() + done, chunk)) {
+                    break;
+                }
+
+                done += chunk;
+            }
+        }
+
+        for(const auto& [bp_address, bp] : breakpoints_) {
+            const auto bp_uaddress = static_cast<uint64_t>(bp_address);
+
+            if(bp.enabled && bp_uaddress >= address && bp_uaddress - address < done) {
+                memory_buffer_[bp_uaddress - address] = bp.saved_data;
+            }
+        }
+
+        return done;
+    }
+
+    auto read_memory(std::string_view args, bool binary) -> void {
+        const auto range = parse_range(args);
+        if(!range) {
+            reply("E00");
+            return;
+        }
+
+        const auto [address, length] = *range;
+        const std::size_t size = std::min(length, binary ? packet_size - 2 : (packet_size - 2) / 2);
+
+        const std::size_t done = read_original(address, size);
+        if(done == 0 && size != 0) {
+            reply("E14");
+            return;
+        }
+
+        std::string out;
+        if(binary) {
+            // Escaped when the packet is framed.
+            out += 'b';
+            out.append(reinterpret_cast<const char*>(memory_buffer_.data()), done);
+        } else {
+            append_hex(memory_buffer_.data(), done, out);
+        }
+
+        reply(out);
+    }
+
+    auto write_memory(std::string_view args, bool binary) -> void {
+        const auto colon = args.find(':');
+        const auto range = parse_range(args.substr(0, std::min(colon, args.size())));
+
+        if(colon == std::string_view::npos || !range) {
+            reply("E00");
+            return;
+        }
+
+        const auto [address, length] = *range;
+        const std::string_view data = args.substr(colon + 1);
+
+        std::vector<uint8_t> bytes;
+        if(binary) {
+            bytes.assign(data.begin(), data.end());
+        } else if(!decode_hex(data, bytes)) {
+            reply("E00");
+            return;
+        }
+
+        if(bytes.size() != length) {
+            reply("E00");
+            return;
+        }
+
+        if(length == 0) {
+            reply("OK");
+            return;
+        }
+
+        // Writes over one of our breakpoints change the byte it restores,
+        // the trap stays in place.
+        for(auto& [bp_address, bp] : breakpoints_) {
+            const auto bp_uaddress = static_cast<uint64_t>(bp_address);
+
+            if(bp.enabled && bp_uaddress >= address && bp_uaddress - address < length) {
+                bp.saved_data = bytes[bp_uaddress - address];
+                bytes[bp_uaddress - address] = 0xcc;
+            }
+        }
+
+        reply(debugee_.write_memory(address, bytes.data(), bytes.size()) ? "OK" : "E14");
+    }
+
+    // type,address,kind for Z and z packets.
+    auto handle_breakpoint(std::string_view args, bool insert) -> void {
+        const auto comma = args.find(',');
+        const auto range = comma == std::string_view::npos ? std::nullopt : parse_range(args.substr(comma + 1));
+
+        if(!range) {
+            reply("E00");
+            return;
+        }
+
+        const std::string_view type = args.substr(0, comma);
+        const auto [address, kind] = *range;
+
+        if(type == "0") {
+            reply(insert ? insert_breakpoint(address) : remove_breakpoint(address));
+        } else if(type == "2") {
+            reply(insert ? insert_watchpoint(address, kind) : remove_watchpoint(address, kind));
+        } else {
+            reply("");
+        }
+    }
+
+    auto insert_breakpoint(uint64_t address) -> const char* {
+        const auto key = static_cast<std::intptr_t>(address);
+        if(breakpoints_.count(key) != 0) {
+            return "OK";
+        }
+
+        nkgt::debugger::breakpoint bp = {pid_, key};
+        if(!nkgt::debugger::enable_breakpoint(bp)) {
+            return "E01";
+        }
+
+        breakpoints_.emplace(key, bp);
+        return "OK";
+    }
+
+    auto remove_breakpoint(uint64_t address) -> const char* {
+        const auto it = breakpoints_.find(static_cast<std::intptr_t>(address));
+        if(it == breakpoints_.end()) {
+            return "OK";
+        }
+
+        if(!nkgt::debugger::disable_breakpoint(it->second)) {
+            return "E01";
+        }
+
+        breakpoints_.erase(it);
+        return "OK";
+    }
+
+    [[nodiscard]]
+    auto poke_debug_register(std::size_t i, uint64_t value) -> bool {
+        return ptrace(PTRACE_POKEUSER, pid_, debug_register_offset(i), value) != -1;
+    }
+
+    // Write watchpoints use the debug registers: DR0-DR3 hold the addresses,
+    // DR7 enables them and sets their length.
+    auto insert_watchpoint(uint64_t address, std::size_t length) -> const char* {
+        uint64_t length_bits = 0;
+        switch(length) {
+        case 1: length_bits = 0b00; break;
+        case 2: length_bits = 0b01; break;
+        case 4: length_bits = 0b11; break;
+        case 8: length_bits = 0b10; break;
+        default: return "E01";
+        }
+
+        if(address % length != 0) {
+            return "E01";
+        }
+
+        const auto slot = std::find(watchpoints_.begin(), watchpoints_.end(), 0);
+        if(slot == watchpoints_.end()) {
+            return "E01";
+        }
+
+        const auto i = static_cast<std::size_t>(slot - watchpoints_.begin());
+        // Local enable, break on writes.
+        const uint64_t dr7 = dr7_ | (uint64_t{1} << (2 * i)) |
+                             (uint64_t{0b01} << (16 + 4 * i)) |
+                             (length_bits << (18 + 4 * i));
+
+        if(!poke_debug_register(i, address) || !poke_debug_register(7, dr7)) {
+            return "E01";
+        }
+
+        dr7_ = dr7;
+        *slot = address;
+        return "OK";
+    }
+
+    auto remove_watchpoint(uint64_t address, std::size_t) -> const char* {
+        const auto slot = std::find(watchpoints_.begin(), watchpoints_.end(), address);
+        if(address == 0 || slot == watchpoints_.end()) {
+            return "OK";
+        }
+
+        const auto i = static_cast<std::size_t>(slot - watchpoints_.begin());
+        const uint64_t dr7 = dr7_ & ~((uint64_t{0b11} << (2 * i)) | (uint64_t{0b1111} << (16 + 4 * i)));
+
+        if(!poke_debug_register(7, dr7)) {
+            return "E01";
+        }
+
+        dr7_ = dr7;
+        *slot = 0;
+        return "OK";
+    }
+
+    // Address of the watchpoint that stopped the debugee, if any. DR6 is
+    // cleared, as the CPU never does it.
+    auto triggered_watchpoint() -> std::optional<uint64_t> {
+        if(dr7_ == 0) {
+            return std::nullopt;
+        }
+
+        errno = 0;
+        const long dr6 = ptrace(PTRACE_PEEKUSER, pid_, debug_register_offset(6), nullptr);
+        if(dr6 == -1 && errno != 0) {
+            return std::nullopt;
+        }
+
+        (void)poke_debug_register(6, 0);
+
+        for(std::size_t i = 0; i < watchpoint_slots; ++i) {
+            if((static_cast<unsigned long>(dr6) & (1ul << i)) != 0 && watchpoints_[i] != 0) {
+                return watchpoints_[i];
+            }
+        }
+
+        return std::nullopt;
+    }
+
+    auto stop_reply(int signal) -> std::string {
+        std::string out = fmt::format("T{:02x}", to_gdb_signal(signal));
+
+        if(signal == SIGTRAP) {
+            if(const auto watch = triggered_watchpoint()) {
+                out += fmt::format("watch:{:x};", *watch);
+            }
+        }
+
+        if(const auto regs = debugee_.read_registers()) {
+            for(const std::size_t number : {rbp_number, rsp_number, rip_number}) {
+                out += fmt::format("{:02x}:", number);
+                append_register(gdb_registers[number], *regs, out);
+                out += ';';
+            }
+        }
+
+        out += fmt::format("thread:{:x};", pid_);
+        return out;
+    }
+
+    auto resume(bool step, int signal) -> void {
+        if(exited_) {
+            reply(last_stop_);
+            return;
+        }
+
+        const auto request = step ? PTRACE_SINGLESTEP : PTRACE_CONT;
+        if(ptrace(request, pid_, nullptr, signal) == -1) {
+            nkgt::util::print_error_message("ptrace", errno);
+            reply("E01");
+            return;
+        }
+
+        debugee_.invalidate_caches();
+
+        const auto status = wait_for_stop();
+        if(!status) {
+            // The client went away while the debugee was running.
+            done_ = true;
+            return;
+        }
+
+        if(WIFEXITED(*status)) {
+            exited_ = true;
+            last_stop_ = fmt::format("W{:02x}", WEXITSTATUS(*status));
+        } else if(WIFSIGNALED(*status)) {
+            exited_ = true;
+            last_stop_ = fmt::format("X{:02x}", to_gdb_signal(WTERMSIG(*status)));
+        } else {
+            last_stop_ = stop_reply(WSTOPSIG(*status));
+        }
+
+        reply(last_stop_);
+    }
+
+    // Waits for the debugee to stop while listening to the client, which can
+    // interrupt it. Returns nothing if the connection is lost.
+    auto wait_for_stop() -> std::optional<int> {
+        // The acknowledgement of the resume request must not wait for the
+        // debugee to stop.
+        if(!flush()) {
+            return std::nullopt;
+        }
+
+        std::array<char, packet_size> buffer;
+
+        for(;;) {
+            int status = 0;
+            const pid_t result = waitpid(pid_, &status, WNOHANG);
+
+            if(result == pid_) {
+                return status;
+            }
+
+            if(result == -1 && errno != EINTR) {
+                nkgt::util::print_error_message("waitpid", errno);
+                return std::nullopt;
+            }
+
+            // SIGCHLD is blocked and read through signal_fd_, so that both
+            // the debugee and the client can be waited for at once.
+            pollfd fds[2] = {{socket_, POLLIN, 0}, {signal_fd_, POLLIN, 0}};
+            if(poll(fds, 2, -1) == -1) {
+                if(errno == EINTR) {
+                    continue;
+                }
+
+                return std::nullopt;
+            }
+
+            if(fds[1].revents & POLLIN) {
+                signalfd_siginfo info;
+                while(read(signal_fd_, &info, sizeof(info)) > 0) {}
+            }
+
+            if(fds[0].revents & (POLLIN | POLLHUP | POLLERR)) {
+                const ssize_t size = read(socket_, buffer.data(), buffer.size());
+                if(size <= 0) {
+                    return std::nullopt;
+                }
+
+                reader_.feed(buffer.data(), static_cast<std::size_t>(size));
+
+                // Packets other than ^C are answered once the debugee stops.
+                while(auto e = reader_.next()) {
+                    if(e->k == nkgt::gdb_server::event::kind::interrupt) {
+                        kill(pid_, SIGINT);
+                    } else {
+                        pending_.push_back(std::move(*e));
+                    }
+                }
+            }
+        }
+    }
+
+    auto detach() -> void {
+        for(auto& [address, bp] : breakpoints_) {
+            (void)nkgt::debugger::disable_breakpoint(bp);
+        }
+
+        breakpoints_.clear();
+
+        if(dr7_ != 0) {
+            (void)poke_debug_register(7, 0);
+        }
+
+        const bool detached = exited_ || ptrace(PTRACE_DETACH, pid_, nullptr, nullptr) != -1;
+        reply(detached ? "OK" : "E01");
+        done_ = true;
+    }
+
+    auto kill_debugee() -> void {
+        if(!exited_) {
+            kill(pid_, SIGKILL);
+            waitpid(pid_, nullptr, 0);
+            exited_ = true;
+        }
+
+        done_ = true;
+    }
+
+    int socket_;
+    int signal_fd_;
+    pid_t pid_;
+    nkgt::target::ptrace_target debugee_;
+    std::unordered_map<std::intptr_t, nkgt::debugger::breakpoint> breakpoints_;
+    std::array<uint64_t, watchpoint_slots> watchpoints_ = {};
+    uint64_t dr7_ = 0;
+
+    nkgt::gdb_server::packet_reader reader_;
+    // Received while the debugee was running.
+    std::vector<nkgt::gdb_server::event> pending_;
+    std::string output_;
+    std::vector<uint8_t> memory_buffer_;
+    // Kept to be sent again if the client asks for it.
+    std::string last_packet_;
+    std::string last_stop_;
+    bool ack_mode_ = true;
+    bool exited_ = false;
+    bool done_ = false;
+};
+
+// Closes a file descriptor when going out of scope.
+class descriptor {
+public:
+    explicit descriptor(int fd) : fd_(fd) {}
+    descriptor(const descriptor&) = delete;
+    descriptor& operator=(const descriptor&) = delete;
+    ~descriptor() {
+        if(fd_ != -1) {
+            close(fd_);
+        }
+    }
+
+    [[nodiscard]]
+    auto get() const -> int { return fd_; }
+
+private:
+    int fd_;
+};
+
+// Accepts a single connection on address, see serve().
+auto accept_client(std::string_view address) -> tl::expected<int, nkgt::error::gdb_server> {
+    using nkgt::error::gdb_server;
+
+    const auto colon = address.rfind(':');
+    const bool tcp = colon != std::string_view::npos && address.find('/') == std::string_view::npos;
+
+    sockaddr_storage storage = {};
+    socklen_t length = 0;
+    std::string unix_path;
+
+    if(tcp) {
+        std::string host(address.substr(0, colon));
+        if(host.empty() || host == "localhost") {
+            host = "127.0.0.1";
+        }
+
+        uint16_t port_number = 0;
+        const std::string_view port_text = address.substr(colon + 1);
+        const auto [end, ec] = std::from_chars(port_text.data(), port_text.data() + port_text.size(), port_number);
+        if(ec != std::errc() || end != port_text.data() + port_text.size()) {
+            return tl::make_unexpected(gdb_server::invalid_address);
+        }
+
+        auto* in = reinterpret_cast<sockaddr_in*>(&storage);
+        in->sin_family = AF_INET;
+        in->sin_port = htons(port_number);
+        if(inet_pton(AF_INET, host.c_str(), &in->sin_addr) != 1 ||
+           (ntohl(in->sin_addr.s_addr) >> 24) != 127) {
+            return tl::make_unexpected(gdb_server::invalid_address);
+        }
+
+        length = sizeof(sockaddr_in);
+    } else {
+        auto* un = reinterpret_cast<sockaddr_un*>(&storage);
+        if(address.empty() || address.size() >= sizeof(un->sun_path)) {
+            return tl::make_unexpected(gdb_server::invalid_address);
+        }
+
+        unix_path = address;
+        un->sun_family = AF_UNIX;
+        std::memcpy(un->sun_path, unix_path.c_str(), unix_path.size() + 1);
+        length = sizeof(sockaddr_un);
+
+        // A socket left behind by a previous session.
+        struct stat st;
+        if(stat(unix_path.c_str(), &st) == 0 && S_ISSOCK(st.st_mode)) {
+            unlink(unix_path.c_str());
+        }
+    }
+
+    const descriptor listener(socket(storage.ss_family, SOCK_STREAM | SOCK_CLOEXEC, 0));
+    if(listener.get() == -1) {
+        nkgt::util::print_error_message("socket", errno);
+        return tl::make_unexpected(gdb_server::socket_fail);
+    }
+
+    const int enable = 1;
+    if(tcp) {
+        setsockopt(listener.get(), SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+    }
+
+    if(bind(listener.get(), reinterpret_cast<const sockaddr*>(&storage), length) == -1) {
+        nkgt::util::print_error_message("bind", errno);
+        return tl::make_unexpected(gdb_server::bind_fail);
+    }
+
+    if(listen(listener.get(), 1) == -1) {
+        nkgt::util::print_error_message("listen", errno);
+        return tl::make_unexpected(gdb_server::listen_fail);
+    }
+
+    fmt::print("Listening for a GDB client on {}.\n", address);
+    std::fflush(stdout);
+
+    int client = -1;
+    do {
+        client = accept4(listener.get(), nullptr, nullptr, SOCK_CLOEXEC);
+    } while(client == -1 && errno == EINTR);
+
+    if(!unix_path.empty()) {
+        unlink(unix_path.c_str());
+    }
+
+    if(client == -1) {
+        nkgt::util::print_error_message("accept", errno);
+        return tl::make_unexpected(gdb_server::accept_fail);
+    }
+
+    if(tcp) {
+        // Replies are already batched, Nagle would only add latency.
+        setsockopt(client, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+    }
+
+    return client;
+}
+
+}
+
+namespace nkgt::gdb_server {
+
+auto packet_reader::next() -> std::optional<event> {
+    while(position_ < buffer_.size()) {
+        const char c = buffer_[position_];
+
+        if(c == '+' || c == '-' || c == '\x03') {
+            ++position_;
+            return event{
+                c == '+' ? event::kind::ack : c == '-' ? event::kind::nack : event::kind::interrupt,
+                {}
+            };
+        }
+
+        if(c != '$') {
+            // Noise between packets.
+            ++position_;
+            continue;
+        }
+
+        const auto end = buffer_.find('#', position_ + 1);
+        if(end == std::string::npos || end + 2 >= buffer_.size()) {
+            break;
+        }
+
+        const std::string_view raw = std::string_view(buffer_).substr(position_ + 1, end - position_ - 1);
+        const int high = hex_value(buffer_[end + 1]);
+        const int low = hex_value(buffer_[end + 2]);
+        position_ = end + 3;
+
+        uint8_t sum = 0;
+        for(const char b : raw) {
+            sum = static_cast<uint8_t>(sum + static_cast<uint8_t>(b));
+        }
+
+        if(high < 0 || low < 0 || sum != ((high << 4) | low)) {
+            return event{event::kind::corrupted, {}};
+        }
+
+        event e = {event::kind::packet, {}};
+        e.payload.reserve(raw.size());
+        for(std::size_t i = 0; i < raw.size(); ++i) {
+            if(raw[i] == '}' && i + 1 < raw.size()) {
+                e.payload += static_cast<char>(raw[++i] ^ 0x20);
+            } else {
+                e.payload += raw[i];
+            }
+        }
+
+        return e;
+    }
+
+    // Only the incomplete packet, if any, is kept.
+    buffer_.erase(0, position_);
+    position_ = 0;
+    return std::nullopt;
+}
+
+auto append_escaped(std::string_view data, std::string& out) -> void {
+    for(const char c : data) {
+        if(c == '#' || c == '$' || c == '}' || c == '*') {
+            out += '}';
+            out += static_cast<char>(c ^ 0x20);
+        } else {
+            out += c;
+        }
+    }
+}
+
+auto append_packet(std::string_view payload, std::string& out) -> void {
+    out += '$';
+    const std::size_t start = out.size();
+    append_escaped(payload, out);
+
+    uint8_t sum = 0;
+    for(std::size_t i = start; i < out.size(); ++i) {
+        sum = static_cast<uint8_t>(sum + static_cast<uint8_t>(out[i]));
+    }
+
+    out += '#';
+    out += hex_digits[sum >> 4];
+    out += hex_digits[sum & 0xf];
+}
+
+auto target_description() -> const std::string& {
+    static const std::string description = build_target_description();
+    return description;
+}
+
+auto serve(pid_t pid, std::string_view address) -> tl::expected<void, error::gdb_server> {
+    const auto client = accept_client(address);
+    if(!client) {
+        return tl::make_unexpected(client.error());
+    }
+
+    const descriptor socket(*client);
+    fmt::print("GDB client connected.\n");
+
+    sigset_t mask;
+    sigset_t previous_mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGCHLD);
+    sigprocmask(SIG_BLOCK, &mask, &previous_mask);
+
+    const descriptor signal_fd(signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC));
+    if(signal_fd.get() == -1) {
+        util::print_error_message("signalfd", errno);
+        sigprocmask(SIG_SETMASK, &previous_mask, nullptr);
+        return tl::make_unexpected(error::gdb_server::socket_fail);
+    }
+
+    server(socket.get(), signal_fd.get(), pid).run();
+
+    sigprocmask(SIG_SETMASK, &previous_mask, nullptr);
+    fmt::print("GDB client disconnected.\n");
+    return {};
+}
+
+}
@@ -0,0 +1,208 @@
+#include "nkgt/maps.hpp"
+#include "nkgt/error_codes.hpp"
+
+#include <tl/expected.hpp>
+
+#include <algorithm>
+#include <charconv>
+#include <fmt/core.h>
+#include <fstream>
+#include <sstream>
+
+namespace {
+
+// Parses an unsigned number at the start of s in the given base and removes it
+// together with the following separator, if any.
+template<typename T>
+[[nodiscard]]
+auto consume_number(std::string_view& s, int base) -> tl::expected<T, nkgt::error::maps> {
+    T value = 0;
+    const auto [end, ec] = std::from_chars(s.data(), s.data() + s.size(), value, base);
+
+    if(ec != std::errc()) {
+        return tl::make_unexpected(nkgt::error::maps::parse_fail);
+    }
+
+    s.remove_prefix(static_cast<std::size_t>(end - s.data()));
+    if(!s.empty()) {
+        s.remove_prefix(1);
+    }
+
+    return value;
+}
+
+[[nodiscard]]
+auto consume_field(std::string_view& s) -> std::string_view {
+    const std::size_t end = std::min(s.find(' '), s.size());
+    const std::string_view field = s.substr(0, end);
+
+    s.remove_prefix(end);
+    while(!s.empty() && s.front() == ' ') {
+        s.remove_prefix(1);
+    }
+
+    return field;
+}
+
+// Format of a line:
+// address           perms offset  dev   inode       pathname
+// 00400000-00452000 r-xp 00000000 08:02 173521      /usr/bin/dbus-daemon
+[[nodiscard]]
+auto parse_line(std::string_view line) -> tl::expected<nkgt::maps::region, nkgt::error::maps> {
+    nkgt::maps::region r;
+
+    const auto start = consume_number<std::uintptr_t>(line, 16);
+    const auto end = consume_number<std::uintptr_t>(line, 16);
+    if(!start || !end) {
+        return tl::make_unexpected(nkgt::error::maps::parse_fail);
+    }
+
+    const std::string_view permissions = consume_field(line);
+    if(permissions.size() != 4) {
+        return tl::make_unexpected(nkgt::error::maps::parse_fail);
+    }
+
+    const auto offset = consume_number<std::uint64_t>(line, 16);
+    if(!offset) {
+        return tl::make_unexpected(nkgt::error::maps::parse_fail);
+    }
+
+    // Device and inode are not needed.
+    (void)consume_field(line);
+    (void)consume_field(line);
+
+    r.start = *start;
+    r.end = *end;
+    r.readable = permissions[0] == 'r';
+    r.writable = permissions[1] == 'w';
+    r.executable = permissions[2] == 'x';
+    r.shared = permissions[3] == 's';
+    r.offset = *offset;
+    r.path = std::string(line);
+
+    return r;
+}
+
+}
+
+namespace nkgt::maps {
+
+auto parse_maps(
+    std::string_view content
+) -> tl::expected<std::vector<region>, error::maps> {
+    std::vector<region> regions;
+
+    while(!content.empty()) {
+        const std::size_t end = std::min(content.find('\n'), content.size());
+        const std::string_view line = content.substr(0, end);
+        content.remove_prefix(std::min(end + 1, content.size()));
+
+        if(line.empty()) {
+            continue;
+        }
+
+        auto r = parse_line(line);
+        if(!r) {
+            return tl::make_unexpected(r.error());
+        }
+
+        regions.push_back(std::move(*r));
+    }
+
+    return regions;
+}
+
+auto read_maps(pid_t pid) -> tl::expected<std::vector<region>, error::maps> {
+    std::ifstream file(fmt::format("/proc/{}/maps", pid));
+
+    if(!file) {
+        return tl::make_unexpected(error::maps::open_fail);
+    }
+
+    std::stringstream content;
+    content << file.rdbuf();
+
+    return parse_maps(content.str());
+}
+
+auto address_space::refresh() -> void {
+    if(!stale_) {
+        return;
+    }
+
+    auto regions = read_maps(pid_);
+    if(!regions) {
+        fmt::print("Failed to read the memory map of PID {}.\n", pid_);
+        regions_.clear();
+        return;
+    }
+
+    regions_ = std::move(*regions);
+    stale_ = false;
+}
+
+auto address_space::regions() -> const std::vector<region>& {
+    refresh();
+    return regions_;
+}
+
+auto address_space::find(std::uintptr_t address) -> const region* {
+    refresh();
+
+    auto it = std::upper_bound(
+        regions_.cbegin(),
+        regions_.cend(),
+        address,
+        [](std::uintptr_t a, const region& r) { return a < r.start; }
+    );
+
+    if(it == regions_.cbegin()) {
+        return nullptr;
+    }
+
+    --it;
+    return address < it->end ? &*it : nullptr;
+}
+
+auto address_space::to_module_offset(
+    std::uintptr_t address
+) -> std::optional<module_offset> {
+    const region* r = find(address);
+    if(r == nullptr || r->path.empty()) {
+        return std::nullopt;
+    }
+
+    // The mappings of a module are consecutive, walk back to the first one.
+    const region* first = r;
+    while(first != regions_.data() && (first - 1)->path == r->path) {
+        --first;
+    }
+
+    return module_offset{first, address - first->start};
+}
+
+auto address_space::module_start(std::string_view path) -> std::optional<std::uintptr_t> {
+    refresh();
+
+    for(const auto& r : regions_) {
+        if(r.offset == 0 && r.path == path) {
+            return r.start;
+        }
+    }
+
+    return std::nullopt;
+}
+
+auto address_space::load_bias(
+    std::string_view path,
+    std::uintptr_t load_base
+) -> std::optional<std::uintptr_t> {
+    const auto start = module_start(path);
+    if(!start) {
+        return std::nullopt;
+    }
+
+    return *start - load_base;
+}
+
+}
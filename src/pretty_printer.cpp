@@ -0,0 +1,792 @@
+#include "nkgt/pretty_printer.hpp"
+#include "nkgt/target.hpp"
+#include "nkgt/types.hpp"
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <string_view>
+#include <vector>
+
+namespace {
+
+using nkgt::types::kind;
+using nkgt::types::type_graph;
+using nkgt::types::type_id;
+
+// The output is flushed to the file when the buffer grows past this size.
+constexpr std::size_t flush_threshold = 64 * 1024;
+
+// Upper bound on the number of scatter reads of a single print. Every level
+// of indirection and every node of a linked container takes one.
+constexpr std::size_t max_rounds = 1024;
+
+constexpr std::size_t page_size = 4096;
+
+// In libstdc++ the value of an _Hash_node follows the pointer to the next
+// node. Types aligned to more than 8 bytes would be further away.
+constexpr std::size_t hash_node_value_offset = sizeof(void*);
+
+[[nodiscard]]
+auto load(const std::byte* data, std::size_t size) -> uint64_t {
+    uint64_t value = 0;
+    std::memcpy(&value, data, std::min(size, sizeof(value)));
+    return value;
+}
+
+[[nodiscard]]
+auto sign_extend(uint64_t value, std::size_t bits) -> int64_t {
+    const unsigned unused = bits < 64 ? static_cast<unsigned>(64 - bits) : 0;
+    return static_cast<int64_t>(value << unused) >> unused;
+}
+
+[[nodiscard]]
+auto starts_with(std::string_view s, std::string_view prefix) -> bool {
+    return s.substr(0, prefix.size()) == prefix;
+}
+
+enum class fetch_state {
+    ready,
+    pending,
+    unreadable,
+};
+
+struct fetch_result {
+    fetch_state state;
+    const std::byte* data;
+};
+
+// Memory of the debugee read so far, in blocks keyed by start address.
+class memory_cache {
+public:
+    // Looks the range up and, when it is not cached yet, queues it for the
+    // next call to fetch_pending().
+    auto get(std::uintptr_t address, std::size_t size) -> fetch_result {
+        if(size == 0) {
+            return {fetch_state::ready, nullptr};
+        }
+
+        auto it = blocks_.upper_bound(address);
+        if(it != blocks_.begin()) {
+            --it;
+
+            const std::uintptr_t offset = address - it->first;
+            if(offset + size <= it->second.bytes.size()) {
+                return it->second.readable
+                     ? fetch_result{fetch_state::ready, it->second.bytes.data() + offset}
+                     : fetch_result{fetch_state::unreadable, nullptr};
+            }
+        }
+
+        pending_.push_back({address, size});
+        return {fetch_state::pending, nullptr};
+    }
+
+    [[nodiscard]]
+    auto has_pending() const -> bool { return !pending_.empty(); }
+
+    // Reads all the queued ranges, adjacent and overlapping ones merged, with
+    // a single scatter read. If that fails the ranges are read one by one to
+    // find out which ones are unreadable.
+    auto fetch_pending(nkgt::target::target& debugee, nkgt::pretty_printer::print_stats& stats) -> void {
+        std::sort(pending_.begin(), pending_.end(), [](const range& a, const range& b) {
+            return a.address < b.address;
+        });
+
+        std::vector<range> merged;
+        for(const auto& r : pending_) {
+            if(!merged.empty() && r.address <= merged.back().address + merged.back().size) {
+                const std::uintptr_t end = std::max(merged.back().address + merged.back().size, r.address + r.size);
+                merged.back().size = end - merged.back().address;
+            } else {
+                merged.push_back(r);
+            }
+        }
+
+        pending_.clear();
+
+        std::vector<nkgt::target::memory_request> requests;
+        std::vector<block*> targets;
+        requests.reserve(merged.size());
+        targets.reserve(merged.size());
+
+        for(const auto& r : merged) {
+            block& b = blocks_[r.address];
+            if(b.bytes.size() >= r.size) {
+                continue;
+            }
+
+            b.bytes.assign(r.size, std::byte{0});
+            b.readable = true;
+            requests.push_back({r.address, b.bytes.data(), r.size});
+            targets.push_back(&b);
+            stats.bytes += r.size;
+        }
+
+        if(requests.empty()) {
+            return;
+        }
+
+        stats.reads += 1;
+        if(debugee.read_memory_scatter(requests.data(), requests.size())) {
+            return;
+        }
+
+        for(std::size_t i = 0; i < requests.size(); ++i) {
+            targets[i]->readable = static_cast<bool>(
+                debugee.read_memory(requests[i].address, requests[i].buffer, requests[i].size)
+            );
+        }
+    }
+
+private:
+    struct range {
+        std::uintptr_t address;
+        std::size_t size;
+    };
+
+    struct block {
+        std::vector<std::byte> bytes;
+        bool readable = false;
+    };
+
+    std::map<std::uintptr_t, block> blocks_;
+    std::vector<range> pending_;
+};
+
+// Formatted output. Disabled while the walker only looks for the memory it
+// needs.
+class output {
+public:
+    explicit output(std::FILE* file) : file_(file) {}
+
+    template<typename... Args>
+    auto write(fmt::format_string<Args...> format, Args&&... args) -> void {
+        if(!enabled) {
+            return;
+        }
+
+        fmt::format_to(fmt::appender(buffer_), format, std::forward<Args>(args)...);
+
+        if(file_ != nullptr && buffer_.size() > flush_threshold) {
+            flush();
+        }
+    }
+
+    auto flush() -> void {
+        if(file_ != nullptr) {
+            std::fwrite(buffer_.data(), 1, buffer_.size(), file_);
+            buffer_.clear();
+        }
+    }
+
+    [[nodiscard]]
+    auto str() const -> std::string { return fmt::to_string(buffer_); }
+
+    bool enabled = false;
+
+private:
+    std::FILE* file_;
+    fmt::memory_buffer buffer_;
+};
+
+class walker {
+public:
+    walker(
+        nkgt::target::target& debugee,
+        const type_graph& graph,
+        const nkgt::pretty_printer::limits& l,
+        output& out
+    ) : debugee_(debugee), graph_(graph), limits_(l), out_(out) {}
+
+    // Walks the value until all the memory it refers to has been fetched,
+    // then walks it a last time with the output enabled.
+    auto run(type_id t, const std::byte* data) -> nkgt::pretty_printer::print_stats {
+        nkgt::pretty_printer::print_stats stats = {0, 0};
+
+        out_.enabled = false;
+        for(std::size_t round = 0; round < max_rounds; ++round) {
+            value(t, data, 0);
+
+            if(!cache_.has_pending()) {
+                break;
+            }
+
+            cache_.fetch_pending(debugee_, stats);
+        }
+
+        out_.enabled = true;
+        value(t, data, 0);
+        out_.flush();
+
+        return stats;
+    }
+
+private:
+    [[nodiscard]]
+    auto size_of(type_id t) const -> std::size_t {
+        t = graph_.strip(t);
+        return t == nkgt::types::no_type ? 0 : graph_.at(t).size;
+    }
+
+    // Prints the value of type t at address, fetching it if needed.
+    auto indirect(type_id t, std::uintptr_t address, std::size_t depth) -> void {
+        const auto size = nkgt::pretty_printer::footprint(graph_, t, limits_);
+        const auto fetched = cache_.get(address, size);
+
+        switch(fetched.state) {
+        case fetch_state::ready:
+            value(t, fetched.data, depth);
+            break;
+        case fetch_state::pending:
+            out_.write("<not fetched>");
+            break;
+        case fetch_state::unreadable:
+            out_.write("<unreadable at {:#x}>", address);
+            break;
+        }
+    }
+
+    auto value(type_id t, const std::byte* data, std::size_t depth) -> void {
+        t = graph_.strip(t);
+        if(t == nkgt::types::no_type) {
+            out_.write("void");
+            return;
+        }
+
+        const auto& type = graph_.at(t);
+
+        switch(type.k) {
+        case kind::signed_integer:
+        case kind::unsigned_integer:
+        case kind::floating_point:
+        case kind::boolean:
+        case kind::character:
+            scalar(type.k, data, type.size);
+            return;
+        case kind::pointer:
+            pointer(type, load(data, sizeof(void*)));
+            return;
+        case kind::reference: {
+            const uint64_t address = load(data, sizeof(void*));
+            out_.write("@{:#x}: ", address);
+            indirect(type.target, address, depth);
+            return;
+        }
+        case kind::enumeration:
+            enumeration(type, data);
+            return;
+        case kind::array:
+            array(type, data, depth);
+            return;
+        case kind::structure:
+            if(visualize(t, data, depth)) {
+                return;
+            }
+            composite(type, data, depth);
+            return;
+        case kind::union_type:
+            composite(type, data, depth);
+            return;
+        case kind::opaque:
+        case kind::typedef_alias:
+        case kind::qualified:
+            bytes(data, type.size);
+            return;
+        }
+    }
+
+    auto scalar(kind k, const std::byte* data, std::size_t size) -> void {
+        const uint64_t raw = load(data, size);
+
+        switch(k) {
+        case kind::signed_integer:
+            out_.write("{}", sign_extend(raw, 8 * size));
+            return;
+        case kind::boolean:
+            out_.write("{}", raw != 0);
+            return;
+        case kind::character:
+            if(size == 1 && raw >= 0x20 && raw < 0x7f) {
+                out_.write("{} '{}'", sign_extend(raw, 8), static_cast<char>(raw));
+            } else {
+                out_.write("{}", raw);
+            }
+            return;
+        case kind::floating_point:
+            if(size == sizeof(float)) {
+                float value;
+                std::memcpy(&value, data, sizeof(value));
+                out_.write("{}", value);
+            } else if(size == sizeof(double)) {
+                double value;
+                std::memcpy(&value, data, sizeof(value));
+                out_.write("{}", value);
+            } else if(size == sizeof(long double)) {
+                long double value;
+                std::memcpy(&value, data, sizeof(value));
+                out_.write("{}", value);
+            } else {
+                bytes(data, size);
+            }
+            return;
+        default:
+            out_.write("{}", raw);
+            return;
+        }
+    }
+
+    // Pointers print as addresses, except for char* which also prints the
+    // string. The string is read up to the end of the page, so that the read
+    // cannot fail because of a missing terminator.
+    auto pointer(const nkgt::types::type& type, uint64_t address) -> void {
+        out_.write("{:#x}", address);
+
+        const type_id pointee = graph_.strip(type.target);
+        if(address == 0 || pointee == nkgt::types::no_type) {
+            return;
+        }
+
+        const auto& target = graph_.at(pointee);
+        if(target.k != kind::character || target.size != 1) {
+            return;
+        }
+
+        const std::size_t size = std::min(limits_.max_string, page_size - address % page_size);
+        const auto fetched = cache_.get(address, size);
+
+        if(fetched.state == fetch_state::ready) {
+            const auto* end = std::find(fetched.data, fetched.data + size, std::byte{0});
+            out_.write(" ");
+            string(fetched.data, static_cast<std::size_t>(end - fetched.data), end == fetched.data + size);
+        }
+    }
+
+    auto string(const std::byte* data, std::size_t size, bool truncated) -> void {
+        out_.write("\"");
+
+        for(std::size_t i = 0; i < size; ++i) {
+            const auto c = static_cast<unsigned char>(data[i]);
+
+            switch(c) {
+            case '"':  out_.write("\\\""); break;
+            case '\\': out_.write("\\\\"); break;
+            case '\n': out_.write("\\n"); break;
+            case '\t': out_.write("\\t"); break;
+            case '\r': out_.write("\\r"); break;
+            default:
+                if(c >= 0x20 && c < 0x7f) {
+                    out_.write("{}", static_cast<char>(c));
+                } else {
+                    out_.write("\\x{:02x}", c);
+                }
+            }
+        }
+
+        out_.write(truncated ? "\"..." : "\"");
+    }
+
+    auto bytes(const std::byte* data, std::size_t size) -> void {
+        constexpr std::size_t max_bytes = 64;
+
+        out_.write("{{");
+        for(std::size_t i = 0; i < std::min(size, max_bytes); ++i) {
+            out_.write(i == 0 ? "{:#04x}" : ", {:#04x}", static_cast<unsigned>(data[i]));
+        }
+        out_.write(size > max_bytes ? ", ...}}" : "}}");
+    }
+
+    auto enumeration(const nkgt::types::type& type, const std::byte* data) -> void {
+        const int64_t value = sign_extend(load(data, type.size), 8 * type.size);
+
+        for(const auto& e : type.enumerators) {
+            if(e.value == value) {
+                out_.write("{}", e.name);
+                return;
+            }
+        }
+
+        out_.write("{}", value);
+    }
+
+    auto array(const nkgt::types::type& type, const std::byte* data, std::size_t depth) -> void {
+        const type_id element = graph_.strip(type.target);
+        const std::size_t element_size = size_of(element);
+
+        if(element != nkgt::types::no_type && graph_.at(element).k == kind::character && element_size == 1) {
+            const std::size_t size = std::min<std::size_t>(type.count, limits_.max_string);
+            const auto* end = std::find(data, data + size, std::byte{0});
+            string(data, static_cast<std::size_t>(end - data), end == data + size && size < type.count);
+            return;
+        }
+
+        elements(element, data, element_size, type.count, depth);
+    }
+
+    // Prints {e0, e1, ...} for count contiguous elements, of which data holds
+    // at least the ones within the element limit.
+    auto elements(
+        type_id element,
+        const std::byte* data,
+        std::size_t element_size,
+        uint64_t count,
+        std::size_t depth
+    ) -> void {
+        if(depth >= limits_.max_depth) {
+            out_.write("{{...}}");
+            return;
+        }
+
+        const auto shown = std::min<uint64_t>(count, limits_.max_elements);
+
+        out_.write("{{");
+        for(uint64_t i = 0; i < shown; ++i) {
+            if(i > 0) {
+                out_.write(", ");
+            }
+            value(element, data + i * element_size, depth + 1);
+        }
+
+        if(count > shown) {
+            out_.write(", ... ({} more)", count - shown);
+        }
+        out_.write("}}");
+    }
+
+    auto composite(const nkgt::types::type& type, const std::byte* data, std::size_t depth) -> void {
+        if(depth >= limits_.max_depth) {
+            out_.write("{{...}}");
+            return;
+        }
+
+        out_.write("{{");
+        bool first = true;
+
+        for(const auto& m : type.members) {
+            out_.write(first ? "" : ", ");
+            first = false;
+
+            if(m.is_base) {
+                out_.write("<{}> = ", m.name);
+            } else {
+                out_.write("{} = ", m.name);
+            }
+
+            if(m.bit_size != 0) {
+                bit_field(m, data);
+            } else {
+                value(m.type, data + m.offset, depth + 1);
+            }
+        }
+
+        out_.write("}}");
+    }
+
+    auto bit_field(const nkgt::types::member& m, const std::byte* data) -> void {
+        const std::size_t first_byte = m.bit_offset / 8u;
+        const unsigned shift = m.bit_offset % 8u;
+        const std::size_t bytes_needed = (shift + m.bit_size + 7u) / 8u;
+
+        const uint64_t raw = load(data + m.offset + first_byte, bytes_needed) >> shift;
+        const uint64_t value = m.bit_size >= 64 ? raw : raw & ((uint64_t{1} << m.bit_size) - 1);
+
+        const type_id t = graph_.strip(m.type);
+        if(t != nkgt::types::no_type && graph_.at(t).k == kind::signed_integer) {
+            out_.write("{}", sign_extend(value, m.bit_size));
+        } else {
+            out_.write("{}", value);
+        }
+    }
+
+    // Returns false when t is not a known libstdc++ type, or when its layout
+    // is not the expected one.
+    auto visualize(type_id t, const std::byte* data, std::size_t depth) -> bool {
+        const std::string_view name = graph_.at(t).name;
+
+        if(starts_with(name, "vector<")) {
+            return vector(t, data, depth);
+        }
+        if(starts_with(name, "basic_string<")) {
+            return basic_string(t, data);
+        }
+        if(starts_with(name, "unordered_map<")) {
+            return unordered_map(t, data, depth);
+        }
+        if(starts_with(name, "shared_ptr<")) {
+            return shared_ptr(t, data, depth);
+        }
+
+        return false;
+    }
+
+    // The member at the end of path, e.g. {"_M_impl", "_M_start"}.
+    [[nodiscard]]
+    auto member(type_id t, std::initializer_list<std::string_view> path) const -> std::optional<nkgt::types::member_location> {
+        nkgt::types::member_location location = {0, t};
+
+        for(const auto name : path) {
+            const auto m = graph_.find_member(location.type, name);
+            if(!m) {
+                return std::nullopt;
+            }
+
+            location = {location.offset + m->offset, m->type};
+        }
+
+        return location;
+    }
+
+    // Pointee of a member that must be a pointer.
+    [[nodiscard]]
+    auto pointee(const nkgt::types::member_location& m) const -> std::optional<type_id> {
+        const type_id t = graph_.strip(m.type);
+        if(t == nkgt::types::no_type || graph_.at(t).k != kind::pointer) {
+            return std::nullopt;
+        }
+
+        return graph_.at(t).target;
+    }
+
+    // std::vector<T>: three pointers in _M_impl, the elements are in
+    // [_M_start, _M_finish).
+    auto vector(type_id t, const std::byte* data, std::size_t depth) -> bool {
+        const auto start = member(t, {"_M_impl", "_M_start"});
+        const auto finish = member(t, {"_M_impl", "_M_finish"});
+        const auto element = start ? pointee(*start) : std::nullopt;
+        const std::size_t element_size = element ? size_of(*element) : 0;
+
+        if(!finish || element_size == 0) {
+            return false;
+        }
+
+        const uint64_t begin = load(data + start->offset, sizeof(void*));
+        const uint64_t end = load(data + finish->offset, sizeof(void*));
+        const uint64_t count = end >= begin ? (end - begin) / element_size : 0;
+
+        out_.write("std::vector of length {} = ", count);
+
+        const auto shown = std::min<uint64_t>(count, limits_.max_elements);
+        const auto fetched = depth < limits_.max_depth
+                           ? cache_.get(begin, shown * element_size)
+                           : fetch_result{fetch_state::ready, nullptr};
+
+        switch(fetched.state) {
+        case fetch_state::ready:
+            elements(*element, fetched.data, element_size, count, depth);
+            break;
+        case fetch_state::pending:
+            out_.write("{{<not fetched>}}");
+            break;
+        case fetch_state::unreadable:
+            out_.write("<unreadable at {:#x}>", begin);
+            break;
+        }
+
+        return true;
+    }
+
+    // std::basic_string<char>: _M_dataplus._M_p points to _M_string_length
+    // characters.
+    auto basic_string(type_id t, const std::byte* data) -> bool {
+        const auto pointer = member(t, {"_M_dataplus", "_M_p"});
+        const auto length = member(t, {"_M_string_length"});
+        const auto character = pointer ? pointee(*pointer) : std::nullopt;
+
+        if(!length || !character || size_of(*character) != 1) {
+            return false;
+        }
+
+        const uint64_t address = load(data + pointer->offset, sizeof(void*));
+        const uint64_t size = load(data + length->offset, sizeof(uint64_t));
+        const auto shown = std::min<uint64_t>(size, limits_.max_string);
+        const auto fetched = cache_.get(address, shown);
+
+        switch(fetched.state) {
+        case fetch_state::ready:
+            string(fetched.data, shown, shown < size);
+            break;
+        case fetch_state::pending:
+            out_.write("<not fetched>");
+            break;
+        case fetch_state::unreadable:
+            out_.write("<unreadable at {:#x}>", address);
+            break;
+        }
+
+        return true;
+    }
+
+    // std::unordered_map<K, V>: the nodes form a singly linked list starting
+    // at _M_h._M_before_begin._M_nxt. The value type of the _Hashtable is its
+    // second template argument, std::pair<const K, V>.
+    auto unordered_map(type_id t, const std::byte* data, std::size_t depth) -> bool {
+        const auto table = member(t, {"_M_h"});
+        const auto first = member(t, {"_M_h", "_M_before_begin", "_M_nxt"});
+        const auto count_member = member(t, {"_M_h", "_M_element_count"});
+
+        if(!table || !first || !count_member) {
+            return false;
+        }
+
+        const type_id table_type = graph_.strip(table->type);
+        const auto& arguments = graph_.at(table_type).template_arguments;
+        if(arguments.size() < 2) {
+            return false;
+        }
+
+        const type_id value_type = arguments[1];
+        const std::size_t value_size = nkgt::pretty_printer::footprint(graph_, value_type, limits_);
+        const uint64_t count = load(data + count_member->offset, sizeof(uint64_t));
+        uint64_t node = load(data + first->offset, sizeof(void*));
+
+        out_.write("std::unordered_map with {} elements = ", count);
+
+        if(depth >= limits_.max_depth) {
+            out_.write("{{...}}");
+            return true;
+        }
+
+        const auto key = member(value_type, {"first"});
+        const auto mapped = member(value_type, {"second"});
+
+        out_.write("{{");
+        uint64_t shown = 0;
+        for(; shown < std::min<uint64_t>(count, limits_.max_elements) && node != 0; ++shown) {
+            const auto fetched = cache_.get(node, hash_node_value_offset + value_size);
+
+            if(fetched.state == fetch_state::pending) {
+                out_.write("{}<not fetched>", shown > 0 ? ", " : "");
+                break;
+            }
+
+            if(fetched.state == fetch_state::unreadable) {
+                out_.write("{}<unreadable at {:#x}>", shown > 0 ? ", " : "", node);
+                break;
+            }
+
+            const std::byte* pair = fetched.data + hash_node_value_offset;
+            out_.write(shown > 0 ? ", " : "");
+
+            if(key && mapped) {
+                out_.write("[");
+                value(key->type, pair + key->offset, depth + 1);
+                out_.write("] = ");
+                value(mapped->type, pair + mapped->offset, depth + 1);
+            } else {
+                value(value_type, pair, depth + 1);
+            }
+
+            node = load(fetched.data, sizeof(void*));
+        }
+
+        if(count > shown) {
+            out_.write(", ... ({} more)", count - shown);
+        }
+        out_.write("}}");
+
+        return true;
+    }
+
+    // std::shared_ptr<T>: _M_ptr is the stored pointer and _M_refcount._M_pi
+    // the control block, whose use and weak counts follow the vtable pointer.
+    // The weak count includes one reference held by all the shared owners.
+    auto shared_ptr(type_id t, const std::byte* data, std::size_t depth) -> bool {
+        const auto pointer = member(t, {"_M_ptr"});
+        const auto control = member(t, {"_M_refcount", "_M_pi"});
+        const auto element = pointer ? pointee(*pointer) : std::nullopt;
+
+        if(!control || !element) {
+            return false;
+        }
+
+        const uint64_t address = load(data + pointer->offset, sizeof(void*));
+        const uint64_t control_address = load(data + control->offset, sizeof(void*));
+
+        if(control_address == 0) {
+            out_.write("std::shared_ptr (empty) = {:#x}", address);
+            return true;
+        }
+
+        const auto counts = cache_.get(control_address + sizeof(void*), 2 * sizeof(int32_t));
+        if(counts.state == fetch_state::ready) {
+            const auto use = static_cast<int32_t>(load(counts.data, sizeof(int32_t)));
+            const auto weak = static_cast<int32_t>(load(counts.data + sizeof(int32_t), sizeof(int32_t)));
+            out_.write("std::shared_ptr (use count {}, weak count {}) = {:#x}", use, use > 0 ? weak - 1 : weak, address);
+        } else {
+            out_.write("std::shared_ptr = {:#x}", address);
+        }
+
+        if(address != 0 && *element != nkgt::types::no_type) {
+            out_.write(" -> ");
+            indirect(*element, address, depth + 1);
+        }
+
+        return true;
+    }
+
+    nkgt::target::target& debugee_;
+    const type_graph& graph_;
+    const nkgt::pretty_printer::limits& limits_;
+    output& out_;
+    memory_cache cache_;
+};
+
+}
+
+namespace nkgt::pretty_printer {
+
+auto footprint(
+    const types::type_graph& graph,
+    types::type_id t,
+    const limits& l
+) -> std::size_t {
+    t = graph.strip(t);
+    if(t == types::no_type) {
+        return 0;
+    }
+
+    const auto& type = graph.at(t);
+    if(type.k != types::kind::array) {
+        return type.size;
+    }
+
+    const types::type_id element = graph.strip(type.target);
+    if(element == types::no_type) {
+        return 0;
+    }
+
+    const auto& element_type = graph.at(element);
+    const std::size_t limit = element_type.k == types::kind::character && element_type.size == 1
+                            ? l.max_string
+                            : l.max_elements;
+
+    return static_cast<std::size_t>(std::min<uint64_t>(type.count, limit)) * element_type.size;
+}
+
+auto print(
+    target::target& debugee,
+    const types::type_graph& graph,
+    types::type_id t,
+    const std::byte* data,
+    const limits& l,
+    std::FILE* out
+) -> print_stats {
+    output o(out);
+    return walker(debugee, graph, l, o).run(t, data);
+}
+
+auto format(
+    target::target& debugee,
+    const types::type_graph& graph,
+    types::type_id t,
+    const std::byte* data,
+    const limits& l
+) -> std::string {
+    output o(nullptr);
+    walker(debugee, graph, l, o).run(t, data);
+    return o.str();
+}
+
+}
@@ -0,0 +1,140 @@
+#include "nkgt/process.hpp"
+#include "nkgt/error_codes.hpp"
+#include "nkgt/stats.hpp"
+#include "nkgt/util.hpp"
+
+#include <tl/expected.hpp>
+
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <fcntl.h>
+#include <sys/ptrace.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char** environ;
+
+namespace {
+
+// NULL terminated array of pointers into strings, as execve() wants it.
+[[nodiscard]]
+auto to_pointers(
+    const std::string* first,
+    const std::vector<std::string>& rest
+) -> std::vector<char*> {
+    std::vector<char*> result;
+    result.reserve(rest.size() + 2);
+
+    if(first != nullptr) {
+        result.push_back(const_cast<char*>(first->c_str()));
+    }
+
+    for(const auto& s : rest) {
+        result.push_back(const_cast<char*>(s.c_str()));
+    }
+
+    result.push_back(nullptr);
+    return result;
+}
+
+// Runs in the child: only async-signal-safe calls from here on. A failure is
+// reported to the parent by writing errno to the pipe, which execve() closes
+// on success.
+[[noreturn]]
+auto execute(
+    const char* program,
+    char* const* argv,
+    char* const* envp,
+    int error_pipe
+) -> void {
+    int error_number = 0;
+
+    if(ptrace(PTRACE_TRACEME, 0, nullptr, nullptr) == -1) {
+        error_number = errno;
+    } else {
+        execve(program, argv, envp);
+        error_number = errno;
+    }
+
+    (void)!write(error_pipe, &error_number, sizeof(error_number));
+    _exit(127);
+}
+
+}
+
+namespace nkgt::process {
+
+auto current_environment() -> std::vector<std::string> {
+    std::vector<std::string> result;
+    for(char** entry = environ; *entry != nullptr; ++entry) {
+        result.emplace_back(*entry);
+    }
+
+    return result;
+}
+
+auto launch(const launch_options& options) -> tl::expected<pid_t, error::launch> {
+    NKGT_STATS_SCOPE("process/launch");
+
+    const std::string program = options.program.string();
+    const auto argv = to_pointers(&program, options.arguments);
+    const auto envp = to_pointers(nullptr, options.environment);
+
+    int error_pipe[2];
+    if(pipe2(error_pipe, O_CLOEXEC) == -1) {
+        util::print_error_message("pipe2", errno);
+        return tl::make_unexpected(error::launch::fork_fail);
+    }
+
+    // Whatever is buffered would otherwise be printed twice if the child
+    // failed before execve().
+    std::fflush(stdout);
+
+    const pid_t pid = fork();
+
+    if(pid == 0) {
+        close(error_pipe[0]);
+        execute(program.c_str(), argv.data(), envp.data(), error_pipe[1]);
+    }
+
+    const int fork_error = errno;
+    close(error_pipe[1]);
+
+    if(pid == -1) {
+        close(error_pipe[0]);
+        util::print_error_message("fork", fork_error);
+        return tl::make_unexpected(error::launch::fork_fail);
+    }
+
+    // Either the SIGTRAP of the successful execve() or the exit of the child.
+    int wait_status = 0;
+    NKGT_STATS_TIME("waitpid", waitpid(pid, &wait_status, 0));
+
+    int error_number = 0;
+    const ssize_t read_size = read(error_pipe[0], &error_number, sizeof(error_number));
+    close(error_pipe[0]);
+
+    if(read_size == sizeof(error_number) || !WIFSTOPPED(wait_status)) {
+        util::print_error_message("execve", error_number);
+        if(WIFSTOPPED(wait_status)) {
+            kill(pid, SIGKILL);
+            waitpid(pid, nullptr, 0);
+        }
+
+        return tl::make_unexpected(error::launch::exec_fail);
+    }
+
+    // Setting the option PTRACE_O_EXITKILL to the debugee ensures that it will
+    // exit when the debugger itself exits.
+    if(NKGT_STATS_TIME("ptrace/SETOPTIONS", ptrace(PTRACE_SETOPTIONS, pid, nullptr, PTRACE_O_EXITKILL)) == -1) {
+        util::print_error_message("ptrace", errno);
+        kill(pid, SIGKILL);
+        waitpid(pid, nullptr, 0);
+        return tl::make_unexpected(error::launch::setoptions_fail);
+    }
+
+    return pid;
+}
+
+}
@@ -0,0 +1,282 @@
+#include "nkgt/target.hpp"
+#include "nkgt/error_codes.hpp"
+#include "nkgt/util.hpp"
+
+#include <tl/expected.hpp>
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cpuid.h>
+#include <cstring>
+#include <elf.h>
+#include <fcntl.h>
+#include <string>
+#include <sys/ptrace.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+constexpr std::size_t word_size = sizeof(long);
+
+// CPUID leaf 0xd, sub-leaf 0 reports in ECX the size of the XSAVE area needed
+// by all the features supported by the CPU.
+[[nodiscard]]
+auto xsave_area_size() -> std::size_t {
+    unsigned eax = 0;
+    unsigned ebx = 0;
+    unsigned ecx = 0;
+    unsigned edx = 0;
+
+    if(__get_cpuid_count(0xd, 0, &eax, &ebx, &ecx, &edx) == 0 || ecx == 0) {
+        return 4096;
+    }
+
+    return ecx;
+}
+
+// See comment in nkgt::debugger::enable_breakpoint() for why errno has to be
+// cleared before calling ptrace with PTRACE_PEEKDATA.
+[[nodiscard]]
+auto peek_word(
+    pid_t pid,
+    std::uintptr_t address
+) -> tl::expected<long, nkgt::error::memory> {
+    errno = 0;
+    const long data = ptrace(PTRACE_PEEKDATA, pid, address, nullptr);
+    if(data == -1 && errno != 0) {
+        return tl::make_unexpected(nkgt::error::memory::read_fail);
+    }
+
+    return data;
+}
+
+[[nodiscard]]
+auto write_proc_mem(
+    pid_t pid,
+    std::uintptr_t address,
+    const void* buffer,
+    std::size_t size
+) -> bool {
+    const std::string path = "/proc/" + std::to_string(pid) + "/mem";
+    const int fd = open(path.c_str(), O_WRONLY | O_CLOEXEC);
+    if(fd == -1) {
+        return false;
+    }
+
+    const ssize_t written = pwrite(fd, buffer, size, static_cast<off_t>(address));
+    close(fd);
+
+    return written >= 0 && static_cast<std::size_t>(written) == size;
+}
+
+}
+
+namespace nkgt::target {
+
+auto target::read_memory_scatter(
+    const memory_request* requests,
+    std::size_t count
+) -> tl::expected<void, error::memory> {
+    for(std::size_t i = 0; i < count; ++i) {
+        const auto result = read_memory(requests[i].address, requests[i].buffer, requests[i].size);
+        if(!result) {
+            return result;
+        }
+    }
+
+    return {};
+}
+
+auto ptrace_target::read_registers(
+) -> tl::expected<user_regs_struct, error::registers> {
+    if(regs_) {
+        return *regs_;
+    }
+
+    user_regs_struct regs;
+
+    if(ptrace(PTRACE_GETREGS, pid_, nullptr, &regs) == -1) {
+        util::print_error_message("ptrace", errno);
+        return tl::make_unexpected(error::registers::getregs_fail);
+    }
+
+    regs_ = regs;
+    return regs;
+}
+
+auto ptrace_target::write_registers(
+    const user_regs_struct& regs
+) -> tl::expected<void, error::registers> {
+    if(ptrace(PTRACE_SETREGS, pid_, nullptr, &regs) == -1) {
+        util::print_error_message("ptrace", errno);
+        regs_.reset();
+        return tl::make_unexpected(error::registers::setregs_fail);
+    }
+
+    regs_ = regs;
+    return {};
+}
+
+auto ptrace_target::read_extended_state(
+) -> tl::expected<const extended_state*, error::registers> {
+    if(extended_state_) {
+        return &*extended_state_;
+    }
+
+    // PTRACE_GETREGSET copies at most iov_len bytes and updates it with the
+    // actual size of the area, so the buffer can be sized with the largest
+    // XSAVE area the CPU supports.
+    std::vector<std::byte> buffer(xsave_area_size());
+    iovec io = {buffer.data(), buffer.size()};
+
+    if(ptrace(PTRACE_GETREGSET, pid_, NT_X86_XSTATE, &io) == 0) {
+        buffer.resize(io.iov_len);
+        extended_state_ = extended_state{std::move(buffer), true};
+        return &*extended_state_;
+    }
+
+    // Fallback for CPUs (or kernels) without XSAVE support.
+    user_fpregs_struct fpregs;
+    if(ptrace(PTRACE_GETFPREGS, pid_, nullptr, &fpregs) == -1) {
+        util::print_error_message("ptrace", errno);
+        return tl::make_unexpected(error::registers::getfpregs_fail);
+    }
+
+    buffer.resize(sizeof(fpregs));
+    std::memcpy(buffer.data(), &fpregs, sizeof(fpregs));
+    extended_state_ = extended_state{std::move(buffer), false};
+    return &*extended_state_;
+}
+
+// process_vm_readv moves the whole range with a single syscall, while
+// PTRACE_PEEKDATA needs one syscall per word. The latter is kept as a fallback
+// for kernels built without CONFIG_CROSS_MEMORY_ATTACH.
+auto ptrace_target::read_memory(
+    std::uintptr_t address,
+    void* buffer,
+    std::size_t size
+) -> tl::expected<void, error::memory> {
+    if(size == 0) {
+        return {};
+    }
+
+    iovec local = {buffer, size};
+    iovec remote = {reinterpret_cast<void*>(address), size};
+
+    const ssize_t read = process_vm_readv(pid_, &local, 1, &remote, 1, 0);
+    if(read >= 0 && static_cast<std::size_t>(read) == size) {
+        return {};
+    }
+
+    if(read == -1 && errno != ENOSYS) {
+        return tl::make_unexpected(error::memory::read_fail);
+    }
+
+    auto* out = static_cast<std::byte*>(buffer);
+    std::size_t done = 0;
+
+    while(done < size) {
+        const auto word = peek_word(pid_, address + done);
+        if(!word) {
+            return tl::make_unexpected(word.error());
+        }
+
+        const std::size_t chunk = std::min(word_size, size - done);
+        std::memcpy(out + done, &*word, chunk);
+        done += chunk;
+    }
+
+    return {};
+}
+
+auto ptrace_target::read_memory_scatter(
+    const memory_request* requests,
+    std::size_t count
+) -> tl::expected<void, error::memory> {
+    std::vector<iovec> local;
+    std::vector<iovec> remote;
+    const std::size_t batch_size = std::min<std::size_t>(count, IOV_MAX);
+    local.reserve(batch_size);
+    remote.reserve(batch_size);
+
+    for(std::size_t begin = 0; begin < count; begin += IOV_MAX) {
+        const std::size_t end = std::min<std::size_t>(count, begin + IOV_MAX);
+        std::size_t expected_size = 0;
+
+        local.clear();
+        remote.clear();
+        for(std::size_t i = begin; i < end; ++i) {
+            local.push_back({requests[i].buffer, requests[i].size});
+            remote.push_back({reinterpret_cast<void*>(requests[i].address), requests[i].size});
+            expected_size += requests[i].size;
+        }
+
+        const ssize_t read = process_vm_readv(
+            pid_,
+            local.data(),
+            local.size(),
+            remote.data(),
+            remote.size(),
+            0
+        );
+
+        // On a partial transfer fall back to one request at a time, so that
+        // the failure is reported exactly as read_memory() would.
+        if(read < 0 || static_cast<std::size_t>(read) != expected_size) {
+            const auto result = target::read_memory_scatter(requests + begin, end - begin);
+            if(!result) {
+                return result;
+            }
+        }
+    }
+
+    return {};
+}
+
+// Unlike process_vm_writev, both /proc/pid/mem and PTRACE_POKEDATA can modify
+// read only pages such as .text. Ranges longer than a word are written with a
+// single pwrite to /proc/pid/mem, PTRACE_POKEDATA (one syscall per word, the
+// last one read back first when it is only partially covered by buffer) is
+// used for the rest and as a fallback.
+auto ptrace_target::write_memory(
+    std::uintptr_t address,
+    const void* buffer,
+    std::size_t size
+) -> tl::expected<void, error::memory> {
+    if(size > word_size && write_proc_mem(pid_, address, buffer, size)) {
+        return {};
+    }
+
+    const auto* in = static_cast<const std::byte*>(buffer);
+    std::size_t done = 0;
+
+    while(done < size) {
+        const std::size_t chunk = std::min(word_size, size - done);
+        long word = 0;
+
+        if(chunk < word_size) {
+            const auto old = peek_word(pid_, address + done);
+            if(!old) {
+                return tl::make_unexpected(error::memory::write_fail);
+            }
+
+            word = *old;
+        }
+
+        std::memcpy(&word, in + done, chunk);
+
+        if(ptrace(PTRACE_POKEDATA, pid_, address + done, word) == -1) {
+            util::print_error_message("ptrace", errno);
+            return tl::make_unexpected(error::memory::write_fail);
+        }
+
+        done += chunk;
+    }
+
+    return {};
+}
+
+}
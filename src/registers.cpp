@@ -1,10 +1,12 @@
 #include "nkgt/registers.hpp"
 #include "nkgt/error_codes.hpp"
-#include "nkgt/util.hpp"
+#include "nkgt/stats.hpp"
+#include "nkgt/target.hpp"
 
-#include <cerrno>
+#include <array>
+#include <cstddef>
 #include <cstdint>
-#include <sys/ptrace.h>
+#include <cstring>
 #include <sys/user.h>
 
 #include "fmt/core.h"
@@ -12,299 +14,281 @@
 
 namespace {
 
-[[nodiscard]]
-auto get_register_value_from_user_regs(
-    const user_regs_struct& regs,
-    nkgt::registers::reg r
-) -> uint64_t {
-    using namespace nkgt::registers;
-
-    switch (r) {
-    case reg::rax:      return regs.rax;
-    case reg::rdx:      return regs.rdx;
-    case reg::rcx:      return regs.rcx;
-    case reg::rbx:      return regs.rbx;
-    case reg::rsi:      return regs.rsi;
-    case reg::rdi:      return regs.rdi;
-    case reg::rbp:      return regs.rbp;
-    case reg::rsp:      return regs.rsp;
-    case reg::r8:       return regs.r8;
-    case reg::r9:       return regs.r9;
-    case reg::r10:      return regs.r10;
-    case reg::r11:      return regs.r11;
-    case reg::r12:      return regs.r12;
-    case reg::r13:      return regs.r13;
-    case reg::r14:      return regs.r14;
-    case reg::r15:      return regs.r15;
-    case reg::eflags:   return regs.eflags;
-    case reg::es:       return regs.es;
-    case reg::cs:       return regs.cs;
-    case reg::ss:       return regs.ss;
-    case reg::ds:       return regs.ds;
-    case reg::fs:       return regs.fs;
-    case reg::gs:       return regs.gs;
-    case reg::fs_base:  return regs.fs_base;
-    case reg::gs_base:  return regs.gs_base;
-    case reg::orig_rax: return regs.orig_rax;
-    case reg::rip:      return regs.rip;
+using nkgt::registers::reg;
+using nkgt::registers::reg_descriptor;
+
+#define NKGT_REG(r, dwarf_r) \
+    reg_descriptor{reg::r, dwarf_r, #r, offsetof(user_regs_struct, r), sizeof(user_regs_struct::r)}
+
+// Sorted in the order used by dump_registers(). The DWARF numbers are the ones
+// of the System V x86_64 psABI, figure 3.36.
+constexpr std::array<reg_descriptor, nkgt::registers::register_count> descriptors = {{
+    NKGT_REG(rax,       0),
+    NKGT_REG(rdx,       1),
+    NKGT_REG(rcx,       2),
+    NKGT_REG(rbx,       3),
+    NKGT_REG(rsi,       4),
+    NKGT_REG(rdi,       5),
+    NKGT_REG(rbp,       6),
+    NKGT_REG(rsp,       7),
+    NKGT_REG(r8,        8),
+    NKGT_REG(r9,        9),
+    NKGT_REG(r10,      10),
+    NKGT_REG(r11,      11),
+    NKGT_REG(r12,      12),
+    NKGT_REG(r13,      13),
+    NKGT_REG(r14,      14),
+    NKGT_REG(r15,      15),
+    NKGT_REG(eflags,   49),
+    NKGT_REG(es,       50),
+    NKGT_REG(cs,       51),
+    NKGT_REG(ss,       52),
+    NKGT_REG(ds,       53),
+    NKGT_REG(fs,       54),
+    NKGT_REG(gs,       55),
+    NKGT_REG(fs_base,  58),
+    NKGT_REG(gs_base,  59),
+    NKGT_REG(orig_rax, -1),
+    NKGT_REG(rip,      16),
+}};
+
+#undef NKGT_REG
+
+// Position in descriptors of every value of reg.
+constexpr auto make_reg_index() -> std::array<std::size_t, nkgt::registers::register_count> {
+    std::array<std::size_t, nkgt::registers::register_count> index = {};
+
+    for(std::size_t i = 0; i < descriptors.size(); ++i) {
+        index[static_cast<std::size_t>(descriptors[i].r)] = i;
     }
+
+    return index;
 }
 
-[[nodiscard]]
-auto get_register_value_from_user_regs(
-    const user_regs_struct& regs,
-    unsigned dwarf_number
-) -> tl::expected<uint64_t, nkgt::error::registers> {
-    switch (dwarf_number) {
-    case 0:  return regs.rax;
-    case 1:  return regs.rdx;
-    case 2:  return regs.rcx;
-    case 3:  return regs.rbx;
-    case 4:  return regs.rsi;
-    case 5:  return regs.rdi;
-    case 6:  return regs.rbp;
-    case 7:  return regs.rsp;
-    case 8:  return regs.r8;
-    case 9:  return regs.r9;
-    case 10: return regs.r10;
-    case 11: return regs.r11;
-    case 12: return regs.r12;
-    case 13: return regs.r13;
-    case 14: return regs.r14;
-    case 15: return regs.r15;
-    case 49: return regs.eflags;
-    case 50: return regs.es;
-    case 51: return regs.cs;
-    case 52: return regs.ss;
-    case 53: return regs.ds;
-    case 54: return regs.fs;
-    case 55: return regs.gs;
-    case 58: return regs.fs_base;
-    case 59: return regs.gs_base;
-    default: return tl::make_unexpected(nkgt::error::registers::unknown_dwarf_number);
+constexpr auto reg_index = make_reg_index();
+
+// Position in descriptors of every DWARF register number, -1 if unused.
+constexpr std::size_t max_dwarf_number = 59;
+
+constexpr auto make_dwarf_index() -> std::array<int, max_dwarf_number + 1> {
+    std::array<int, max_dwarf_number + 1> index = {};
+
+    for(auto& i : index) {
+        i = -1;
+    }
+
+    for(std::size_t i = 0; i < descriptors.size(); ++i) {
+        if(descriptors[i].dwarf_r >= 0) {
+            index[static_cast<std::size_t>(descriptors[i].dwarf_r)] = static_cast<int>(i);
+        }
     }
+
+    return index;
 }
 
-auto set_register_value_to_user_regs(
-    user_regs_struct& regs,
-    nkgt::registers::reg r,
-    uint64_t value
-) -> void {
-    using namespace nkgt::registers;
-
-    switch (r) {
-    case reg::rax:      regs.rax = value; return;
-    case reg::rdx:      regs.rdx = value; return;
-    case reg::rcx:      regs.rcx = value; return;
-    case reg::rbx:      regs.rbx = value; return;
-    case reg::rsi:      regs.rsi = value; return;
-    case reg::rdi:      regs.rdi = value; return;
-    case reg::rbp:      regs.rbp = value; return;
-    case reg::rsp:      regs.rsp = value; return;
-    case reg::r8:       regs.r8 = value; return;
-    case reg::r9:       regs.r9 = value; return;
-    case reg::r10:      regs.r10 = value; return;
-    case reg::r11:      regs.r11 = value; return;
-    case reg::r12:      regs.r12 = value; return;
-    case reg::r13:      regs.r13 = value; return;
-    case reg::r14:      regs.r14 = value; return;
-    case reg::r15:      regs.r15 = value; return;
-    case reg::eflags:   regs.eflags = value; return;
-    case reg::es:       regs.es = value; return;
-    case reg::cs:       regs.cs = value; return;
-    case reg::ss:       regs.ss = value; return;
-    case reg::ds:       regs.ds = value; return;
-    case reg::fs:       regs.fs = value; return;
-    case reg::gs:       regs.gs = value; return;
-    case reg::fs_base:  regs.fs_base = value; return;
-    case reg::gs_base:  regs.gs_base = value; return;
-    case reg::orig_rax: regs.orig_rax = value; return;
-    case reg::rip:      regs.rip = value; return;
+constexpr auto dwarf_index = make_dwarf_index();
+
+// Perfect hash of the register names. The seed of the hash is searched
+// at compile time so that every name lands in a different slot, a lookup is
+// then a hash, one table access and one string comparison.
+constexpr std::size_t name_slot_bits = 6;
+constexpr std::size_t name_slot_count = std::size_t{1} << name_slot_bits;
+
+constexpr auto hash_name(std::string_view name, uint32_t seed) -> std::size_t {
+    uint32_t hash = 2166136261u ^ seed;
+
+    for(const char c : name) {
+        hash ^= static_cast<uint8_t>(c);
+        hash *= 16777619u;
     }
+
+    // FNV-1a alone mixes the last characters poorly (r8 and r9 would almost
+    // always collide), so the MurmurHash3 finalizer is applied on top.
+    hash ^= hash >> 16;
+    hash *= 0x85ebca6bu;
+    hash ^= hash >> 13;
+    hash *= 0xc2b2ae35u;
+    hash ^= hash >> 16;
+
+    return hash >> (32 - name_slot_bits);
 }
 
-std::array<std::pair<nkgt::registers::reg, std::string>, 27> reg_name_lookup = {{
-    {nkgt::registers::reg::rax,      "rax"},
-    {nkgt::registers::reg::rdx,      "rdx"},
-    {nkgt::registers::reg::rcx,      "rcx"},
-    {nkgt::registers::reg::rbx,      "rbx"},
-    {nkgt::registers::reg::rsi,      "rsi"},
-    {nkgt::registers::reg::rdi,      "rdi"},
-    {nkgt::registers::reg::rbp,      "rbp"},
-    {nkgt::registers::reg::rsp,      "rsp"},
-    {nkgt::registers::reg::r8,       "r8"},
-    {nkgt::registers::reg::r9,       "r9"},
-    {nkgt::registers::reg::r10,      "r10"},
-    {nkgt::registers::reg::r11,      "r11"},
-    {nkgt::registers::reg::r12,      "r12"},
-    {nkgt::registers::reg::r13,      "r13"},
-    {nkgt::registers::reg::r14,      "r14"},
-    {nkgt::registers::reg::r15,      "r15"},
-    {nkgt::registers::reg::eflags,   "eflags"},
-    {nkgt::registers::reg::es,       "es"},
-    {nkgt::registers::reg::cs,       "cs"},
-    {nkgt::registers::reg::ss,       "ss"},
-    {nkgt::registers::reg::ds,       "ds"},
-    {nkgt::registers::reg::fs,       "fs"},
-    {nkgt::registers::reg::gs,       "gs"},
-    {nkgt::registers::reg::fs_base,  "fs_base"},
-    {nkgt::registers::reg::gs_base,  "gs_base"},
-    {nkgt::registers::reg::orig_rax, "orig_rax"},
-    {nkgt::registers::reg::rip,      "rip"},
-}};
+constexpr auto is_perfect(uint32_t seed) -> bool {
+    std::array<bool, name_slot_count> used = {};
 
-[[nodiscard]]
-auto query_user_regs(
-    pid_t pid
-) -> tl::expected<user_regs_struct, nkgt::error::registers> {
-    user_regs_struct regs;
-
-    if(ptrace(PTRACE_GETREGS, pid, nullptr, &regs) == -1) {
-        nkgt::util::print_error_message("ptrace", errno);
-        return tl::make_unexpected(nkgt::error::registers::getregs_fail);
+    for(const auto& d : descriptors) {
+        const std::size_t slot = hash_name(d.name, seed);
+        if(used[slot]) {
+            return false;
+        }
+
+        used[slot] = true;
+    }
+
+    return true;
+}
+
+constexpr auto find_seed() -> uint32_t {
+    uint32_t seed = 0;
+    while(!is_perfect(seed)) {
+        seed += 1;
     }
 
-    return regs;
+    return seed;
+}
+
+constexpr uint32_t name_seed = find_seed();
+
+constexpr auto make_name_slots() -> std::array<int, name_slot_count> {
+    std::array<int, name_slot_count> slots = {};
+
+    for(auto& s : slots) {
+        s = -1;
+    }
+
+    for(std::size_t i = 0; i < descriptors.size(); ++i) {
+        slots[hash_name(descriptors[i].name, name_seed)] = static_cast<int>(i);
+    }
+
+    return slots;
+}
+
+constexpr auto name_slots = make_name_slots();
+
+static_assert(reg_index[static_cast<std::size_t>(reg::rip)] == descriptors.size() - 1);
+static_assert(dwarf_index[7] >= 0 && descriptors[dwarf_index[7]].r == reg::rsp);
+
+[[nodiscard]]
+auto read_field(const user_regs_struct& regs, const reg_descriptor& d) -> uint64_t {
+    uint64_t value = 0;
+    std::memcpy(&value, reinterpret_cast<const std::byte*>(&regs) + d.offset, d.size);
+    return value;
+}
+
+auto write_field(user_regs_struct& regs, const reg_descriptor& d, uint64_t value) -> void {
+    std::memcpy(reinterpret_cast<std::byte*>(&regs) + d.offset, &value, d.size);
 }
 
 }
 
 namespace nkgt::registers {
 
+auto descriptor(reg r) -> const reg_descriptor& {
+    return descriptors[reg_index[static_cast<std::size_t>(r)]];
+}
+
 auto get_register_value(
-    pid_t pid,
+    target::target& debugee,
     reg r
 ) -> tl::expected<uint64_t, error::registers> {
-    const auto regs = query_user_regs(pid);
+    uint64_t value = 0;
+    const auto result = read_registers(debugee, &r, &value, 1);
 
-    if(!regs) {
-        return tl::make_unexpected(regs.error());
+    if(!result) {
+        return tl::make_unexpected(result.error());
     }
 
-    return get_register_value_from_user_regs(*regs, r);
+    return value;
+}
+
+auto get_register_value(const user_regs_struct& regs, reg r) -> uint64_t {
+    return read_field(regs, descriptor(r));
+}
+
+auto from_dwarf_number(unsigned dwarf_number) -> tl::expected<reg, error::registers> {
+    if(dwarf_number > max_dwarf_number || dwarf_index[dwarf_number] < 0) {
+        return tl::make_unexpected(error::registers::unknown_dwarf_number);
+    }
+
+    return descriptors[static_cast<std::size_t>(dwarf_index[dwarf_number])].r;
 }
 
 auto get_register_value_from_dwarf_number(
-    pid_t pid,
+    target::target& debugee,
     unsigned dwarf_number
 ) -> tl::expected<uint64_t, error::registers> {
-    const auto regs = query_user_regs(pid);
+    const auto r = from_dwarf_number(dwarf_number);
 
-    if(!regs) {
-        return tl::make_unexpected(regs.error());
+    if(!r) {
+        return tl::make_unexpected(r.error());
     }
 
-    return get_register_value_from_user_regs(*regs, dwarf_number);
+    return get_register_value(debugee, *r);
 }
 
 auto set_register_value(
-    pid_t pid,
+    target::target& debugee,
     reg r,
     uint64_t value
 ) -> tl::expected<void, error::registers> {
-    auto regs = query_user_regs(pid);
+    return write_registers(debugee, &r, &value, 1);
+}
 
-    if(!regs) {
-        return tl::make_unexpected(regs.error());
-    }
+auto read_registers(
+    target::target& debugee,
+    const reg* regs,
+    uint64_t* values,
+    std::size_t count
+) -> tl::expected<void, error::registers> {
+    const auto user_regs = NKGT_STATS_TIME("target/read_registers", debugee.read_registers());
 
-    set_register_value_to_user_regs(*regs, r, value);
+    if(!user_regs) {
+        return tl::make_unexpected(user_regs.error());
+    }
 
-    if(ptrace(PTRACE_SETREGS, pid, nullptr, &regs) == -1) {
-        util::print_error_message("ptrace", errno);
-        return tl::make_unexpected(error::registers::setregs_fail);
+    for(std::size_t i = 0; i < count; ++i) {
+        values[i] = read_field(*user_regs, descriptor(regs[i]));
     }
 
     return {};
 }
 
-auto to_string(reg r) -> std::string {
-    switch (r) {
-    case reg::rax:      return "rax";
-    case reg::rdx:      return "rdx";
-    case reg::rcx:      return "rcx";
-    case reg::rbx:      return "rbx";
-    case reg::rsi:      return "rsi";
-    case reg::rdi:      return "rdi";
-    case reg::rbp:      return "rbp";
-    case reg::rsp:      return "rsp";
-    case reg::r8:       return "r8";
-    case reg::r9:       return "r9";
-    case reg::r10:      return "r10";
-    case reg::r11:      return "r11";
-    case reg::r12:      return "r12";
-    case reg::r13:      return "r13";
-    case reg::r14:      return "r14";
-    case reg::r15:      return "r15";
-    case reg::eflags:   return "eflags";
-    case reg::es:       return "es";
-    case reg::cs:       return "cs";
-    case reg::ss:       return "ss";
-    case reg::ds:       return "ds";
-    case reg::fs:       return "fs";
-    case reg::gs:       return "gs";
-    case reg::fs_base:  return "fs_base";
-    case reg::gs_base:  return "gs_base";
-    case reg::orig_rax: return "orig_rax";
-    case reg::rip:      return "rip";
+auto write_registers(
+    target::target& debugee,
+    const reg* regs,
+    const uint64_t* values,
+    std::size_t count
+) -> tl::expected<void, error::registers> {
+    auto user_regs = NKGT_STATS_TIME("target/read_registers", debugee.read_registers());
+
+    if(!user_regs) {
+        return tl::make_unexpected(user_regs.error());
     }
+
+    for(std::size_t i = 0; i < count; ++i) {
+        write_field(*user_regs, descriptor(regs[i]), values[i]);
+    }
+
+    return NKGT_STATS_TIME("target/write_registers", debugee.write_registers(*user_regs));
+}
+
+auto to_string(reg r) -> std::string {
+    return std::string(descriptor(r).name);
 }
 
 auto from_string(
     std::string_view reg_str
 ) -> tl::expected<reg, error::registers> {
-    for(const auto& [r, name] : reg_name_lookup) {
-        if(name == reg_str) {
-            return r;
-        }
+    const int i = name_slots[hash_name(reg_str, name_seed)];
+
+    if(i < 0 || descriptors[static_cast<std::size_t>(i)].name != reg_str) {
+        return tl::make_unexpected(error::registers::unknown_reg_name);
     }
 
-    return tl::make_unexpected(error::registers::unknown_reg_name);
+    return descriptors[static_cast<std::size_t>(i)].r;
 }
 
-auto dump_registers(pid_t pid) -> void {
-    const auto regs = query_user_regs(pid);
+auto dump_registers(target::target& debugee) -> void {
+    const auto regs = NKGT_STATS_TIME("target/read_registers", debugee.read_registers());
 
     if(!regs) {
         fmt::print("Unable to retrieve register values\n");
         return;
     }
 
-    fmt::print("rax:      {:#018x}\n"
-               "rdx:      {:#018x}\n"
-               "rcx:      {:#018x}\n"
-               "rbx:      {:#018x}\n"
-               "rsi:      {:#018x}\n"
-               "rdi:      {:#018x}\n"
-               "rbp:      {:#018x}\n"
-               "rsp:      {:#018x}\n"
-               "r8:       {:#018x}\n"
-               "r9:       {:#018x}\n"
-               "r10:      {:#018x}\n"
-               "r11:      {:#018x}\n"
-               "r12:      {:#018x}\n"
-               "r13:      {:#018x}\n"
-               "r14:      {:#018x}\n"
-               "r15:      {:#018x}\n"
-               "eflags:   {:#018x}\n"
-               "es:       {:#018x}\n"
-               "cs:       {:#018x}\n"
-               "ss:       {:#018x}\n"
-               "ds:       {:#018x}\n"
-               "fs:       {:#018x}\n"
-               "gs:       {:#018x}\n"
-               "fs_base:  {:#018x}\n"
-               "gs_base:  {:#018x}\n"
-               "orig_rax: {:#018x}\n"
-               "rip:      {:#018x}\n",
-               regs->rax, regs->rdx, regs->rcx, regs->rbx,
-               regs->rsi, regs->rdi, regs->rbp, regs->rsp,
-               regs->r8, regs->r9, regs->r10, regs->r11,
-               regs->r12, regs->r13, regs->r14, regs->r15,
-               regs->eflags, regs->es, regs->cs, regs->ss,
-               regs->ds, regs->fs, regs->gs, regs->fs_base,
-               regs->gs_base, regs->orig_rax, regs->rip
-    );
+    for(const auto& d : descriptors) {
+        fmt::print("{:<10}{:#018x}\n", fmt::format("{}:", d.name), read_field(*regs, d));
+    }
 }
 
 }
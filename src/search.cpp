@@ -0,0 +1,465 @@
+#include "nkgt/search.hpp"
+#include "nkgt/error_codes.hpp"
+#include "nkgt/target.hpp"
+
+#include <tl/expected.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <cstring>
+#include <sys/uio.h>
+#include <thread>
+#include <unistd.h>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+namespace {
+
+// Large enough for the cost of the syscall to be negligible compared to the
+// copy, small enough to keep every worker busy on medium sized regions.
+constexpr std::size_t chunk_size = std::size_t{8} << 20;
+
+// Chunks are scanned in slices of this size, the matches past the limit of
+// find() are dropped after each of them.
+constexpr std::size_t slice_size = std::size_t{64} << 10;
+
+// Reads as much as possible of [address, address + size) and returns how
+// many bytes at the start of buffer were read. process_vm_readv stops at the
+// first page it cannot read, other targets are read a page at a time once
+// reading the whole range failed.
+[[nodiscard]]
+auto read_prefix(
+    nkgt::target::target& debugee,
+    std::uintptr_t address,
+    uint8_t* buffer,
+    std::size_t size,
+    std::size_t page_size
+) -> std::size_t {
+    if(debugee.is_live()) {
+        iovec local = {buffer, size};
+        iovec remote = {reinterpret_cast<void*>(address), size};
+        const ssize_t read = process_vm_readv(debugee.pid(), &local, 1, &remote, 1, 0);
+        return read > 0 ? static_cast<std::size_t>(read) : 0;
+    }
+
+    if(debugee.read_memory(address, buffer, size)) {
+        return size;
+    }
+
+    std::size_t done = 0;
+    while(done < size) {
+        const std::size_t chunk = std::min(size - done, page_size - (address + done) % page_size);
+        if(!debugee.read_memory(address + done, buffer + done, chunk)) {
+            break;
+        }
+
+        done += chunk;
+    }
+
+    return done;
+}
+
+// Keeps only the max lowest addresses of matches, in no particular order, and
+// adds the number of the others to dropped.
+auto keep_lowest(std::vector<std::uintptr_t>& matches, std::size_t max, std::size_t& dropped) -> void {
+    if(matches.size() <= max) {
+        return;
+    }
+
+    const auto limit = matches.begin() + static_cast<std::ptrdiff_t>(max);
+    std::nth_element(matches.begin(), limit, matches.end());
+    dropped += matches.size() - max;
+    matches.erase(limit, matches.end());
+}
+
+struct scan_context {
+    const uint8_t* data;
+    const nkgt::search::pattern& p;
+    // Index of the byte of the pattern looked for with SIMD instructions.
+    std::size_t anchor;
+    std::uintptr_t base;
+    std::vector<std::uintptr_t>& out;
+};
+
+[[nodiscard]]
+auto matches_at(const uint8_t* data, const nkgt::search::pattern& p) -> bool {
+    for(std::size_t i = 0; i < p.bytes.size(); ++i) {
+        if((data[i] & p.mask[i]) != p.bytes[i]) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// Called for every position j where the anchor byte was found.
+auto verify_candidate(const scan_context& c, std::size_t j) -> void {
+    const std::size_t start = j - c.anchor;
+    if(matches_at(c.data + start, c.p)) {
+        c.out.push_back(c.base + start);
+    }
+}
+
+auto scan_anchor_portable(
+    const scan_context& c,
+    std::size_t begin,
+    std::size_t end
+) -> void {
+    const uint8_t needle = c.p.bytes[c.anchor];
+    std::size_t j = begin;
+
+    while(j < end) {
+        const void* hit = std::memchr(c.data + j, needle, end - j);
+        if(hit == nullptr) {
+            return;
+        }
+
+        j = static_cast<std::size_t>(static_cast<const uint8_t*>(hit) - c.data);
+        verify_candidate(c, j);
+        j += 1;
+    }
+}
+
+#if defined(__x86_64__)
+auto scan_anchor_sse2(
+    const scan_context& c,
+    std::size_t begin,
+    std::size_t end
+) -> void {
+    const __m128i needle = _mm_set1_epi8(static_cast<char>(c.p.bytes[c.anchor]));
+    std::size_t j = begin;
+
+    for(; j + 16 <= end; j += 16) {
+        const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(c.data + j));
+        auto hits = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(block, needle)));
+
+        while(hits != 0) {
+            verify_candidate(c, j + static_cast<std::size_t>(__builtin_ctz(hits)));
+            hits &= hits - 1;
+        }
+    }
+
+    scan_anchor_portable(c, j, end);
+}
+
+__attribute__((target("avx2")))
+auto scan_anchor_avx2(
+    const scan_context& c,
+    std::size_t begin,
+    std::size_t end
+) -> void {
+    const __m256i needle = _mm256_set1_epi8(static_cast<char>(c.p.bytes[c.anchor]));
+    std::size_t j = begin;
+
+    for(; j + 32 <= end; j += 32) {
+        const __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(c.data + j));
+        auto hits = static_cast<unsigned>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, needle)));
+
+        while(hits != 0) {
+            verify_candidate(c, j + static_cast<std::size_t>(__builtin_ctz(hits)));
+            hits &= hits - 1;
+        }
+    }
+
+    scan_anchor_sse2(c, j, end);
+}
+#endif
+
+[[nodiscard]]
+auto parse_hex_nibble(char c) -> tl::expected<uint8_t, nkgt::error::search> {
+    if(c >= '0' && c <= '9') return static_cast<uint8_t>(c - '0');
+    if(c >= 'a' && c <= 'f') return static_cast<uint8_t>(c - 'a' + 10);
+    if(c >= 'A' && c <= 'F') return static_cast<uint8_t>(c - 'A' + 10);
+
+    return tl::make_unexpected(nkgt::error::search::malformed_pattern);
+}
+
+[[nodiscard]]
+auto parse_bytes(std::string_view s) -> tl::expected<nkgt::search::pattern, nkgt::error::search> {
+    if(s.size() % 2 != 0) {
+        return tl::make_unexpected(nkgt::error::search::malformed_pattern);
+    }
+
+    nkgt::search::pattern p;
+    for(std::size_t i = 0; i < s.size(); i += 2) {
+        uint8_t byte = 0;
+        uint8_t mask = 0;
+
+        for(std::size_t n = 0; n < 2; ++n) {
+            byte = static_cast<uint8_t>(byte << 4);
+            mask = static_cast<uint8_t>(mask << 4);
+
+            if(s[i + n] == '?') {
+                continue;
+            }
+
+            const auto nibble = parse_hex_nibble(s[i + n]);
+            if(!nibble) {
+                return tl::make_unexpected(nibble.error());
+            }
+
+            byte = static_cast<uint8_t>(byte | *nibble);
+            mask = static_cast<uint8_t>(mask | 0xf);
+        }
+
+        p.bytes.push_back(byte);
+        p.mask.push_back(mask);
+    }
+
+    return p;
+}
+
+[[nodiscard]]
+auto parse_integer(
+    std::string_view s,
+    std::size_t width
+) -> tl::expected<nkgt::search::pattern, nkgt::error::search> {
+    int base = 10;
+    if(s.substr(0, 2) == "0x") {
+        s.remove_prefix(2);
+        base = 16;
+    }
+
+    uint64_t value = 0;
+    const auto [end, ec] = std::from_chars(s.data(), s.data() + s.size(), value, base);
+    if(ec != std::errc() || end != s.data() + s.size()) {
+        return tl::make_unexpected(nkgt::error::search::malformed_pattern);
+    }
+
+    if(width < sizeof(uint64_t) && value >> (width * 8) != 0) {
+        return tl::make_unexpected(nkgt::error::search::malformed_pattern);
+    }
+
+    nkgt::search::pattern p;
+    for(std::size_t i = 0; i < width; ++i) {
+        p.bytes.push_back(static_cast<uint8_t>(value >> (i * 8)));
+        p.mask.push_back(0xff);
+    }
+
+    return p;
+}
+
+// Sorts the ranges and merges the ones that touch, so that matches crossing
+// the boundary between two adjacent mappings are found too.
+[[nodiscard]]
+auto coalesce(
+    std::vector<nkgt::search::address_range> ranges
+) -> std::vector<nkgt::search::address_range> {
+    std::sort(
+        ranges.begin(),
+        ranges.end(),
+        [](const auto& a, const auto& b) { return a.start < b.start; }
+    );
+
+    std::vector<nkgt::search::address_range> merged;
+    for(const auto& r : ranges) {
+        if(r.start >= r.end) {
+            continue;
+        }
+
+        if(!merged.empty() && merged.back().end >= r.start) {
+            merged.back().end = std::max(merged.back().end, r.end);
+        } else {
+            merged.push_back(r);
+        }
+    }
+
+    return merged;
+}
+
+}
+
+namespace nkgt::search {
+
+auto parse_pattern(std::string_view s) -> tl::expected<pattern, error::search> {
+    const std::size_t colon = s.find(':');
+    if(colon == std::string_view::npos) {
+        return tl::make_unexpected(error::search::malformed_pattern);
+    }
+
+    const std::string_view kind = s.substr(0, colon);
+    const std::string_view value = s.substr(colon + 1);
+
+    if(value.empty()) {
+        return tl::make_unexpected(error::search::empty_pattern);
+    }
+
+    if(kind == "str") {
+        pattern p;
+        p.bytes.assign(value.begin(), value.end());
+        p.mask.assign(value.size(), 0xff);
+        return p;
+    } else if(kind == "bytes") {
+        return parse_bytes(value);
+    } else if(kind == "u8") {
+        return parse_integer(value, 1);
+    } else if(kind == "u16") {
+        return parse_integer(value, 2);
+    } else if(kind == "u32") {
+        return parse_integer(value, 4);
+    } else if(kind == "u64") {
+        return parse_integer(value, 8);
+    }
+
+    return tl::make_unexpected(error::search::malformed_pattern);
+}
+
+auto scan(
+    const uint8_t* data,
+    std::size_t search_size,
+    std::size_t size,
+    const pattern& p,
+    std::uintptr_t base,
+    std::vector<std::uintptr_t>& out
+) -> void {
+    const std::size_t length = p.bytes.size();
+    if(length == 0 || size < length) {
+        return;
+    }
+
+    // Last position where a match can start.
+    const std::size_t last = std::min(search_size, size - length + 1);
+
+    const auto anchor = static_cast<std::size_t>(
+        std::find(p.mask.cbegin(), p.mask.cend(), 0xff) - p.mask.cbegin()
+    );
+
+    // Without a byte to look for every position has to be verified.
+    if(anchor == length) {
+        for(std::size_t i = 0; i < last; ++i) {
+            if(matches_at(data + i, p)) {
+                out.push_back(base + i);
+            }
+        }
+
+        return;
+    }
+
+    const scan_context c = {data, p, anchor, base, out};
+
+#if defined(__x86_64__)
+    static const bool has_avx2 = __builtin_cpu_supports("avx2");
+
+    if(has_avx2) {
+        scan_anchor_avx2(c, anchor, last + anchor);
+    } else {
+        scan_anchor_sse2(c, anchor, last + anchor);
+    }
+#else
+    scan_anchor_portable(c, anchor, last + anchor);
+#endif
+}
+
+auto find(
+    target::target& debugee,
+    const std::vector<address_range>& ranges,
+    const pattern& p,
+    std::size_t max_matches
+) -> find_result {
+    struct chunk {
+        std::uintptr_t start;
+        std::size_t search_size;
+        std::size_t read_size;
+    };
+
+    // Every chunk is read together with the first length - 1 bytes of the
+    // next one, so that a match crossing the boundary is seen entirely.
+    const std::size_t overlap = p.bytes.size() - 1;
+    const auto page_size = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+    std::vector<chunk> chunks;
+
+    for(const auto& r : coalesce(ranges)) {
+        for(std::uintptr_t start = r.start; start < r.end; start += chunk_size) {
+            const std::size_t search_size = std::min(chunk_size, r.end - start);
+            const std::size_t read_size = std::min(search_size + overlap, r.end - start);
+            chunks.push_back({start, search_size, read_size});
+        }
+    }
+
+    const std::size_t worker_count = std::min<std::size_t>(
+        std::max(1u, std::thread::hardware_concurrency()),
+        chunks.size()
+    );
+
+    std::atomic<std::size_t> next_chunk = 0;
+    std::vector<std::vector<std::uintptr_t>> results(worker_count);
+    std::vector<std::size_t> unreadable(worker_count, 0);
+    std::vector<std::size_t> dropped(worker_count, 0);
+    std::vector<std::thread> workers;
+
+    for(std::size_t w = 0; w < worker_count; ++w) {
+        workers.emplace_back([&, w]() {
+            std::vector<uint8_t> buffer(chunk_size + overlap);
+
+            for(std::size_t i = next_chunk++; i < chunks.size(); i = next_chunk++) {
+                const chunk& c = chunks[i];
+
+                // The bytes read up to a page that cannot be read are scanned,
+                // then the reading resumes after that page.
+                std::size_t offset = 0;
+                while(offset < c.read_size) {
+                    const std::size_t read = read_prefix(
+                        debugee,
+                        c.start + offset,
+                        buffer.data() + offset,
+                        c.read_size - offset,
+                        page_size
+                    );
+
+                    const std::size_t search_end = std::min(c.search_size, offset + read);
+                    for(std::size_t slice = offset; slice < search_end; slice += slice_size) {
+                        scan(
+                            buffer.data() + slice,
+                            std::min(slice_size, search_end - slice),
+                            offset + read - slice,
+                            p,
+                            c.start + slice,
+                            results[w]
+                        );
+
+                        keep_lowest(results[w], max_matches, dropped[w]);
+                    }
+
+                    offset += read;
+                    if(offset == c.read_size) {
+                        break;
+                    }
+
+                    const std::size_t skipped = std::min(
+                        c.read_size - offset,
+                        page_size - (c.start + offset) % page_size
+                    );
+
+                    // The overlap belongs to the next chunk, which counts it.
+                    if(offset < c.search_size) {
+                        unreadable[w] += std::min(skipped, c.search_size - offset);
+                    }
+
+                    offset += skipped;
+                }
+            }
+        });
+    }
+
+    for(auto& worker : workers) {
+        worker.join();
+    }
+
+    find_result result;
+    for(std::size_t w = 0; w < worker_count; ++w) {
+        result.matches.insert(result.matches.end(), results[w].cbegin(), results[w].cend());
+        result.count += results[w].size() + dropped[w];
+        result.unreadable += unreadable[w];
+    }
+
+    // The matches dropped here are already in count.
+    std::size_t merged_dropped = 0;
+    keep_lowest(result.matches, max_matches, merged_dropped);
+    std::sort(result.matches.begin(), result.matches.end());
+    return result;
+}
+
+}
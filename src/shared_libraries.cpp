@@ -0,0 +1,394 @@
+#include "nkgt/shared_libraries.hpp"
+#include "nkgt/error_codes.hpp"
+#include "nkgt/stats.hpp"
+
+#include <fmt/core.h>
+#include <tl/expected.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <elf.h>
+#include <fstream>
+#include <link.h>
+#include <unordered_map>
+
+namespace {
+
+// Bound on the length of the chain, in case the debugee corrupted it into a
+// cycle.
+constexpr std::size_t max_link_map_entries = 1 << 16;
+
+constexpr std::size_t max_path_length = 4096;
+constexpr std::size_t page_size = 4096;
+
+// The auxiliary vector entries the tracker needs.
+struct auxv {
+    std::uintptr_t base = 0;
+    std::uintptr_t phdr = 0;
+    std::size_t phnum = 0;
+};
+
+[[nodiscard]]
+auto read_auxv(pid_t pid) -> std::optional<auxv> {
+    std::ifstream file(fmt::format("/proc/{}/auxv", pid), std::ios::binary);
+    if(!file) {
+        return std::nullopt;
+    }
+
+    auxv result;
+    Elf64_auxv_t entry;
+    while(file.read(reinterpret_cast<char*>(&entry), sizeof(entry)) && entry.a_type != AT_NULL) {
+        switch(entry.a_type) {
+        case AT_BASE:
+            result.base = entry.a_un.a_val;
+            break;
+        case AT_PHDR:
+            result.phdr = entry.a_un.a_val;
+            break;
+        case AT_PHNUM:
+            result.phnum = entry.a_un.a_val;
+            break;
+        default:
+            break;
+        }
+    }
+
+    return result;
+}
+
+// Reads a NUL terminated string without crossing into a page that may not be
+// mapped, since the read of a range fails as a whole.
+[[nodiscard]]
+auto read_string(
+    nkgt::target::target& debugee,
+    std::uintptr_t address
+) -> std::optional<std::string> {
+    std::string result;
+    std::array<char, 256> chunk;
+
+    while(result.size() < max_path_length) {
+        const std::size_t size = std::min(chunk.size(), page_size - address % page_size);
+        if(!debugee.read_memory(address, chunk.data(), size)) {
+            return std::nullopt;
+        }
+
+        const auto* end = static_cast<const char*>(std::memchr(chunk.data(), 0, size));
+        if(end != nullptr) {
+            result.append(chunk.data(), static_cast<std::size_t>(end - chunk.data()));
+            return result;
+        }
+
+        result.append(chunk.data(), size);
+        address += size;
+    }
+
+    return result;
+}
+
+}
+
+namespace nkgt::shared_libraries {
+
+auto operator==(const link_entry& a, const link_entry& b) -> bool {
+    return a.node == b.node &&
+           a.load_bias == b.load_bias &&
+           a.name_address == b.name_address &&
+           a.path == b.path;
+}
+
+auto read_link_map(
+    target::target& debugee,
+    std::uintptr_t head,
+    const std::vector<link_entry>& known
+) -> tl::expected<std::vector<link_entry>, error::shared_libraries> {
+    std::unordered_map<std::uintptr_t, const link_entry*> known_nodes;
+    for(const auto& entry : known) {
+        known_nodes.emplace(entry.node, &entry);
+    }
+
+    std::vector<link_entry> entries;
+    std::uintptr_t node = head;
+
+    while(node != 0) {
+        if(entries.size() == max_link_map_entries) {
+            return tl::make_unexpected(error::shared_libraries::read_fail);
+        }
+
+        link_map map;
+        if(!debugee.read_memory(node, &map, sizeof(map))) {
+            return tl::make_unexpected(error::shared_libraries::read_fail);
+        }
+
+        link_entry entry = {
+            node,
+            map.l_addr,
+            reinterpret_cast<std::uintptr_t>(map.l_name),
+            {}
+        };
+
+        const auto it = known_nodes.find(node);
+        if(it != known_nodes.cend() &&
+           it->second->load_bias == entry.load_bias &&
+           it->second->name_address == entry.name_address) {
+            entry.path = it->second->path;
+        } else if(entry.name_address != 0) {
+            auto path = read_string(debugee, entry.name_address);
+            if(!path) {
+                return tl::make_unexpected(error::shared_libraries::read_fail);
+            }
+
+            entry.path = std::move(*path);
+        }
+
+        entries.push_back(std::move(entry));
+        node = reinterpret_cast<std::uintptr_t>(map.l_next);
+    }
+
+    return entries;
+}
+
+auto diff(
+    const std::vector<link_entry>& before,
+    const std::vector<link_entry>& after
+) -> link_map_diff {
+    const auto by_node = [](const std::vector<link_entry>& entries) {
+        std::unordered_map<std::uintptr_t, const link_entry*> nodes;
+        for(const auto& entry : entries) {
+            nodes.emplace(entry.node, &entry);
+        }
+
+        return nodes;
+    };
+
+    const auto before_nodes = by_node(before);
+    const auto after_nodes = by_node(after);
+    link_map_diff result;
+
+    for(const auto& entry : after) {
+        const auto it = before_nodes.find(entry.node);
+        if(it == before_nodes.cend() || !(*it->second == entry)) {
+            result.added.push_back(entry);
+        }
+    }
+
+    for(const auto& entry : before) {
+        const auto it = after_nodes.find(entry.node);
+        if(it == after_nodes.cend() || !(*it->second == entry)) {
+            result.removed.push_back(entry);
+        }
+    }
+
+    return result;
+}
+
+auto library::symbols() const -> const symbols::symbol_table* {
+    const auto& table = symbols_.get();
+    return table ? &*table : nullptr;
+}
+
+auto library::resolve(std::string_view name) const -> std::optional<std::uintptr_t> {
+    const auto* table = symbols();
+    const auto* function = table != nullptr ? table->find(name) : nullptr;
+
+    if(function == nullptr) {
+        return std::nullopt;
+    }
+
+    return entry_.load_bias + function->address;
+}
+
+auto library::contains(std::uintptr_t address) const -> bool {
+    const auto* table = symbols();
+    return table != nullptr &&
+           address >= entry_.load_bias &&
+           table->lookup(address - entry_.load_bias) != nullptr;
+}
+
+tracker::tracker(
+    std::uintptr_t breakpoint_address,
+    std::uintptr_t dynamic_address
+) : breakpoint_address_(breakpoint_address),
+    dynamic_address_(dynamic_address),
+    loader_([this]() { load_symbols(); }) {}
+
+tracker::~tracker() {
+    {
+        std::lock_guard lock(mutex_);
+        stopping_ = true;
+    }
+
+    wake_.notify_one();
+    loader_.join();
+}
+
+auto tracker::update(
+    target::target& debugee
+) -> tl::expected<library_changes, error::shared_libraries> {
+    NKGT_STATS_SCOPE("shared_libraries/update");
+
+    // The loader fills DT_DEBUG before reporting the first change.
+    if(r_debug_address_ == 0) {
+        for(std::uintptr_t address = dynamic_address_;; address += sizeof(Elf64_Dyn)) {
+            Elf64_Dyn entry;
+            if(!debugee.read_memory(address, &entry, sizeof(entry))) {
+                return tl::make_unexpected(error::shared_libraries::read_fail);
+            }
+
+            if(entry.d_tag == DT_NULL) {
+                break;
+            }
+
+            if(entry.d_tag == DT_DEBUG) {
+                r_debug_address_ = entry.d_un.d_ptr;
+                break;
+            }
+        }
+
+        if(r_debug_address_ == 0) {
+            return library_changes{};
+        }
+    }
+
+    r_debug rendezvous;
+    if(!debugee.read_memory(r_debug_address_, &rendezvous, sizeof(rendezvous))) {
+        return tl::make_unexpected(error::shared_libraries::read_fail);
+    }
+
+    // The list is only walked once the loader is done with it, that is on
+    // the second of the two calls surrounding each change.
+    if(rendezvous.r_state != r_debug::RT_CONSISTENT) {
+        return library_changes{};
+    }
+
+    auto entries = read_link_map(debugee, reinterpret_cast<std::uintptr_t>(rendezvous.r_map), entries_);
+    if(!entries) {
+        return tl::make_unexpected(entries.error());
+    }
+
+    const auto changes = diff(entries_, *entries);
+    entries_ = std::move(*entries);
+
+    library_changes result;
+
+    for(const auto& entry : changes.removed) {
+        const auto it = std::find_if(libraries_.begin(), libraries_.end(), [&](const auto& l) {
+            return l->entry() == entry;
+        });
+
+        if(it != libraries_.end()) {
+            result.unloaded.push_back(std::move(*it));
+            libraries_.erase(it);
+        }
+    }
+
+    {
+        std::lock_guard lock(mutex_);
+
+        for(const auto& entry : changes.added) {
+            // The program itself has no name and the vDSO has no file.
+            if(entry.path.find('/') == std::string::npos) {
+                continue;
+            }
+
+            job j = {entry.path, {}};
+            libraries_.push_back(std::make_unique<library>(entry, j.symbols.get_future().share()));
+            result.loaded.push_back(libraries_.back().get());
+            jobs_.push_back(std::move(j));
+        }
+    }
+
+    wake_.notify_one();
+    return result;
+}
+
+auto tracker::resolve(
+    std::string_view name
+) const -> std::optional<std::pair<std::uintptr_t, const library*>> {
+    for(const auto& l : libraries_) {
+        if(const auto address = l->resolve(name)) {
+            return std::make_pair(*address, l.get());
+        }
+    }
+
+    return std::nullopt;
+}
+
+auto tracker::load_symbols() -> void {
+    while(true) {
+        job next;
+
+        {
+            std::unique_lock lock(mutex_);
+            wake_.wait(lock, [this]() { return stopping_ || !jobs_.empty(); });
+
+            // Whatever is left is not needed anymore.
+            if(stopping_) {
+                return;
+            }
+
+            next = std::move(jobs_.front());
+            jobs_.pop_front();
+        }
+
+        auto table = NKGT_STATS_TIME("elf/load_symbols", symbols::load_symbols(next.path));
+        next.symbols.set_value(table ? std::make_optional(std::move(*table)) : std::nullopt);
+    }
+}
+
+auto start_tracking(
+    target::target& debugee,
+    maps::address_space& memory_map
+) -> tl::expected<std::unique_ptr<tracker>, error::shared_libraries> {
+    const auto aux = read_auxv(debugee.pid());
+    if(!aux) {
+        return tl::make_unexpected(error::shared_libraries::auxv_fail);
+    }
+
+    // AT_BASE is where the kernel mapped the interpreter, 0 when there is
+    // none.
+    if(aux->base == 0 || aux->phdr == 0) {
+        return tl::make_unexpected(error::shared_libraries::static_program);
+    }
+
+    std::vector<Elf64_Phdr> headers(aux->phnum);
+    if(!debugee.read_memory(aux->phdr, headers.data(), headers.size() * sizeof(Elf64_Phdr))) {
+        return tl::make_unexpected(error::shared_libraries::read_fail);
+    }
+
+    const auto find_header = [&](Elf64_Word type) {
+        return std::find_if(headers.cbegin(), headers.cend(), [type](const Elf64_Phdr& h) {
+            return h.p_type == type;
+        });
+    };
+
+    const auto phdr = find_header(PT_PHDR);
+    const auto dynamic = find_header(PT_DYNAMIC);
+    if(phdr == headers.cend() || dynamic == headers.cend()) {
+        return tl::make_unexpected(error::shared_libraries::static_program);
+    }
+
+    const std::uintptr_t program_bias = aux->phdr - phdr->p_vaddr;
+
+    const auto* loader = memory_map.find(aux->base);
+    if(loader == nullptr || loader->path.empty()) {
+        return tl::make_unexpected(error::shared_libraries::loader_not_found);
+    }
+
+    const auto loader_symbols = NKGT_STATS_TIME("elf/load_symbols", symbols::load_symbols(loader->path));
+    if(!loader_symbols) {
+        return tl::make_unexpected(error::shared_libraries::loader_not_found);
+    }
+
+    const auto* rendezvous = loader_symbols->find("_dl_debug_state");
+    if(rendezvous == nullptr) {
+        return tl::make_unexpected(error::shared_libraries::loader_not_found);
+    }
+
+    return std::make_unique<tracker>(
+        aux->base - loader_symbols->load_base() + rendezvous->address,
+        program_bias + dynamic->p_vaddr
+    );
+}
+
+}
@@ -0,0 +1,254 @@
+#include "nkgt/snapshot.hpp"
+#include "nkgt/checkpoint.hpp"
+#include "nkgt/error_codes.hpp"
+#include "nkgt/maps.hpp"
+#include "nkgt/target.hpp"
+#include "nkgt/util.hpp"
+
+#include <tl/expected.hpp>
+
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <fcntl.h>
+#include <fmt/core.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+// Bit 55 of a /proc/pid/pagemap entry is set when the page has been written
+// since the soft-dirty bits were last cleared. See
+// Documentation/admin-guide/mm/soft-dirty.rst in the kernel sources.
+constexpr uint64_t pagemap_soft_dirty = uint64_t{1} << 55;
+
+// Writing 4 to /proc/pid/clear_refs clears the soft-dirty bits of all the
+// pages of the process.
+[[nodiscard]]
+auto clear_soft_dirty(pid_t pid) -> bool {
+    const int fd = open(fmt::format("/proc/{}/clear_refs", pid).c_str(), O_WRONLY | O_CLOEXEC);
+    if(fd == -1) {
+        nkgt::util::print_error_message("open", errno);
+        return false;
+    }
+
+    const bool result = write(fd, "4", 1) == 1;
+    if(!result) {
+        nkgt::util::print_error_message("write", errno);
+    }
+
+    close(fd);
+    return result;
+}
+
+// Merges consecutive soft-dirty pages of the writable regions of pid into
+// ranges, so that each one can be fetched with a single read.
+[[nodiscard]]
+auto dirty_ranges(
+    pid_t pid,
+    std::size_t page_size
+) -> tl::expected<std::vector<nkgt::snapshot::byte_range>, nkgt::error::snapshot> {
+    const auto regions = nkgt::maps::read_maps(pid);
+    if(!regions) {
+        return tl::make_unexpected(nkgt::error::snapshot::pagemap_fail);
+    }
+
+    const int fd = open(fmt::format("/proc/{}/pagemap", pid).c_str(), O_RDONLY | O_CLOEXEC);
+    if(fd == -1) {
+        nkgt::util::print_error_message("open", errno);
+        return tl::make_unexpected(nkgt::error::snapshot::pagemap_fail);
+    }
+
+    std::vector<nkgt::snapshot::byte_range> ranges;
+    std::vector<uint64_t> entries;
+
+    for(const auto& region : *regions) {
+        // Guard pages and the like cannot hold any data.
+        if(!region.readable) {
+            continue;
+        }
+
+        const std::size_t pages = (region.end - region.start) / page_size;
+        entries.resize(pages);
+
+        const auto offset = static_cast<off_t>(region.start / page_size * sizeof(uint64_t));
+        const ssize_t read = pread(fd, entries.data(), pages * sizeof(uint64_t), offset);
+        if(read < 0) {
+            // Some special regions such as [vsyscall] cannot be read.
+            continue;
+        }
+
+        const std::size_t valid = static_cast<std::size_t>(read) / sizeof(uint64_t);
+        for(std::size_t i = 0; i < valid; ++i) {
+            if((entries[i] & pagemap_soft_dirty) == 0) {
+                continue;
+            }
+
+            const std::uintptr_t address = region.start + i * page_size;
+            if(!ranges.empty() && ranges.back().start + ranges.back().size == address) {
+                ranges.back().size += page_size;
+            } else {
+                ranges.push_back({address, page_size});
+            }
+        }
+    }
+
+    close(fd);
+    return ranges;
+}
+
+}
+
+namespace nkgt::snapshot {
+
+auto take(target::target& debugee) -> tl::expected<pid_t, error::snapshot> {
+    const auto child = checkpoint::fork_debugee(debugee);
+    if(!child) {
+        return tl::make_unexpected(error::snapshot::fork_fail);
+    }
+
+    if(!clear_soft_dirty(debugee.pid())) {
+        kill(*child, SIGKILL);
+        waitpid(*child, nullptr, __WALL);
+        return tl::make_unexpected(error::snapshot::clear_refs_fail);
+    }
+
+    return *child;
+}
+
+auto diff(
+    target::target& debugee,
+    pid_t snapshot_pid,
+    const std::vector<patch>& patches
+) -> tl::expected<std::vector<byte_range>, error::snapshot> {
+    const auto page_size = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+
+    const auto ranges = dirty_ranges(debugee.pid(), page_size);
+    if(!ranges) {
+        return tl::make_unexpected(ranges.error());
+    }
+
+    target::ptrace_target snapshot(snapshot_pid);
+    std::vector<byte_range> result;
+    std::vector<std::byte> current;
+    std::vector<std::byte> old;
+
+    for(const auto& range : *ranges) {
+        current.resize(range.size);
+        old.resize(range.size);
+
+        if(!debugee.read_memory(range.start, current.data(), range.size)) {
+            return tl::make_unexpected(error::snapshot::read_fail);
+        }
+
+        hide_patches(current.data(), range.start, range.size, patches);
+
+        if(snapshot.read_memory(range.start, old.data(), range.size)) {
+            hide_patches(old.data(), range.start, range.size, patches);
+            diff_bytes(old.data(), current.data(), range.size, range.start, result);
+            continue;
+        }
+
+        // Some of the pages did not exist at the time of the snapshot, fall
+        // back to a page by page comparison.
+        for(std::size_t offset = 0; offset < range.size; offset += page_size) {
+            if(snapshot.read_memory(range.start + offset, old.data() + offset, page_size)) {
+                hide_patches(old.data() + offset, range.start + offset, page_size, patches);
+                diff_bytes(
+                    old.data() + offset,
+                    current.data() + offset,
+                    page_size,
+                    range.start + offset,
+                    result
+                );
+            } else if(!result.empty() && result.back().start + result.back().size == range.start + offset) {
+                result.back().size += page_size;
+            } else {
+                result.push_back({range.start + offset, page_size});
+            }
+        }
+    }
+
+    return result;
+}
+
+auto hide_patches(
+    std::byte* buffer,
+    std::uintptr_t address,
+    std::size_t size,
+    const std::vector<patch>& patches
+) -> void {
+    for(const auto& p : patches) {
+        if(p.address >= address && p.address - address < size) {
+            buffer[p.address - address] = static_cast<std::byte>(p.original);
+        }
+    }
+}
+
+auto diff_bytes(
+    const std::byte* a,
+    const std::byte* b,
+    std::size_t size,
+    std::uintptr_t base,
+    std::vector<byte_range>& out
+) -> void {
+    // Ranges can span multiple calls, e.g. when a write crosses a page
+    // boundary, so the last one is extended if it ends exactly at base.
+    auto mark = [&](std::size_t i) {
+        const std::uintptr_t address = base + i;
+        if(!out.empty() && out.back().start + out.back().size == address) {
+            out.back().size += 1;
+        } else {
+            out.push_back({address, 1});
+        }
+    };
+
+    std::size_t i = 0;
+
+#if defined(__SSE2__)
+    for(; i + 16 <= size; i += 16) {
+        const __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+        const __m128i y = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+        const int equal = _mm_movemask_epi8(_mm_cmpeq_epi8(x, y));
+
+        if(equal == 0xffff) {
+            continue;
+        }
+
+        for(std::size_t j = 0; j < 16; ++j) {
+            if((equal & (1 << j)) == 0) {
+                mark(i + j);
+            }
+        }
+    }
+#else
+    for(; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t)) {
+        uint64_t x;
+        uint64_t y;
+        std::memcpy(&x, a + i, sizeof(x));
+        std::memcpy(&y, b + i, sizeof(y));
+
+        if(x == y) {
+            continue;
+        }
+
+        for(std::size_t j = 0; j < sizeof(uint64_t); ++j) {
+            if(a[i + j] != b[i + j]) {
+                mark(i + j);
+            }
+        }
+    }
+#endif
+
+    for(; i < size; ++i) {
+        if(a[i] != b[i]) {
+            mark(i);
+        }
+    }
+}
+
+}
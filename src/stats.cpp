@@ -0,0 +1,207 @@
+#include "nkgt/stats.hpp"
+#include "nkgt/error_codes.hpp"
+
+#include <fmt/core.h>
+#include <fmt/format.h>
+#include <tl/expected.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace {
+
+// Head of the list of the call sites, which are only ever added. Constant
+// initialized, so that sites reached during static initialization are safe.
+std::atomic<nkgt::stats::call_site*> first_site = nullptr;
+
+auto file_name(const char* path) -> std::string_view {
+    const std::string_view p = path;
+    const auto slash = p.rfind('/');
+    return slash == std::string_view::npos ? p : p.substr(slash + 1);
+}
+
+}
+
+namespace nkgt::stats {
+
+auto format_duration(uint64_t ns) -> std::string {
+    if(ns < 1'000) {
+        return fmt::format("{}ns", ns);
+    }
+
+    if(ns < 1'000'000) {
+        return fmt::format("{:.1f}us", static_cast<double>(ns) / 1e3);
+    }
+
+    if(ns < 1'000'000'000) {
+        return fmt::format("{:.1f}ms", static_cast<double>(ns) / 1e6);
+    }
+
+    return fmt::format("{:.2f}s", static_cast<double>(ns) / 1e9);
+}
+
+auto histogram::percentile(double p) const -> uint64_t {
+    const uint64_t total = count();
+    if(total == 0) {
+        return 0;
+    }
+
+    // Rank of the value we are looking for, starting from 1.
+    const auto rank = std::max<uint64_t>(
+        1,
+        static_cast<uint64_t>(std::ceil(p * static_cast<double>(total)))
+    );
+
+    uint64_t seen = 0;
+    for(std::size_t i = 0; i < bucket_count; ++i) {
+        seen += buckets_[i].load(std::memory_order_relaxed);
+
+        if(seen >= rank) {
+            return std::min(bucket_upper_bound(i), max());
+        }
+    }
+
+    // Only reachable while other threads are recording.
+    return max();
+}
+
+auto histogram::reset() -> void {
+    for(auto& bucket : buckets_) {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+
+    count_.store(0, std::memory_order_relaxed);
+    sum_.store(0, std::memory_order_relaxed);
+    max_.store(0, std::memory_order_relaxed);
+}
+
+call_site::call_site(const char* name, const char* file, int line)
+    : name(name), file(file), line(line) {
+    call_site* head = first_site.load(std::memory_order_relaxed);
+
+    do {
+        next_ = head;
+    } while(!first_site.compare_exchange_weak(head, this, std::memory_order_release, std::memory_order_relaxed));
+}
+
+auto sites() -> std::vector<const call_site*> {
+    std::vector<const call_site*> result;
+
+    for(const call_site* s = first_site.load(std::memory_order_acquire); s != nullptr; s = s->next_) {
+        result.push_back(s);
+    }
+
+    std::sort(result.begin(), result.end(), [](const call_site* a, const call_site* b) {
+        const int by_name = std::strcmp(a->name, b->name);
+        if(by_name != 0) {
+            return by_name < 0;
+        }
+
+        const int by_file = std::strcmp(a->file, b->file);
+        return by_file != 0 ? by_file < 0 : a->line < b->line;
+    });
+
+    return result;
+}
+
+auto reset() -> void {
+    for(call_site* s = first_site.load(std::memory_order_acquire); s != nullptr; s = s->next_) {
+        s->latency.reset();
+    }
+}
+
+auto print(std::FILE* out) -> void {
+    const auto all = sites();
+
+    std::vector<std::string> locations;
+    std::size_t name_width = 4;
+    std::size_t location_width = 8;
+    for(const auto* s : all) {
+        locations.push_back(fmt::format("{}:{}", file_name(s->file), s->line));
+        name_width = std::max(name_width, std::strlen(s->name));
+        location_width = std::max(location_width, locations.back().size());
+    }
+
+    fmt::print(
+        out,
+        "{:<{}}  {:<{}}  {:>10}  {:>10}  {:>10}  {:>10}\n",
+        "site", name_width,
+        "location", location_width,
+        "count", "p50", "p99", "max"
+    );
+
+    for(std::size_t i = 0; i < all.size(); ++i) {
+        const histogram& h = all[i]->latency;
+        if(h.count() == 0) {
+            continue;
+        }
+
+        fmt::print(
+            out,
+            "{:<{}}  {:<{}}  {:>10}  {:>10}  {:>10}  {:>10}\n",
+            all[i]->name, name_width,
+            locations[i], location_width,
+            h.count(),
+            format_duration(h.percentile(0.5)),
+            format_duration(h.percentile(0.99)),
+            format_duration(h.max())
+        );
+    }
+}
+
+auto to_json() -> std::string {
+    fmt::memory_buffer buffer;
+    fmt::format_to(std::back_inserter(buffer), "{{\n  \"sites\": [");
+
+    bool first = true;
+    for(const auto* s : sites()) {
+        const histogram& h = s->latency;
+
+        // Names and file names are string literals from our own sources, so
+        // they never need escaping.
+        fmt::format_to(
+            std::back_inserter(buffer),
+            "{}\n    {{\"name\": \"{}\", \"file\": \"{}\", \"line\": {}, \"count\": {}, "
+            "\"sum_ns\": {}, \"p50_ns\": {}, \"p99_ns\": {}, \"max_ns\": {}}}",
+            first ? "" : ",",
+            s->name,
+            file_name(s->file),
+            s->line,
+            h.count(),
+            h.sum(),
+            h.percentile(0.5),
+            h.percentile(0.99),
+            h.max()
+        );
+
+        first = false;
+    }
+
+    fmt::format_to(std::back_inserter(buffer), "\n  ]\n}}\n");
+    return fmt::to_string(buffer);
+}
+
+auto dump(const std::filesystem::path& path) -> tl::expected<void, error::stats> {
+    std::FILE* out = std::fopen(path.c_str(), "w");
+    if(out == nullptr) {
+        return tl::make_unexpected(error::stats::open_fail);
+    }
+
+    const std::string json = to_json();
+    const bool written = std::fwrite(json.data(), 1, json.size(), out) == json.size();
+
+    if(std::fclose(out) != 0 || !written) {
+        return tl::make_unexpected(error::stats::write_fail);
+    }
+
+    return {};
+}
+
+}
@@ -0,0 +1,468 @@
+#include "nkgt/symbol_index.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cxxabi.h>
+#include <iterator>
+#include <optional>
+
+namespace {
+
+// Trigrams are made of 6 bit character codes, so that a dense table of 2^18
+// entries can hold all of them. Characters that do not appear in identifiers
+// and in the usual punctuation of demangled names share code 0, false
+// positives are filtered out when the candidates are checked.
+constexpr std::size_t code_bits = 6;
+constexpr std::size_t trigram_count = std::size_t{1} << (3 * code_bits);
+
+// Posting lists have a skip entry every skip_interval ids.
+constexpr uint32_t skip_interval = 64;
+
+// Lists with more than max_density ids per id of the shortest one are not
+// intersected, see symbol_index::search.
+constexpr std::size_t max_density = 16;
+
+// Names checked by a search. Ids go from the shortest name to the longest, so
+// running out of budget drops the longest candidates. It bounds the latency
+// of queries made of common trigrams (std, get, ...), whose candidates are
+// spread all over the names.
+constexpr std::size_t check_budget = 2048;
+
+[[nodiscard]]
+constexpr auto fold(char c) -> char {
+    return c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+[[nodiscard]]
+constexpr auto code_of(char c) -> uint32_t {
+    if(c >= 'a' && c <= 'z') {
+        return static_cast<uint32_t>(c - 'a') + 1;
+    }
+
+    if(c >= '0' && c <= '9') {
+        return static_cast<uint32_t>(c - '0') + 27;
+    }
+
+    constexpr std::string_view punctuation = "_:<>(),*&~.[] ";
+    const auto i = punctuation.find(c);
+    return i == std::string_view::npos ? 0 : static_cast<uint32_t>(i) + 37;
+}
+
+static_assert(code_of(' ') < (1u << code_bits));
+
+[[nodiscard]]
+auto trigram_at(std::string_view s, std::size_t i) -> uint32_t {
+    return code_of(s[i]) << (2 * code_bits) | code_of(s[i + 1]) << code_bits | code_of(s[i + 2]);
+}
+
+[[nodiscard]]
+auto varint_size(uint32_t value) -> std::size_t {
+    std::size_t size = 1;
+    while(value >= 0x80) {
+        value >>= 7;
+        ++size;
+    }
+
+    return size;
+}
+
+auto write_varint(uint32_t value, uint8_t* out) -> uint8_t* {
+    while(value >= 0x80) {
+        *out++ = static_cast<uint8_t>(value | 0x80);
+        value >>= 7;
+    }
+
+    *out++ = static_cast<uint8_t>(value);
+    return out;
+}
+
+// Walks the ids of a posting list in increasing order.
+class posting_cursor {
+public:
+    using skip = nkgt::symbol_index::symbol_index::skip;
+
+    posting_cursor(
+        const uint8_t* postings,
+        const uint8_t* begin,
+        const uint8_t* end,
+        const skip* skips_begin,
+        const skip* skips_end
+    ) : postings_(postings), p_(begin), end_(end), skip_(skips_begin), skips_end_(skips_end) {}
+
+    [[nodiscard]]
+    auto next(uint32_t& id) -> bool {
+        if(p_ == end_) {
+            return false;
+        }
+
+        uint32_t delta = 0;
+        for(unsigned shift = 0;; shift += 7) {
+            const uint8_t byte = *p_++;
+            delta |= static_cast<uint32_t>(byte & 0x7f) << shift;
+            if((byte & 0x80) == 0) {
+                break;
+            }
+        }
+
+        id = base_ + delta;
+        base_ = id + 1;
+        return true;
+    }
+
+    // Skips the ids below target. Returns the first id not below it, or
+    // nothing when the list is over.
+    [[nodiscard]]
+    auto seek(uint32_t target) -> std::optional<uint32_t> {
+        // Every id before a skip is below its base, so whole blocks can be
+        // jumped over without decoding them.
+        for(; skip_ != skips_end_ && skip_->base <= target; ++skip_) {
+            if(postings_ + skip_->offset > p_) {
+                p_ = postings_ + skip_->offset;
+                base_ = skip_->base;
+            }
+        }
+
+        uint32_t id = base_ - 1;
+        while(base_ <= target) {
+            if(!next(id)) {
+                return std::nullopt;
+            }
+        }
+
+        return id;
+    }
+
+private:
+    const uint8_t* postings_;
+    const uint8_t* p_;
+    const uint8_t* end_;
+    const skip* skip_;
+    const skip* skips_end_;
+    // Ids are stored as the difference from the previous id plus one.
+    uint32_t base_ = 0;
+};
+
+// Wraps __cxa_demangle, reusing its output buffer across calls.
+class demangler {
+public:
+    demangler() = default;
+    demangler(const demangler&) = delete;
+    demangler& operator=(const demangler&) = delete;
+    ~demangler() { std::free(buffer_); }
+
+    // Returns name unchanged when it is not a mangled C++ name.
+    [[nodiscard]]
+    auto operator()(const std::string& name) -> std::string_view {
+        if(name.size() < 2 || name[0] != '_' || name[1] != 'Z') {
+            return name;
+        }
+
+        int status = 0;
+        char* result = abi::__cxa_demangle(name.c_str(), buffer_, &length_, &status);
+        if(status != 0 || result == nullptr) {
+            return name;
+        }
+
+        buffer_ = result;
+        return buffer_;
+    }
+
+private:
+    char* buffer_ = nullptr;
+    std::size_t length_ = 0;
+};
+
+// Unqualified name of a demangled function, without its parameters:
+// process for ns::Order::process(int).
+[[nodiscard]]
+auto unqualified(std::string_view name) -> std::string_view {
+    name = name.substr(0, name.find('('));
+    const auto scope = name.rfind("::");
+    return scope == std::string_view::npos ? name : name.substr(scope + 2);
+}
+
+// Lower is better, see symbol_index::search.
+[[nodiscard]]
+auto rank(std::string_view name, std::string_view query) -> int {
+    if(name == query || name.substr(0, name.find('(')) == query) {
+        return 0;
+    }
+
+    if(unqualified(name).substr(0, query.size()) == query) {
+        return 1;
+    }
+
+    if(name.substr(0, query.size()) == query) {
+        return 2;
+    }
+
+    for(auto i = name.find(query); i != std::string_view::npos; i = name.find(query, i + 1)) {
+        if(name[i - 1] == ':' || name[i - 1] == '_' || name[i - 1] == ' ') {
+            return 3;
+        }
+    }
+
+    return 4;
+}
+
+}
+
+namespace nkgt::symbol_index {
+
+symbol_index::symbol_index(const std::vector<symbols::symbol>& functions) {
+    std::string all_names;
+    std::vector<std::size_t> offsets;
+    offsets.reserve(functions.size() + 1);
+
+    demangler demangle;
+    for(const auto& function : functions) {
+        offsets.push_back(all_names.size());
+        const auto demangled = demangle(function.name);
+        std::transform(demangled.begin(), demangled.end(), std::back_inserter(all_names), fold);
+    }
+    offsets.push_back(all_names.size());
+
+    const auto folded_name = [&](std::size_t i) {
+        return std::string_view(all_names).substr(offsets[i], offsets[i + 1] - offsets[i]);
+    };
+
+    // Ids are assigned from the shortest name to the longest, so that walking
+    // a posting list meets the best ties first and search can stop early.
+    std::vector<std::size_t> order(functions.size());
+    for(std::size_t i = 0; i < order.size(); ++i) {
+        order[i] = i;
+    }
+
+    std::sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b) {
+        const auto x = folded_name(a);
+        const auto y = folded_name(b);
+        return x.size() != y.size() ? x.size() < y.size() : x < y;
+    });
+
+    names_.reserve(functions.size());
+    folded_.reserve(all_names.size());
+    folded_offsets_.reserve(functions.size() + 1);
+    for(const auto i : order) {
+        names_.push_back(functions[i].name);
+        folded_offsets_.push_back(folded_.size());
+        folded_ += folded_name(i);
+    }
+    folded_offsets_.push_back(folded_.size());
+
+    const auto count = static_cast<uint32_t>(names_.size());
+
+    // Two passes over the trigrams of every name: the first sizes the posting
+    // lists, the second fills them. next_id holds the last id added to each
+    // list plus one, which is both the base of the next delta and a way of
+    // skipping trigrams repeated in the same name.
+    std::vector<uint32_t> next_id(trigram_count, 0);
+    posting_counts_.assign(trigram_count, 0);
+    posting_offsets_.assign(trigram_count + 1, 0);
+
+    for(uint32_t id = 0; id < count; ++id) {
+        const auto name = folded(id);
+        for(std::size_t i = 0; i + 3 <= name.size(); ++i) {
+            const auto t = trigram_at(name, i);
+            if(next_id[t] == id + 1) {
+                continue;
+            }
+
+            posting_offsets_[t + 1] += varint_size(id - next_id[t]);
+            ++posting_counts_[t];
+            next_id[t] = id + 1;
+        }
+    }
+
+    for(std::size_t t = 0; t < trigram_count; ++t) {
+        posting_offsets_[t + 1] += posting_offsets_[t];
+    }
+
+    postings_.resize(posting_offsets_.back());
+    std::vector<uint64_t> cursor(posting_offsets_.begin(), posting_offsets_.end() - 1);
+    std::fill(next_id.begin(), next_id.end(), 0);
+
+    skip_offsets_.assign(trigram_count + 1, 0);
+    for(std::size_t t = 0; t < trigram_count; ++t) {
+        skip_offsets_[t + 1] = skip_offsets_[t] + posting_counts_[t] / skip_interval;
+    }
+
+    skips_.resize(skip_offsets_.back());
+    std::vector<uint32_t> written(trigram_count, 0);
+
+    for(uint32_t id = 0; id < count; ++id) {
+        const auto name = folded(id);
+        for(std::size_t i = 0; i + 3 <= name.size(); ++i) {
+            const auto t = trigram_at(name, i);
+            if(next_id[t] == id + 1) {
+                continue;
+            }
+
+            if(written[t] != 0 && written[t] % skip_interval == 0) {
+                skips_[skip_offsets_[t] + written[t] / skip_interval - 1] = {cursor[t], next_id[t]};
+            }
+            ++written[t];
+
+            uint8_t* out = postings_.data() + cursor[t];
+            cursor[t] = static_cast<uint64_t>(write_varint(id - next_id[t], out) - postings_.data());
+            next_id[t] = id + 1;
+        }
+    }
+
+    sorted_.resize(count);
+    for(uint32_t id = 0; id < count; ++id) {
+        sorted_[id] = id;
+    }
+
+    std::sort(sorted_.begin(), sorted_.end(), [this](uint32_t a, uint32_t b) {
+        return folded(a) < folded(b);
+    });
+}
+
+auto symbol_index::folded(uint32_t id) const -> std::string_view {
+    return std::string_view(folded_).substr(
+        folded_offsets_[id],
+        folded_offsets_[id + 1] - folded_offsets_[id]
+    );
+}
+
+auto symbol_index::search(
+    std::string_view query,
+    std::size_t max_results
+) const -> std::vector<std::string_view> {
+    std::string q;
+    std::transform(query.begin(), query.end(), std::back_inserter(q), fold);
+
+    if(q.empty() || max_results == 0) {
+        return {};
+    }
+
+    std::vector<uint32_t> candidates;
+
+    if(q.size() < 3) {
+        auto it = std::lower_bound(sorted_.begin(), sorted_.end(), q, [this](uint32_t id, const std::string& s) {
+            return folded(id) < s;
+        });
+
+        for(; it != sorted_.end() && candidates.size() < check_budget; ++it) {
+            if(folded(*it).substr(0, q.size()) != q) {
+                break;
+            }
+
+            candidates.push_back(*it);
+        }
+    } else {
+        std::vector<uint32_t> trigrams;
+        for(std::size_t i = 0; i + 3 <= q.size(); ++i) {
+            trigrams.push_back(trigram_at(q, i));
+        }
+
+        std::sort(trigrams.begin(), trigrams.end());
+        trigrams.erase(std::unique(trigrams.begin(), trigrams.end()), trigrams.end());
+        std::sort(trigrams.begin(), trigrams.end(), [this](uint32_t a, uint32_t b) {
+            return posting_counts_[a] < posting_counts_[b];
+        });
+
+        // Looking an id up in a list much denser than the first one costs
+        // more than checking the name, so those lists are left out.
+        const auto densest = std::size_t{posting_counts_[trigrams[0]]} * max_density;
+
+        std::vector<posting_cursor> lists;
+        for(const auto t : trigrams) {
+            if(posting_counts_[t] > densest) {
+                break;
+            }
+
+            lists.emplace_back(
+                postings_.data(),
+                postings_.data() + posting_offsets_[t],
+                postings_.data() + posting_offsets_[t + 1],
+                skips_.data() + skip_offsets_[t],
+                skips_.data() + skip_offsets_[t + 1]
+            );
+        }
+
+        // Walk the shortest list and look every id up in the others, which
+        // only advance as far as needed. Sharing all the trigrams does not
+        // mean containing the query, so survivors are checked before being
+        // kept.
+        std::size_t checked = 0;
+        uint32_t id = 0;
+        while(checked < check_budget && lists[0].next(id)) {
+            bool everywhere = true;
+            for(std::size_t i = 1; i < lists.size() && everywhere; ++i) {
+                const auto found = lists[i].seek(id);
+                if(!found) {
+                    // This list is over, so is the intersection.
+                    return rank_matches(q, candidates, max_results);
+                }
+
+                everywhere = *found == id;
+            }
+
+            if(!everywhere) {
+                continue;
+            }
+
+            ++checked;
+            if(folded(id).find(q) != std::string_view::npos) {
+                candidates.push_back(id);
+            }
+        }
+    }
+
+    return rank_matches(q, candidates, max_results);
+}
+
+auto symbol_index::rank_matches(
+    std::string_view q,
+    const std::vector<uint32_t>& candidates,
+    std::size_t max_results
+) const -> std::vector<std::string_view> {
+    struct scored {
+        int rank;
+        std::size_t length;
+        uint32_t id;
+
+        auto operator<(const scored& other) const -> bool {
+            if(rank != other.rank) {
+                return rank < other.rank;
+            }
+
+            return length != other.length ? length < other.length : id < other.id;
+        }
+    };
+
+    std::vector<scored> results;
+    results.reserve(candidates.size());
+    for(const auto id : candidates) {
+        const auto name = folded(id);
+        results.push_back({rank(name, q), name.size(), id});
+    }
+
+    const auto kept = std::min(max_results, results.size());
+    std::partial_sort(
+        results.begin(),
+        results.begin() + static_cast<std::ptrdiff_t>(kept),
+        results.end()
+    );
+
+    std::vector<std::string_view> names;
+    names.reserve(kept);
+    for(std::size_t i = 0; i < kept; ++i) {
+        names.push_back(names_[results[i].id]);
+    }
+
+    return names;
+}
+
+background_index::background_index(const std::vector<symbols::symbol>& functions)
+    : thread_([this, &functions]() {
+          index_ = std::make_unique<symbol_index>(functions);
+          ready_.store(index_.get(), std::memory_order_release);
+      }) {}
+
+background_index::~background_index() {
+    thread_.join();
+}
+
+}
@@ -0,0 +1,205 @@
+#include "nkgt/symbols.hpp"
+#include "nkgt/error_codes.hpp"
+#include "nkgt/util.hpp"
+
+#include <tl/expected.hpp>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <elf.h>
+#include <fcntl.h>
+#include <memory>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+// Read only view of a whole file, unmapped on destruction.
+class mapped_file {
+public:
+    mapped_file(const std::byte* data, std::size_t size) : data_(data), size_(size) {}
+    mapped_file(const mapped_file&) = delete;
+    mapped_file& operator=(const mapped_file&) = delete;
+    ~mapped_file() { munmap(const_cast<std::byte*>(data_), size_); }
+
+    // Copies a T from offset, returns false if it does not fit in the file.
+    template<typename T>
+    [[nodiscard]]
+    auto read(std::size_t offset, T& out) const -> bool {
+        if(offset > size_ || sizeof(T) > size_ - offset) {
+            return false;
+        }
+
+        std::memcpy(&out, data_ + offset, sizeof(T));
+        return true;
+    }
+
+    [[nodiscard]]
+    auto data() const -> const std::byte* { return data_; }
+
+    [[nodiscard]]
+    auto size() const -> std::size_t { return size_; }
+
+private:
+    const std::byte* data_;
+    std::size_t size_;
+};
+
+[[nodiscard]]
+auto map_file(const std::filesystem::path& path) -> std::unique_ptr<mapped_file> {
+    const int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if(fd == -1) {
+        nkgt::util::print_error_message("open", errno);
+        return nullptr;
+    }
+
+    struct stat info;
+    if(fstat(fd, &info) == -1) {
+        nkgt::util::print_error_message("fstat", errno);
+        close(fd);
+        return nullptr;
+    }
+
+    const auto size = static_cast<std::size_t>(info.st_size);
+    void* mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if(mapping == MAP_FAILED) {
+        nkgt::util::print_error_message("mmap", errno);
+        return nullptr;
+    }
+
+    return std::make_unique<mapped_file>(static_cast<const std::byte*>(mapping), size);
+}
+
+}
+
+namespace nkgt::symbols {
+
+auto symbol_table::lookup(std::uintptr_t address) const -> const symbol* {
+    auto it = std::upper_bound(
+        functions_.cbegin(),
+        functions_.cend(),
+        address,
+        [](std::uintptr_t a, const symbol& s) { return a < s.address; }
+    );
+
+    if(it == functions_.cbegin()) {
+        return nullptr;
+    }
+
+    --it;
+    if(it->size != 0 && address >= it->address + it->size) {
+        return nullptr;
+    }
+
+    return &*it;
+}
+
+auto symbol_table::find(std::string_view name) const -> const symbol* {
+    for(const auto& s : functions_) {
+        if(s.name == name) {
+            return &s;
+        }
+    }
+
+    return nullptr;
+}
+
+auto load_symbols(
+    const std::filesystem::path& path
+) -> tl::expected<symbol_table, error::debug_symbols> {
+    const auto file = map_file(path);
+    if(!file) {
+        return tl::make_unexpected(error::debug_symbols::load_fail);
+    }
+
+    Elf64_Ehdr header;
+    if(!file->read(0, header) ||
+       std::memcmp(header.e_ident, ELFMAG, SELFMAG) != 0 ||
+       header.e_ident[EI_CLASS] != ELFCLASS64) {
+        return tl::make_unexpected(error::debug_symbols::load_fail);
+    }
+
+    symbol_table table;
+    table.path_ = path;
+
+    for(std::size_t i = 0; i < header.e_phnum; ++i) {
+        Elf64_Phdr program_header;
+        if(!file->read(header.e_phoff + i * sizeof(Elf64_Phdr), program_header)) {
+            return tl::make_unexpected(error::debug_symbols::load_fail);
+        }
+
+        // Segments are sorted by address, so the first PT_LOAD is the lowest.
+        if(program_header.p_type == PT_LOAD) {
+            table.load_base_ = program_header.p_vaddr - program_header.p_offset;
+            break;
+        }
+    }
+
+    std::vector<Elf64_Shdr> sections(header.e_shnum);
+    for(std::size_t i = 0; i < sections.size(); ++i) {
+        if(!file->read(header.e_shoff + i * sizeof(Elf64_Shdr), sections[i])) {
+            return tl::make_unexpected(error::debug_symbols::load_fail);
+        }
+    }
+
+    auto symtab = std::find_if(
+        sections.cbegin(),
+        sections.cend(),
+        [](const Elf64_Shdr& s) { return s.sh_type == SHT_SYMTAB; }
+    );
+
+    if(symtab == sections.cend()) {
+        symtab = std::find_if(
+            sections.cbegin(),
+            sections.cend(),
+            [](const Elf64_Shdr& s) { return s.sh_type == SHT_DYNSYM; }
+        );
+    }
+
+    if(symtab == sections.cend() || symtab->sh_link >= sections.size()) {
+        // Not an error: the file simply has no symbols.
+        return table;
+    }
+
+    const Elf64_Shdr& strtab = sections[symtab->sh_link];
+    const std::size_t count = symtab->sh_size / sizeof(Elf64_Sym);
+
+    for(std::size_t i = 0; i < count; ++i) {
+        Elf64_Sym sym;
+        if(!file->read(symtab->sh_offset + i * sizeof(Elf64_Sym), sym)) {
+            return tl::make_unexpected(error::debug_symbols::load_fail);
+        }
+
+        if(ELF64_ST_TYPE(sym.st_info) != STT_FUNC || sym.st_value == 0 || sym.st_name >= strtab.sh_size) {
+            continue;
+        }
+
+        const std::size_t name_offset = strtab.sh_offset + sym.st_name;
+        if(name_offset >= file->size()) {
+            continue;
+        }
+
+        const auto* name = reinterpret_cast<const char*>(file->data() + name_offset);
+        const std::size_t max_length = std::min<std::size_t>(strtab.sh_size - sym.st_name, file->size() - name_offset);
+
+        table.functions_.push_back({
+            std::string(name, strnlen(name, max_length)),
+            sym.st_value,
+            sym.st_size
+        });
+    }
+
+    std::sort(
+        table.functions_.begin(),
+        table.functions_.end(),
+        [](const symbol& a, const symbol& b) { return a.address < b.address; }
+    );
+
+    return table;
+}
+
+}
@@ -0,0 +1,79 @@
+#include "nkgt/types.hpp"
+
+#include <fmt/core.h>
+
+namespace nkgt::types {
+
+auto type_graph::add(type t) -> type_id {
+    types_.push_back(std::move(t));
+    return static_cast<type_id>(types_.size() - 1);
+}
+
+auto type_graph::strip(type_id id) const -> type_id {
+    // Bounded, so that a malformed cycle of typedefs cannot hang the caller.
+    for(std::size_t i = 0; i < types_.size() && id != no_type; ++i) {
+        const type& t = types_[id];
+
+        if(t.k != kind::typedef_alias && t.k != kind::qualified) {
+            return id;
+        }
+
+        id = t.target;
+    }
+
+    return id;
+}
+
+auto type_graph::display_name(type_id id) const -> std::string {
+    if(id == no_type) {
+        return "void";
+    }
+
+    const type& t = types_[id];
+
+    switch(t.k) {
+    case kind::pointer:
+        return display_name(t.target) + "*";
+    case kind::reference:
+        return display_name(t.target) + "&";
+    case kind::array:
+        return fmt::format("{}[{}]", display_name(t.target), t.count);
+    case kind::qualified:
+        return fmt::format("{} {}", t.name, display_name(t.target));
+    default:
+        return t.name.empty() ? "<anonymous>" : t.name;
+    }
+}
+
+auto type_graph::find_member(type_id id, std::string_view name) const -> std::optional<member_location> {
+    id = strip(id);
+    if(id == no_type) {
+        return std::nullopt;
+    }
+
+    const type& t = types_[id];
+    if(t.k != kind::structure && t.k != kind::union_type) {
+        return std::nullopt;
+    }
+
+    for(const auto& m : t.members) {
+        if(!m.is_base && m.name == name) {
+            return member_location{m.offset, m.type};
+        }
+    }
+
+    for(const auto& m : t.members) {
+        if(!m.is_base) {
+            continue;
+        }
+
+        const auto found = find_member(m.type, name);
+        if(found) {
+            return member_location{m.offset + found->offset, found->type};
+        }
+    }
+
+    return std::nullopt;
+}
+
+}
@@ -76,6 +76,30 @@ std::vector<std::string_view> split(std::string_view s, char delimiter) {
     return tokens;
 }
 
+bool tokenize(std::string_view s, tokens& out) {
+    out.clear();
+    std::size_t i = 0;
+
+    while(true) {
+        while(i < s.size() && s[i] == ' ') {
+            i += 1;
+        }
+
+        if(i == s.size()) {
+            return true;
+        }
+
+        const std::size_t begin = i;
+        while(i < s.size() && s[i] != ' ') {
+            i += 1;
+        }
+
+        if(!out.push_back(s.substr(begin, i - begin))) {
+            return false;
+        }
+    }
+}
+
 bool is_prefix(std::string_view s, std::string_view of) {
     if(s.size() > of.size() || s.empty()) {
         return false;
@@ -0,0 +1,299 @@
+#include "nkgt/vector_registers.hpp"
+#include "nkgt/error_codes.hpp"
+#include "nkgt/target.hpp"
+
+#include <tl/expected.hpp>
+
+#include <charconv>
+#include <cpuid.h>
+#include <cstdint>
+#include <cstring>
+#include <fmt/core.h>
+#include <fmt/format.h>
+
+namespace {
+
+// Size of the legacy (FXSAVE) region of the area and offsets in it.
+constexpr std::size_t legacy_size = 512;
+constexpr std::size_t st_offset = 32;
+constexpr std::size_t xmm_offset = 160;
+// The kernel stores the XCR0 of the debugee in the software reserved bytes of
+// the legacy region, see USER_XSTATE_XCR0_WORD in arch/x86/include/asm/user.h.
+constexpr std::size_t xcr0_offset = 464;
+// XSTATE_BV, the first word of the XSAVE header, tells which components are
+// not in their initial (all zero) state.
+constexpr std::size_t xstate_bv_offset = 512;
+
+// XSAVE state components.
+constexpr unsigned component_avx = 2;
+constexpr unsigned component_opmask = 5;
+constexpr unsigned component_zmm_hi256 = 6;
+constexpr unsigned component_hi16_zmm = 7;
+
+// Offset of an extended component in the standard format XSAVE area. It is
+// reported by CPUID leaf 0xd, the fallback values are the ones used by every
+// CPU implementing the component so far.
+[[nodiscard]]
+auto component_offset(unsigned component) -> std::size_t {
+    unsigned eax = 0;
+    unsigned ebx = 0;
+    unsigned ecx = 0;
+    unsigned edx = 0;
+
+    if(__get_cpuid_count(0xd, component, &eax, &ebx, &ecx, &edx) != 0 && ebx != 0) {
+        return ebx;
+    }
+
+    switch(component) {
+    case component_avx:       return 576;
+    case component_opmask:    return 1088;
+    case component_zmm_hi256: return 1152;
+    case component_hi16_zmm:  return 1664;
+    default:                  return 0;
+    }
+}
+
+// Decoded view of the extended state, with one entry per XSAVE component.
+struct xsave_layout {
+    const std::byte* data;
+    std::size_t size;
+    uint64_t xcr0;
+    uint64_t xstate_bv;
+};
+
+[[nodiscard]]
+auto is_enabled(const xsave_layout& l, unsigned component) -> bool {
+    return (l.xcr0 & (uint64_t{1} << component)) != 0;
+}
+
+// Copies size bytes of component at offset into out. Components in their
+// initial state may contain stale data in the area and must read as zero.
+[[nodiscard]]
+auto copy_component(
+    const xsave_layout& l,
+    unsigned component,
+    std::size_t offset,
+    std::size_t size,
+    std::byte* out
+) -> bool {
+    if(!is_enabled(l, component)) {
+        return false;
+    }
+
+    if((l.xstate_bv & (uint64_t{1} << component)) == 0) {
+        std::memset(out, 0, size);
+        return true;
+    }
+
+    const std::size_t start = component_offset(component) + offset;
+    if(start + size > l.size) {
+        return false;
+    }
+
+    std::memcpy(out, l.data + start, size);
+    return true;
+}
+
+template<typename T>
+auto append_lanes(std::string& out, const std::byte* data, std::size_t count) -> void {
+    out += '{';
+
+    for(std::size_t i = 0; i < count; ++i) {
+        T lane;
+        std::memcpy(&lane, data + i * sizeof(T), sizeof(T));
+
+        if(i != 0) {
+            out += ", ";
+        }
+
+        // The unary plus promotes 8 bit lanes, which would otherwise be
+        // formatted as characters.
+        out += fmt::format("{}", +lane);
+    }
+
+    out += '}';
+}
+
+}
+
+namespace nkgt::registers {
+
+auto vector_from_string(std::string_view name) -> tl::expected<vector_reg, error::registers> {
+    struct prefix {
+        std::string_view name;
+        vector_kind kind;
+        unsigned count;
+    };
+
+    constexpr std::array<prefix, 5> prefixes = {{
+        {"xmm", vector_kind::xmm, 32},
+        {"ymm", vector_kind::ymm, 32},
+        {"zmm", vector_kind::zmm, 32},
+        {"st",  vector_kind::st,  8},
+        {"k",   vector_kind::k,   8},
+    }};
+
+    for(const auto& p : prefixes) {
+        if(name.substr(0, p.name.size()) != p.name) {
+            continue;
+        }
+
+        const std::string_view number = name.substr(p.name.size());
+        unsigned index = 0;
+        const auto [end, ec] = std::from_chars(number.data(), number.data() + number.size(), index);
+
+        if(number.empty() || ec != std::errc() || end != number.data() + number.size() || index >= p.count) {
+            return tl::make_unexpected(error::registers::unknown_reg_name);
+        }
+
+        return vector_reg{p.kind, index};
+    }
+
+    return tl::make_unexpected(error::registers::unknown_reg_name);
+}
+
+auto get_vector_register_value(
+    target::target& debugee,
+    vector_reg r
+) -> tl::expected<vector_value, error::registers> {
+    const auto state = debugee.read_extended_state();
+    if(!state) {
+        return tl::make_unexpected(state.error());
+    }
+
+    const auto& area = (*state)->data;
+    vector_value value = {};
+
+    // The legacy region is always there, both for XSAVE and FXSAVE areas, but
+    // the note of a truncated core file may be shorter.
+    if(area.size() < legacy_size) {
+        return tl::make_unexpected(error::registers::unavailable_register);
+    }
+
+    if(r.kind == vector_kind::st) {
+        value.size = 10;
+        std::memcpy(value.bytes.data(), area.data() + st_offset + 16 * r.index, value.size);
+        return value;
+    }
+
+    if(r.kind == vector_kind::xmm && r.index < 16) {
+        value.size = 16;
+        std::memcpy(value.bytes.data(), area.data() + xmm_offset + 16 * r.index, value.size);
+        return value;
+    }
+
+    if(!(*state)->is_xsave || area.size() < xstate_bv_offset + sizeof(uint64_t)) {
+        return tl::make_unexpected(error::registers::unavailable_register);
+    }
+
+    xsave_layout l = {area.data(), area.size(), 0, 0};
+    std::memcpy(&l.xcr0, area.data() + xcr0_offset, sizeof(l.xcr0));
+    std::memcpy(&l.xstate_bv, area.data() + xstate_bv_offset, sizeof(l.xstate_bv));
+
+    std::byte* out = value.bytes.data();
+    bool available = true;
+
+    switch(r.kind) {
+    case vector_kind::k:
+        value.size = 8;
+        available = copy_component(l, component_opmask, 8 * r.index, 8, out);
+        break;
+    case vector_kind::xmm:
+        // xmm16-31 are the low 128 bits of zmm16-31.
+        value.size = 16;
+        available = copy_component(l, component_hi16_zmm, 64 * (r.index - 16), 16, out);
+        break;
+    case vector_kind::ymm:
+        value.size = 32;
+        if(r.index < 16) {
+            std::memcpy(out, area.data() + xmm_offset + 16 * r.index, 16);
+            available = copy_component(l, component_avx, 16 * r.index, 16, out + 16);
+        } else {
+            available = copy_component(l, component_hi16_zmm, 64 * (r.index - 16), 32, out);
+        }
+        break;
+    case vector_kind::zmm:
+        value.size = 64;
+        if(r.index < 16) {
+            std::memcpy(out, area.data() + xmm_offset + 16 * r.index, 16);
+            available = copy_component(l, component_avx, 16 * r.index, 16, out + 16) &&
+                        copy_component(l, component_zmm_hi256, 32 * r.index, 32, out + 32);
+        } else {
+            available = copy_component(l, component_hi16_zmm, 64 * (r.index - 16), 64, out);
+        }
+        break;
+    case vector_kind::st:
+        break;
+    }
+
+    if(!available) {
+        return tl::make_unexpected(error::registers::unavailable_register);
+    }
+
+    return value;
+}
+
+auto format_vector_value(
+    const vector_value& value,
+    std::string_view view
+) -> tl::expected<std::string, error::registers> {
+    std::string out;
+    const std::byte* data = value.bytes.data();
+
+    if(view.empty()) {
+        if(value.size == 10) {
+            long double st = 0;
+            std::memcpy(&st, data, value.size);
+            return fmt::format("{}", st);
+        }
+
+        out += '{';
+        for(std::size_t i = 0; i < value.size / 8; ++i) {
+            uint64_t lane;
+            std::memcpy(&lane, data + 8 * i, sizeof(lane));
+            out += fmt::format("{}{:#018x}", i == 0 ? "" : ", ", lane);
+        }
+        out += '}';
+
+        return out;
+    }
+
+    const std::size_t separator = view.find('_');
+    if(view.front() != 'v' || separator == std::string_view::npos) {
+        return tl::make_unexpected(error::registers::unknown_view);
+    }
+
+    std::size_t lanes = 0;
+    const auto [_, ec] = std::from_chars(view.data() + 1, view.data() + separator, lanes);
+    if(ec != std::errc()) {
+        return tl::make_unexpected(error::registers::unknown_view);
+    }
+
+    const std::string_view type = view.substr(separator + 1);
+    std::size_t lane_size = 0;
+
+    if(type == "int8" || type == "uint8") lane_size = 1;
+    else if(type == "int16" || type == "uint16") lane_size = 2;
+    else if(type == "int32" || type == "uint32" || type == "float") lane_size = 4;
+    else if(type == "int64" || type == "uint64" || type == "double") lane_size = 8;
+    else return tl::make_unexpected(error::registers::unknown_view);
+
+    if(lanes * lane_size != value.size) {
+        return tl::make_unexpected(error::registers::unknown_view);
+    }
+
+    if(type == "int8")        append_lanes<int8_t>(out, data, lanes);
+    else if(type == "uint8")  append_lanes<uint8_t>(out, data, lanes);
+    else if(type == "int16")  append_lanes<int16_t>(out, data, lanes);
+    else if(type == "uint16") append_lanes<uint16_t>(out, data, lanes);
+    else if(type == "int32")  append_lanes<int32_t>(out, data, lanes);
+    else if(type == "uint32") append_lanes<uint32_t>(out, data, lanes);
+    else if(type == "int64")  append_lanes<int64_t>(out, data, lanes);
+    else if(type == "uint64") append_lanes<uint64_t>(out, data, lanes);
+    else if(type == "float")  append_lanes<float>(out, data, lanes);
+    else if(type == "double") append_lanes<double>(out, data, lanes);
+
+    return out;
+}
+
+}
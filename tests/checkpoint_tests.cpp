@@ -0,0 +1,83 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "nkgt/checkpoint.hpp"
+#include "nkgt/process.hpp"
+#include "nkgt/target.hpp"
+
+#include <array>
+#include <csignal>
+#include <cstdint>
+#include <sys/ptrace.h>
+#include <sys/wait.h>
+
+namespace {
+
+// Resumes pid, passing on the signals it receives, until it exits. Returns
+// its exit code, or -1 if it did not exit normally.
+auto run_to_exit(pid_t pid) -> int {
+    int signal = 0;
+
+    while(true) {
+        if(ptrace(PTRACE_CONT, pid, nullptr, signal) == -1) {
+            return -1;
+        }
+
+        int wait_status = 0;
+        if(waitpid(pid, &wait_status, __WALL) != pid) {
+            return -1;
+        }
+
+        if(WIFEXITED(wait_status)) {
+            return WEXITSTATUS(wait_status);
+        }
+
+        if(!WIFSTOPPED(wait_status)) {
+            return -1;
+        }
+
+        signal = WSTOPSIG(wait_status) == SIGTRAP || WSTOPSIG(wait_status) == SIGSTOP ? 0 : WSTOPSIG(wait_status);
+    }
+}
+
+auto same_registers(const user_regs_struct& a, const user_regs_struct& b) -> bool {
+    return a.rip == b.rip && a.rsp == b.rsp && a.rbp == b.rbp && a.rax == b.rax &&
+           a.rbx == b.rbx && a.rcx == b.rcx && a.rdx == b.rdx && a.rsi == b.rsi &&
+           a.rdi == b.rdi && a.r8 == b.r8 && a.r12 == b.r12 && a.r15 == b.r15;
+}
+
+}
+
+TEST_CASE("Checkpoints are forks with the code and registers of the debugee", "[checkpoint]") {
+    const auto pid = nkgt::process::launch({"/bin/sh", {"-c", "exit $((FIRST + 2))"}, {"FIRST=40"}});
+    REQUIRE(pid);
+
+    nkgt::target::ptrace_target debugee(*pid);
+    const auto regs = debugee.read_registers();
+    REQUIRE(regs);
+
+    std::array<uint8_t, 16> code;
+    REQUIRE(debugee.read_memory(regs->rip, code.data(), code.size()));
+
+    const auto child = nkgt::checkpoint::fork_debugee(debugee);
+    REQUIRE(child);
+    REQUIRE(*child != *pid);
+
+    nkgt::target::ptrace_target checkpoint(*child);
+
+    const std::array<nkgt::target::target*, 2> processes = {&debugee, &checkpoint};
+    for(auto* process : processes) {
+        process->invalidate_caches();
+
+        const auto after = process->read_registers();
+        REQUIRE(after);
+        REQUIRE(same_registers(*after, *regs));
+
+        std::array<uint8_t, 16> code_after;
+        REQUIRE(process->read_memory(regs->rip, code_after.data(), code_after.size()));
+        REQUIRE(code_after == code);
+    }
+
+    // Both run the program from where the debugee was stopped.
+    REQUIRE(run_to_exit(*child) == 42);
+    REQUIRE(run_to_exit(*pid) == 42);
+}
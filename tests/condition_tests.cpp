@@ -0,0 +1,108 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "nkgt/condition.hpp"
+#include "nkgt/target.hpp"
+
+#include "fake_target.hpp"
+
+#include <cstring>
+#include <vector>
+
+namespace {
+
+auto evaluate(
+    std::string_view expression,
+    const user_regs_struct& regs,
+    nkgt::target::target& debugee
+) -> tl::expected<bool, nkgt::error::condition> {
+    const auto program = nkgt::condition::compile(expression);
+    REQUIRE(program);
+    return program->evaluate(regs, debugee);
+}
+
+}
+
+TEST_CASE("Conditions are evaluated on the registers", "[condition]") {
+    fake_target debugee(0x1000, 0x100);
+    user_regs_struct regs = {};
+    regs.rdi = 0x42;
+    regs.rsi = 7;
+    regs.rax = 0xffffffffffffffff;
+
+    REQUIRE(*evaluate("rdi == 0x42", regs, debugee));
+    REQUIRE(!*evaluate("$rdi != 66", regs, debugee));
+    REQUIRE(*evaluate("rsi * 2 + 1 == 15", regs, debugee));
+    REQUIRE(*evaluate("1 + 2 * 3 == 7 && (1 + 2) * 3 == 9", regs, debugee));
+    REQUIRE(*evaluate("rdi & 0xf0 == 0x40", regs, debugee) == false);
+    REQUIRE(*evaluate("(rdi & 0xf0) == 0x40", regs, debugee));
+    REQUIRE(*evaluate("rax > rdi || rsi < 0", regs, debugee));
+    REQUIRE(*evaluate("-1 == rax && ~rax == 0 && !rbx", regs, debugee));
+    REQUIRE(*evaluate("1 << 64 == 0 && rsi % 4 == 3 && rsi >> 1 == 3", regs, debugee));
+    REQUIRE(debugee.reads == 0);
+
+    SECTION("Errors") {
+        REQUIRE(nkgt::condition::compile("rdi ==").error() == nkgt::error::condition::syntax_error);
+        REQUIRE(nkgt::condition::compile("(rdi").error() == nkgt::error::condition::syntax_error);
+        REQUIRE(nkgt::condition::compile("12ab").error() == nkgt::error::condition::syntax_error);
+        REQUIRE(nkgt::condition::compile("xyz == 1").error() == nkgt::error::condition::unknown_register);
+        REQUIRE(evaluate("rdi / rbx", regs, debugee).error() == nkgt::error::condition::division_by_zero);
+    }
+}
+
+TEST_CASE("Memory operands are read in one batch", "[condition]") {
+    fake_target debugee(0x1000, 0x100);
+    debugee.store(0x1008, uint64_t{10});
+    debugee.store(0x1010, uint64_t{0x1234});
+
+    user_regs_struct regs = {};
+    regs.rsp = 0x1000;
+
+    REQUIRE(*evaluate("*(rsp + 8) == 10", regs, debugee));
+    REQUIRE(debugee.reads == 1);
+
+    debugee.reads = 0;
+    REQUIRE(*evaluate("*(rsp + 8) + *(rsp + 16) == 0x123e && *(rsp + 8) < 11", regs, debugee));
+    REQUIRE(debugee.reads == 1);
+
+    SECTION("Errors") {
+        REQUIRE(nkgt::condition::compile("**rsp").error() == nkgt::error::condition::nested_load);
+        REQUIRE(nkgt::condition::compile("*rsp+*rsp+*rsp+*rsp+*rsp+*rsp+*rsp+*rsp+*rsp").error() ==
+                nkgt::error::condition::too_complex);
+        REQUIRE(evaluate("*(rsp + 0x1000) == 0", regs, debugee).error() == nkgt::error::condition::read_fail);
+    }
+}
+
+TEST_CASE("&& and || only evaluate their right operand when needed", "[condition]") {
+    fake_target debugee(0x1000, 0x100);
+    debugee.store(0x1000, uint64_t{5});
+
+    user_regs_struct regs = {};
+
+    SECTION("Guards against null pointers and zero divisors") {
+        REQUIRE(*evaluate("rdi != 0 && *rdi == 5", regs, debugee) == false);
+        REQUIRE(*evaluate("rdi != 0 && 100 / rdi > 1", regs, debugee) == false);
+        REQUIRE(*evaluate("rdi == 0 || *rdi == 5", regs, debugee));
+        REQUIRE(*evaluate("rdi == 0 || *(100 / rdi) == 5", regs, debugee));
+
+        regs.rdi = 0x1000;
+        REQUIRE(*evaluate("rdi != 0 && *rdi == 5", regs, debugee));
+        REQUIRE(*evaluate("rdi != 0 && 0x2000 / rdi > 1", regs, debugee));
+        REQUIRE(*evaluate("rdi == 0 || *rdi == 5", regs, debugee));
+    }
+
+    SECTION("Readable operands are still read in one batch") {
+        regs.rdi = 0x1000;
+        regs.rsp = 0x1008;
+        REQUIRE(*evaluate("rdi != 0 && *rdi == 5 && *rsp == 0", regs, debugee));
+        REQUIRE(debugee.reads == 1);
+    }
+
+    SECTION("Values that are used are still errors") {
+        REQUIRE(evaluate("rdi == 0 && *rdi == 5", regs, debugee).error() == nkgt::error::condition::read_fail);
+        REQUIRE(evaluate("rdi == 0 && 100 / rdi > 1", regs, debugee).error() ==
+                nkgt::error::condition::division_by_zero);
+        REQUIRE(evaluate("*rdi == 5 && rdi != 0", regs, debugee).error() == nkgt::error::condition::read_fail);
+        REQUIRE(evaluate("rdi != 0 || *(100 / rdi) == 5", regs, debugee).error() ==
+                nkgt::error::condition::division_by_zero);
+    }
+}
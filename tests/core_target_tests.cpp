@@ -0,0 +1,225 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "nkgt/target.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <elf.h>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <sys/procfs.h>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+using bytes = std::vector<std::byte>;
+
+constexpr std::uintptr_t segment_address = 0x400000;
+constexpr std::size_t segment_memory_size = 0x100;
+
+auto core_path() -> std::filesystem::path {
+    return std::filesystem::temp_directory_path() / ("core_target_tests." + std::to_string(getpid()));
+}
+
+template<typename T>
+auto append(bytes& out, const T& value) -> void {
+    const auto* begin = reinterpret_cast<const std::byte*>(&value);
+    out.insert(out.end(), begin, begin + sizeof(value));
+}
+
+auto pad(bytes& out) -> void {
+    out.resize((out.size() + 3) & ~std::size_t{3});
+}
+
+// A note named CORE, as the kernel writes them.
+auto append_note(bytes& out, uint32_t type, const bytes& desc) -> void {
+    constexpr char name[] = "CORE";
+    append(out, Elf64_Nhdr{sizeof(name), static_cast<uint32_t>(desc.size()), type});
+    append(out, name);
+    pad(out);
+    out.insert(out.end(), desc.begin(), desc.end());
+    pad(out);
+}
+
+auto prstatus_note(pid_t pid, const user_regs_struct& regs) -> bytes {
+    elf_prstatus status = {};
+    status.pr_pid = pid;
+    std::memcpy(&status.pr_reg, &regs, sizeof(regs));
+
+    bytes desc;
+    append(desc, status);
+    return desc;
+}
+
+// NT_FILE with one mapping of path at the address of the segment.
+auto file_note(uint64_t count, const std::string& path) -> bytes {
+    bytes desc;
+    append(desc, count);
+    append(desc, uint64_t{0x1000});
+    append(desc, std::array<uint64_t, 3>{segment_address, segment_address + 0x1000, 2});
+    desc.insert(desc.end(), reinterpret_cast<const std::byte*>(path.c_str()),
+                reinterpret_cast<const std::byte*>(path.c_str()) + path.size() + 1);
+    return desc;
+}
+
+// Core file with the ELF header, a PT_NOTE segment holding notes and a
+// PT_LOAD segment at segment_address whose first contents.size() bytes are in
+// the file.
+struct core_image {
+    Elf64_Ehdr header;
+    std::array<Elf64_Phdr, 2> segments;
+    bytes notes;
+    bytes contents;
+
+    core_image(bytes note_data, bytes load_data)
+        : header(), segments(), notes(std::move(note_data)), contents(std::move(load_data)) {
+        std::memcpy(header.e_ident, ELFMAG, SELFMAG);
+        header.e_ident[EI_CLASS] = ELFCLASS64;
+        header.e_ident[EI_DATA] = ELFDATA2LSB;
+        header.e_ident[EI_VERSION] = EV_CURRENT;
+        header.e_type = ET_CORE;
+        header.e_machine = EM_X86_64;
+        header.e_version = EV_CURRENT;
+        header.e_phoff = sizeof(Elf64_Ehdr);
+        header.e_ehsize = sizeof(Elf64_Ehdr);
+        header.e_phentsize = sizeof(Elf64_Phdr);
+        header.e_phnum = static_cast<Elf64_Half>(segments.size());
+
+        const std::size_t notes_offset = sizeof(Elf64_Ehdr) + sizeof(segments);
+        segments[0].p_type = PT_NOTE;
+        segments[0].p_offset = notes_offset;
+        segments[0].p_filesz = notes.size();
+
+        segments[1].p_type = PT_LOAD;
+        segments[1].p_offset = notes_offset + notes.size();
+        segments[1].p_vaddr = segment_address;
+        segments[1].p_filesz = contents.size();
+        segments[1].p_memsz = segment_memory_size;
+    }
+
+    auto write(const std::filesystem::path& path) const -> void {
+        bytes out;
+        append(out, header);
+        append(out, segments);
+        out.insert(out.end(), notes.begin(), notes.end());
+        out.insert(out.end(), contents.begin(), contents.end());
+
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char*>(out.data()), static_cast<std::streamsize>(out.size()));
+    }
+};
+
+auto load(const core_image& image) -> tl::expected<std::unique_ptr<nkgt::target::core_target>, nkgt::error::core_file> {
+    const auto path = core_path();
+    image.write(path);
+    auto core = nkgt::target::load_core(path);
+    std::filesystem::remove(path);
+    return core;
+}
+
+auto sample_contents() -> bytes {
+    bytes contents(16);
+    for(std::size_t i = 0; i < contents.size(); ++i) {
+        contents[i] = static_cast<std::byte>(i + 1);
+    }
+
+    return contents;
+}
+
+auto sample_notes(uint64_t file_count) -> bytes {
+    user_regs_struct regs = {};
+    regs.rip = segment_address + 4;
+    regs.rsp = 0x7ffc0000;
+
+    bytes notes;
+    append_note(notes, NT_PRSTATUS, prstatus_note(4321, regs));
+    append_note(notes, NT_FILE, file_note(file_count, "/usr/bin/program"));
+    return notes;
+}
+
+}
+
+TEST_CASE("Core files are loaded", "[core_target]") {
+    const auto core = load(core_image(sample_notes(1), sample_contents()));
+    REQUIRE(core);
+
+    const auto& target = **core;
+    REQUIRE(target.pid() == 4321);
+    REQUIRE_FALSE(target.is_live());
+
+    const auto regs = (*core)->read_registers();
+    REQUIRE(regs);
+    REQUIRE(regs->rip == segment_address + 4);
+    REQUIRE(regs->rsp == 0x7ffc0000);
+
+    REQUIRE(target.mappings().size() == 1);
+    REQUIRE(target.mappings()[0].start == segment_address);
+    REQUIRE(target.mappings()[0].offset == 0x2000);
+    REQUIRE(target.mappings()[0].path == "/usr/bin/program");
+
+    SECTION("Memory in the file") {
+        uint32_t value = 0;
+        REQUIRE((*core)->read_memory(segment_address + 4, &value, sizeof(value)));
+        REQUIRE(value == 0x08070605);
+        REQUIRE(target.view(segment_address, 16) != nullptr);
+    }
+
+    SECTION("Memory past the end of the file is zero filled") {
+        std::array<uint8_t, 16> buffer;
+        buffer.fill(0xff);
+        REQUIRE(target.view(segment_address + 8, buffer.size()) == nullptr);
+        REQUIRE((*core)->read_memory(segment_address + 8, buffer.data(), buffer.size()));
+
+        for(std::size_t i = 0; i < buffer.size(); ++i) {
+            REQUIRE(std::size_t{buffer[i]} == (i < 8 ? i + 9 : 0));
+        }
+    }
+
+    SECTION("Memory outside of the segments cannot be read") {
+        uint64_t value = 0;
+        REQUIRE_FALSE((*core)->read_memory(segment_address + segment_memory_size - 4, &value, sizeof(value)));
+        REQUIRE_FALSE((*core)->read_memory(segment_address - 8, &value, sizeof(value)));
+        REQUIRE_FALSE((*core)->write_memory(segment_address, &value, sizeof(value)));
+    }
+}
+
+TEST_CASE("Crafted core files are rejected", "[core_target]") {
+    core_image image(sample_notes(1), sample_contents());
+
+    SECTION("Program headers past the end of the file") {
+        image.header.e_phoff = UINT64_MAX - 8;
+        REQUIRE(load(image).error() == nkgt::error::core_file::invalid_format);
+    }
+
+    SECTION("More program headers than the file holds") {
+        image.header.e_phnum = 0xfff0;
+        REQUIRE(load(image).error() == nkgt::error::core_file::invalid_format);
+    }
+
+    SECTION("Segment past the end of the file") {
+        image.segments[1].p_offset = UINT64_MAX - 4;
+        REQUIRE(load(image).error() == nkgt::error::core_file::invalid_format);
+    }
+
+    SECTION("Segment whose end overflows") {
+        image.segments[1].p_filesz = UINT64_MAX - image.segments[1].p_offset + 1;
+        REQUIRE(load(image).error() == nkgt::error::core_file::invalid_format);
+    }
+
+    SECTION("NT_FILE note whose size overflows") {
+        // count * 24 wraps around to 24, the size of the one entry.
+        const auto core = load(core_image(sample_notes((uint64_t{1} << 61) + 1), sample_contents()));
+        REQUIRE(core);
+        REQUIRE((*core)->mappings().empty());
+    }
+
+    SECTION("Missing NT_PRSTATUS note") {
+        bytes notes;
+        append_note(notes, NT_FILE, file_note(1, "/usr/bin/program"));
+        REQUIRE(load(core_image(notes, sample_contents())).error() == nkgt::error::core_file::missing_registers);
+    }
+}
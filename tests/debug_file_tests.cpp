@@ -0,0 +1,213 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "nkgt/debug_file.hpp"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+struct test_section {
+    std::string name;
+    uint32_t type;
+    std::vector<uint8_t> content;
+};
+
+auto test_directory() -> fs::path {
+    return fs::temp_directory_path() / ("debug_file_tests." + std::to_string(getpid()));
+}
+
+// Writes an ELF file with only a header, the given sections and the section
+// names, which is all the debug_file functions look at.
+auto write_elf(const fs::path& path, const std::vector<test_section>& sections) -> void {
+    std::vector<uint8_t> names(1, 0);
+    std::vector<uint8_t> data(sizeof(Elf64_Ehdr), 0);
+    std::vector<Elf64_Shdr> headers(1, Elf64_Shdr{});
+
+    for(const auto& s : sections) {
+        Elf64_Shdr header = {};
+        header.sh_name = static_cast<uint32_t>(names.size());
+        header.sh_type = s.type;
+        header.sh_offset = data.size();
+        header.sh_size = s.content.size();
+        headers.push_back(header);
+
+        names.insert(names.end(), s.name.cbegin(), s.name.cend());
+        names.push_back(0);
+        if(s.type != SHT_NOBITS) {
+            data.insert(data.end(), s.content.cbegin(), s.content.cend());
+        }
+    }
+
+    Elf64_Shdr string_table = {};
+    string_table.sh_name = static_cast<uint32_t>(names.size());
+    string_table.sh_type = SHT_STRTAB;
+    string_table.sh_offset = data.size();
+    const std::string shstrtab = ".shstrtab";
+    names.insert(names.end(), shstrtab.cbegin(), shstrtab.cend());
+    names.push_back(0);
+    string_table.sh_size = names.size();
+    headers.push_back(string_table);
+    data.insert(data.end(), names.cbegin(), names.cend());
+
+    Elf64_Ehdr header = {};
+    std::memcpy(header.e_ident, ELFMAG, SELFMAG);
+    header.e_ident[EI_CLASS] = ELFCLASS64;
+    header.e_ident[EI_DATA] = ELFDATA2LSB;
+    header.e_ident[EI_VERSION] = EV_CURRENT;
+    header.e_type = ET_EXEC;
+    header.e_machine = EM_X86_64;
+    header.e_shoff = data.size();
+    header.e_shentsize = sizeof(Elf64_Shdr);
+    header.e_shnum = static_cast<uint16_t>(headers.size());
+    header.e_shstrndx = static_cast<uint16_t>(headers.size() - 1);
+    std::memcpy(data.data(), &header, sizeof(header));
+
+    fs::create_directories(path.parent_path());
+    std::ofstream out(path, std::ios::binary);
+    out.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+    out.write(reinterpret_cast<const char*>(headers.data()), static_cast<std::streamsize>(headers.size() * sizeof(Elf64_Shdr)));
+}
+
+auto build_id_note(const std::vector<uint8_t>& id) -> test_section {
+    std::vector<uint8_t> note = {4, 0, 0, 0, static_cast<uint8_t>(id.size()), 0, 0, 0, NT_GNU_BUILD_ID, 0, 0, 0, 'G', 'N', 'U', 0};
+    note.insert(note.end(), id.cbegin(), id.cend());
+    note.resize((note.size() + 3) & ~std::size_t{3}, 0);
+    return {".note.gnu.build-id", SHT_NOTE, note};
+}
+
+auto debuglink_section(const std::string& name, uint32_t crc) -> test_section {
+    std::vector<uint8_t> content(name.cbegin(), name.cend());
+    content.resize((name.size() + 4) & ~std::size_t{3}, 0);
+    content.resize(content.size() + sizeof(crc));
+    std::memcpy(content.data() + content.size() - sizeof(crc), &crc, sizeof(crc));
+    return {".gnu_debuglink", SHT_PROGBITS, content};
+}
+
+auto debug_info_section(uint32_t type) -> test_section {
+    return {".debug_info", type, {1, 2, 3, 4}};
+}
+
+auto file_crc(const fs::path& path) -> uint32_t {
+    const auto file = nkgt::debug_file::open_elf(path);
+    REQUIRE(file);
+    return nkgt::debug_file::crc32((*file)->data(), (*file)->size());
+}
+
+}
+
+TEST_CASE("CRC-32 of .gnu_debuglink", "[debug_file]") {
+    const std::string text = "123456789";
+    const auto* data = reinterpret_cast<const std::byte*>(text.data());
+
+    REQUIRE(nkgt::debug_file::crc32(data, 0) == 0);
+    REQUIRE(nkgt::debug_file::crc32(data, text.size()) == 0xcbf43926);
+    REQUIRE(nkgt::debug_file::crc32(data + 4, 5, nkgt::debug_file::crc32(data, 4)) == 0xcbf43926);
+}
+
+TEST_CASE("Build-id and debuglink are read from the sections", "[debug_file]") {
+    const auto directory = test_directory();
+    const auto path = directory / "program";
+    write_elf(path, {build_id_note({0xab, 0xcd, 0xef, 0x01}), debuglink_section("program.debug", 0x12345678), debug_info_section(SHT_NOBITS)});
+
+    const auto file = nkgt::debug_file::open_elf(path);
+    REQUIRE(file);
+    REQUIRE((*file)->sections().size() == 5);
+    REQUIRE((*file)->find_section(".gnu_debuglink") != nullptr);
+    REQUIRE((*file)->find_section(".text") == nullptr);
+    REQUIRE((*file)->build_id() == std::vector<uint8_t>{0xab, 0xcd, 0xef, 0x01});
+    REQUIRE(!(*file)->has_debug_info());
+
+    const auto link = (*file)->link();
+    REQUIRE(link);
+    REQUIRE(link->name == "program.debug");
+    REQUIRE(link->crc == 0x12345678);
+
+    REQUIRE(
+        nkgt::debug_file::build_id_path("/usr/lib/debug", (*file)->build_id()) ==
+        "/usr/lib/debug/.build-id/ab/cdef01.debug"
+    );
+
+    fs::remove_all(directory);
+}
+
+TEST_CASE("Separate debug files are found by build-id", "[debug_file]") {
+    const auto directory = test_directory();
+    const auto root = directory / "debug";
+    const std::vector<uint8_t> id = {0x01, 0x02, 0x03, 0x04, 0x05};
+
+    write_elf(directory / "program", {build_id_note(id), debug_info_section(SHT_NOBITS)});
+    const auto program = nkgt::debug_file::open_elf(directory / "program");
+    REQUIRE(program);
+
+    SECTION("The build-id of the candidate has to match") {
+        write_elf(nkgt::debug_file::build_id_path(root, id), {build_id_note({0x01}), debug_info_section(SHT_PROGBITS)});
+        REQUIRE(!nkgt::debug_file::find_separate_debug_file(**program, {root}));
+    }
+
+    SECTION("The candidate has to hold the DWARF information") {
+        write_elf(nkgt::debug_file::build_id_path(root, id), {build_id_note(id), debug_info_section(SHT_NOBITS)});
+        REQUIRE(!nkgt::debug_file::find_separate_debug_file(**program, {root}));
+    }
+
+    SECTION("Matching file") {
+        const auto expected = nkgt::debug_file::build_id_path(root, id);
+        write_elf(expected, {build_id_note(id), debug_info_section(SHT_PROGBITS)});
+        REQUIRE(nkgt::debug_file::find_separate_debug_file(**program, {directory / "missing", root}) == expected);
+    }
+
+    fs::remove_all(directory);
+}
+
+TEST_CASE("Separate debug files are found by debuglink", "[debug_file]") {
+    const auto directory = test_directory();
+    const auto root = directory / "debug";
+    const auto debug_path = directory / ".debug" / "program.debug";
+
+    write_elf(debug_path, {debug_info_section(SHT_PROGBITS)});
+    const uint32_t crc = file_crc(debug_path);
+
+    SECTION("In the .debug directory next to the program") {
+        write_elf(directory / "program", {debuglink_section("program.debug", crc)});
+        const auto program = nkgt::debug_file::open_elf(directory / "program");
+        REQUIRE(program);
+        REQUIRE(nkgt::debug_file::find_separate_debug_file(**program, {root}) == debug_path);
+    }
+
+    SECTION("Under the debug root") {
+        const auto moved = root / directory.relative_path() / "program.debug";
+        fs::create_directories(moved.parent_path());
+        fs::rename(debug_path, moved);
+
+        REQUIRE(nkgt::debug_file::find_debuglink_file(directory / "program", {"program.debug", crc}, {root}) == moved);
+        REQUIRE(!nkgt::debug_file::find_debuglink_file(directory / "program", {"program.debug", crc}, {}));
+    }
+
+    SECTION("The CRC has to match") {
+        REQUIRE(!nkgt::debug_file::find_debuglink_file(directory / "program", {"program.debug", crc + 1}, {root}));
+    }
+
+    fs::remove_all(directory);
+}
+
+TEST_CASE("Files that are not ELF are rejected", "[debug_file]") {
+    const auto directory = test_directory();
+    const auto path = directory / "text";
+    fs::create_directories(directory);
+
+    {
+        std::ofstream out(path);
+        out << std::string(sizeof(Elf64_Ehdr) + 16, 'x');
+    }
+
+    REQUIRE(nkgt::debug_file::open_elf(path).error() == nkgt::error::debug_file::invalid_format);
+
+    fs::remove_all(directory);
+    REQUIRE(nkgt::debug_file::open_elf(path).error() == nkgt::error::debug_file::open_fail);
+}
@@ -0,0 +1,53 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "nkgt/debugger.hpp"
+#include "nkgt/target.hpp"
+
+#include "fake_target.hpp"
+
+#include <cstring>
+#include <unordered_map>
+#include <vector>
+
+TEST_CASE("Breakpoints are enabled one page at a time", "[debugger]") {
+    fake_target debugee(0x10000, 0x3000, 0x90);
+    debugee.memory[0x10] = 0x55;
+    debugee.memory[0xff0] = 0x48;
+    debugee.memory[0x1008] = 0xc3;
+
+    std::unordered_map<std::intptr_t, nkgt::debugger::breakpoint> breakpoint_list;
+    for(const std::intptr_t address : {0x10010, 0x10400, 0x10ff0, 0x11008}) {
+        breakpoint_list[address] = {0, address};
+    }
+
+    REQUIRE(nkgt::debugger::enable_breakpoints(debugee, breakpoint_list));
+    REQUIRE(debugee.reads == 2);
+    REQUIRE(debugee.writes == 2);
+
+    for(const auto& [address, bp] : breakpoint_list) {
+        REQUIRE(bp.enabled);
+        REQUIRE(bp.pid == 1234);
+        REQUIRE(debugee.memory[static_cast<std::size_t>(address) - debugee.base] == 0xcc);
+    }
+
+    REQUIRE(breakpoint_list[0x10010].saved_data == 0x55);
+    REQUIRE(breakpoint_list[0x10400].saved_data == 0x90);
+    REQUIRE(breakpoint_list[0x10ff0].saved_data == 0x48);
+    REQUIRE(breakpoint_list[0x11008].saved_data == 0xc3);
+    // Bytes between the breakpoints are written back unchanged.
+    REQUIRE(debugee.memory[0x11] == 0x90);
+
+    SECTION("Enabled breakpoints are left alone") {
+        REQUIRE(nkgt::debugger::enable_breakpoints(debugee, breakpoint_list));
+        REQUIRE(debugee.writes == 2);
+    }
+
+    SECTION("Unmapped pages are reported and their breakpoints stay disabled") {
+        breakpoint_list[0x40000] = {0, 0x40000};
+        const auto result = nkgt::debugger::enable_breakpoints(debugee, breakpoint_list);
+
+        REQUIRE(!result);
+        REQUIRE(result.error() == nkgt::error::breakpoint::peek_address_fail);
+        REQUIRE(!breakpoint_list[0x40000].enabled);
+    }
+}
@@ -0,0 +1,166 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "nkgt/disassembler.hpp"
+
+#include <string>
+#include <vector>
+
+namespace {
+
+struct expected_instruction {
+    std::vector<uint8_t> code;
+    std::string text;
+};
+
+auto decode(const std::vector<uint8_t>& code, std::uintptr_t address = 0x1000) -> std::optional<nkgt::disassembler::instruction> {
+    return nkgt::disassembler::decode(code.data(), code.size(), address);
+}
+
+}
+
+TEST_CASE("Instructions are decoded in Intel syntax", "[disassembler]") {
+    const std::vector<expected_instruction> instructions = {
+        {{0xf3, 0x0f, 0x1e, 0xfa}, "endbr64"},
+        {{0x55}, "push rbp"},
+        {{0x48, 0x89, 0xe5}, "mov rbp, rsp"},
+        {{0x41, 0x57}, "push r15"},
+        {{0x48, 0x83, 0xec, 0x10}, "sub rsp, 0x10"},
+        {{0x48, 0x83, 0xe4, 0xf0}, "and rsp, -0x10"},
+        {{0x89, 0x7d, 0xfc}, "mov dword ptr [rbp - 0x4], edi"},
+        {{0x8b, 0x04, 0x8a}, "mov eax, dword ptr [rdx + rcx*4]"},
+        {{0x64, 0x48, 0x8b, 0x04, 0x25, 0x28, 0x00, 0x00, 0x00}, "mov rax, qword ptr fs:[0x28]"},
+        {{0x0f, 0xb6, 0xc0}, "movzx eax, al"},
+        {{0x88, 0xe0}, "mov al, ah"},
+        {{0x40, 0x88, 0xf0}, "mov al, sil"},
+        {{0x66, 0x0f, 0x1f, 0x44, 0x00, 0x00}, "nop word ptr [rax + rax*1]"},
+        {{0x48, 0xb8, 0x88, 0x77, 0x66, 0x55, 0x44, 0x33, 0x22, 0x11}, "mov rax, 0x1122334455667788"},
+        {{0xf7, 0xc7, 0x01, 0x00, 0x00, 0x00}, "test edi, 0x1"},
+        {{0xf0, 0x0f, 0xb1, 0x17}, "lock cmpxchg dword ptr [rdi], edx"},
+        {{0xf3, 0x48, 0xab}, "rep stosq"},
+        {{0x48, 0x98}, "cdqe"},
+        {{0xc3}, "ret"},
+        {{0xcc}, "int3"},
+        {{0x0f, 0x05}, "syscall"},
+        {{0x0f, 0xae, 0xf0}, "mfence"},
+        {{0x66, 0x0f, 0xef, 0xc0}, "pxor xmm0, xmm0"},
+        {{0xf2, 0x0f, 0x58, 0x45, 0xf8}, "addsd xmm0, qword ptr [rbp - 0x8]"},
+        {{0xc5, 0xf9, 0xef, 0xc0}, "vpxor xmm0, xmm0, xmm0"},
+        {{0xc5, 0xfe, 0x6f, 0x0e}, "vmovdqu ymm1, ymmword ptr [rsi]"},
+        {{0xc5, 0xf8, 0x77}, "vzeroupper"},
+        {{0xc4, 0xe2, 0xf9, 0xa9, 0xc2}, "vfmadd213sd xmm0, xmm0, xmm2"},
+        {{0x62, 0xe1, 0xfe, 0x48, 0x6f, 0x07}, "vmovdqu64 zmm16, zmmword ptr [rdi]"},
+        {{0xc4, 0xe2, 0x78, 0xf2, 0xc1}, "andn eax, eax, ecx"},
+        {{0xd9, 0x7c, 0x24, 0x02}, "fnstcw word ptr [rsp + 0x2]"},
+        {{0x9b, 0xd9, 0x7c, 0x24, 0x02}, "fstcw word ptr [rsp + 0x2]"},
+        {{0xdb, 0x6c, 0x24, 0x20}, "fld tbyte ptr [rsp + 0x20]"},
+    };
+
+    for(const auto& expected : instructions) {
+        const auto i = decode(expected.code);
+        REQUIRE(i);
+        REQUIRE(i->text == expected.text);
+        REQUIRE(i->size == expected.code.size());
+        REQUIRE(i->address == 0x1000);
+    }
+}
+
+TEST_CASE("Targets of branches and rip relative operands", "[disassembler]") {
+    const auto call = decode({0xe8, 0xfb, 0xff, 0xff, 0xff});
+    REQUIRE(call);
+    REQUIRE(call->text == "call 0x1000");
+    REQUIRE(call->target == 0x1000);
+    REQUIRE(!call->ends_block);
+
+    const auto jump = decode({0x74, 0x10});
+    REQUIRE(jump);
+    REQUIRE(jump->text == "je 0x1012");
+    REQUIRE(jump->target == 0x1012);
+    REQUIRE(jump->ends_block);
+
+    const auto near_jump = decode({0x0f, 0x85, 0x00, 0x01, 0x00, 0x00});
+    REQUIRE(near_jump);
+    REQUIRE(near_jump->text == "jne 0x1106");
+
+    const auto lea = decode({0x48, 0x8d, 0x05, 0xf9, 0x0f, 0x00, 0x00});
+    REQUIRE(lea);
+    REQUIRE(lea->text == "lea rax, [rip + 0xff9]");
+    REQUIRE(lea->target == 0x2000);
+    REQUIRE(!lea->ends_block);
+
+    const auto indirect = decode({0xff, 0xe0});
+    REQUIRE(indirect);
+    REQUIRE(indirect->text == "jmp rax");
+    REQUIRE(!indirect->target);
+    REQUIRE(indirect->ends_block);
+
+    const auto indirect_call = decode({0xff, 0x15, 0x00, 0x10, 0x00, 0x00});
+    REQUIRE(indirect_call);
+    REQUIRE(indirect_call->text == "call qword ptr [rip + 0x1000]");
+    REQUIRE(!indirect_call->ends_block);
+}
+
+TEST_CASE("Truncated and invalid instructions", "[disassembler]") {
+    // The immediate is missing.
+    REQUIRE(!decode({0x48, 0x83, 0xec}));
+    REQUIRE(!decode({0xe8, 0x00, 0x00}));
+    REQUIRE(!nkgt::disassembler::decode(nullptr, 0, 0x1000));
+
+    // Not valid in 64-bit mode.
+    const auto invalid = decode({0x06, 0x90});
+    REQUIRE(invalid);
+    REQUIRE(invalid->text == "(bad)");
+    REQUIRE(invalid->size == 1);
+
+    // Register operand of an instruction that only takes memory.
+    const auto lea = decode({0x8d, 0xc0});
+    REQUIRE(lea);
+    REQUIRE(lea->text == "(bad)");
+}
+
+TEST_CASE("Blocks are cached until their code is written", "[disassembler]") {
+    // push rbp; mov rbp, rsp; je +2; nop; ret; then the next block.
+    const std::vector<uint8_t> code = {0x55, 0x48, 0x89, 0xe5, 0x74, 0x02, 0x90, 0xc3, 0x31, 0xc0, 0xc3};
+    nkgt::disassembler::block_cache cache;
+
+    REQUIRE(cache.find(0x1ffc) == nullptr);
+
+    const auto* first = cache.insert(code.data(), code.size(), 0x1ffc);
+    REQUIRE(first != nullptr);
+    REQUIRE(first->instructions.size() == 3);
+    REQUIRE(first->instructions.back().text == "je 0x2004");
+    REQUIRE(first->end() == 0x2002);
+    REQUIRE(cache.find(0x1ffc) == first);
+
+    const auto* second = cache.insert(code.data() + 6, code.size() - 6, 0x2002);
+    REQUIRE(second != nullptr);
+    REQUIRE(second->instructions.size() == 2);
+    REQUIRE(second->end() == 0x2004);
+
+    const auto* far_away = cache.insert(code.data() + 8, code.size() - 8, 0x5000);
+    REQUIRE(far_away != nullptr);
+    REQUIRE(cache.size() == 3);
+
+    SECTION("Blocks crossing into a written page are dropped") {
+        cache.invalidate(0x2800, 8);
+        REQUIRE(cache.size() == 1);
+        REQUIRE(cache.find(0x1ffc) == nullptr);
+        REQUIRE(cache.find(0x5000) != nullptr);
+    }
+
+    SECTION("Blocks on other pages are kept") {
+        cache.invalidate(0x3000, 8);
+        REQUIRE(cache.size() == 3);
+
+        cache.invalidate(0x1000, 8);
+        REQUIRE(cache.size() == 2);
+        REQUIRE(cache.find(0x2002) != nullptr);
+    }
+
+    SECTION("Nothing is cached without a whole instruction") {
+        REQUIRE(cache.insert(code.data() + 1, 2, 0x7000) == nullptr);
+        REQUIRE(cache.size() == 3);
+
+        cache.clear();
+        REQUIRE(cache.size() == 0);
+    }
+}
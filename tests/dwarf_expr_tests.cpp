@@ -0,0 +1,210 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "nkgt/dwarf_expr.hpp"
+#include "nkgt/target.hpp"
+
+#include "fake_target.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+// DWARF opcodes used by the tests.
+constexpr uint8_t op_addr = 0x03;
+constexpr uint8_t op_deref = 0x06;
+constexpr uint8_t op_consts = 0x11;
+constexpr uint8_t op_abs = 0x19;
+constexpr uint8_t op_div = 0x1b;
+constexpr uint8_t op_minus = 0x1c;
+constexpr uint8_t op_plus_uconst = 0x23;
+constexpr uint8_t op_lit2 = 0x32;
+constexpr uint8_t op_lit5 = 0x35;
+constexpr uint8_t op_reg0 = 0x50;
+constexpr uint8_t op_breg7 = 0x77;
+constexpr uint8_t op_fbreg = 0x91;
+constexpr uint8_t op_piece = 0x93;
+constexpr uint8_t op_call_frame_cfa = 0x9c;
+constexpr uint8_t op_stack_value = 0x9f;
+constexpr uint8_t op_entry_value = 0xa3;
+constexpr uint8_t op_form_tls_address = 0x9b;
+
+auto assemble(
+    std::initializer_list<std::array<uint64_t, 3>> operations
+) -> nkgt::dwarf_expr::program {
+    nkgt::dwarf_expr::program code;
+
+    for(const auto& op : operations) {
+        const auto decoded = nkgt::dwarf_expr::decode(static_cast<uint8_t>(op[0]), op[1], op[2]);
+        REQUIRE(decoded);
+        code.push_back(*decoded);
+    }
+
+    return code;
+}
+
+constexpr auto minus(int64_t value) -> uint64_t {
+    return static_cast<uint64_t>(value);
+}
+
+}
+
+TEST_CASE("Location expressions are evaluated", "[dwarf_expr]") {
+    using nkgt::dwarf_expr::piece;
+
+    fake_target target(0x1000, 64);
+    user_regs_struct regs = {};
+    regs.rax = 42;
+    regs.rsp = 0x1020;
+    nkgt::dwarf_expr::context ctx = {target, regs, 0x400000, 0x1030, 0x1038};
+
+    SECTION("Frame base and register relative addresses") {
+        const auto fbreg = nkgt::dwarf_expr::evaluate(assemble({{op_fbreg, minus(-20), 0}}), ctx);
+        REQUIRE(fbreg);
+        REQUIRE(fbreg->size() == 1);
+        REQUIRE(fbreg->front().k == piece::kind::memory);
+        REQUIRE(fbreg->front().value == 0x1030 - 20);
+
+        const auto breg = nkgt::dwarf_expr::evaluate(assemble({{op_breg7, 8, 0}}), ctx);
+        REQUIRE(breg);
+        REQUIRE(breg->front().value == 0x1028);
+
+        const auto cfa = nkgt::dwarf_expr::evaluate_value(assemble({{op_call_frame_cfa, 0, 0}}), ctx);
+        REQUIRE(cfa);
+        REQUIRE(*cfa == 0x1038);
+    }
+
+    SECTION("Static addresses are relocated by the load bias") {
+        const auto result = nkgt::dwarf_expr::evaluate(assemble({{op_addr, 0x4010, 0}}), ctx);
+        REQUIRE(result);
+        REQUIRE(result->front().value == 0x404010);
+    }
+
+    SECTION("Arithmetic, dereferences and computed values") {
+        const uint64_t pointer = 0x1010;
+        std::memcpy(target.memory.data() + 8, &pointer, sizeof(pointer));
+
+        const auto result = nkgt::dwarf_expr::evaluate(assemble({
+            {op_consts, 0x1008, 0},
+            {op_deref, 0, 0},
+            {op_plus_uconst, 4, 0},
+            {op_lit5, 0, 0},
+            {op_lit2, 0, 0},
+            {op_minus, 0, 0},
+            {op_minus, 0, 0},
+            {op_stack_value, 0, 0},
+        }), ctx);
+
+        REQUIRE(result);
+        REQUIRE(result->front().k == piece::kind::value);
+        REQUIRE(result->front().value == 0x1010 + 4 - 3);
+    }
+
+    SECTION("Overflowing signed arithmetic wraps") {
+        const uint64_t min = minus(INT64_MIN);
+
+        const auto absolute = nkgt::dwarf_expr::evaluate_value(assemble({
+            {op_consts, min, 0},
+            {op_abs, 0, 0},
+        }), ctx);
+        REQUIRE(absolute);
+        REQUIRE(*absolute == min);
+
+        const auto quotient = nkgt::dwarf_expr::evaluate_value(assemble({
+            {op_consts, min, 0},
+            {op_consts, minus(-1), 0},
+            {op_div, 0, 0},
+        }), ctx);
+        REQUIRE(quotient);
+        REQUIRE(*quotient == min);
+
+        const auto negated = nkgt::dwarf_expr::evaluate_value(assemble({
+            {op_consts, 42, 0},
+            {op_consts, minus(-1), 0},
+            {op_div, 0, 0},
+        }), ctx);
+        REQUIRE(negated);
+        REQUIRE(*negated == minus(-42));
+    }
+
+    SECTION("Objects split between registers and memory") {
+        const auto result = nkgt::dwarf_expr::evaluate(assemble({
+            {op_reg0, 0, 0},
+            {op_piece, 4, 0},
+            {op_fbreg, 0, 0},
+            {op_piece, 4, 0},
+        }), ctx);
+
+        REQUIRE(result);
+        REQUIRE(result->size() == 2);
+        REQUIRE((*result)[0].k == piece::kind::reg);
+        REQUIRE((*result)[0].size == 4);
+        REQUIRE((*result)[1].k == piece::kind::memory);
+        REQUIRE((*result)[1].value == 0x1030);
+    }
+
+    SECTION("Entry values are reported as optimized out") {
+        const auto result = nkgt::dwarf_expr::evaluate(assemble({{op_entry_value, 0, 0}}), ctx);
+        REQUIRE(result);
+        REQUIRE(result->front().k == piece::kind::optimized_out);
+    }
+
+    SECTION("Malformed and unsupported expressions fail") {
+        REQUIRE_FALSE(nkgt::dwarf_expr::decode(op_form_tls_address, 0, 0));
+        REQUIRE_FALSE(nkgt::dwarf_expr::evaluate(assemble({{op_minus, 0, 0}}), ctx));
+    }
+}
+
+TEST_CASE("Location lists select the entry covering pc", "[dwarf_expr]") {
+    nkgt::dwarf_expr::location location;
+    location.entries.push_back({0x100, 0x120, assemble({{op_reg0, 0, 0}})});
+    location.entries.push_back({0x120, 0x180, assemble({{op_fbreg, 0, 0}})});
+
+    REQUIRE(location.at(0x100) == &location.entries[0].code);
+    REQUIRE(location.at(0x17f) == &location.entries[1].code);
+    REQUIRE(location.at(0x180) == nullptr);
+    REQUIRE(location.at(0xff) == nullptr);
+}
+
+TEST_CASE("Pieces are read with a single scatter read", "[dwarf_expr]") {
+    using nkgt::dwarf_expr::piece;
+
+    fake_target target(0x1000, 64);
+    user_regs_struct regs = {};
+    regs.rax = 0x11223344;
+    nkgt::dwarf_expr::context ctx = {target, regs, 0, 0, 0};
+
+    for(std::size_t i = 0; i < target.memory.size(); ++i) {
+        target.memory[i] = static_cast<uint8_t>(i);
+    }
+
+    const std::vector<piece> pieces = {
+        {piece::kind::memory, 0x1004, 2},
+        {piece::kind::reg, 0, 4},
+        {piece::kind::value, 0xaabb, 2},
+        {piece::kind::memory, 0x1010, 0},
+    };
+
+    std::array<std::byte, 12> bytes;
+    REQUIRE(nkgt::dwarf_expr::read_pieces(pieces, ctx, bytes.data(), bytes.size()));
+
+    const std::array<uint8_t, 12> expected = {
+        0x04, 0x05,
+        0x44, 0x33, 0x22, 0x11,
+        0xbb, 0xaa,
+        0x10, 0x11, 0x12, 0x13,
+    };
+
+    REQUIRE(std::memcmp(bytes.data(), expected.data(), bytes.size()) == 0);
+    REQUIRE(target.scatter_reads == 1);
+
+    SECTION("Optimized out pieces cannot be read") {
+        const std::vector<piece> missing = {{piece::kind::optimized_out, 0, 0}};
+        const auto result = nkgt::dwarf_expr::read_pieces(missing, ctx, bytes.data(), bytes.size());
+        REQUIRE_FALSE(result);
+        REQUIRE(result.error() == nkgt::error::dwarf_expr::optimized_out);
+    }
+}
@@ -0,0 +1,155 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "nkgt/event_log.hpp"
+
+#include <filesystem>
+#include <unistd.h>
+
+using nkgt::event_log::event;
+using nkgt::event_log::record;
+
+namespace {
+
+auto log_path() -> std::filesystem::path {
+    return std::filesystem::temp_directory_path() / ("event_log_tests." + std::to_string(getpid()));
+}
+
+auto hit(uint64_t time_ns, uint64_t address) -> record {
+    return {time_ns, event::breakpoint, 0, 42, address, {time_ns % 100, 0, 0, 0, 0}};
+}
+
+}
+
+TEST_CASE("Records are read back oldest first", "[event_log]") {
+    const auto path = log_path();
+
+    SECTION("Before the ring wraps around") {
+        {
+            auto log = nkgt::event_log::create(path, 8);
+            REQUIRE(log);
+            (*log)->append(hit(1, 0x1000));
+            (*log)->append(hit(2, 0x2000));
+            REQUIRE((*log)->written() == 2);
+        }
+
+        const auto contents = nkgt::event_log::read(path);
+        REQUIRE(contents);
+        REQUIRE(contents->capacity == 8);
+        REQUIRE(contents->written == 2);
+        REQUIRE(contents->records.size() == 2);
+        REQUIRE(contents->records[0].address == 0x1000);
+        REQUIRE(contents->records[1].address == 0x2000);
+        REQUIRE(contents->records[1].thread == 42);
+    }
+
+    SECTION("Only the last capacity records are kept") {
+        {
+            // Rounded up to 8.
+            auto log = nkgt::event_log::create(path, 7);
+            REQUIRE(log);
+            REQUIRE((*log)->capacity() == 8);
+
+            for(uint64_t i = 0; i < 21; ++i) {
+                (*log)->append(hit(i, 0x1000 + i));
+            }
+        }
+
+        const auto contents = nkgt::event_log::read(path);
+        REQUIRE(contents);
+        REQUIRE(contents->written == 21);
+        REQUIRE(contents->records.size() == 8);
+
+        for(uint64_t i = 0; i < 8; ++i) {
+            REQUIRE(contents->records[i].time_ns == 13 + i);
+        }
+    }
+
+    std::filesystem::remove(path);
+}
+
+TEST_CASE("Files that are not event logs are rejected", "[event_log]") {
+    const auto path = log_path();
+    {
+        auto log = nkgt::event_log::create(path, 8);
+        REQUIRE(log);
+    }
+
+    // Shorter than the records the header announces.
+    std::filesystem::resize_file(path, sizeof(nkgt::event_log::file_header) + 4 * sizeof(record));
+    REQUIRE(nkgt::event_log::read(path).error() == nkgt::error::event_log::invalid_format);
+
+    std::filesystem::resize_file(path, 10);
+    REQUIRE(nkgt::event_log::read(path).error() == nkgt::error::event_log::invalid_format);
+
+    std::filesystem::remove(path);
+    REQUIRE(nkgt::event_log::read(path).error() == nkgt::error::event_log::open_fail);
+}
+
+TEST_CASE("Register snapshots span several records", "[event_log]") {
+    const auto path = log_path();
+
+    user_regs_struct regs = {};
+    regs.rax = 1;
+    regs.rip = 0x401000;
+    regs.es = 0x2b;
+
+    {
+        auto log = nkgt::event_log::create(path, 16);
+        REQUIRE(log);
+        (*log)->append(hit(1, 0x400fff));
+        (*log)->append_registers(1, 42, regs);
+    }
+
+    const auto contents = nkgt::event_log::read(path);
+    REQUIRE(contents);
+    REQUIRE(contents->records.size() == 1 + nkgt::event_log::register_records);
+
+    const auto& records = contents->records;
+    const auto snapshot = nkgt::event_log::snapshot_registers(&records[1], records.size() - 1);
+    REQUIRE(snapshot);
+    REQUIRE(snapshot->rax == 1);
+    REQUIRE(snapshot->rip == 0x401000);
+    REQUIRE(snapshot->es == 0x2b);
+
+    // Truncated or not starting at the first part.
+    REQUIRE(!nkgt::event_log::snapshot_registers(&records[1], records.size() - 2));
+    REQUIRE(!nkgt::event_log::snapshot_registers(&records[2], records.size() - 2));
+
+    std::filesystem::remove(path);
+}
+
+TEST_CASE("Events are aggregated by type and address", "[event_log]") {
+    std::vector<record> records = {
+        hit(10, 0x1000),
+        {20, event::skipped, 0, 42, 0x2000, {30, 5, 0, 0, 0}},
+        {30, event::skipped, 0, 42, 0x2000, {50, 7, 0, 0, 0}},
+        {40, event::skipped, 0, 42, 0x2000, {40, 6, 0, 0, 0}},
+        {40, event::registers, 0, 42, 0x2001, {}},
+        {50, event::signal, 0, 42, 0x1000, {11, 0, 0, 0, 0}},
+    };
+
+    const auto summary = nkgt::event_log::summarize(records);
+    REQUIRE(summary.size() == 3);
+
+    REQUIRE(summary[0].type == event::skipped);
+    REQUIRE(summary[0].count == 3);
+    REQUIRE(summary[0].first_ns == 20);
+    REQUIRE(summary[0].last_ns == 40);
+    REQUIRE(summary[0].total_run_ns == 120);
+    REQUIRE(summary[0].total_condition_ns == 18);
+
+    // Ties keep the order of type and address.
+    REQUIRE(summary[1].type == event::breakpoint);
+    REQUIRE(summary[1].total_run_ns == 10);
+    REQUIRE(summary[2].type == event::signal);
+    REQUIRE(summary[2].total_run_ns == 0);
+}
+
+TEST_CASE("Event names", "[event_log]") {
+    for(std::size_t i = 0; i < nkgt::event_log::event_count; ++i) {
+        const auto e = static_cast<event>(i);
+        REQUIRE(nkgt::event_log::from_string(nkgt::event_log::to_string(e)) == e);
+    }
+
+    REQUIRE(!nkgt::event_log::from_string("breakpoints"));
+}
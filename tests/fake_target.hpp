@@ -0,0 +1,110 @@
+#pragma once
+#include "nkgt/error_codes.hpp"
+#include "nkgt/target.hpp"
+
+#include <tl/expected.hpp>
+
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <sys/user.h>
+#include <vector>
+
+// Target of the tests whose registers are regs and extended_state and whose
+// memory is a single buffer starting at base. The calls are counted, so that
+// batching and caching can be verified: a read_memory_scatter() counts as a
+// single read.
+class fake_target final : public nkgt::target::target {
+public:
+    fake_target() = default;
+
+    fake_target(std::uintptr_t memory_base, std::size_t size, uint8_t fill = 0)
+        : base(memory_base), memory(size, fill) {}
+
+    auto read_registers(
+    ) -> tl::expected<user_regs_struct, nkgt::error::registers> override {
+        register_reads += 1;
+        return regs;
+    }
+
+    auto write_registers(
+        const user_regs_struct& r
+    ) -> tl::expected<void, nkgt::error::registers> override {
+        register_writes += 1;
+        regs = r;
+        return {};
+    }
+
+    auto read_extended_state(
+    ) -> tl::expected<const nkgt::target::extended_state*, nkgt::error::registers> override {
+        if(!extended_state) {
+            return tl::make_unexpected(nkgt::error::registers::getfpregs_fail);
+        }
+
+        return &*extended_state;
+    }
+
+    auto invalidate_caches() -> void override {}
+
+    auto read_memory(
+        std::uintptr_t address,
+        void* buffer,
+        std::size_t size
+    ) -> tl::expected<void, nkgt::error::memory> override {
+        reads += 1;
+        if(!contains(address, size)) {
+            return tl::make_unexpected(nkgt::error::memory::read_fail);
+        }
+
+        std::memcpy(buffer, memory.data() + (address - base), size);
+        return {};
+    }
+
+    auto write_memory(
+        std::uintptr_t address,
+        const void* buffer,
+        std::size_t size
+    ) -> tl::expected<void, nkgt::error::memory> override {
+        writes += 1;
+        if(!contains(address, size)) {
+            return tl::make_unexpected(nkgt::error::memory::write_fail);
+        }
+
+        std::memcpy(memory.data() + (address - base), buffer, size);
+        return {};
+    }
+
+    auto read_memory_scatter(
+        const nkgt::target::memory_request* requests,
+        std::size_t count
+    ) -> tl::expected<void, nkgt::error::memory> override {
+        const int before = reads;
+        const auto result = target::read_memory_scatter(requests, count);
+        reads = before + 1;
+        scatter_reads += 1;
+        return result;
+    }
+
+    auto is_live() const -> bool override { return true; }
+    auto pid() const -> pid_t override { return 1234; }
+
+    [[nodiscard]]
+    auto contains(std::uintptr_t address, std::size_t size) const -> bool {
+        return address >= base && size <= memory.size() && address - base <= memory.size() - size;
+    }
+
+    template<typename T>
+    auto store(std::uintptr_t address, const T& value) -> void {
+        std::memcpy(memory.data() + (address - base), &value, sizeof(value));
+    }
+
+    user_regs_struct regs = {};
+    std::optional<nkgt::target::extended_state> extended_state;
+    std::uintptr_t base = 0;
+    std::vector<uint8_t> memory;
+    int register_reads = 0;
+    int register_writes = 0;
+    int reads = 0;
+    int writes = 0;
+    int scatter_reads = 0;
+};
@@ -0,0 +1,79 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "nkgt/function_timer.hpp"
+
+#include <vector>
+
+using nkgt::function_timer::timestamp;
+
+TEST_CASE("Calls are paired with their returns", "[function_timer]") {
+    nkgt::function_timer::timer t("f", 0x1000);
+    const pid_t thread = 1;
+
+    SECTION("Stops during a call are not counted") {
+        REQUIRE(t.enter(thread, 0x2000, 0x7000, {1000, 1, 0}));
+        REQUIRE(t.is_return_address(0x2000));
+
+        // Three stops later, 200ns of which were spent stopped.
+        const auto released = t.leave(thread, 0x2000, 0x7008, {6000, 4, 200}, 1000);
+        REQUIRE(released == std::vector<std::uintptr_t>{0x2000});
+        REQUIRE(!t.is_return_address(0x2000));
+        REQUIRE(t.latency().count() == 1);
+        REQUIRE(t.latency().max() == 6000 - 1000 - 200 - 3 * 1000);
+    }
+
+    SECTION("Recursive calls") {
+        // The outer call returns to the caller, the inner ones into f itself.
+        REQUIRE(t.enter(thread, 0x2000, 0x7000, {0, 0, 0}));
+        REQUIRE(t.enter(thread, 0x1010, 0x6f00, {10, 1, 0}));
+        REQUIRE(!t.enter(thread, 0x1010, 0x6e00, {20, 2, 0}));
+
+        REQUIRE(t.leave(thread, 0x1010, 0x6e08, {40, 3, 0}, 0).empty());
+        REQUIRE(t.leave(thread, 0x1010, 0x6f08, {80, 4, 0}, 0) == std::vector<std::uintptr_t>{0x1010});
+        REQUIRE(t.leave(thread, 0x2000, 0x7008, {160, 5, 0}, 0) == std::vector<std::uintptr_t>{0x2000});
+
+        REQUIRE(t.latency().count() == 3);
+        REQUIRE(t.latency().sum() == 20 + 70 + 160);
+    }
+
+    SECTION("Return addresses reached without returning are ignored") {
+        REQUIRE(t.enter(thread, 0x2000, 0x7000, {0, 0, 0}));
+        REQUIRE(t.leave(thread, 0x2000, 0x6000, {10, 1, 0}, 0).empty());
+        REQUIRE(t.leave(2, 0x2000, 0x7008, {10, 1, 0}, 0).empty());
+        REQUIRE(t.latency().count() == 0);
+        REQUIRE(t.is_return_address(0x2000));
+    }
+
+    SECTION("Calls discarded by a longjmp are dropped") {
+        REQUIRE(t.enter(thread, 0x2000, 0x7000, {0, 0, 0}));
+        REQUIRE(t.enter(thread, 0x3000, 0x6000, {10, 1, 0}));
+
+        // Back above both frames.
+        const auto released = t.leave(thread, 0x2000, 0x7008, {100, 2, 0}, 0);
+        REQUIRE(released == std::vector<std::uintptr_t>{0x3000, 0x2000});
+        REQUIRE(t.dropped() == 1);
+        REQUIRE(t.latency().count() == 1);
+    }
+
+    SECTION("Threads have their own calls") {
+        REQUIRE(t.enter(1, 0x2000, 0x7000, {0, 0, 0}));
+        REQUIRE(!t.enter(2, 0x2000, 0x9000, {5, 1, 0}));
+
+        REQUIRE(t.leave(2, 0x2000, 0x9008, {10, 2, 0}, 0).empty());
+        REQUIRE(t.leave(1, 0x2000, 0x7008, {30, 3, 0}, 0) == std::vector<std::uintptr_t>{0x2000});
+        REQUIRE(t.latency().sum() == 5 + 30);
+    }
+
+    SECTION("Overhead larger than the call") {
+        REQUIRE(t.enter(thread, 0x2000, 0x7000, {0, 0, 0}));
+        REQUIRE(t.leave(thread, 0x2000, 0x7008, {100, 1, 0}, 1000).size() == 1);
+        REQUIRE(t.latency().max() == 0);
+    }
+
+    SECTION("Calls in progress can be forgotten") {
+        REQUIRE(t.enter(thread, 0x2000, 0x7000, {0, 0, 0}));
+        REQUIRE(t.clear_calls() == std::vector<std::uintptr_t>{0x2000});
+        REQUIRE(t.dropped() == 1);
+        REQUIRE(!t.is_return_address(0x2000));
+    }
+}
@@ -0,0 +1,92 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "nkgt/gdb_server.hpp"
+
+#include <string>
+#include <string_view>
+
+using nkgt::gdb_server::event;
+
+namespace {
+
+auto framed(std::string_view payload) -> std::string {
+    std::string out;
+    nkgt::gdb_server::append_packet(payload, out);
+    return out;
+}
+
+}
+
+TEST_CASE("Packets are framed with their checksum", "[gdb_server]") {
+    REQUIRE(framed("") == "$#00");
+    REQUIRE(framed("OK") == "$OK#9a");
+    REQUIRE(framed("qSupported") == "$qSupported#37");
+
+    SECTION("Reserved characters are escaped") {
+        REQUIRE(framed(std::string("a#b$c}d*", 8)) == "$a}\x03" "b}\x04" "c}]d}\x0a#ec");
+    }
+}
+
+TEST_CASE("The reader splits the stream coming from the client", "[gdb_server]") {
+    nkgt::gdb_server::packet_reader reader;
+
+    SECTION("Pipelined packets are returned in order") {
+        const std::string stream = "+" + framed("m1000,4") + framed("qC") + "-\x03";
+        reader.feed(stream.data(), stream.size());
+
+        REQUIRE(reader.next()->k == event::kind::ack);
+
+        auto e = reader.next();
+        REQUIRE(e->k == event::kind::packet);
+        REQUIRE(e->payload == "m1000,4");
+
+        e = reader.next();
+        REQUIRE(e->k == event::kind::packet);
+        REQUIRE(e->payload == "qC");
+
+        REQUIRE(reader.next()->k == event::kind::nack);
+        REQUIRE(reader.next()->k == event::kind::interrupt);
+        REQUIRE(!reader.next());
+    }
+
+    SECTION("Packets can arrive in pieces") {
+        const std::string stream = framed("vCont;c");
+        reader.feed(stream.data(), 4);
+        REQUIRE(!reader.next());
+
+        reader.feed(stream.data() + 4, stream.size() - 5);
+        REQUIRE(!reader.next());
+
+        reader.feed(stream.data() + stream.size() - 1, 1);
+        REQUIRE(reader.next()->payload == "vCont;c");
+    }
+
+    SECTION("Binary data is unescaped") {
+        const std::string payload("X10,4:#$}*", 10);
+        const std::string stream = framed(payload);
+        reader.feed(stream.data(), stream.size());
+
+        REQUIRE(reader.next()->payload == payload);
+    }
+
+    SECTION("Wrong checksums are reported") {
+        const std::string stream = "$OK#00" + framed("g");
+        reader.feed(stream.data(), stream.size());
+
+        REQUIRE(reader.next()->k == event::kind::corrupted);
+        REQUIRE(reader.next()->payload == "g");
+    }
+}
+
+TEST_CASE("The target description lists the registers of the g packet", "[gdb_server]") {
+    const std::string& xml = nkgt::gdb_server::target_description();
+
+    std::size_t registers = 0;
+    for(auto i = xml.find("<reg "); i != std::string::npos; i = xml.find("<reg ", i + 1)) {
+        ++registers;
+    }
+
+    REQUIRE(registers == 60);
+    REQUIRE(xml.find("<reg name=\"rip\" bitsize=\"64\" type=\"code_ptr\"/>") != std::string::npos);
+    REQUIRE(xml.find("<feature name=\"org.gnu.gdb.i386.sse\">") != std::string::npos);
+}
@@ -0,0 +1,87 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "nkgt/maps.hpp"
+
+TEST_CASE("/proc/pid/maps content is correctly parsed", "[maps]") {
+    SECTION("Empty content results in no regions") {
+        const auto regions = nkgt::maps::parse_maps("");
+
+        REQUIRE(regions);
+        REQUIRE(regions->empty());
+    }
+
+    SECTION("File backed and anonymous regions") {
+        const auto regions = nkgt::maps::parse_maps(
+            "00400000-00452000 r-xp 00000000 08:02 173521      /usr/bin/dbus-daemon\n"
+            "00e03000-00e24000 rw-p 00000000 00:00 0           [heap]\n"
+            "7fff0000-7fff1000 rw-s 0000a000 00:00 0\n"
+        );
+
+        REQUIRE(regions);
+        REQUIRE(regions->size() == 3);
+
+        const auto& text = (*regions)[0];
+        REQUIRE(text.start == 0x400000);
+        REQUIRE(text.end == 0x452000);
+        REQUIRE(text.readable);
+        REQUIRE_FALSE(text.writable);
+        REQUIRE(text.executable);
+        REQUIRE_FALSE(text.shared);
+        REQUIRE(text.path == "/usr/bin/dbus-daemon");
+
+        REQUIRE((*regions)[1].path == "[heap]");
+        REQUIRE((*regions)[2].shared);
+        REQUIRE((*regions)[2].offset == 0xa000);
+        REQUIRE((*regions)[2].path.empty());
+    }
+
+    SECTION("Paths containing spaces are kept whole") {
+        const auto regions = nkgt::maps::parse_maps(
+            "00400000-00452000 r-xp 00000000 08:02 173521      /tmp/a b (deleted)\n"
+        );
+
+        REQUIRE(regions);
+        REQUIRE((*regions)[0].path == "/tmp/a b (deleted)");
+    }
+
+    SECTION("Malformed lines are an error") {
+        REQUIRE_FALSE(nkgt::maps::parse_maps("00400000 r-xp 00000000 08:02 173521\n"));
+    }
+}
+
+TEST_CASE("Addresses are correctly translated through the memory map", "[maps]") {
+    const auto regions = nkgt::maps::parse_maps(
+        "555555554000-555555555000 r--p 00000000 08:02 1 /usr/bin/app\n"
+        "555555555000-555555556000 r-xp 00001000 08:02 1 /usr/bin/app\n"
+        "555555556000-555555557000 rw-p 00000000 00:00 0\n"
+        "7ffff7dd0000-7ffff7df0000 r-xp 00000000 08:02 2 /usr/lib/libc.so.6\n"
+    );
+
+    REQUIRE(regions);
+    nkgt::maps::address_space space(*regions);
+
+    SECTION("Addresses are found in the containing region only") {
+        REQUIRE(space.find(0x555555555abc) == &space.regions()[1]);
+        REQUIRE(space.find(0x555555557000) == nullptr);
+        REQUIRE(space.find(0x1000) == nullptr);
+    }
+
+    SECTION("Offsets are relative to the first mapping of the module") {
+        const auto location = space.to_module_offset(0x555555555abc);
+
+        REQUIRE(location);
+        REQUIRE(location->module->path == "/usr/bin/app");
+        REQUIRE(location->offset == 0x1abc);
+        REQUIRE(space.module_start(location->module->path) == 0x555555554000);
+    }
+
+    SECTION("Anonymous memory has no module") {
+        REQUIRE_FALSE(space.to_module_offset(0x555555556010));
+    }
+
+    SECTION("The load bias accounts for the link time base address") {
+        REQUIRE(space.load_bias("/usr/bin/app", 0) == 0x555555554000);
+        REQUIRE(space.load_bias("/usr/lib/libc.so.6", 0x1000) == 0x7ffff7dcf000);
+        REQUIRE_FALSE(space.load_bias("/usr/lib/libm.so.6", 0));
+    }
+}
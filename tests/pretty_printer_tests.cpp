@@ -0,0 +1,234 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "nkgt/pretty_printer.hpp"
+#include "nkgt/target.hpp"
+
+#include "fake_target.hpp"
+#include "nkgt/types.hpp"
+
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace {
+
+using nkgt::types::kind;
+using nkgt::types::type_id;
+
+auto scalar(nkgt::types::type_graph& g, kind k, std::string name, std::size_t size) -> type_id {
+    nkgt::types::type t;
+    t.k = k;
+    t.name = std::move(name);
+    t.size = size;
+    return g.add(std::move(t));
+}
+
+auto pointer_to(nkgt::types::type_graph& g, type_id target) -> type_id {
+    nkgt::types::type t;
+    t.k = kind::pointer;
+    t.size = sizeof(void*);
+    t.target = target;
+    return g.add(std::move(t));
+}
+
+auto structure(
+    nkgt::types::type_graph& g,
+    std::string name,
+    std::size_t size,
+    std::vector<nkgt::types::member> members
+) -> type_id {
+    nkgt::types::type t;
+    t.k = kind::structure;
+    t.name = std::move(name);
+    t.size = size;
+    t.members = std::move(members);
+    return g.add(std::move(t));
+}
+
+auto field(std::string name, type_id type, uint64_t offset) -> nkgt::types::member {
+    return {std::move(name), type, offset, 0, 0, false};
+}
+
+auto base_class(type_id type) -> nkgt::types::member {
+    return {"base", type, 0, 0, 0, true};
+}
+
+template<typename T>
+auto as_bytes(const T& value) -> std::vector<std::byte> {
+    std::vector<std::byte> bytes(sizeof(value));
+    std::memcpy(bytes.data(), &value, sizeof(value));
+    return bytes;
+}
+
+}
+
+TEST_CASE("Plain values are printed according to their type", "[pretty_printer]") {
+    fake_target target(0x10000, 0x4000);
+    nkgt::types::type_graph g;
+    nkgt::pretty_printer::limits limits;
+
+    const auto int_type = scalar(g, kind::signed_integer, "int", 4);
+    const auto char_type = scalar(g, kind::character, "char", 1);
+    const auto point = structure(g, "point", 8, {field("x", int_type, 0), field("y", int_type, 4)});
+
+    SECTION("Structs") {
+        const int32_t value[2] = {3, -4};
+        REQUIRE(nkgt::pretty_printer::format(target, g, point, as_bytes(value).data(), limits) == "{x = 3, y = -4}");
+        REQUIRE(g.display_name(pointer_to(g, point)) == "point*");
+    }
+
+    SECTION("Arrays are cut at the element limit") {
+        nkgt::types::type array;
+        array.k = kind::array;
+        array.size = 5 * 4;
+        array.target = int_type;
+        array.count = 5;
+        const auto array_type = g.add(std::move(array));
+
+        limits.max_elements = 3;
+        REQUIRE(nkgt::pretty_printer::footprint(g, array_type, limits) == 12);
+
+        const int32_t value[3] = {1, 2, 3};
+        REQUIRE(nkgt::pretty_printer::format(target, g, array_type, as_bytes(value).data(), limits) == "{1, 2, 3, ... (2 more)}");
+    }
+
+    SECTION("Char arrays and pointers print as strings") {
+        nkgt::types::type array;
+        array.k = kind::array;
+        array.size = 8;
+        array.target = char_type;
+        array.count = 8;
+        const auto array_type = g.add(std::move(array));
+
+        const char text[8] = "a\"b\n";
+        REQUIRE(nkgt::pretty_printer::format(target, g, array_type, as_bytes(text).data(), limits) == "\"a\\\"b\\n\"");
+
+        std::memcpy(target.memory.data() + 0x100, "hello", 6);
+        const uint64_t address = target.base + 0x100;
+        REQUIRE(
+            nkgt::pretty_printer::format(target, g, pointer_to(g, char_type), as_bytes(address).data(), limits) ==
+            "0x10100 \"hello\""
+        );
+    }
+
+    SECTION("Nesting is cut at the depth limit") {
+        const auto outer = structure(g, "outer", 8, {field("p", point, 0)});
+        limits.max_depth = 1;
+
+        const int32_t value[2] = {1, 2};
+        REQUIRE(nkgt::pretty_printer::format(target, g, outer, as_bytes(value).data(), limits) == "{p = {...}}");
+    }
+}
+
+TEST_CASE("libstdc++ containers are printed by their content", "[pretty_printer]") {
+    fake_target target(0x10000, 0x4000);
+    nkgt::types::type_graph g;
+    nkgt::pretty_printer::limits limits;
+
+    const auto int_type = scalar(g, kind::signed_integer, "int", 4);
+    const auto long_type = scalar(g, kind::unsigned_integer, "unsigned long", 8);
+    const auto char_type = scalar(g, kind::character, "char", 1);
+    const auto point = structure(g, "point", 8, {field("x", int_type, 0), field("y", int_type, 4)});
+
+    SECTION("std::vector elements are fetched with a single read") {
+        const auto point_pointer = pointer_to(g, point);
+        const auto impl_data = structure(g, "_Vector_impl_data", 24, {
+            field("_M_start", point_pointer, 0),
+            field("_M_finish", point_pointer, 8),
+            field("_M_end_of_storage", point_pointer, 16),
+        });
+        const auto impl = structure(g, "_Vector_impl", 24, {base_class(impl_data)});
+        const auto vector = structure(g, "vector<point, std::allocator<point> >", 24, {field("_M_impl", impl, 0)});
+
+        const uint64_t begin = target.base + 0x200;
+        for(int32_t i = 0; i < 1000; ++i) {
+            target.store(begin + 8 * static_cast<uint64_t>(i), i);
+            target.store(begin + 8 * static_cast<uint64_t>(i) + 4, -i);
+        }
+
+        const uint64_t value[3] = {begin, begin + 8000, begin + 8000};
+        limits.max_elements = 2;
+
+        REQUIRE(
+            nkgt::pretty_printer::format(target, g, vector, as_bytes(value).data(), limits) ==
+            "std::vector of length 1000 = {{x = 0, y = 0}, {x = 1, y = -1}, ... (998 more)}"
+        );
+        REQUIRE(target.scatter_reads == 1);
+    }
+
+    SECTION("std::string") {
+        const auto hider = structure(g, "_Alloc_hider", 8, {field("_M_p", pointer_to(g, char_type), 0)});
+        const auto string = structure(g, "basic_string<char, std::char_traits<char>, std::allocator<char> >", 32, {
+            field("_M_dataplus", hider, 0),
+            field("_M_string_length", long_type, 8),
+        });
+
+        std::memcpy(target.memory.data() + 0x300, "debugger", 8);
+        const uint64_t value[4] = {target.base + 0x300, 5, 0, 0};
+
+        REQUIRE(nkgt::pretty_printer::format(target, g, string, as_bytes(value).data(), limits) == "\"debug\"");
+    }
+
+    SECTION("std::shared_ptr") {
+        const auto counted_base = scalar(g, kind::opaque, "_Sp_counted_base", 16);
+        const auto count = structure(g, "__shared_count", 8, {field("_M_pi", pointer_to(g, counted_base), 0)});
+        const auto shared = structure(g, "shared_ptr<int>", 16, {
+            field("_M_ptr", pointer_to(g, int_type), 0),
+            field("_M_refcount", count, 8),
+        });
+
+        const uint64_t object = target.base + 0x400;
+        const uint64_t control = target.base + 0x500;
+        target.store(object, int32_t{42});
+        target.store(control + 8, int32_t{2});
+        target.store(control + 12, int32_t{2});
+
+        const uint64_t value[2] = {object, control};
+        REQUIRE(
+            nkgt::pretty_printer::format(target, g, shared, as_bytes(value).data(), limits) ==
+            "std::shared_ptr (use count 2, weak count 1) = 0x10400 -> 42"
+        );
+    }
+
+    SECTION("std::unordered_map nodes are followed") {
+        const auto pair = structure(g, "pair<int const, int>", 8, {field("first", int_type, 0), field("second", int_type, 4)});
+        const auto node_base = structure(g, "_Hash_node_base", 8, {});
+        g.at(node_base).members.push_back(field("_M_nxt", pointer_to(g, node_base), 0));
+
+        const auto table = structure(g, "_Hashtable<...>", 56, {
+            field("_M_buckets", long_type, 0),
+            field("_M_bucket_count", long_type, 8),
+            field("_M_before_begin", node_base, 16),
+            field("_M_element_count", long_type, 24),
+        });
+        g.at(table).template_arguments = {int_type, pair};
+        const auto map = structure(g, "unordered_map<int, int, ...>", 56, {field("_M_h", table, 0)});
+
+        const uint64_t first = target.base + 0x600;
+        const uint64_t second = target.base + 0x700;
+        target.store(first, second);
+        target.store(first + 8, int32_t{1});
+        target.store(first + 12, int32_t{10});
+        target.store(second, uint64_t{0});
+        target.store(second + 8, int32_t{2});
+        target.store(second + 12, int32_t{20});
+
+        const uint64_t value[7] = {0, 0, first, 2, 0, 0, 0};
+        REQUIRE(
+            nkgt::pretty_printer::format(target, g, map, as_bytes(value).data(), limits) ==
+            "std::unordered_map with 2 elements = {[1] = 10, [2] = 20}"
+        );
+    }
+
+    SECTION("Unreadable memory is reported") {
+        const auto hider = structure(g, "_Alloc_hider", 8, {field("_M_p", pointer_to(g, char_type), 0)});
+        const auto string = structure(g, "basic_string<char>", 32, {
+            field("_M_dataplus", hider, 0),
+            field("_M_string_length", long_type, 8),
+        });
+
+        const uint64_t value[4] = {0x10, 5, 0, 0};
+        REQUIRE(nkgt::pretty_printer::format(target, g, string, as_bytes(value).data(), limits) == "<unreadable at 0x10>");
+    }
+}
@@ -0,0 +1,32 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "nkgt/process.hpp"
+
+#include <csignal>
+#include <sys/ptrace.h>
+#include <sys/wait.h>
+
+TEST_CASE("Programs are launched stopped, with their arguments", "[process]") {
+    const nkgt::process::launch_options options = {
+        "/bin/sh",
+        {"-c", "exit $((FIRST + 2))"},
+        {"FIRST=40"}
+    };
+
+    const auto pid = nkgt::process::launch(options);
+    REQUIRE(pid);
+
+    int wait_status = 0;
+    REQUIRE(ptrace(PTRACE_CONT, *pid, nullptr, nullptr) == 0);
+    REQUIRE(waitpid(*pid, &wait_status, 0) == *pid);
+    REQUIRE(WIFEXITED(wait_status));
+    REQUIRE(WEXITSTATUS(wait_status) == 42);
+}
+
+TEST_CASE("Programs that cannot be executed are reported", "[process]") {
+    const nkgt::process::launch_options options = {"/nonexistent/program", {}, {}};
+    const auto pid = nkgt::process::launch(options);
+
+    REQUIRE(!pid);
+    REQUIRE(pid.error() == nkgt::error::launch::exec_fail);
+}
@@ -0,0 +1,64 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "nkgt/registers.hpp"
+#include "nkgt/target.hpp"
+
+#include "fake_target.hpp"
+
+#include <cstddef>
+
+TEST_CASE("Register names are correctly converted", "[registers]") {
+    using nkgt::registers::reg;
+
+    SECTION("Every register round trips through its name") {
+        for(std::size_t i = 0; i < nkgt::registers::register_count; ++i) {
+            const auto r = static_cast<reg>(i);
+            REQUIRE(nkgt::registers::from_string(nkgt::registers::to_string(r)) == r);
+        }
+    }
+
+    SECTION("Unknown names and prefixes of valid names are an error") {
+        REQUIRE_FALSE(nkgt::registers::from_string("r16"));
+        REQUIRE_FALSE(nkgt::registers::from_string("ra"));
+        REQUIRE_FALSE(nkgt::registers::from_string(""));
+    }
+}
+
+TEST_CASE("Registers are accessed in batches", "[registers]") {
+    using nkgt::registers::reg;
+
+    fake_target target;
+    target.regs.rdi = 0x42;
+    target.regs.rip = 0x1000;
+    target.regs.r15 = 7;
+
+    SECTION("Reads need a single register set") {
+        const reg regs[] = {reg::rip, reg::rdi, reg::r15};
+        uint64_t values[3] = {};
+
+        REQUIRE(nkgt::registers::read_registers(target, regs, values, 3));
+        REQUIRE(values[0] == 0x1000);
+        REQUIRE(values[1] == 0x42);
+        REQUIRE(values[2] == 7);
+        REQUIRE(target.register_reads == 1);
+    }
+
+    SECTION("Writes need one read and one write") {
+        const reg regs[] = {reg::rax, reg::gs_base};
+        const uint64_t values[] = {1, 2};
+
+        REQUIRE(nkgt::registers::write_registers(target, regs, values, 2));
+        REQUIRE(target.regs.rax == 1);
+        REQUIRE(target.regs.gs_base == 2);
+        REQUIRE(target.regs.rdi == 0x42);
+        REQUIRE(target.register_reads == 1);
+        REQUIRE(target.register_writes == 1);
+    }
+
+    SECTION("DWARF numbers map to the psABI registers") {
+        REQUIRE(nkgt::registers::get_register_value_from_dwarf_number(target, 5) == uint64_t{0x42});
+        REQUIRE(nkgt::registers::get_register_value_from_dwarf_number(target, 16) == uint64_t{0x1000});
+        REQUIRE_FALSE(nkgt::registers::get_register_value_from_dwarf_number(target, 17));
+        REQUIRE_FALSE(nkgt::registers::get_register_value_from_dwarf_number(target, 1000));
+    }
+}
@@ -0,0 +1,121 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "nkgt/search.hpp"
+#include "nkgt/target.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <vector>
+
+TEST_CASE("Search patterns are correctly parsed", "[search]") {
+    SECTION("Strings are taken verbatim") {
+        const auto p = nkgt::search::parse_pattern("str:abc");
+
+        REQUIRE(p);
+        REQUIRE(p->bytes == std::vector<uint8_t>({'a', 'b', 'c'}));
+        REQUIRE(p->mask == std::vector<uint8_t>({0xff, 0xff, 0xff}));
+    }
+
+    SECTION("Integers are little endian") {
+        const auto p = nkgt::search::parse_pattern("u32:0x11223344");
+
+        REQUIRE(p);
+        REQUIRE(p->bytes == std::vector<uint8_t>({0x44, 0x33, 0x22, 0x11}));
+    }
+
+    SECTION("Integers not fitting the width are an error") {
+        REQUIRE_FALSE(nkgt::search::parse_pattern("u8:256"));
+    }
+
+    SECTION("Wildcards clear the mask of the nibble") {
+        const auto p = nkgt::search::parse_pattern("bytes:a??b");
+
+        REQUIRE(p);
+        REQUIRE(p->bytes == std::vector<uint8_t>({0xa0, 0x0b}));
+        REQUIRE(p->mask == std::vector<uint8_t>({0xf0, 0x0f}));
+    }
+
+    SECTION("Unknown kinds and empty patterns are an error") {
+        REQUIRE_FALSE(nkgt::search::parse_pattern("f32:1.0"));
+        REQUIRE_FALSE(nkgt::search::parse_pattern("str:"));
+        REQUIRE_FALSE(nkgt::search::parse_pattern("abc"));
+    }
+}
+
+TEST_CASE("Memory blocks are correctly scanned", "[search]") {
+    std::vector<uint8_t> data(1000, 0);
+    std::vector<std::uintptr_t> matches;
+
+    SECTION("Every occurrence is reported, including at the edges") {
+        std::memcpy(data.data(), "key", 3);
+        std::memcpy(data.data() + 500, "key", 3);
+        std::memcpy(data.data() + 997, "key", 3);
+
+        const auto p = nkgt::search::parse_pattern("str:key");
+        nkgt::search::scan(data.data(), data.size(), data.size(), *p, 0x1000, matches);
+
+        REQUIRE(matches == std::vector<std::uintptr_t>({0x1000, 0x11f4, 0x13e5}));
+    }
+
+    SECTION("Matches straddling the end of the search area are found") {
+        std::memcpy(data.data() + 510, "key", 3);
+
+        const auto p = nkgt::search::parse_pattern("str:key");
+        nkgt::search::scan(data.data(), 512, 514, *p, 0, matches);
+
+        REQUIRE(matches == std::vector<std::uintptr_t>({510}));
+    }
+
+    SECTION("Masked patterns without a full byte check every position") {
+        data[100] = 0x12;
+        data[101] = 0x34;
+
+        const auto p = nkgt::search::parse_pattern("bytes:?2?4");
+        nkgt::search::scan(data.data(), data.size(), data.size(), *p, 0, matches);
+
+        REQUIRE(matches == std::vector<std::uintptr_t>({100}));
+    }
+}
+
+TEST_CASE("Pages that cannot be read are skipped and counted", "[search]") {
+    // The memory of the test itself, with an unreadable page in the middle.
+    const auto page_size = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+    void* mapping = mmap(nullptr, 3 * page_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    REQUIRE(mapping != MAP_FAILED);
+
+    auto* memory = static_cast<uint8_t*>(mapping);
+    const auto base = reinterpret_cast<std::uintptr_t>(memory);
+    std::memcpy(memory + 16, "needle", 6);
+    std::memcpy(memory + 2 * page_size + 32, "needle", 6);
+    REQUIRE(mprotect(memory + page_size, page_size, PROT_NONE) == 0);
+
+    nkgt::target::ptrace_target self(getpid());
+    const auto p = nkgt::search::parse_pattern("str:needle");
+    REQUIRE(p);
+
+    const auto result = nkgt::search::find(self, {{base, base + 3 * page_size}}, *p, 64);
+
+    REQUIRE(result.matches == std::vector<std::uintptr_t>({base + 16, base + 2 * page_size + 32}));
+    REQUIRE(result.count == 2);
+    REQUIRE(result.unreadable == page_size);
+
+    munmap(mapping, 3 * page_size);
+}
+
+TEST_CASE("Only the lowest matches up to the limit are kept", "[search]") {
+    // Three chunks of zeros, so that every worker finds matches.
+    std::vector<uint8_t> memory((std::size_t{24} << 20) + 100, 0);
+    const auto base = reinterpret_cast<std::uintptr_t>(memory.data());
+
+    nkgt::target::ptrace_target self(getpid());
+    const auto p = nkgt::search::parse_pattern("u16:0");
+    REQUIRE(p);
+
+    const auto result = nkgt::search::find(self, {{base, base + memory.size()}}, *p, 3);
+
+    REQUIRE(result.matches == std::vector<std::uintptr_t>({base, base + 1, base + 2}));
+    REQUIRE(result.count == memory.size() - 1);
+    REQUIRE(result.unreadable == 0);
+}
@@ -0,0 +1,103 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "nkgt/shared_libraries.hpp"
+#include "nkgt/target.hpp"
+
+#include "fake_target.hpp"
+
+#include <cstring>
+#include <link.h>
+#include <string_view>
+#include <vector>
+
+using nkgt::shared_libraries::link_entry;
+
+namespace {
+
+// Writes a link_map node at address, in the debugee's layout.
+auto add_node(
+    fake_target& debugee,
+    std::uintptr_t address,
+    std::uintptr_t bias,
+    std::uintptr_t name,
+    std::uintptr_t next
+) -> void {
+    link_map node = {};
+    node.l_addr = bias;
+    node.l_name = reinterpret_cast<char*>(name);
+    node.l_next = reinterpret_cast<link_map*>(next);
+    debugee.store(address, node);
+}
+
+auto add_string(fake_target& debugee, std::uintptr_t address, std::string_view s) -> void {
+    std::memcpy(debugee.memory.data() + (address - debugee.base), s.data(), s.size());
+    debugee.memory[address - debugee.base + s.size()] = 0;
+}
+
+}
+
+TEST_CASE("The link_map chain is read from the debugee", "[shared_libraries]") {
+    fake_target debugee(0x10000, 0x2000);
+    add_string(debugee, 0x10800, "");
+    add_string(debugee, 0x10900, "/lib/libc.so.6");
+    // A name crossing a page boundary.
+    add_string(debugee, 0x10ff8, "/usr/lib/plugins/libplugin.so");
+    add_node(debugee, 0x10000, 0, 0x10800, 0x10100);
+    add_node(debugee, 0x10100, 0x7f0000000000, 0x10900, 0x10200);
+    add_node(debugee, 0x10200, 0x7f1000000000, 0x10ff8, 0);
+
+    const auto entries = nkgt::shared_libraries::read_link_map(debugee, 0x10000, {});
+    REQUIRE(entries);
+    REQUIRE(*entries == std::vector<link_entry>{
+        {0x10000, 0, 0x10800, ""},
+        {0x10100, 0x7f0000000000, 0x10900, "/lib/libc.so.6"},
+        {0x10200, 0x7f1000000000, 0x10ff8, "/usr/lib/plugins/libplugin.so"},
+    });
+
+    SECTION("Known nodes are not read again") {
+        debugee.reads = 0;
+        const auto again = nkgt::shared_libraries::read_link_map(debugee, 0x10000, *entries);
+        REQUIRE(again);
+        REQUIRE(*again == *entries);
+        REQUIRE(debugee.reads == 3);
+    }
+
+    SECTION("A reused node is read again") {
+        add_string(debugee, 0x10a00, "/lib/libm.so.6");
+        add_node(debugee, 0x10200, 0x7f2000000000, 0x10a00, 0);
+
+        const auto again = nkgt::shared_libraries::read_link_map(debugee, 0x10000, *entries);
+        REQUIRE(again);
+        REQUIRE(again->back().path == "/lib/libm.so.6");
+    }
+
+    SECTION("Unreadable nodes are reported") {
+        add_node(debugee, 0x10200, 0, 0x10800, 0xdead0000);
+        REQUIRE(!nkgt::shared_libraries::read_link_map(debugee, 0x10000, {}));
+    }
+}
+
+TEST_CASE("Link maps are compared node by node", "[shared_libraries]") {
+    const link_entry program = {0x1000, 0, 0x2000, ""};
+    const link_entry libc = {0x1100, 0x7f00, 0x2100, "/lib/libc.so.6"};
+    const link_entry plugin = {0x1200, 0x7f10, 0x2200, "/opt/libplugin.so"};
+    const link_entry other = {0x1200, 0x7f20, 0x2300, "/opt/libother.so"};
+
+    SECTION("Loads") {
+        const auto changes = nkgt::shared_libraries::diff({program, libc}, {program, libc, plugin});
+        REQUIRE(changes.added == std::vector<link_entry>{plugin});
+        REQUIRE(changes.removed.empty());
+    }
+
+    SECTION("Unloads") {
+        const auto changes = nkgt::shared_libraries::diff({program, libc, plugin}, {program, libc});
+        REQUIRE(changes.added.empty());
+        REQUIRE(changes.removed == std::vector<link_entry>{plugin});
+    }
+
+    SECTION("A node reused for another library is both") {
+        const auto changes = nkgt::shared_libraries::diff({program, plugin}, {program, other});
+        REQUIRE(changes.added == std::vector<link_entry>{other});
+        REQUIRE(changes.removed == std::vector<link_entry>{plugin});
+    }
+}
@@ -0,0 +1,64 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "nkgt/snapshot.hpp"
+
+#include <cstddef>
+#include <vector>
+
+TEST_CASE("Differences between memory blocks are correctly identified", "[snapshot]") {
+    std::vector<std::byte> a(100, std::byte{0});
+    std::vector<std::byte> b(100, std::byte{0});
+    std::vector<nkgt::snapshot::byte_range> ranges;
+
+    SECTION("Identical blocks have no differences") {
+        nkgt::snapshot::diff_bytes(a.data(), b.data(), a.size(), 0x1000, ranges);
+
+        REQUIRE(ranges.empty());
+    }
+
+    SECTION("Consecutive differences are merged, also across vector lanes") {
+        b[3] = std::byte{1};
+        for(std::size_t i = 14; i < 40; ++i) {
+            b[i] = std::byte{2};
+        }
+        b[99] = std::byte{3};
+
+        nkgt::snapshot::diff_bytes(a.data(), b.data(), a.size(), 0x1000, ranges);
+
+        REQUIRE(ranges.size() == 3);
+        REQUIRE(ranges[0].start == 0x1003);
+        REQUIRE(ranges[0].size == 1);
+        REQUIRE(ranges[1].start == 0x100e);
+        REQUIRE(ranges[1].size == 26);
+        REQUIRE(ranges[2].start == 0x1063);
+        REQUIRE(ranges[2].size == 1);
+    }
+
+    SECTION("A range ending at the start of the next block is extended") {
+        b[99] = std::byte{1};
+        nkgt::snapshot::diff_bytes(a.data(), b.data(), a.size(), 0x1000, ranges);
+
+        b[99] = std::byte{0};
+        b[0] = std::byte{1};
+        nkgt::snapshot::diff_bytes(a.data(), b.data(), a.size(), 0x1064, ranges);
+
+        REQUIRE(ranges.size() == 1);
+        REQUIRE(ranges[0].start == 0x1063);
+        REQUIRE(ranges[0].size == 2);
+    }
+}
+
+TEST_CASE("Breakpoints are hidden from the comparison", "[snapshot]") {
+    // The snapshot has a breakpoint at 0x1002, the current memory at 0x1005.
+    std::vector<std::byte> old = {std::byte{0x55}, std::byte{0x48}, std::byte{0xcc}, std::byte{0x89}, std::byte{0xe5}, std::byte{0x90}};
+    std::vector<std::byte> current = {std::byte{0x55}, std::byte{0x48}, std::byte{0x8b}, std::byte{0x89}, std::byte{0xe5}, std::byte{0xcc}};
+    const std::vector<nkgt::snapshot::patch> patches = {{0x1002, 0x8b}, {0x1005, 0x90}, {0x2000, 0x00}};
+    std::vector<nkgt::snapshot::byte_range> ranges;
+
+    nkgt::snapshot::hide_patches(old.data(), 0x1000, old.size(), patches);
+    nkgt::snapshot::hide_patches(current.data(), 0x1000, current.size(), patches);
+    nkgt::snapshot::diff_bytes(old.data(), current.data(), old.size(), 0x1000, ranges);
+
+    REQUIRE(ranges.empty());
+    REQUIRE(current[5] == std::byte{0x90});
+}
@@ -0,0 +1,74 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "nkgt/stats.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+
+using nkgt::stats::histogram;
+
+TEST_CASE("Histogram buckets keep the relative error bounded", "[stats]") {
+    SECTION("Small values have a bucket each") {
+        for(uint64_t v = 0; v < histogram::sub_buckets; ++v) {
+            REQUIRE(histogram::bucket_of(v) == v);
+            REQUIRE(histogram::bucket_upper_bound(histogram::bucket_of(v)) == v);
+        }
+    }
+
+    SECTION("Every value is at most 1/sub_buckets below its bucket bound") {
+        for(uint64_t v = 1; v < (uint64_t{1} << 40); v = v * 3 + 1) {
+            const auto bound = histogram::bucket_upper_bound(histogram::bucket_of(v));
+            REQUIRE(bound >= v);
+            REQUIRE(bound - v <= v / histogram::sub_buckets);
+        }
+    }
+
+    SECTION("Buckets are contiguous") {
+        for(std::size_t b = 1; b + 1 < histogram::bucket_count; ++b) {
+            REQUIRE(histogram::bucket_of(histogram::bucket_upper_bound(b - 1) + 1) == b);
+        }
+    }
+
+    SECTION("Huge values land in the last bucket") {
+        REQUIRE(histogram::bucket_of(UINT64_MAX) == histogram::bucket_count - 1);
+    }
+}
+
+TEST_CASE("Histogram percentiles", "[stats]") {
+    histogram h;
+    REQUIRE(h.percentile(0.5) == 0);
+
+    for(uint64_t v = 1; v <= 1000; ++v) {
+        h.record(v * 1000);
+    }
+
+    REQUIRE(h.count() == 1000);
+    REQUIRE(h.max() == 1'000'000);
+    REQUIRE(h.sum() == 500'500'000);
+
+    const auto p50 = h.percentile(0.5);
+    REQUIRE(p50 >= 500'000);
+    REQUIRE(p50 <= 500'000 + 500'000 / histogram::sub_buckets);
+
+    REQUIRE(h.percentile(0.99) >= 990'000);
+    REQUIRE(h.percentile(1.0) == 1'000'000);
+
+    h.reset();
+    REQUIRE(h.count() == 0);
+    REQUIRE(h.max() == 0);
+}
+
+TEST_CASE("Call sites register themselves", "[stats]") {
+    static nkgt::stats::call_site site("stats_tests/site", "tests/stats_tests.cpp", 1);
+    site.latency.record(42);
+
+    const auto all = nkgt::stats::sites();
+    REQUIRE(std::find(all.begin(), all.end(), &site) != all.end());
+
+    const std::string json = nkgt::stats::to_json();
+    REQUIRE(json.find("{\"name\": \"stats_tests/site\", \"file\": \"stats_tests.cpp\", \"line\": 1, \"count\": 1") != std::string::npos);
+
+    nkgt::stats::reset();
+    REQUIRE(site.latency.count() == 0);
+}
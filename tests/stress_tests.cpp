@@ -0,0 +1,219 @@
+// Integration tests of the ptrace paths of the debugger on real inferiors (see
+// example/stress.hpp), at high breakpoint hit rates. Every hit goes through
+// step_over_breakpoint() and a register and memory write that the inferior
+// checks, and the breakpoint is regularly toggled with disable_breakpoint()
+// and enable_breakpoint(). The throughput of each run is printed.
+
+#include <catch2/catch_test_macros.hpp>
+
+#include "nkgt/debugger.hpp"
+#include "nkgt/maps.hpp"
+#include "nkgt/process.hpp"
+#include "nkgt/registers.hpp"
+#include "nkgt/symbols.hpp"
+#include "nkgt/target.hpp"
+
+#include "stress.hpp"
+
+#include <fmt/core.h>
+
+#include <array>
+#include <chrono>
+#include <csignal>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <sys/ptrace.h>
+#include <sys/wait.h>
+#include <unordered_map>
+
+namespace {
+
+using nkgt::registers::reg;
+
+// Bytes checked from the start of stress_hit().
+constexpr std::size_t code_size = 256;
+// The breakpoint is disabled and enabled again every toggle_interval hits.
+constexpr uint64_t toggle_interval = 1024;
+
+struct run_result {
+    uint64_t hits = 0;
+    uint64_t signals = 0;
+    // Hits where the debugger could not do its part, or that were not at the
+    // breakpoint.
+    uint64_t failures = 0;
+    bool code_intact = false;
+    std::optional<int> exit_code;
+    double seconds = 0;
+};
+
+auto function_address(pid_t pid, const std::string& program, std::string_view name) -> std::optional<std::uintptr_t> {
+    const auto table = nkgt::symbols::load_symbols(program);
+    const auto* function = table ? table->find(name) : nullptr;
+    if(function == nullptr) {
+        return std::nullopt;
+    }
+
+    nkgt::maps::address_space address_space(pid);
+    const auto bias = address_space.load_bias(std::filesystem::canonical(program).string(), table->load_base());
+    if(!bias) {
+        return std::nullopt;
+    }
+
+    return function->address + *bias;
+}
+
+// continue_execution() only delivers the signals that arrive while it steps
+// over the breakpoint. The one the inferior stopped with is left to the
+// caller and passed on here.
+auto deliver(nkgt::target::target& debugee, int signal) -> std::optional<int> {
+    if(ptrace(PTRACE_CONT, debugee.pid(), nullptr, signal) == -1) {
+        return std::nullopt;
+    }
+
+    int status = 0;
+    waitpid(debugee.pid(), &status, 0);
+    debugee.invalidate_caches();
+    return status;
+}
+
+// Does the part of the debugger at a hit: writes the slot, sets the reply
+// and reads it back from the kernel. Returns false if any of it failed.
+auto answer(nkgt::target::target& debugee, const user_regs_struct& regs) -> bool {
+    const uint64_t value = stress_slot_value(regs.rsi);
+    if(!debugee.write_memory(regs.rdi, &value, sizeof(value)) ||
+       !nkgt::registers::set_register_value(debugee, reg::rdx, stress_reply(regs.rsi))) {
+        return false;
+    }
+
+    debugee.invalidate_caches();
+    const auto reply = nkgt::registers::get_register_value(debugee, reg::rdx);
+    return reply && *reply == stress_reply(regs.rsi);
+}
+
+auto toggle(nkgt::target::target& debugee, nkgt::debugger::breakpoint& bp, uint8_t original) -> bool {
+    uint8_t disabled = 0;
+    uint8_t enabled = 0;
+
+    return nkgt::debugger::disable_breakpoint(bp) &&
+           debugee.read_memory(static_cast<std::uintptr_t>(bp.address), &disabled, 1) &&
+           nkgt::debugger::enable_breakpoint(bp) &&
+           debugee.read_memory(static_cast<std::uintptr_t>(bp.address), &enabled, 1) &&
+           disabled == original && enabled == 0xcc && bp.saved_data == original;
+}
+
+// Runs program with a breakpoint on stress_hit() until it exits. After
+// expected_hits hits the breakpoint is removed and the code of stress_hit()
+// is compared with the one before the first hit.
+auto stress(const std::string& program, uint64_t iterations, uint64_t expected_hits) -> run_result {
+    run_result r;
+
+    const auto pid = nkgt::process::launch({program, {std::to_string(iterations)}, {}});
+    REQUIRE(pid);
+
+    nkgt::target::ptrace_target debugee(*pid);
+    const auto address = function_address(*pid, program, "stress_hit");
+    REQUIRE(address);
+
+    std::array<uint8_t, code_size> original;
+    std::array<uint8_t, code_size> code;
+    REQUIRE(debugee.read_memory(*address, original.data(), original.size()));
+
+    std::unordered_map<std::intptr_t, nkgt::debugger::breakpoint> breakpoints;
+    auto& bp = breakpoints[static_cast<std::intptr_t>(*address)];
+    bp.pid = *pid;
+    bp.address = static_cast<std::intptr_t>(*address);
+    REQUIRE(nkgt::debugger::enable_breakpoint(bp));
+
+    const auto start = std::chrono::steady_clock::now();
+    auto status = nkgt::debugger::continue_execution(debugee, breakpoints);
+
+    while(status && WIFSTOPPED(*status)) {
+        const int signal = WSTOPSIG(*status);
+        if(signal != SIGTRAP) {
+            r.signals += 1;
+            status = deliver(debugee, signal);
+            continue;
+        }
+
+        const auto regs = debugee.read_registers();
+        if(!regs || regs->rip - 1 != *address || !bp.enabled) {
+            r.failures += 1;
+            break;
+        }
+
+        r.hits += 1;
+        if(!answer(debugee, *regs)) {
+            r.failures += 1;
+        }
+
+        if(r.hits % toggle_interval == 0 && !toggle(debugee, bp, original[0])) {
+            r.failures += 1;
+        }
+
+        if(r.hits == expected_hits) {
+            r.code_intact = nkgt::registers::set_register_value(debugee, reg::rip, *address) &&
+                            nkgt::debugger::disable_breakpoint(bp) &&
+                            debugee.read_memory(*address, code.data(), code.size()) &&
+                            code == original;
+        }
+
+        status = nkgt::debugger::continue_execution(debugee, breakpoints);
+    }
+
+    r.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    if(status && WIFEXITED(*status)) {
+        r.exit_code = WEXITSTATUS(*status);
+    } else {
+        kill(*pid, SIGKILL);
+        waitpid(*pid, nullptr, 0);
+    }
+
+    fmt::print(
+        "{:<16} {:>9} hits {:>9} signals {:>8.2f} s {:>10.0f} hits/s\n",
+        std::filesystem::path(program).filename().string(),
+        r.hits,
+        r.signals,
+        r.seconds,
+        static_cast<double>(r.hits) / r.seconds
+    );
+
+    return r;
+}
+
+}
+
+// Only the main thread is traced and hits the breakpoint: this covers the
+// writes of the debugger to the code and memory of a process whose other
+// threads keep running, not the tracing of several threads.
+TEST_CASE("Breakpoints on the main thread while untraced threads run", "[stress]") {
+    const auto r = stress(STRESS_THREADS_INFERIOR, STRESS_ITERATIONS, STRESS_ITERATIONS);
+
+    REQUIRE(r.failures == 0);
+    REQUIRE(r.hits == STRESS_ITERATIONS);
+    REQUIRE(r.code_intact);
+    REQUIRE(r.exit_code == EXIT_SUCCESS);
+}
+
+TEST_CASE("Breakpoints in an inferior that keeps forking", "[stress]") {
+    const auto r = stress(STRESS_FORK_INFERIOR, STRESS_ITERATIONS, STRESS_ITERATIONS);
+
+    REQUIRE(r.failures == 0);
+    REQUIRE(r.hits == STRESS_ITERATIONS);
+    REQUIRE(r.code_intact);
+    REQUIRE(r.exit_code == EXIT_SUCCESS);
+}
+
+TEST_CASE("Breakpoints in an inferior that keeps raising signals", "[stress]") {
+    // One more hit from the SIGUSR1 handler every 3 iterations.
+    const uint64_t expected_hits = STRESS_ITERATIONS + (STRESS_ITERATIONS + 2) / 3;
+    const auto r = stress(STRESS_SIGNALS_INFERIOR, STRESS_ITERATIONS, expected_hits);
+
+    REQUIRE(r.failures == 0);
+    REQUIRE(r.hits == expected_hits);
+    REQUIRE(r.signals >= STRESS_ITERATIONS / 2 + expected_hits - STRESS_ITERATIONS);
+    REQUIRE(r.code_intact);
+    REQUIRE(r.exit_code == EXIT_SUCCESS);
+}
@@ -0,0 +1,92 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "nkgt/symbol_index.hpp"
+#include "nkgt/symbols.hpp"
+
+#include <chrono>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+using nkgt::symbol_index::symbol_index;
+
+namespace {
+
+auto make_functions(const std::vector<std::string>& names) -> std::vector<nkgt::symbols::symbol> {
+    std::vector<nkgt::symbols::symbol> functions;
+    std::uintptr_t address = 0x1000;
+    for(const auto& name : names) {
+        functions.push_back({name, address, 16});
+        address += 16;
+    }
+
+    return functions;
+}
+
+}
+
+TEST_CASE("Names are found by any substring of their demangled form", "[symbol_index]") {
+    const auto functions = make_functions({
+        "main",
+        // shop::Order::process(int)
+        "_ZN4shop5Order7processEi",
+        // shop::reorder(shop::Order&)
+        "_ZN4shop7reorderERNS_5OrderE",
+        // shop::OrderBook::add()
+        "_ZN4shop9OrderBook3addEv",
+        "order_count",
+        "unrelated",
+    });
+    const symbol_index index(functions);
+    REQUIRE(index.size() == functions.size());
+
+    SECTION("Matches are ranked") {
+        const auto matches = index.search("ord", 10);
+        REQUIRE(matches == std::vector<std::string_view>{
+            "order_count",
+            "_ZN4shop9OrderBook3addEv",
+            "_ZN4shop5Order7processEi",
+            "_ZN4shop7reorderERNS_5OrderE",
+        });
+    }
+
+    SECTION("Search ignores case and sees through the mangling") {
+        REQUIRE(index.search("ORDER::PROC", 10) == std::vector<std::string_view>{"_ZN4shop5Order7processEi"});
+        REQUIRE(index.search("shop::reorder(shop::Order&)", 10) == std::vector<std::string_view>{"_ZN4shop7reorderERNS_5OrderE"});
+    }
+
+    SECTION("Sharing trigrams is not enough") {
+        REQUIRE(index.search("rderorder", 10).empty());
+        REQUIRE(index.search("xyz", 10).empty());
+    }
+
+    SECTION("Short queries match prefixes") {
+        REQUIRE(index.search("ma", 10) == std::vector<std::string_view>{"main"});
+        REQUIRE(index.search("s", 10).size() == 3);
+    }
+
+    SECTION("Results are capped") {
+        REQUIRE(index.search("ord", 2).size() == 2);
+        REQUIRE(index.search("", 10).empty());
+    }
+}
+
+TEST_CASE("Indexes are built in the background", "[symbol_index]") {
+    std::vector<std::string> names;
+    for(int i = 0; i < 10000; ++i) {
+        names.push_back("function_" + std::to_string(i));
+    }
+
+    const auto functions = make_functions(names);
+    const nkgt::symbol_index::background_index background(functions);
+
+    while(background.get() == nullptr) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    const auto matches = background.get()->search("function_999", 3);
+    REQUIRE(matches.size() == 3);
+    REQUIRE(matches[0] == "function_999");
+    REQUIRE(matches[1] == "function_9990");
+}
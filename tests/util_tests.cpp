@@ -4,6 +4,9 @@
 
 #include "nkgt/util.hpp"
 
+#include <string>
+#include <string_view>
+
 TEST_CASE("String are correctly split", "[util]") {
     using Catch::Matchers::SizeIs;
     using Catch::Matchers::RangeEquals;
@@ -44,6 +47,41 @@ TEST_CASE("String are correctly split", "[util]") {
     }
 }
 
+TEST_CASE("Lines are tokenized without allocating", "[util]") {
+    using Catch::Matchers::RangeEquals;
+
+    nkgt::util::tokens tokens;
+
+    SECTION("Same fields as split") {
+        const std::string_view line = "  f 0909 !34j  0-09    aaa     ";
+        REQUIRE(nkgt::util::tokenize(line, tokens));
+        REQUIRE_THAT(tokens, RangeEquals(nkgt::util::split(line, ' ')));
+    }
+
+    SECTION("Blank lines have no fields") {
+        REQUIRE(nkgt::util::tokenize("    ", tokens));
+        REQUIRE(tokens.empty());
+    }
+
+    SECTION("Previous fields are discarded") {
+        REQUIRE(nkgt::util::tokenize("a b c", tokens));
+        REQUIRE(nkgt::util::tokenize("d", tokens));
+        REQUIRE(tokens.size() == 1);
+        REQUIRE(tokens[0] == "d");
+    }
+
+    SECTION("Lines with too many fields are rejected") {
+        std::string line;
+        for(std::size_t i = 0; i < nkgt::util::tokens::capacity; ++i) {
+            line += "x ";
+        }
+
+        REQUIRE(nkgt::util::tokenize(line, tokens));
+        REQUIRE(tokens.size() == nkgt::util::tokens::capacity);
+        REQUIRE_FALSE(nkgt::util::tokenize(line + "y", tokens));
+    }
+}
+
 TEST_CASE("Prefixes are correctly identified", "[util]") {
     SECTION("Actual prefix returns true") {
         REQUIRE(nkgt::util::is_prefix("c", "continue"));
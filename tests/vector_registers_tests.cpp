@@ -0,0 +1,86 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "nkgt/vector_registers.hpp"
+
+#include "fake_target.hpp"
+
+#include <cstring>
+
+TEST_CASE("Vector register names are correctly parsed", "[registers]") {
+    using nkgt::registers::vector_kind;
+
+    SECTION("Valid names") {
+        const auto ymm = nkgt::registers::vector_from_string("ymm3");
+        REQUIRE(ymm);
+        REQUIRE(ymm->kind == vector_kind::ymm);
+        REQUIRE(ymm->index == 3);
+
+        const auto k = nkgt::registers::vector_from_string("k7");
+        REQUIRE(k);
+        REQUIRE(k->kind == vector_kind::k);
+        REQUIRE(k->index == 7);
+
+        REQUIRE(nkgt::registers::vector_from_string("zmm31"));
+    }
+
+    SECTION("Out of range indices and malformed names are an error") {
+        REQUIRE_FALSE(nkgt::registers::vector_from_string("xmm32"));
+        REQUIRE_FALSE(nkgt::registers::vector_from_string("k8"));
+        REQUIRE_FALSE(nkgt::registers::vector_from_string("xmm"));
+        REQUIRE_FALSE(nkgt::registers::vector_from_string("xmm1a"));
+        REQUIRE_FALSE(nkgt::registers::vector_from_string("rax"));
+    }
+}
+
+TEST_CASE("Vector register values are formatted according to the view", "[registers]") {
+    nkgt::registers::vector_value value = {};
+    value.size = 16;
+
+    const float lanes[4] = {1.5f, -2.0f, 0.0f, 8.0f};
+    std::memcpy(value.bytes.data(), lanes, sizeof(lanes));
+
+    SECTION("Typed views") {
+        REQUIRE(nkgt::registers::format_vector_value(value, "v4_float") == "{1.5, -2, 0, 8}");
+        REQUIRE(nkgt::registers::format_vector_value(value, "v16_uint8")->substr(0, 13) == "{0, 0, 192, 6");
+    }
+
+    SECTION("Views not covering the register exactly are an error") {
+        REQUIRE_FALSE(nkgt::registers::format_vector_value(value, "v8_float"));
+        REQUIRE_FALSE(nkgt::registers::format_vector_value(value, "v4_half"));
+        REQUIRE_FALSE(nkgt::registers::format_vector_value(value, "float"));
+    }
+
+    SECTION("The default view prints 64 bit hex lanes") {
+        REQUIRE(
+            nkgt::registers::format_vector_value(value, "") ==
+            "{0xc00000003fc00000, 0x4100000000000000}"
+        );
+    }
+}
+
+TEST_CASE("Vector registers are read from the legacy region", "[registers]") {
+    using nkgt::registers::vector_kind;
+
+    fake_target debugee;
+    debugee.extended_state = nkgt::target::extended_state{std::vector<std::byte>(512), false};
+    debugee.extended_state->data[160 + 16 * 2] = std::byte{0x2a};
+
+    SECTION("FXSAVE area") {
+        const auto value = nkgt::registers::get_vector_register_value(debugee, {vector_kind::xmm, 2});
+        REQUIRE(value);
+        REQUIRE(value->size == 16);
+        REQUIRE(value->bytes[0] == std::byte{0x2a});
+    }
+
+    SECTION("Truncated area, as found in a crafted core file") {
+        debugee.extended_state->data.resize(100);
+        REQUIRE(
+            nkgt::registers::get_vector_register_value(debugee, {vector_kind::st, 0}).error() ==
+            nkgt::error::registers::unavailable_register
+        );
+        REQUIRE(
+            nkgt::registers::get_vector_register_value(debugee, {vector_kind::xmm, 2}).error() ==
+            nkgt::error::registers::unavailable_register
+        );
+    }
+}